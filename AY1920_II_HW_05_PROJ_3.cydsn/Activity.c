@@ -0,0 +1,166 @@
+/*
+* This file includes the activity/inactivity state machine and the
+* heartbeat frame sent while idle.
+*/
+
+#include "Activity.h"
+#include "Frame.h"
+#include "Timebase.h"
+#include "CyLib.h"
+
+static LIS3DH_Device* activity_device;
+static LIS3DH_ODR active_odr;
+static LIS3DH_Mode active_mode;
+static uint8_t active;
+
+static uint32_t last_motion_ms;
+static uint32_t last_poll_ms;
+static uint32_t last_heartbeat_ms;
+static uint16_t wake_count;
+
+    /*
+    *   Read the latched interrupt source, which also re-arms the generator.
+    */
+    static uint8_t Activity_MotionDetected(void)
+    {
+        uint8_t source;
+        last_poll_ms = Timebase_GetMs();
+        return (LIS3DH_ReadInt1Source(activity_device, &source) == NO_ERROR) &&
+               (source & LIS3DH_INT1_SRC_IA);
+    }
+    
+    /*
+    *   Switch the device between the idle and the active configuration.
+    *   The idle rate is valid in every mode, it is set first on the way
+    *   to idle and last on the way back.
+    */
+    static ErrorCode Activity_SetIdle(uint8_t idle)
+    {
+        ErrorCode error;
+        
+        if (idle)
+        {
+            error = LIS3DH_SetODR(activity_device, ACTIVITY_IDLE_ODR);
+            if (error == NO_ERROR)
+            {
+                error = LIS3DH_SetMode(activity_device, ACTIVITY_IDLE_MODE);
+            }
+            return error;
+        }
+        error = LIS3DH_SetMode(activity_device, active_mode);
+        if (error == NO_ERROR)
+        {
+            error = LIS3DH_SetODR(activity_device, active_odr);
+        }
+        return error;
+    }
+    
+    /*
+    *   Heartbeat payload (little endian): timestamp in ms (32 bit),
+    *   number of wake-ups (16 bit), idle output data rate in Hz (16 bit).
+    */
+    static void Activity_SendHeartbeat(void)
+    {
+        uint8_t payload[8];
+        uint8_t* p = payload;
+        
+        last_heartbeat_ms = Timebase_GetMs();
+        p = Frame_Put32(p, last_heartbeat_ms);
+        p = Frame_Put16(p, wake_count);
+        p = Frame_Put16(p, LIS3DH_GetODRHz(activity_device));
+        Frame_Send(FRAME_HEADER_HEARTBEAT, payload, (uint8_t)(p - payload));
+    }
+
+    ErrorCode Activity_Init(LIS3DH_Device* device)
+    {
+        uint8_t source;
+        ErrorCode error;
+        
+        activity_device = device;
+        active_odr = LIS3DH_GetODR(device);
+        active_mode = LIS3DH_GetMode(device);
+        active = 0;
+        wake_count = 0;
+        
+        error = LIS3DH_ConfigureInt1(device, LIS3DH_INT1_CFG_XYZ_HIGH,
+                                     ACTIVITY_THRESHOLD_MG, ACTIVITY_DURATION, 1);
+        if (error == NO_ERROR)
+        {
+            error = Activity_SetIdle(1);
+        }
+        if (error == NO_ERROR)
+        {
+            // Clear a request latched before the configuration
+            error = LIS3DH_ReadInt1Source(device, &source);
+        }
+        last_poll_ms = Timebase_GetMs();
+        Activity_SendHeartbeat();
+        return error;
+    }
+    
+    uint8_t Activity_IsActive(void)
+    {
+        return active;
+    }
+    
+    uint8_t Activity_Idle(void)
+    {
+        uint32_t elapsed = Timebase_GetMs() - last_poll_ms;
+        if (elapsed < ACTIVITY_POLL_MS)
+        {
+            // Nothing to do until the next poll, keep the bus quiet
+            CyDelay(ACTIVITY_POLL_MS - elapsed);
+        }
+        
+        if (Activity_MotionDetected())
+        {
+            if (Activity_SetIdle(0) == NO_ERROR)
+            {
+                active = 1;
+                wake_count++;
+                last_motion_ms = last_poll_ms;
+                return 1;
+            }
+        }
+        
+        if ((Timebase_GetMs() - last_heartbeat_ms) >= ACTIVITY_HEARTBEAT_MS)
+        {
+            Activity_SendHeartbeat();
+        }
+        return 0;
+    }
+    
+    ErrorCode Activity_Wake(void)
+    {
+        ErrorCode error = Activity_SetIdle(0);
+        if (error == NO_ERROR)
+        {
+            // Not a wake-up on motion, wake_count is left alone
+            active = 1;
+            last_motion_ms = Timebase_GetMs();
+        }
+        return error;
+    }
+    
+    void Activity_Update(void)
+    {
+        if ((Timebase_GetMs() - last_poll_ms) < ACTIVITY_POLL_MS)
+        {
+            return;
+        }
+        
+        if (Activity_MotionDetected())
+        {
+            last_motion_ms = last_poll_ms;
+        }
+        else if ((last_poll_ms - last_motion_ms) >= ACTIVITY_HOLD_MS)
+        {
+            if (Activity_SetIdle(1) == NO_ERROR)
+            {
+                active = 0;
+                Activity_SendHeartbeat();
+            }
+        }
+    }
+
+/* [] END OF FILE */
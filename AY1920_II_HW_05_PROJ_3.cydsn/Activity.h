@@ -0,0 +1,112 @@
+/**
+*   \file Activity.h
+*   \brief Activity-gated streaming based on the LIS3DH interrupt 1 generator.
+*
+*   The interrupt 1 generator detects motion on the high-pass filtered
+*   signal of the three axes. While the device is idle the output data rate
+*   is lowered to ACTIVITY_IDLE_ODR and the device runs in ACTIVITY_IDLE_MODE,
+*   no sample is read and only a heartbeat frame is sent every
+*   ACTIVITY_HEARTBEAT_MS. When motion is detected the previous output data
+*   rate and resolution mode are restored and samples are streamed until no
+*   motion is detected for ACTIVITY_HOLD_MS.
+*/
+
+#ifndef __ACTIVITY_H
+    #define __ACTIVITY_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH.h"
+    
+    /**
+    *   \brief Motion threshold in mg (gravity removed).
+    */
+    #ifndef ACTIVITY_THRESHOLD_MG
+        #define ACTIVITY_THRESHOLD_MG 64
+    #endif
+    
+    /**
+    *   \brief Minimum duration of the motion, in 1/ODR steps.
+    */
+    #ifndef ACTIVITY_DURATION
+        #define ACTIVITY_DURATION 0
+    #endif
+    
+    /**
+    *   \brief Output data rate while idle.
+    */
+    #ifndef ACTIVITY_IDLE_ODR
+        #define ACTIVITY_IDLE_ODR LIS3DH_ODR_10HZ
+    #endif
+    
+    /**
+    *   \brief Resolution mode while idle, only the motion detector runs.
+    */
+    #ifndef ACTIVITY_IDLE_MODE
+        #define ACTIVITY_IDLE_MODE LIS3DH_MODE_LOW_POWER
+    #endif
+    
+    /**
+    *   \brief Time without motion before going idle, in ms.
+    */
+    #ifndef ACTIVITY_HOLD_MS
+        #define ACTIVITY_HOLD_MS 2000u
+    #endif
+    
+    /**
+    *   \brief Period of the heartbeat frames while idle, in ms.
+    */
+    #ifndef ACTIVITY_HEARTBEAT_MS
+        #define ACTIVITY_HEARTBEAT_MS 1000u
+    #endif
+    
+    /**
+    *   \brief Period of the interrupt source polling, in ms.
+    *
+    *   The source is latched, so no event is lost between two polls.
+    */
+    #ifndef ACTIVITY_POLL_MS
+        #define ACTIVITY_POLL_MS 100u
+    #endif
+    
+    /**
+    *   \brief Configure the motion detection and go idle.
+    *
+    *   \param device Device providing the samples, its current output data
+    *   rate and resolution mode are used while active.
+    */
+    ErrorCode Activity_Init(LIS3DH_Device* device);
+    
+    /**
+    *   \brief Return 1 while motion is present.
+    */
+    uint8_t Activity_IsActive(void);
+    
+    /**
+    *   \brief Service the idle state, to be called in place of the acquisition.
+    *
+    *   Waits for the next poll, sends the heartbeat when due and restores
+    *   the output data rate and the resolution mode when motion is detected.
+    *   \retval Returns 1 when the device has become active.
+    */
+    uint8_t Activity_Idle(void);
+    
+    /**
+    *   \brief Restore the active output data rate and resolution mode without
+    *   motion, for the samples of a calibration.
+    *
+    *   Activity_Update() puts the device back to idle once no motion has
+    *   been detected for ACTIVITY_HOLD_MS since the call.
+    */
+    ErrorCode Activity_Wake(void);
+    
+    /**
+    *   \brief Service the active state, to be called for each sample.
+    *
+    *   Lowers the output data rate and the resolution mode when no motion has
+    *   been detected for ACTIVITY_HOLD_MS.
+    */
+    void Activity_Update(void);
+    
+#endif // __ACTIVITY_H
+/* [] END OF FILE */
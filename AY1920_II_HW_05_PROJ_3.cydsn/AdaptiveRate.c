@@ -0,0 +1,269 @@
+/*
+* This file includes the estimation of the signal content and the
+* selection of the output data rate.
+*/
+
+#include "AdaptiveRate.h"
+#include "Filter.h"
+#include "Frame.h"
+#include "Timebase.h"
+
+/**
+*   \brief Shift of the running mean used to remove gravity.
+*/
+#define ADAPTIVE_RATE_DC_SHIFT 5
+
+/**
+*   \brief Step of the rate table.
+*/
+typedef struct {
+    LIS3DH_ODR odr;     ///< Output data rate
+    LIS3DH_Mode mode;   ///< Resolution mode
+    uint16_t hz;        ///< Output data rate in Hz
+} AdaptiveRateLevel;
+
+/*
+*   Rate table, from the slowest to the fastest rate. The top rate uses the
+*   normal mode, whose turn-on time (1/ODR) is shorter than the high
+*   resolution one (7/ODR), to settle quickly on transients. 1 Hz is left
+*   out: a window would last ADAPTIVE_RATE_WINDOW seconds and the signal
+*   that should raise the rate would be aliased. The steps above the
+*   link budget are skipped, see AdaptiveRate_TopLevel().
+*/
+static const AdaptiveRateLevel levels[] = {
+    {LIS3DH_ODR_10HZ, LIS3DH_MODE_HIGH_RES, 10u},
+    {LIS3DH_ODR_25HZ, LIS3DH_MODE_HIGH_RES, 25u},
+    {LIS3DH_ODR_50HZ, LIS3DH_MODE_HIGH_RES, 50u},
+    {LIS3DH_ODR_100HZ, LIS3DH_MODE_HIGH_RES, 100u},
+    {LIS3DH_ODR_200HZ, LIS3DH_MODE_HIGH_RES, 200u},
+    {LIS3DH_ODR_400HZ, LIS3DH_MODE_HIGH_RES, 400u},
+    {LIS3DH_ODR_1344HZ, LIS3DH_MODE_NORMAL, 1344u}
+};
+
+#define ADAPTIVE_RATE_LEVELS (sizeof(levels)/sizeof(levels[0]))
+
+/**
+*   \brief Bytes of the tagged data frame on the wire.
+*/
+#define ADAPTIVE_RATE_FRAME_BYTES (11u + FRAME_OVERHEAD)
+
+static LIS3DH_Device* rate_device;
+static uint8_t level;
+static uint8_t top_level;
+static uint16_t rate_hz;
+
+// Running mean (Q8) and state of the zero crossing detector of each axis
+static int32_t dc_q8[LIS3DH_AXES];
+static int8_t sign[LIS3DH_AXES];
+static uint8_t dc_valid;
+
+// Window accumulators
+static uint64_t energy[LIS3DH_AXES];
+static uint8_t crossings[LIS3DH_AXES];
+static uint16_t window_count;
+static uint8_t quiet_windows;
+static uint8_t shock;
+static uint8_t settle;
+
+// Bandwidth statistics
+static uint16_t sequence;
+static uint32_t samples_sent;
+static uint32_t start_ms;
+
+    /*
+    *   Clear the window accumulators.
+    */
+    static void AdaptiveRate_ResetWindow(void)
+    {
+        uint8_t axis;
+        for (axis = 0; axis < LIS3DH_AXES; axis++)
+        {
+            energy[axis] = 0;
+            crossings[axis] = 0;
+        }
+        window_count = 0;
+        shock = 0;
+    }
+    
+    /*
+    *   Fastest step of the table whose tagged frames fit in
+    *   ADAPTIVE_RATE_LINK_SHARE percent of UART_Debug. The UART has no
+    *   software buffer: a faster rate would stall the main loop on the
+    *   writes and overrun the FIFO of the device.
+    */
+    static uint8_t AdaptiveRate_TopLevel(void)
+    {
+        uint32_t budget = (FRAME_UART_BYTES_PER_S*ADAPTIVE_RATE_LINK_SHARE)/100u;
+        uint8_t top = 0;
+        while ((top < ADAPTIVE_RATE_LEVELS - 1) &&
+               ((uint32_t)levels[top + 1].hz*ADAPTIVE_RATE_FRAME_BYTES <= budget*Filter_GetDecimation()))
+        {
+            top++;
+        }
+        return top;
+    }
+    
+    /*
+    *   Move the device to a step of the table and announce the change.
+    */
+    static uint8_t AdaptiveRate_SetLevel(uint8_t new_level)
+    {
+        ErrorCode error = LIS3DH_SetMode(rate_device, levels[new_level].mode);
+        if (error == NO_ERROR)
+        {
+            error = LIS3DH_SetODR(rate_device, levels[new_level].odr);
+        }
+        if (error != NO_ERROR)
+        {
+            return 0;
+        }
+        level = new_level;
+        rate_hz = LIS3DH_GetODRHz(rate_device);
+        quiet_windows = 0;
+        settle = ADAPTIVE_RATE_SETTLE_SAMPLES;
+        AdaptiveRate_ResetWindow();
+        
+        uint8_t payload[15];
+        uint8_t* p = payload;
+        uint32_t now = Timebase_GetMs();
+        uint32_t top_samples = (uint32_t)(((uint64_t)(now - start_ms)*levels[top_level].hz) /
+                                          (1000u*Filter_GetDecimation()));
+        p = Frame_Put32(p, now);
+        p = Frame_Put16(p, rate_hz);
+        *p++ = levels[new_level].mode;
+        p = Frame_Put32(p, samples_sent);
+        p = Frame_Put32(p, top_samples);
+        Frame_Send(FRAME_HEADER_RATE_CHANGE, payload, (uint8_t)(p - payload));
+        return 1;
+    }
+    
+    ErrorCode AdaptiveRate_Init(LIS3DH_Device* device)
+    {
+        LIS3DH_ODR odr = LIS3DH_GetODR(device);
+        
+        rate_device = device;
+        sequence = 0;
+        samples_sent = 0;
+        start_ms = Timebase_GetMs();
+        dc_valid = 0;
+        top_level = AdaptiveRate_TopLevel();
+        
+        // Start from the table step closest to the configured rate
+        level = 0;
+        while ((level < top_level) && (levels[level].odr < odr))
+        {
+            level++;
+        }
+        return AdaptiveRate_SetLevel(level) ? NO_ERROR : ERROR;
+    }
+    
+    void AdaptiveRate_SendSample(const int16_t* sample_mg)
+    {
+        uint8_t payload[11];
+        uint8_t* p = payload;
+        
+        p = Frame_Put16(p, rate_hz);
+        *p++ = Filter_GetDecimation();
+        p = Frame_Put16(p, sequence++);
+        p = Frame_Put16(p, (uint16_t)sample_mg[0]);
+        p = Frame_Put16(p, (uint16_t)sample_mg[1]);
+        p = Frame_Put16(p, (uint16_t)sample_mg[2]);
+        Frame_Send(FRAME_HEADER_TAGGED_DATA, payload, (uint8_t)(p - payload));
+        samples_sent++;
+    }
+    
+    uint8_t AdaptiveRate_AddSample(const int16_t* sample_mg)
+    {
+        uint8_t axis;
+        
+        // The device and the filter chain restart after a change
+        if (settle > 0)
+        {
+            settle--;
+            dc_valid = 0;
+            return 0;
+        }
+        if (!dc_valid)
+        {
+            // Start the mean from the first sample, not from zero
+            for (axis = 0; axis < LIS3DH_AXES; axis++)
+            {
+                dc_q8[axis] = (int32_t)sample_mg[axis] << 8;
+                sign[axis] = 0;
+            }
+            dc_valid = 1;
+        }
+        
+        for (axis = 0; axis < LIS3DH_AXES; axis++)
+        {
+            int32_t x_q8 = (int32_t)sample_mg[axis] << 8;
+            dc_q8[axis] += (x_q8 - dc_q8[axis]) >> ADAPTIVE_RATE_DC_SHIFT;
+            int32_t ac = (x_q8 - dc_q8[axis]) >> 8;
+        
+            energy[axis] += (uint32_t)(ac*ac);
+            if (ac > ADAPTIVE_RATE_SHOCK_MG || ac < -ADAPTIVE_RATE_SHOCK_MG)
+            {
+                shock = 1;
+            }
+        
+            // Schmitt trigger, crossings inside the dead band are ignored
+            if (ac > ADAPTIVE_RATE_DEADBAND_MG && sign[axis] <= 0)
+            {
+                crossings[axis] += (sign[axis] < 0);
+                sign[axis] = 1;
+            }
+            else if (ac < -ADAPTIVE_RATE_DEADBAND_MG && sign[axis] >= 0)
+            {
+                crossings[axis] += (sign[axis] > 0);
+                sign[axis] = -1;
+            }
+        }
+        
+        if (shock && level < top_level)
+        {
+            return AdaptiveRate_SetLevel(top_level);
+        }
+        if (++window_count < ADAPTIVE_RATE_WINDOW)
+        {
+            return 0;
+        }
+        
+        // Axis with the largest energy drives the frequency estimate
+        uint8_t dominant = 0;
+        for (axis = 1; axis < LIS3DH_AXES; axis++)
+        {
+            if (energy[axis] > energy[dominant])
+            {
+                dominant = axis;
+            }
+        }
+        uint64_t high = (uint64_t)ADAPTIVE_RATE_HIGH_MG*ADAPTIVE_RATE_HIGH_MG*ADAPTIVE_RATE_WINDOW;
+        uint64_t low = (uint64_t)ADAPTIVE_RATE_LOW_MG*ADAPTIVE_RATE_LOW_MG*ADAPTIVE_RATE_WINDOW;
+        // A tone at f gives 2*f/fs*N crossings per window
+        uint16_t up_crossings = (2u*ADAPTIVE_RATE_WINDOW)/ADAPTIVE_RATE_UP_DIVISOR;
+        uint16_t down_crossings = (2u*ADAPTIVE_RATE_WINDOW)/ADAPTIVE_RATE_DOWN_DIVISOR;
+        uint8_t fast = (crossings[dominant] > up_crossings);
+        uint8_t slow = (crossings[dominant] < down_crossings);
+        
+        if ((energy[dominant] > high || fast) && level < top_level)
+        {
+            return AdaptiveRate_SetLevel(level + 1);
+        }
+        
+        if (energy[dominant] < low && slow)
+        {
+            quiet_windows++;
+        }
+        else
+        {
+            quiet_windows = 0;
+        }
+        if (quiet_windows >= ADAPTIVE_RATE_HOLD_WINDOWS && level > 0)
+        {
+            return AdaptiveRate_SetLevel(level - 1);
+        }
+        AdaptiveRate_ResetWindow();
+        return 0;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,139 @@
+/**
+*   \file AdaptiveRate.h
+*   \brief Output data rate controller driven by the signal content.
+*
+*   For each window of ADAPTIVE_RATE_WINDOW samples the controller estimates
+*   the AC energy (gravity removed by a running mean) and the dominant
+*   frequency (zero crossings of the axis with the largest energy, with a
+*   dead band against noise). The device moves one step up the rate table
+*   when the signal is too energetic or too fast for the current rate, jumps
+*   to the top when a single sample exceeds ADAPTIVE_RATE_SHOCK_MG, and moves
+*   one step down after ADAPTIVE_RATE_HOLD_WINDOWS quiet and slow windows.
+*
+*   Each sample is sent in a 15 byte frame tagged with the rate it was
+*   acquired at, so the top rate is the fastest step of the table whose
+*   frames, after the decimation of the filter chain, fit in
+*   ADAPTIVE_RATE_LINK_SHARE percent of FRAME_UART_BYTES_PER_S: at 19200
+*   baud and without decimation that is 100 Hz, 1344 Hz would need about
+*   20 kB/s. Each rate change is announced with the statistics needed by
+*   the host to evaluate the bandwidth saved against the top rate.
+*
+*   Host_Tools/adaptive_rate_sim.c runs this file on synthetic signals and
+*   prints the rates selected and the load of the link.
+*/
+
+#ifndef __ADAPTIVE_RATE_H
+    #define __ADAPTIVE_RATE_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH.h"
+    
+    /**
+    *   \brief Samples of each analysis window.
+    */
+    #ifndef ADAPTIVE_RATE_WINDOW
+        #define ADAPTIVE_RATE_WINDOW 32u
+    #endif
+    
+    /**
+    *   \brief AC RMS above which the rate is raised, in mg.
+    */
+    #ifndef ADAPTIVE_RATE_HIGH_MG
+        #define ADAPTIVE_RATE_HIGH_MG 100
+    #endif
+    
+    /**
+    *   \brief AC RMS below which the rate can be lowered, in mg.
+    */
+    #ifndef ADAPTIVE_RATE_LOW_MG
+        #define ADAPTIVE_RATE_LOW_MG 20
+    #endif
+    
+    /**
+    *   \brief Single sample deviation that selects the top rate, in mg.
+    */
+    #ifndef ADAPTIVE_RATE_SHOCK_MG
+        #define ADAPTIVE_RATE_SHOCK_MG 500
+    #endif
+    
+    /**
+    *   \brief Dead band of the zero crossing detector, in mg.
+    */
+    #ifndef ADAPTIVE_RATE_DEADBAND_MG
+        #define ADAPTIVE_RATE_DEADBAND_MG 8
+    #endif
+    
+    /**
+    *   \brief Rate raised when the dominant frequency exceeds ODR/ADAPTIVE_RATE_UP_DIVISOR.
+    */
+    #ifndef ADAPTIVE_RATE_UP_DIVISOR
+        #define ADAPTIVE_RATE_UP_DIVISOR 8u
+    #endif
+    
+    /**
+    *   \brief Rate lowered when the dominant frequency is below ODR/ADAPTIVE_RATE_DOWN_DIVISOR.
+    */
+    #ifndef ADAPTIVE_RATE_DOWN_DIVISOR
+        #define ADAPTIVE_RATE_DOWN_DIVISOR 32u
+    #endif
+    
+    /**
+    *   \brief Share of UART_Debug the tagged frames can take, in percent.
+    *
+    *   The rest is left to the rate change, telemetry and command frames.
+    */
+    #ifndef ADAPTIVE_RATE_LINK_SHARE
+        #define ADAPTIVE_RATE_LINK_SHARE 80u
+    #endif
+    
+    /**
+    *   \brief Samples ignored after a rate change.
+    *
+    *   The device needs up to 7/ODR to settle in high resolution mode and
+    *   main.c restarts the filter chain from zero, whose step response
+    *   would otherwise look like a shock.
+    */
+    #ifndef ADAPTIVE_RATE_SETTLE_SAMPLES
+        #define ADAPTIVE_RATE_SETTLE_SAMPLES 8u
+    #endif
+    
+    /**
+    *   \brief Consecutive quiet windows needed to lower the rate.
+    */
+    #ifndef ADAPTIVE_RATE_HOLD_WINDOWS
+        #define ADAPTIVE_RATE_HOLD_WINDOWS 4u
+    #endif
+    
+    /**
+    *   \brief Start the controller from the current rate of the device.
+    *
+    *   \param device Device providing the samples.
+    */
+    ErrorCode AdaptiveRate_Init(LIS3DH_Device* device);
+    
+    /**
+    *   \brief Send a sample tagged with the current rate.
+    *
+    *   Payload (little endian): output data rate in Hz (16 bit), decimation
+    *   of the filter chain (8 bit), sequence number (16 bit), X, Y and Z in
+    *   mg (16 bit each).
+    *   \param sample_mg Array of LIS3DH_AXES accelerations in mg.
+    */
+    void AdaptiveRate_SendSample(const int16_t* sample_mg);
+    
+    /**
+    *   \brief Update the estimates and change the rate if needed.
+    *
+    *   On a change the rate change frame is sent. Payload (little endian):
+    *   timestamp in ms (32 bit), new output data rate in Hz (16 bit), new
+    *   resolution mode (8 bit), samples sent since the start (32 bit),
+    *   samples that the top rate would have produced in the same time
+    *   (32 bit).
+    *   \param sample_mg Array of LIS3DH_AXES accelerations in mg.
+    *   \retval Returns 1 when the rate has changed.
+    */
+    uint8_t AdaptiveRate_AddSample(const int16_t* sample_mg);
+    
+#endif // __ADAPTIVE_RATE_H
+/* [] END OF FILE */
@@ -0,0 +1,105 @@
+/*
+* This file includes the scheduling, averaging and transmission of the
+* auxiliary ADC channels.
+*/
+
+#include "AuxAdc.h"
+#include "Frame.h"
+#include "Timebase.h"
+
+/**
+*   \brief Conversions averaged in each frame.
+*/
+#define AUX_ADC_READINGS (1u << (2*AUX_ADC_OVERSAMPLING_BITS))
+
+/**
+*   \brief Resolution of the ADC in bits, lower in low power mode.
+*/
+#define AUX_ADC_BITS 10
+#define AUX_ADC_BITS_LOW_POWER 8
+
+static LIS3DH_Device* adc_device;
+static uint32_t last_frame_ms;
+
+// Accumulators of the conversions of the current frame
+static int32_t sum[LIS3DH_ADC_CHANNELS];
+static uint8_t readings;
+static uint8_t readings_bits;
+
+    ErrorCode AuxAdc_Init(LIS3DH_Device* device)
+    {
+        adc_device = device;
+        readings = 0;
+        // First frame in the first slots after the start
+        last_frame_ms = Timebase_GetMs() - AUX_ADC_PERIOD_MS;
+        return LIS3DH_EnableAdc(device, 1, (AUX_ADC_CHANNELS & AUX_ADC_CHANNEL_TEMPERATURE) != 0);
+    }
+    
+    uint8_t AuxAdc_Service(void)
+    {
+        int16_t raw[LIS3DH_ADC_CHANNELS];
+        uint8_t channel;
+        uint8_t bits = (LIS3DH_GetMode(adc_device) == LIS3DH_MODE_LOW_POWER) ? AUX_ADC_BITS_LOW_POWER : AUX_ADC_BITS;
+        
+        if (readings > 0 && bits != readings_bits)
+        {
+            // The mode changed during the frame (idle state of the activity
+            // stream), the conversions of the previous mode are dropped
+            readings = 0;
+            for (channel = 0; channel < LIS3DH_ADC_CHANNELS; channel++)
+            {
+                sum[channel] = 0;
+            }
+        }
+        else if (readings == 0)
+        {
+            uint32_t now = Timebase_GetMs();
+            if ((now - last_frame_ms) < AUX_ADC_PERIOD_MS)
+            {
+                return 0;
+            }
+            // Keep the period independent of the slot the frame falls in
+            last_frame_ms += AUX_ADC_PERIOD_MS;
+            if ((now - last_frame_ms) >= AUX_ADC_PERIOD_MS)
+            {
+                last_frame_ms = now;
+            }
+            for (channel = 0; channel < LIS3DH_ADC_CHANNELS; channel++)
+            {
+                sum[channel] = 0;
+            }
+        }
+        
+        // One conversion per slot, the ADC is updated at the output data rate
+        if (LIS3DH_ReadAdc(adc_device, raw) != NO_ERROR)
+        {
+            return 0;
+        }
+        readings_bits = bits;
+        for (channel = 0; channel < LIS3DH_ADC_CHANNELS; channel++)
+        {
+            sum[channel] += raw[channel] >> (16 - bits);
+        }
+        if (++readings < AUX_ADC_READINGS)
+        {
+            return 0;
+        }
+        readings = 0;
+        
+        uint8_t payload[2 + 2*LIS3DH_ADC_CHANNELS];
+        uint8_t* p = payload;
+        *p++ = AUX_ADC_CHANNELS;
+        *p++ = bits + AUX_ADC_OVERSAMPLING_BITS;
+        for (channel = 0; channel < LIS3DH_ADC_CHANNELS; channel++)
+        {
+            if (AUX_ADC_CHANNELS & (1u << channel))
+            {
+                // Sum of 4^n conversions scaled to n extra bits
+                p = Frame_Put16(p, (uint16_t)(sum[channel] >> AUX_ADC_OVERSAMPLING_BITS));
+            }
+        }
+        Frame_Send(FRAME_HEADER_AUX_ADC, payload, (uint8_t)(p - payload));
+        return 1;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,87 @@
+/**
+*   \file AuxAdc.h
+*   \brief Slow auxiliary ADC channels interleaved with the acceleration stream.
+*
+*   The three auxiliary ADC channels of the LIS3DH (ADC1, ADC2 and ADC3,
+*   the latter connected to the temperature sensor) are read together with
+*   one auto-increment burst of OUT_ADC1_L..OUT_ADC3_H, so that with block
+*   data update the low and high bytes always come from the same
+*   conversion.
+*
+*   Every AUX_ADC_PERIOD_MS 4^AUX_ADC_OVERSAMPLING_BITS consecutive
+*   conversions are averaged, adding AUX_ADC_OVERSAMPLING_BITS bits of
+*   resolution at the same frame rate. The ADC gives 10 bits, 8 bits in low
+*   power mode (as in the idle state of the activity stream): the
+*   resolution of each frame follows the mode of its conversions.
+*
+*   Each conversion is read in the bus slot that follows an acceleration
+*   sample, so that the slow channels never delay the next acceleration
+*   reading. On the I2C bus at 100 kbit/s the burst read of the six ADC
+*   registers takes 84 bit times, about 1 ms, and the data ready poll and
+*   the acceleration read about 1.3 ms: at 400 Hz the three fit in the
+*   2.5 ms slot, at 1.344 kHz and above the slot is shorter than the
+*   acceleration read alone.
+*/
+
+#ifndef __AUX_ADC_H
+    #define __AUX_ADC_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH.h"
+    
+    /**
+    *   \brief ADC1 input pin.
+    */
+    #define AUX_ADC_CHANNEL_1 0x01
+    
+    /**
+    *   \brief ADC2 input pin.
+    */
+    #define AUX_ADC_CHANNEL_2 0x02
+    
+    /**
+    *   \brief Temperature sensor on ADC3.
+    */
+    #define AUX_ADC_CHANNEL_TEMPERATURE 0x04
+    
+    /**
+    *   \brief Channels sent, OR of AUX_ADC_CHANNEL_x.
+    */
+    #ifndef AUX_ADC_CHANNELS
+        #define AUX_ADC_CHANNELS AUX_ADC_CHANNEL_TEMPERATURE
+    #endif
+    
+    /**
+    *   \brief Period of the auxiliary frames in ms.
+    */
+    #ifndef AUX_ADC_PERIOD_MS
+        #define AUX_ADC_PERIOD_MS 1000u
+    #endif
+    
+    /**
+    *   \brief Extra bits of resolution obtained by averaging, at most 3.
+    */
+    #ifndef AUX_ADC_OVERSAMPLING_BITS
+        #define AUX_ADC_OVERSAMPLING_BITS 1
+    #endif
+    
+    /**
+    *   \brief Enable the ADC and, if selected, the temperature sensor.
+    */
+    ErrorCode AuxAdc_Init(LIS3DH_Device* device);
+    
+    /**
+    *   \brief Use the bus slot after an acceleration sample.
+    *
+    *   When the period has elapsed the conversions are read in the next
+    *   slots and averaged, then sent in a frame whose payload (little
+    *   endian) is the channel mask (8 bit), the resolution in bits of the
+    *   averaged values (8 bit, from the mode of the device) and, for each selected channel from ADC1 to ADC3, the averaged
+    *   value right-justified (16 bit).
+    *   \retval Returns 1 when a frame has been sent.
+    */
+    uint8_t AuxAdc_Service(void);
+    
+#endif // __AUX_ADC_H
+/* [] END OF FILE */
@@ -0,0 +1,37 @@
+/**
+*   \file BusStats.h
+*   \brief Traffic and error counters kept by the sensor bus interfaces.
+*
+*   Both the I2C and the SPI interface count the transactions, the bits
+*   clocked on the bus and the failed transactions by cause, so that the
+*   load of the bus can be estimated whatever the transport is. The counters
+*   are free running: readers take the difference between two readings.
+*/
+
+#ifndef __BUS_STATS_H
+    #define __BUS_STATS_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Causes of a failed bus transaction.
+    */
+    typedef enum {
+        BUS_ERROR_NAK,              ///< Address or data not acknowledged
+        BUS_ERROR_ARBITRATION,      ///< Arbitration lost
+        BUS_ERROR_NOT_READY,        ///< Bus busy or master not ready
+        BUS_ERROR_OTHER,            ///< Any other failure
+        BUS_ERROR_TYPES
+    } BusError;
+    
+    /**
+    *   \brief Counters of a sensor bus.
+    */
+    typedef struct {
+        uint32_t transactions;              ///< Transactions started
+        uint32_t bits;                      ///< Bit times used on the bus
+        uint16_t errors[BUS_ERROR_TYPES];   ///< Failed transactions by cause
+    } BusStats;
+
+#endif // __BUS_STATS_H
+/* [] END OF FILE */
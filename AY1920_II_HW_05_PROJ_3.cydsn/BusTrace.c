@@ -0,0 +1,144 @@
+/*
+* This file includes the ring of the sensor bus transactions and the
+* trace frames.
+*/
+
+#include "BusTrace.h"
+
+#if (BUS_TRACE_ENABLE)
+
+#include "Frame.h"
+#if defined(PROFILE_HOST)
+    #include <time.h>
+#endif
+
+/**
+*   \brief Transaction of the ring.
+*/
+typedef struct {
+    uint32_t start;             ///< Counter when the transaction went on the bus
+    uint32_t end;               ///< Counter at its end
+    uint8_t device_address;     ///< Bus address of the device
+    uint8_t register_address;   ///< Address of the first register
+    uint8_t register_count;     ///< Registers read or written
+    uint8_t flags;              ///< Direction, class and result
+} BusTraceEntry;
+
+#define BUS_TRACE_FLAG_WRITE 0x80
+#define BUS_TRACE_CLASS_SHIFT 4
+#define BUS_TRACE_RESULT_MASK 0x0F
+
+uint32_t bus_trace_start;
+
+static BusTraceEntry ring[BUS_TRACE_DEPTH];
+
+// Transactions recorded since start, the next one goes in ring[recorded % depth]
+static volatile uint32_t recorded;
+// Entries of the ring older than the last clear
+static uint32_t cleared;
+
+// Set while the ring is being sent, the transactions are then only counted
+// (since start, the gaps between two dumps)
+static volatile uint8_t frozen;
+static volatile uint16_t missed;
+
+#if defined(PROFILE_HOST)
+    uint32_t BusTrace_HostNow(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint32_t)((uint64_t)ts.tv_sec*1000000000u + (uint64_t)ts.tv_nsec);
+    }
+#endif
+
+    void BusTrace_Start(void)
+    {
+    #if !defined(PROFILE_HOST)
+        // Running already if the profiling has started it, the value is kept
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    #endif
+        recorded = 0;
+        cleared = 0;
+        frozen = 0;
+        missed = 0;
+    }
+    
+    void BusTrace_Record(uint8_t device_address, uint8_t register_address,
+                         uint8_t register_count, uint8_t write,
+                         BusClass bus_class, uint8_t result)
+    {
+        uint32_t now = BUS_TRACE_NOW();
+        BusTraceEntry* entry;
+        
+        if (frozen)
+        {
+            if (missed < 0xFFFF)
+            {
+                missed++;
+            }
+            return;
+        }
+        entry = &ring[recorded & (BUS_TRACE_DEPTH - 1)];
+        entry->start = bus_trace_start;
+        entry->end = now;
+        entry->device_address = device_address;
+        entry->register_address = register_address;
+        entry->register_count = register_count;
+        entry->flags = (write ? BUS_TRACE_FLAG_WRITE : 0) |
+                       (uint8_t)(bus_class << BUS_TRACE_CLASS_SHIFT) |
+                       (result & BUS_TRACE_RESULT_MASK);
+        recorded++;
+    }
+    
+    void BusTrace_Dump(uint8_t clear)
+    {
+        uint8_t payload[4 + BUS_TRACE_FRAME_ENTRIES*BUS_TRACE_ENTRY_SIZE];
+        uint8_t* p;
+        uint32_t first;
+        uint32_t index;
+        uint16_t count;
+        
+        // The interface records from its interrupt
+        uint8 interrupts = CyEnterCriticalSection();
+        frozen = 1;
+        CyExitCriticalSection(interrupts);
+        
+        first = recorded - cleared > BUS_TRACE_DEPTH ? recorded - BUS_TRACE_DEPTH : cleared;
+        count = (uint16_t)(recorded - first);
+        
+        p = Frame_Put32(payload, BUS_TRACE_CLOCK_HZ);
+        p = Frame_Put32(p, recorded);
+        p = Frame_Put16(p, count);
+        p = Frame_Put16(p, missed);
+        Frame_Send(FRAME_HEADER_TRACE_INFO, payload, (uint8_t)(p - payload));
+        
+        for (index = first; index != recorded; )
+        {
+            p = Frame_Put32(payload, index);
+            do
+            {
+                const BusTraceEntry* entry = &ring[index & (BUS_TRACE_DEPTH - 1)];
+                p = Frame_Put32(p, entry->start);
+                p = Frame_Put32(p, entry->end);
+                *p++ = entry->device_address;
+                *p++ = entry->register_address;
+                *p++ = entry->register_count;
+                *p++ = entry->flags;
+                index++;
+            } while (index != recorded && (uint8_t)(p - payload) + BUS_TRACE_ENTRY_SIZE <= sizeof(payload));
+            Frame_Send(FRAME_HEADER_TRACE_ENTRIES, payload, (uint8_t)(p - payload));
+        }
+        
+        interrupts = CyEnterCriticalSection();
+        if (clear)
+        {
+            cleared = recorded;
+        }
+        frozen = 0;
+        CyExitCriticalSection(interrupts);
+    }
+
+#endif
+
+/* [] END OF FILE */
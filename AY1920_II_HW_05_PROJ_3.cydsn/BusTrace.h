@@ -0,0 +1,123 @@
+/**
+*   \file BusTrace.h
+*   \brief Trace of the sensor bus transactions kept in a RAM ring.
+*
+*   Every transaction run by the sensor bus interface is recorded with its
+*   device and register address, the number of registers, its direction and
+*   priority class, the counter values when it went on the bus and when it
+*   ended, and its result. The ring keeps the last BUS_TRACE_DEPTH
+*   transactions and is sent on request, so that the timing of the bus can
+*   be looked at after a throughput drop without a logic analyzer
+*   (Host_Tools/bus_trace.c turns it into a timeline and a latency
+*   histogram per register).
+*
+*   With BUS_TRACE_ENABLE set to 0 (default) the macros expand to nothing,
+*   their arguments are not evaluated and no RAM is used. The counter is the
+*   DWT cycle counter of the Cortex-M3, or the monotonic clock of the host in
+*   ns with PROFILE_HOST, as in Profile.h.
+*
+*   Information frame payload (little endian): counter clock in Hz (32 bit),
+*   transactions recorded since start (32 bit), entries in the ring (16 bit),
+*   transactions not recorded since start because the ring was being sent
+*   (16 bit, saturated).
+*   Entries frame payload: number of the first entry since start (32 bit),
+*   then up to BUS_TRACE_FRAME_ENTRIES entries from the oldest, each made of
+*   start and end count (32 bit each), device address, register address and
+*   number of registers (8 bit each), flags (8 bit: bit 7 write, bits 5-4
+*   class, bits 3-0 result).
+*/
+
+#ifndef __BUS_TRACE_H
+    #define __BUS_TRACE_H
+    
+    #include "cytypes.h"
+    #include "BusStats.h"
+    #include "BusTransaction.h"
+    #include "ErrorCodes.h"
+    
+    /**
+    *   \brief Compile the trace.
+    */
+    #ifndef BUS_TRACE_ENABLE
+        #define BUS_TRACE_ENABLE 0
+    #endif
+    
+    /**
+    *   \brief Entries of the ring, power of 2.
+    */
+    #ifndef BUS_TRACE_DEPTH
+        #define BUS_TRACE_DEPTH 128u
+    #endif
+    
+    /**
+    *   \brief Result of a transaction ended without error, otherwise the
+    *   result is BUS_TRACE_FAILED() of its BusError cause.
+    */
+    #define BUS_TRACE_OK 0
+    #define BUS_TRACE_FAILED(cause) (1 + (cause))
+    
+    /**
+    *   \brief Bytes of an entry in the entries frame.
+    */
+    #define BUS_TRACE_ENTRY_SIZE 12u
+    
+    /**
+    *   \brief Entries of an entries frame.
+    */
+    #define BUS_TRACE_FRAME_ENTRIES 20u
+    
+    #if (BUS_TRACE_ENABLE)
+        #if defined(PROFILE_HOST)
+            /**
+            *   \brief Monotonic clock of the host, in ns.
+            */
+            uint32_t BusTrace_HostNow(void);
+            #define BUS_TRACE_NOW() BusTrace_HostNow()
+            #define BUS_TRACE_CLOCK_HZ 1000000000u
+        #else
+            #include "CyLib.h"
+            #define BUS_TRACE_NOW() (DWT->CYCCNT)
+            #define BUS_TRACE_CLOCK_HZ BCLK__BUS_CLK__HZ
+        #endif
+        
+        /**
+        *   \brief Counter value when the transaction on the bus started.
+        */
+        extern uint32_t bus_trace_start;
+        
+        /**
+        *   \brief Start the cycle counter and clear the ring.
+        */
+        void BusTrace_Start(void);
+        
+        /**
+        *   \brief Record the transaction on the bus, from bus_trace_start to now.
+        *
+        *   Called at the end of the transaction, from the interrupt or with
+        *   the interrupts disabled.
+        */
+        void BusTrace_Record(uint8_t device_address, uint8_t register_address,
+                             uint8_t register_count, uint8_t write,
+                             BusClass bus_class, uint8_t result);
+        
+        /**
+        *   \brief Send the information frame and the entries, from the oldest.
+        *
+        *   The transactions ended while the entries are sent are counted, not
+        *   recorded, so that the ring is not overwritten under the dump.
+        *   \param clear Clear the ring after the dump.
+        */
+        void BusTrace_Dump(uint8_t clear);
+        
+        #define BUS_TRACE_START() BusTrace_Start()
+        #define BUS_TRACE_BEGIN() (bus_trace_start = BUS_TRACE_NOW())
+        #define BUS_TRACE_END(device_address, register_address, register_count, write, bus_class, result) \
+            BusTrace_Record((device_address), (register_address), (register_count), (write), (bus_class), (result))
+    #else
+        #define BUS_TRACE_START()
+        #define BUS_TRACE_BEGIN()
+        #define BUS_TRACE_END(device_address, register_address, register_count, write, bus_class, result)
+    #endif
+
+#endif // __BUS_TRACE_H
+/* [] END OF FILE */
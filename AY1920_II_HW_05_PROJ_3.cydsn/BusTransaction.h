@@ -0,0 +1,112 @@
+/**
+*   \file BusTransaction.h
+*   \brief Transactions queued on the sensor bus.
+*
+*   Every transaction on the sensor bus is described by a BusTransaction
+*   owned by the caller and executed by the interface in order of priority
+*   class: the sample reads go before the configuration writes, which go
+*   before the diagnostic reads, so that a slow diagnostic never delays a
+*   FIFO drain by more than the transaction already on the bus. A queued
+*   transaction passed over by higher classes BUS_MAX_BYPASS times goes
+*   next whatever its class, which bounds its wait even while the sample
+*   reads keep the bus busy.
+*
+*   The latency of each transaction, from its submission to its end, is
+*   checked against the deadline of its class. The per-class counters are
+*   free running like the ones of BusStats.h.
+*/
+
+#ifndef __BUS_TRANSACTION_H
+    #define __BUS_TRANSACTION_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    
+    /**
+    *   \brief Times a queued transaction can be passed over by higher classes.
+    */
+    #ifndef BUS_MAX_BYPASS
+        #define BUS_MAX_BYPASS 4
+    #endif
+    
+    /**
+    *   \brief Deadline of the sample reads in ms.
+    *
+    *   At 100 kbit/s a sample read (0.84 ms) can wait for the transaction
+    *   on the bus and for a configuration write and a diagnostic read both
+    *   passed over BUS_MAX_BYPASS times: 2.24 ms in Host_Tools/bus_queue_test.c.
+    *   The latency is counted in whole ms of Timebase_GetMs().
+    */
+    #ifndef BUS_DEADLINE_SAMPLE_MS
+        #define BUS_DEADLINE_SAMPLE_MS 3u
+    #endif
+    
+    /**
+    *   \brief Deadline of the configuration transactions in ms.
+    */
+    #ifndef BUS_DEADLINE_CONFIG_MS
+        #define BUS_DEADLINE_CONFIG_MS 20u
+    #endif
+    
+    /**
+    *   \brief Deadline of the diagnostic reads in ms.
+    */
+    #ifndef BUS_DEADLINE_DIAGNOSTIC_MS
+        #define BUS_DEADLINE_DIAGNOSTIC_MS 100u
+    #endif
+    
+    /**
+    *   \brief Priority classes, from the highest.
+    */
+    typedef enum {
+        BUS_CLASS_SAMPLE,           ///< Sample reads and FIFO drains
+        BUS_CLASS_CONFIG,           ///< Configuration writes and read-back
+        BUS_CLASS_DIAGNOSTIC,       ///< Identification, interrupt source and auxiliary ADC
+        BUS_CLASSES
+    } BusClass;
+    
+    /**
+    *   \brief State of a transaction.
+    */
+    #define BUS_TRANSACTION_IDLE 0      ///< Never submitted
+    #define BUS_TRANSACTION_QUEUED 1    ///< Waiting for the bus
+    #define BUS_TRANSACTION_ACTIVE 2    ///< On the bus
+    #define BUS_TRANSACTION_DONE 3      ///< Over, error is valid
+    
+    typedef struct BusTransaction BusTransaction;
+    
+    /**
+    *   \brief Function called from the interrupt at the end of a transaction.
+    *
+    *   It may submit another transaction, e.g. the read that follows a poll.
+    */
+    typedef void (*BusTransactionDone)(BusTransaction* transaction);
+    
+    /**
+    *   \brief Description of a transaction, must stay valid until it is over.
+    */
+    struct BusTransaction {
+        uint8_t device_address;         ///< Bus address of the device
+        uint8_t register_address;       ///< Address of the first register
+        uint8_t register_count;         ///< Registers read or written
+        uint8_t write;                  ///< 1 to write the registers, 0 to read them
+        uint8_t* data;                  ///< Registers read or to be written
+        BusClass bus_class;             ///< Priority class
+        BusTransactionDone done;        ///< Called at the end, NULL if not needed
+        volatile uint8_t state;         ///< BUS_TRANSACTION_* state
+        ErrorCode error;                ///< Result, valid when done
+        uint8_t bypassed;               ///< Times passed over by higher classes
+        uint32_t submitted_ms;          ///< Time of submission
+    };
+    
+    /**
+    *   \brief Counters of a priority class.
+    */
+    typedef struct {
+        uint32_t transactions;          ///< Transactions over
+        uint16_t worst_ms;              ///< Worst latency, submission to end
+        uint16_t missed;                ///< Transactions over the deadline
+    } BusClassStats;
+
+#endif // __BUS_TRANSACTION_H
+/* [] END OF FILE */
@@ -0,0 +1,22 @@
+/*
+* This file includes the bitwise implementation of the CRC-16,
+* which is small enough to avoid a lookup table in flash.
+*/
+
+#include "CRC.h"
+
+    uint16_t CRC16_Update(uint16_t crc, const uint8_t* data, uint16_t length)
+    {
+        while (length--)
+        {
+            crc ^= (uint16_t)(*data++) << 8;
+            uint8_t bit;
+            for (bit = 0; bit < 8; bit++)
+            {
+                crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+            }
+        }
+        return crc;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,29 @@
+/**
+*   \file CRC.h
+*   \brief CRC-16/CCITT-FALSE checksum.
+*
+*   Used to validate data kept in the emulated EEPROM.
+*/
+
+#ifndef __CRC_H
+    #define __CRC_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Initial value of the CRC.
+    */
+    #define CRC16_INIT 0xFFFF
+    
+    /**
+    *   \brief Update a CRC-16 (polynomial 0x1021) with a block of data.
+    *
+    *   \param crc Current value of the CRC, CRC16_INIT for a new computation.
+    *   \param data Pointer to the data.
+    *   \param length Number of bytes.
+    *   \retval Updated CRC.
+    */
+    uint16_t CRC16_Update(uint16_t crc, const uint8_t* data, uint16_t length);
+    
+#endif // __CRC_H
+/* [] END OF FILE */
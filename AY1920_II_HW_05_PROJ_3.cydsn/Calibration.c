@@ -0,0 +1,294 @@
+/*
+* This file includes the calibration procedures and the storage of
+* the coefficients in the emulated EEPROM.
+*/
+
+#include "Calibration.h"
+#include "CRC.h"
+#include "cy_em_eeprom.h"
+
+/**
+*   \brief Identifier of a valid calibration record.
+*/
+#define CALIBRATION_MAGIC 0xCA1B
+
+/**
+*   \brief Gain equal to 1 in Q2.14.
+*/
+#define CALIBRATION_UNITY_GAIN (1u << CALIBRATION_GAIN_SHIFT)
+
+/**
+*   \brief Gravity in mg.
+*/
+#define CALIBRATION_ONE_G_MG 1000
+
+/**
+*   \brief Bitmask of the Z axis pointing up.
+*/
+#define CALIBRATION_Z_UP_MASK (1u << 4)
+
+/**
+*   \brief Bitmask of all the six positions.
+*/
+#define CALIBRATION_ALL_MASK 0x3F
+
+/**
+*   \brief Record stored in the emulated EEPROM.
+*/
+typedef struct {
+    uint16_t magic;
+    CalibrationCoeffs coeffs;
+    uint16_t crc;
+} CalibrationRecord;
+
+/**
+*   \brief Logical size of the emulated EEPROM.
+*/
+#define CALIBRATION_EEPROM_SIZE sizeof(CalibrationRecord)
+
+// Flash area of the emulated EEPROM, aligned to a flash row
+CY_ALIGN(CY_FLASH_SIZEOF_ROW)
+static const uint8_t calibration_flash[CY_EM_EEPROM_GET_PHYSICAL_SIZE(CALIBRATION_EEPROM_SIZE, 1u, 0u)] = {0u};
+
+static cy_stc_eeprom_context_t eeprom_context;
+static uint8_t eeprom_ready;
+
+static CalibrationCoeffs coeffs;
+
+// State of the running procedure
+static CalibrationProcedure procedure;
+static uint8_t positions_done;
+static int16_t position_mean[2*CALIBRATION_AXES];
+static int32_t sum[CALIBRATION_AXES];
+static int16_t min[CALIBRATION_AXES];
+static int16_t max[CALIBRATION_AXES];
+static uint8_t sample_count;
+static ErrorCode save_result = NO_ERROR;
+
+    /*
+    *   Load nominal coefficients: no offset, unity gain.
+    */
+    static void Calibration_SetNominal(void)
+    {
+        uint8_t axis;
+        for (axis = 0; axis < CALIBRATION_AXES; axis++)
+        {
+            coeffs.offset_mg[axis] = 0;
+            coeffs.gain[axis] = CALIBRATION_UNITY_GAIN;
+        }
+    }
+    
+    /*
+    *   Compute the coefficients from the acquired positions.
+    */
+    static void Calibration_Compute(void)
+    {
+        uint8_t axis;
+        if (procedure == CALIBRATION_SIX_POSITION)
+        {
+            for (axis = 0; axis < CALIBRATION_AXES; axis++)
+            {
+                int32_t up = position_mean[2*axis];
+                int32_t down = position_mean[2*axis + 1];
+                coeffs.offset_mg[axis] = (int16_t)((up + down) / 2);
+                // up - down is 2 g on an ideal sensor
+                coeffs.gain[axis] = (uint16_t)(((int32_t)2*CALIBRATION_ONE_G_MG << CALIBRATION_GAIN_SHIFT) / (up - down));
+            }
+        }
+        else
+        {
+            // Z up: X and Y read 0 g and Z reads 1 g, gains are not observable
+            Calibration_SetNominal();
+            for (axis = 0; axis < CALIBRATION_AXES; axis++)
+            {
+                coeffs.offset_mg[axis] = position_mean[2*axis];
+            }
+            coeffs.offset_mg[2] -= CALIBRATION_ONE_G_MG;
+        }
+    }
+    
+    /*
+    *   Restart the accumulation of a position.
+    */
+    static void Calibration_ResetWindow(void)
+    {
+        uint8_t axis;
+        for (axis = 0; axis < CALIBRATION_AXES; axis++)
+        {
+            sum[axis] = 0;
+            min[axis] = INT16_MAX;
+            max[axis] = INT16_MIN;
+        }
+        sample_count = 0;
+    }
+    
+    ErrorCode Calibration_Init(void)
+    {
+        cy_stc_eeprom_config_t config;
+        CalibrationRecord record;
+        
+        Calibration_SetNominal();
+        procedure = CALIBRATION_NONE;
+        
+        config.eepromSize = CALIBRATION_EEPROM_SIZE;
+        config.wearLevelingFactor = 1u;
+        config.redundantCopy = 0u;
+        config.blockingWrite = 1u;
+        config.userFlashStartAddr = (uint32_t)calibration_flash;
+        
+        eeprom_ready = (Cy_Em_EEPROM_Init(&config, &eeprom_context) == CY_EM_EEPROM_SUCCESS);
+        if (!eeprom_ready)
+        {
+            return ERROR;
+        }
+        if (Cy_Em_EEPROM_Read(0u, &record, sizeof(record), &eeprom_context) != CY_EM_EEPROM_SUCCESS)
+        {
+            return ERROR;
+        }
+        if (record.magic != CALIBRATION_MAGIC ||
+            record.crc != CRC16_Update(CRC16_INIT, (const uint8_t*)&record.coeffs, sizeof(record.coeffs)))
+        {
+            return ERROR;
+        }
+        coeffs = record.coeffs;
+        return NO_ERROR;
+    }
+    
+    void Calibration_Start(CalibrationProcedure new_procedure)
+    {
+        procedure = new_procedure;
+        positions_done = 0;
+        save_result = NO_ERROR;
+        Calibration_ResetWindow();
+    }
+    
+    uint8_t Calibration_IsRunning(void)
+    {
+        return (procedure != CALIBRATION_NONE);
+    }
+    
+    uint8_t Calibration_AddSample(const int16_t* sample_mg)
+    {
+        uint8_t axis;
+        
+        if (procedure == CALIBRATION_NONE)
+        {
+            return positions_done;
+        }
+        
+        for (axis = 0; axis < CALIBRATION_AXES; axis++)
+        {
+            sum[axis] += sample_mg[axis];
+            if (sample_mg[axis] < min[axis]) min[axis] = sample_mg[axis];
+            if (sample_mg[axis] > max[axis]) max[axis] = sample_mg[axis];
+        }
+        if (++sample_count < CALIBRATION_SAMPLES)
+        {
+            return positions_done;
+        }
+        
+        // The board must be still during the whole window
+        uint8_t still = 1;
+        int16_t mean[CALIBRATION_AXES];
+        for (axis = 0; axis < CALIBRATION_AXES; axis++)
+        {
+            mean[axis] = (int16_t)(sum[axis] / CALIBRATION_SAMPLES);
+            if (max[axis] - min[axis] > CALIBRATION_STILL_MG)
+            {
+                still = 0;
+            }
+        }
+        Calibration_ResetWindow();
+        if (!still)
+        {
+            return positions_done;
+        }
+        
+        // Find the axis aligned with gravity
+        for (axis = 0; axis < CALIBRATION_AXES; axis++)
+        {
+            if (mean[axis] >= CALIBRATION_VERTICAL_MG || mean[axis] <= -CALIBRATION_VERTICAL_MG)
+            {
+                break;
+            }
+        }
+        if (axis == CALIBRATION_AXES)
+        {
+            return positions_done;
+        }
+        uint8_t position = 2*axis + (mean[axis] < 0);
+        
+        if (procedure == CALIBRATION_STATIC_LEVEL)
+        {
+            if ((1u << position) != CALIBRATION_Z_UP_MASK)
+            {
+                return positions_done;
+            }
+            // Keep the whole vector, offsets of X and Y are needed too
+            for (axis = 0; axis < CALIBRATION_AXES; axis++)
+            {
+                position_mean[2*axis] = mean[axis];
+            }
+            positions_done = CALIBRATION_Z_UP_MASK;
+        }
+        else
+        {
+            position_mean[position] = mean[axis];
+            positions_done |= (1u << position);
+            if (positions_done != CALIBRATION_ALL_MASK)
+            {
+                return positions_done;
+            }
+        }
+        
+        Calibration_Compute();
+        save_result = Calibration_Save();
+        procedure = CALIBRATION_NONE;
+        return positions_done;
+    }
+    
+    void Calibration_Apply(int16_t* sample_mg)
+    {
+        uint8_t axis;
+        for (axis = 0; axis < CALIBRATION_AXES; axis++)
+        {
+            int32_t value = ((int32_t)(sample_mg[axis] - coeffs.offset_mg[axis]) * coeffs.gain[axis]
+                             + (1 << (CALIBRATION_GAIN_SHIFT - 1))) >> CALIBRATION_GAIN_SHIFT;
+            if (value > INT16_MAX)
+            {
+                value = INT16_MAX;
+            }
+            else if (value < INT16_MIN)
+            {
+                value = INT16_MIN;
+            }
+            sample_mg[axis] = (int16_t)value;
+        }
+    }
+    
+    ErrorCode Calibration_GetSaveResult(void)
+    {
+        return save_result;
+    }
+    
+    const CalibrationCoeffs* Calibration_GetCoeffs(void)
+    {
+        return &coeffs;
+    }
+    
+    ErrorCode Calibration_Save(void)
+    {
+        CalibrationRecord record;
+        record.magic = CALIBRATION_MAGIC;
+        record.coeffs = coeffs;
+        record.crc = CRC16_Update(CRC16_INIT, (const uint8_t*)&record.coeffs, sizeof(record.coeffs));
+        
+        if (!eeprom_ready ||
+            Cy_Em_EEPROM_Write(0u, &record, sizeof(record), &eeprom_context) != CY_EM_EEPROM_SUCCESS)
+        {
+            return ERROR;
+        }
+        return NO_ERROR;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,132 @@
+/**
+*   \file Calibration.h
+*   \brief Per-axis offset and gain calibration of the accelerometer.
+*
+*   Coefficients are computed on-device by one of two procedures:
+*   - static level: the board lies flat with Z pointing up, only the
+*     offsets are estimated;
+*   - six-position tumble: the board is placed still with each axis
+*     pointing up and down, offsets and gains are estimated.
+*
+*   Coefficients are kept in the emulated EEPROM together with a CRC and are
+*   applied in fixed point to the samples in mg, so that the host receives
+*   calibrated data.
+*
+*   The procedures are fed with the samples of the acquisition loop: run them
+*   with the DC-removal filter disabled.
+*/
+
+#ifndef __CALIBRATION_H
+    #define __CALIBRATION_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    
+    /**
+    *   \brief Number of axes calibrated.
+    */
+    #define CALIBRATION_AXES 3
+    
+    /**
+    *   \brief Fractional bits of the gains.
+    */
+    #define CALIBRATION_GAIN_SHIFT 14
+    
+    /**
+    *   \brief Samples averaged for each position.
+    */
+    #ifndef CALIBRATION_SAMPLES
+        #define CALIBRATION_SAMPLES 64
+    #endif
+    
+    /**
+    *   \brief Maximum peak-to-peak value in mg for a position to be still.
+    */
+    #ifndef CALIBRATION_STILL_MG
+        #define CALIBRATION_STILL_MG 50
+    #endif
+    
+    /**
+    *   \brief Minimum value in mg on the vertical axis to accept a position.
+    */
+    #ifndef CALIBRATION_VERTICAL_MG
+        #define CALIBRATION_VERTICAL_MG 800
+    #endif
+    
+    /**
+    *   \brief Calibration procedures.
+    */
+    typedef enum {
+        CALIBRATION_NONE,           ///< No procedure running
+        CALIBRATION_STATIC_LEVEL,   ///< Offsets only, Z axis up
+        CALIBRATION_SIX_POSITION    ///< Offsets and gains, each axis up and down
+    } CalibrationProcedure;
+    
+    /**
+    *   \brief Calibration coefficients.
+    */
+    typedef struct {
+        int16_t offset_mg[CALIBRATION_AXES];    ///< Offsets in mg
+        uint16_t gain[CALIBRATION_AXES];        ///< Gains, Q2.14
+    } CalibrationCoeffs;
+    
+    /**
+    *   \brief Load the coefficients from the emulated EEPROM.
+    *
+    *   Nominal coefficients are used if no valid record is found.
+    *   \retval NO_ERROR if a valid record has been loaded.
+    */
+    ErrorCode Calibration_Init(void);
+    
+    /**
+    *   \brief Start a calibration procedure.
+    */
+    void Calibration_Start(CalibrationProcedure procedure);
+    
+    /**
+    *   \brief Check if a procedure is running.
+    */
+    uint8_t Calibration_IsRunning(void);
+    
+    /**
+    *   \brief Feed a sample to the running procedure.
+    *
+    *   When the last position has been acquired the coefficients are computed,
+    *   applied and saved in the emulated EEPROM, see
+    *   Calibration_GetSaveResult().
+    *   \param sample_mg Array of CALIBRATION_AXES raw accelerations in mg.
+    *   \retval Bitmask of the positions acquired so far
+    *   (bit 2*axis for axis up, bit 2*axis+1 for axis down).
+    */
+    uint8_t Calibration_AddSample(const int16_t* sample_mg);
+    
+    /**
+    *   \brief Apply the coefficients to a sample, in place.
+    *
+    *   \param sample_mg Array of CALIBRATION_AXES accelerations in mg.
+    */
+    void Calibration_Apply(int16_t* sample_mg);
+    
+    /**
+    *   \brief Result of the save at the end of the last procedure.
+    *
+    *   \retval Returns ERROR if the coefficients of the last completed
+    *   procedure are applied but not stored, and are lost at the next start.
+    */
+    ErrorCode Calibration_GetSaveResult(void);
+    
+    /**
+    *   \brief Current coefficients.
+    */
+    const CalibrationCoeffs* Calibration_GetCoeffs(void);
+    
+    /**
+    *   \brief Write the current coefficients to the emulated EEPROM.
+    *
+    *   \retval Returns ERROR if the emulated EEPROM can't be used or the
+    *   write failed.
+    */
+    ErrorCode Calibration_Save(void);
+    
+#endif // __CALIBRATION_H
+/* [] END OF FILE */
@@ -0,0 +1,226 @@
+/*
+* This file includes the snapshot burst capture and the dump
+* of the captured data.
+*/
+
+#include "Capture.h"
+#include "Frame.h"
+#include "Timebase.h"
+
+#if (CAPTURE_ENABLE)
+
+/**
+*   \brief Bytes of the data frame header (capture id and sequence number).
+*/
+#define CAPTURE_DATA_HEADER 4
+
+/**
+*   \brief Samples that fit in the buffer.
+*/
+#if (CAPTURE_LOW_POWER)
+    #define CAPTURE_CAPACITY (CAPTURE_BUFFER_SIZE / 3u)
+#else
+    #define CAPTURE_CAPACITY ((CAPTURE_BUFFER_SIZE / 9u) * 2u)
+#endif
+
+/**
+*   \brief Bytes of the information payload, gaps included.
+*/
+#define CAPTURE_INFO_SIZE (2 + 1 + 2 + 2 + 4 + 4 + 2 + 1 + 4*CAPTURE_MAX_GAPS)
+
+#if (CAPTURE_INFO_SIZE > CAPTURE_DATA_HEADER + CAPTURE_CHUNK_SIZE)
+    #error "CAPTURE_MAX_GAPS does not fit in the payload of the frames"
+#endif
+
+static uint8_t capture_buffer[CAPTURE_BUFFER_SIZE];
+
+// Write position in the buffer, half byte pending for 12-bit packing
+static uint32_t write_index;
+static uint8_t nibble_pending;
+
+// Statistics of the last capture
+static uint16_t capture_id;
+static uint32_t capture_samples;
+static uint32_t capture_duration_ms;
+static uint16_t capture_overruns;
+static uint16_t capture_odr_hz;
+
+// Index of the first sample after each of the first overruns
+static uint32_t capture_gaps[CAPTURE_MAX_GAPS];
+static uint8_t capture_gap_count;
+
+    /*
+    *   Append a left-justified value to the buffer.
+    */
+    static CY_INLINE void Capture_PutValue(int16_t raw)
+    {
+    #if (CAPTURE_LOW_POWER)
+        capture_buffer[write_index++] = (uint8_t)(raw >> 8);
+    #else
+        uint16_t value = (uint16_t)(raw >> 4) & 0x0FFF;
+        if (!nibble_pending)
+        {
+            capture_buffer[write_index] = (uint8_t)(value & 0xFF);
+            capture_buffer[write_index + 1] = (uint8_t)(value >> 8);
+            write_index += 1;
+            nibble_pending = 1;
+        }
+        else
+        {
+            capture_buffer[write_index] |= (uint8_t)((value & 0x0F) << 4);
+            capture_buffer[write_index + 1] = (uint8_t)(value >> 4);
+            write_index += 2;
+            nibble_pending = 0;
+        }
+    #endif
+    }
+    
+    /*
+    *   Change the output data rate and the mode in the order that never
+    *   leaves the device on LIS3DH_ODR_1600HZ_LP out of the low power mode:
+    *   the mode first when the new rate needs it, the rate first otherwise
+    *   (every other rate is valid in every mode).
+    */
+    static ErrorCode Capture_SetRate(LIS3DH_Device* device, LIS3DH_ODR odr, LIS3DH_Mode mode)
+    {
+        ErrorCode error;
+        
+        if (odr == LIS3DH_ODR_1600HZ_LP)
+        {
+            error = LIS3DH_SetMode(device, mode);
+            if (error == NO_ERROR)
+            {
+                error = LIS3DH_SetODR(device, odr);
+            }
+            return error;
+        }
+        error = LIS3DH_SetODR(device, odr);
+        if (error == NO_ERROR)
+        {
+            error = LIS3DH_SetMode(device, mode);
+        }
+        return error;
+    }
+    
+    ErrorCode Capture_Record(LIS3DH_Device* device)
+    {
+        int16_t fifo[LIS3DH_FIFO_DEPTH*LIS3DH_AXES];
+        uint8_t count;
+        uint8_t overrun;
+        ErrorCode error;
+        ErrorCode restore_error;
+        
+        // Save the configuration to be restored
+        LIS3DH_ODR odr = LIS3DH_GetODR(device);
+        LIS3DH_Mode mode = LIS3DH_GetMode(device);
+        
+        write_index = 0;
+        nibble_pending = 0;
+        capture_samples = 0;
+        capture_overruns = 0;
+        capture_gap_count = 0;
+        capture_id++;
+        
+        error = Capture_SetRate(device, LIS3DH_ODR_1344HZ, CAPTURE_MODE);
+        if (error == NO_ERROR)
+        {
+            error = LIS3DH_SetFifo(device, LIS3DH_FIFO_STREAM, 0);
+        }
+        capture_odr_hz = LIS3DH_GetODRHz(device);
+        
+        uint32_t start = Timebase_GetMs();
+        while (error == NO_ERROR && capture_samples < CAPTURE_CAPACITY)
+        {
+            uint32_t missing = CAPTURE_CAPACITY - capture_samples;
+            error = LIS3DH_ReadFifo(device, fifo,
+                                    missing < LIS3DH_FIFO_DEPTH ? (uint8_t)missing : LIS3DH_FIFO_DEPTH,
+                                    &count, &overrun);
+            // The samples of this drain follow the ones lost
+            if (overrun)
+            {
+                capture_overruns++;
+                if (capture_gap_count < CAPTURE_MAX_GAPS)
+                {
+                    capture_gaps[capture_gap_count++] = capture_samples;
+                }
+            }
+        
+            uint8_t i;
+            for (i = 0; i < count*LIS3DH_AXES; i++)
+            {
+                Capture_PutValue(fifo[i]);
+            }
+            capture_samples += count;
+        }
+        capture_duration_ms = Timebase_GetMs() - start;
+        
+        // Restore the previous configuration, each part even if another one
+        // failed, and return the first error
+        restore_error = LIS3DH_SetFifo(device, LIS3DH_FIFO_BYPASS, 0);
+        if (error == NO_ERROR)
+        {
+            error = restore_error;
+        }
+        restore_error = Capture_SetRate(device, odr, mode);
+        if (error == NO_ERROR)
+        {
+            error = restore_error;
+        }
+        
+        return error;
+    }
+    
+    void Capture_Dump(void)
+    {
+        uint8_t payload[CAPTURE_DATA_HEADER + CAPTURE_CHUNK_SIZE];
+        uint8_t* p = payload;
+        
+        p = Frame_Put16(p, capture_id);
+        *p++ = CAPTURE_MODE;
+        p = Frame_Put16(p, capture_odr_hz);
+        p = Frame_Put16(p, Capture_GetRate());
+        p = Frame_Put32(p, capture_samples);
+        p = Frame_Put32(p, capture_duration_ms);
+        p = Frame_Put16(p, capture_overruns);
+        *p++ = capture_gap_count;
+        uint8_t gap;
+        for (gap = 0; gap < capture_gap_count; gap++)
+        {
+            p = Frame_Put32(p, capture_gaps[gap]);
+        }
+        Frame_Send(FRAME_HEADER_CAPTURE_INFO, payload, (uint8_t)(p - payload));
+        
+        // Bytes used, including a pending half byte
+        uint32_t used = write_index + nibble_pending;
+        uint32_t offset;
+        uint16_t sequence = 0;
+        for (offset = 0; offset < used; offset += CAPTURE_CHUNK_SIZE)
+        {
+            uint32_t length = used - offset;
+            if (length > CAPTURE_CHUNK_SIZE)
+            {
+                length = CAPTURE_CHUNK_SIZE;
+            }
+            p = Frame_Put16(payload, capture_id);
+            p = Frame_Put16(p, sequence++);
+            uint32_t i;
+            for (i = 0; i < length; i++)
+            {
+                p[i] = capture_buffer[offset + i];
+            }
+            Frame_Send(FRAME_HEADER_CAPTURE_DATA, payload, (uint8_t)(CAPTURE_DATA_HEADER + length));
+        }
+    }
+    
+    uint16_t Capture_GetRate(void)
+    {
+        if (capture_duration_ms == 0)
+        {
+            return 0;
+        }
+        return (uint16_t)((capture_samples * 1000u) / capture_duration_ms);
+    }
+
+#endif // CAPTURE_ENABLE
+
+/* [] END OF FILE */
@@ -0,0 +1,119 @@
+/**
+*   \file Capture.h
+*   \brief Snapshot burst capture at the maximum output data rate.
+*
+*   The UART cannot sustain the maximum ODR of the LIS3DH. In snapshot mode
+*   the accelerometer is switched to its maximum ODR and the FIFO is drained
+*   in bursts into a RAM buffer that takes most of the SRAM, until the buffer
+*   is full. The buffer is then dumped at link speed as a sequence of framed
+*   packets: one information frame, followed by data frames carrying a
+*   sequence number, so that the host can detect lost packets.
+*
+*   Samples are packed: 3 bytes per sample in low power mode (8 bit),
+*   9 bytes every 2 samples in high resolution mode (12 bit). The samples
+*   lost when the FIFO overruns between two drains leave gaps in the
+*   sequence, whose positions are listed in the information frame.
+*
+*   The buffer takes 48 KB of the 64 KB of SRAM of the CY8C5888, so the
+*   module is only compiled with CAPTURE_ENABLE set to 1.
+*/
+
+#ifndef __CAPTURE_H
+    #define __CAPTURE_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH.h"
+    #include "Sensor_Bus.h"
+    
+    /**
+    *   \brief Compile the capture and its buffer, 0 to leave the SRAM to the
+    *   other modules (STREAM_MODE_SNAPSHOT is then refused).
+    */
+    #ifndef CAPTURE_ENABLE
+        #define CAPTURE_ENABLE 0
+    #endif
+    
+    /**
+    *   \brief Size of the capture buffer in bytes.
+    */
+    #ifndef CAPTURE_BUFFER_SIZE
+        #define CAPTURE_BUFFER_SIZE 49152u
+    #endif
+    
+    /**
+    *   \brief Capture in low power mode.
+    *
+    *   1 captures 8-bit samples at 5.376 kHz, 0 (default) 12-bit samples at
+    *   1.344 kHz. A FIFO drain takes 583 us per sample over I2C at
+    *   100 kbit/s (Sensor_Bus.h), so the low power rate needs SPI or I2C
+    *   at 400 kbit/s, otherwise the FIFO overruns for the whole capture.
+    */
+    #ifndef CAPTURE_LOW_POWER
+        #define CAPTURE_LOW_POWER 0
+    #endif
+    
+    /**
+    *   \brief Resolution mode of the capture, from CAPTURE_LOW_POWER (the
+    *   LIS3DH_Mode values are not visible to the preprocessor).
+    */
+    #if (CAPTURE_LOW_POWER)
+        #define CAPTURE_MODE LIS3DH_MODE_LOW_POWER
+    #else
+        #define CAPTURE_MODE LIS3DH_MODE_HIGH_RES
+    #endif
+    
+    /**
+    *   \brief Payload bytes of each data frame.
+    */
+    #ifndef CAPTURE_CHUNK_SIZE
+        #define CAPTURE_CHUNK_SIZE 192u
+    #endif
+    
+    /**
+    *   \brief FIFO overruns whose position is kept, the following ones are
+    *   only counted.
+    */
+    #ifndef CAPTURE_MAX_GAPS
+        #define CAPTURE_MAX_GAPS 16u
+    #endif
+    
+    #if (CAPTURE_ENABLE)
+    
+    #if (CAPTURE_LOW_POWER) && (SENSOR_BUS_TRANSPORT == SENSOR_BUS_I2C) && (I2C_PERIPHERAL_BIT_RATE < 400000u)
+        #error "CAPTURE_LOW_POWER needs SPI or I2C at 400 kbit/s to drain the FIFO at 5.376 kHz"
+    #endif
+    
+    /**
+    *   \brief Fill the buffer at the maximum output data rate.
+    *
+    *   Blocking. The configuration of the device is restored at the end.
+    *   \param device Device to capture from.
+    *   \retval Returns ERROR if the capture or the restore of the
+    *   configuration failed on the bus.
+    */
+    ErrorCode Capture_Record(LIS3DH_Device* device);
+    
+    /**
+    *   \brief Send the captured samples on UART_Debug.
+    *
+    *   Information frame payload (little endian): capture id (16 bit),
+    *   resolution mode (8 bit), nominal ODR in Hz (16 bit), achieved rate in
+    *   Hz (16 bit), samples (32 bit), duration in ms (32 bit), FIFO overruns
+    *   (16 bit), gaps listed (8 bit), then for each of the first
+    *   CAPTURE_MAX_GAPS overruns the index of the first sample after the
+    *   samples lost (32 bit).
+    *   Data frame payload: capture id (16 bit), sequence number (16 bit),
+    *   packed samples.
+    */
+    void Capture_Dump(void);
+    
+    /**
+    *   \brief Rate achieved by the last capture, in samples/s.
+    */
+    uint16_t Capture_GetRate(void);
+    
+    #endif // CAPTURE_ENABLE
+    
+#endif // __CAPTURE_H
+/* [] END OF FILE */
@@ -0,0 +1,132 @@
+/*
+* This file includes the reception and parsing of the commands
+* received on UART_Debug.
+*/
+
+#include "Command.h"
+#include "Frame.h"
+#include "UART_Debug.h"
+#if (COMMAND_RX_ISR == COMMAND_RX_ISR_UART)
+    #include "isr_UART_RX.h"
+#elif (COMMAND_RX_ISR == COMMAND_RX_ISR_SYSTICK)
+    #include "CyLib.h"
+#endif
+
+#if (COMMAND_RX_ISR == COMMAND_RX_ISR_SYSTICK) && (FRAME_UART_BAUD > 38400u)
+    #error "The SysTick drain overflows the RX FIFO above 38400 baud, use COMMAND_RX_ISR_UART"
+#endif
+
+/**
+*   \brief SysTick callback slot used by the reception, after the time base.
+*/
+#define COMMAND_CALLBACK_SLOT 1u
+
+/**
+*   \brief Bytes of a command.
+*/
+#define COMMAND_LENGTH 4
+
+#define COMMAND_RX_MASK (COMMAND_RX_BUFFER_SIZE - 1u)
+
+static volatile uint8_t rx_buffer[COMMAND_RX_BUFFER_SIZE];
+static volatile uint8_t rx_head;
+static uint8_t rx_tail;
+static volatile uint16_t overruns;
+static uint16_t checksum_errors;
+
+// Bytes of the command being parsed
+static uint8_t pending[COMMAND_LENGTH];
+static uint8_t pending_count;
+
+    /*
+    *   Move the bytes from the hardware FIFO to the ring buffer.
+    */
+    static void Command_Drain(void)
+    {
+        while (UART_Debug_ReadRxStatus() & UART_Debug_RX_STS_FIFO_NOTEMPTY)
+        {
+            uint8_t data = UART_Debug_ReadRxData();
+            uint8_t next = (uint8_t)((rx_head + 1u) & COMMAND_RX_MASK);
+            if (next == rx_tail)
+            {
+                overruns++;
+                continue;
+            }
+            rx_buffer[rx_head] = data;
+            rx_head = next;
+        }
+    }
+    
+#if (COMMAND_RX_ISR == COMMAND_RX_ISR_UART)
+    /*
+    *   Byte received on UART_Debug.
+    */
+    CY_ISR(Command_RxIsr)
+    {
+        Command_Drain();
+    }
+#endif
+
+    void Command_Start(void)
+    {
+        rx_head = 0;
+        rx_tail = 0;
+        overruns = 0;
+        checksum_errors = 0;
+        pending_count = 0;
+    #if (COMMAND_RX_ISR == COMMAND_RX_ISR_UART)
+        isr_UART_RX_StartEx(Command_RxIsr);
+    #elif (COMMAND_RX_ISR == COMMAND_RX_ISR_SYSTICK)
+        CySysTickSetCallback(COMMAND_CALLBACK_SLOT, Command_Drain);
+    #endif
+    }
+    
+    uint8_t Command_Get(Command* command)
+    {
+    #if (COMMAND_RX_ISR == COMMAND_RX_POLL)
+        Command_Drain();
+    #endif
+        while (rx_tail != rx_head)
+        {
+            uint8_t data = rx_buffer[rx_tail];
+            rx_tail = (uint8_t)((rx_tail + 1u) & COMMAND_RX_MASK);
+            
+            // Resynchronize on the sync byte after a corrupted command
+            if (pending_count == 0 && data != COMMAND_SYNC)
+            {
+                continue;
+            }
+            pending[pending_count++] = data;
+            if (pending_count < COMMAND_LENGTH)
+            {
+                continue;
+            }
+            pending_count = 0;
+            
+            if ((pending[0] ^ pending[1] ^ pending[2]) != pending[3])
+            {
+                checksum_errors++;
+                continue;
+            }
+            command->opcode = pending[1];
+            command->argument = pending[2];
+            return 1;
+        }
+        return 0;
+    }
+    
+    void Command_Reply(const Command* command, uint8_t status)
+    {
+        uint8_t payload[3];
+        payload[0] = command->opcode;
+        payload[1] = status;
+        payload[2] = command->argument;
+        Frame_Send(FRAME_HEADER_COMMAND_ACK, payload, sizeof(payload));
+    }
+    
+    uint16_t Command_GetErrors(void)
+    {
+        return overruns + checksum_errors;
+    }
+
+/* [] END OF FILE */
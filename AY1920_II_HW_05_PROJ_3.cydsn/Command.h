@@ -0,0 +1,202 @@
+/**
+*   \file Command.h
+*   \brief Binary command channel on the RX line of UART_Debug.
+*
+*   Each command is four bytes long, so that it fits the hardware RX FIFO:
+*
+*       COMMAND_SYNC | opcode | argument | checksum
+*
+*   where the checksum is the XOR of the first three bytes. Every command
+*   is answered with an acknowledge frame carrying the opcode, the status
+*   and the argument.
+*
+*   The bytes are moved from the FIFO to a ring buffer from an interrupt,
+*   so that no command is lost while the loop blocks (capture, idle wait of
+*   the activity stream, page writes of the event log, long frames) and the
+*   host can queue up to COMMAND_RX_BUFFER_SIZE bytes of commands. The
+*   interrupt is selected with COMMAND_RX_ISR:
+*   - COMMAND_RX_ISR_SYSTICK (default): the FIFO is drained by a callback of
+*     the 1 ms SysTick interrupt of the time base (Timebase.h), which needs
+*     nothing in the TopDesign. At most 4 bytes arrive in 1 ms up to 38400
+*     baud, so the FIFO never overflows between two ticks;
+*   - COMMAND_RX_ISR_UART: the FIFO is drained by an isr_UART_RX interrupt
+*     component connected to the rx_interrupt terminal of UART_Debug (RX
+*     interrupt on byte received), to be placed in the TopDesign. Needed
+*     above 38400 baud;
+*   - COMMAND_RX_POLL: fallback, the FIFO is drained when the commands are
+*     read, and the host must wait for the acknowledge before sending the
+*     next command.
+*   Bytes are still lost if interrupts stay disabled for longer than the
+*   FIFO lasts (2 ms at 19200 baud).
+*/
+
+#ifndef __COMMAND_H
+    #define __COMMAND_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief First byte of each command.
+    */
+    #define COMMAND_SYNC 0xB0
+    
+    /**
+    *   \brief Set the output data rate, argument LIS3DH_ODR.
+    *
+    *   LIS3DH_ODR_1600HZ_LP exists only in low power mode: it is refused in
+    *   the other modes, and the other modes are refused at that rate.
+    */
+    #define COMMAND_SET_ODR 0x01
+    
+    /**
+    *   \brief Set the full-scale range, argument LIS3DH_FullScale.
+    */
+    #define COMMAND_SET_FULL_SCALE 0x02
+    
+    /**
+    *   \brief Set the resolution mode, argument LIS3DH_Mode.
+    */
+    #define COMMAND_SET_MODE 0x03
+    
+    /**
+    *   \brief Switch the stream format, argument stream mode.
+    */
+    #define COMMAND_SET_STREAM 0x04
+    
+    /**
+    *   \brief Start streaming.
+    */
+    #define COMMAND_START 0x05
+    
+    /**
+    *   \brief Stop streaming, only acknowledges and statistics are sent.
+    */
+    #define COMMAND_STOP 0x06
+    
+    /**
+    *   \brief Request a statistics frame, followed by the latency frame of
+    *   the bus priority classes (Telemetry_SendBusClasses()).
+    */
+    #define COMMAND_GET_STATS 0x07
+    
+    /**
+    *   \brief Render the samples of the raw stream as text, argument
+    *   decimation (0 for the binary packets, see TextStream.h).
+    */
+    #define COMMAND_SET_TEXT 0x08
+    
+    /**
+    *   \brief Set the period of the tilt frames, argument period in units of
+    *   TILT_PERIOD_UNIT_MS (1 to 255, see Tilt.h).
+    */
+    #define COMMAND_SET_TILT_PERIOD 0x09
+    
+    /**
+    *   \brief Send the event log, argument 1 to erase it afterwards (see
+    *   EventLog.h).
+    */
+    #define COMMAND_DUMP_LOG 0x0A
+    
+    /**
+    *   \brief Send the trace of the sensor bus, argument 1 to clear it
+    *   afterwards (see BusTrace.h).
+    */
+    #define COMMAND_DUMP_TRACE 0x0B
+    
+    /**
+    *   \brief Run a calibration procedure on the next samples, argument
+    *   CalibrationProcedure (CALIBRATION_NONE aborts the running one, see
+    *   Calibration.h).
+    *
+    *   Accepted in the raw stream mode only, while the samples are read;
+    *   the samples are not streamed until the procedure ends and its result
+    *   is printed on the debug UART.
+    */
+    #define COMMAND_CALIBRATE 0x0C
+    
+    /**
+    *   \brief Command executed.
+    */
+    #define COMMAND_STATUS_OK 0x00
+    
+    /**
+    *   \brief Argument out of range.
+    */
+    #define COMMAND_STATUS_INVALID 0x01
+    
+    /**
+    *   \brief Error on the sensor bus while executing the command.
+    */
+    #define COMMAND_STATUS_BUS_ERROR 0x02
+    
+    /**
+    *   \brief Unknown opcode.
+    */
+    #define COMMAND_STATUS_UNKNOWN 0x03
+    
+    /**
+    *   \brief RX FIFO drained when the commands are read.
+    */
+    #define COMMAND_RX_POLL 0
+    
+    /**
+    *   \brief RX FIFO drained by the isr_UART_RX component.
+    */
+    #define COMMAND_RX_ISR_UART 1
+    
+    /**
+    *   \brief RX FIFO drained by the SysTick callback.
+    */
+    #define COMMAND_RX_ISR_SYSTICK 2
+    
+    /**
+    *   \brief Reception of the commands.
+    */
+    #ifndef COMMAND_RX_ISR
+        #define COMMAND_RX_ISR COMMAND_RX_ISR_SYSTICK
+    #endif
+    
+    /**
+    *   \brief Size of the RX ring buffer, power of 2.
+    */
+    #ifndef COMMAND_RX_BUFFER_SIZE
+        #define COMMAND_RX_BUFFER_SIZE 32u
+    #endif
+    
+    /**
+    *   \brief Command received from the host.
+    */
+    typedef struct {
+        uint8_t opcode;     ///< Operation
+        uint8_t argument;   ///< Argument of the operation
+    } Command;
+    
+    /**
+    *   \brief Clear the parser and start the reception.
+    *
+    *   With COMMAND_RX_ISR_SYSTICK, to be called after Timebase_Start().
+    */
+    void Command_Start(void);
+    
+    /**
+    *   \brief Get the next valid command.
+    *
+    *   \param command Command received.
+    *   \retval Returns 1 if a command has been received.
+    */
+    uint8_t Command_Get(Command* command);
+    
+    /**
+    *   \brief Send the acknowledge of a command.
+    *
+    *   Payload: opcode (8 bit), status (8 bit), argument (8 bit).
+    */
+    void Command_Reply(const Command* command, uint8_t status);
+    
+    /**
+    *   \brief Commands discarded for a wrong checksum or a full buffer.
+    */
+    uint16_t Command_GetErrors(void);
+    
+#endif // __COMMAND_H
+/* [] END OF FILE */
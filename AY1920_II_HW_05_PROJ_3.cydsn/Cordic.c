@@ -0,0 +1,98 @@
+/*
+* This file includes the CORDIC iterations in vectoring mode.
+*/
+
+#include "Cordic.h"
+#include <stddef.h>
+
+#if (CORDIC_ITERATIONS < 8) || (CORDIC_ITERATIONS > 24)
+    #error "CORDIC_ITERATIONS must be between 8 and 24"
+#endif
+
+/**
+*   \brief Inverse of the CORDIC gain in Q0.32.
+*
+*   The gain converges to 1.6467602581 after a few iterations, the
+*   difference from 8 to 24 iterations is below 1 ppm.
+*/
+#define CORDIC_GAIN_INVERSE 2608131496UL
+
+/*
+*   atan(2^-i) as binary angles.
+*/
+static const int32_t arctangent[24] = {
+    536870912, 316933406, 167458907, 85004756,
+     42667331,  21354465,  10679838,  5340245,
+      2670163,   1335087,    667544,   333772,
+       166886,     83443,     41722,    20861,
+        10430,      5215,      2608,     1304,
+          652,       326,       163,       81
+};
+
+    int32_t Cordic_Vector(int32_t x, int32_t y, uint32_t* magnitude)
+    {
+        // Unsigned, so that the angle wraps at 180 degrees without overflow
+        uint32_t angle = 0;
+        int32_t x_shifted;
+        uint8_t i;
+        
+        if (x == 0 && y == 0)
+        {
+            if (magnitude != NULL)
+            {
+                *magnitude = 0;
+            }
+            return 0;
+        }
+        
+        // The iterations cover +-99.9 degrees: the left half-plane is first
+        // rotated by 90 degrees
+        if (x < 0)
+        {
+            x_shifted = x;
+            if (y >= 0)
+            {
+                x = y;
+                y = -x_shifted;
+                angle = (uint32_t)CORDIC_ANGLE_90;
+            }
+            else
+            {
+                x = -y;
+                y = x_shifted;
+                angle = (uint32_t)-CORDIC_ANGLE_90;
+            }
+        }
+        
+        // Each step rotates by atan(2^-i) towards the X axis
+        for (i = 0; i < CORDIC_ITERATIONS; i++)
+        {
+            x_shifted = x >> i;
+            if (y > 0)
+            {
+                x += y >> i;
+                y -= x_shifted;
+                angle += (uint32_t)arctangent[i];
+            }
+            else
+            {
+                x -= y >> i;
+                y += x_shifted;
+                angle -= (uint32_t)arctangent[i];
+            }
+        }
+        
+        if (magnitude != NULL)
+        {
+            *magnitude = (uint32_t)(((uint64_t)(uint32_t)x * CORDIC_GAIN_INVERSE) >> 32);
+        }
+        return (int32_t)angle;
+    }
+    
+    int16_t Cordic_ToCentidegrees(int32_t angle)
+    {
+        // 36000 hundredths of a degree per turn of 2^32
+        return (int16_t)(((int64_t)angle * 36000 + (1LL << 31)) >> 32);
+    }
+
+/* [] END OF FILE */
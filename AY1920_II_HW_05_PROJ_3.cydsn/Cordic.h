@@ -0,0 +1,63 @@
+/**
+*   \file Cordic.h
+*   \brief Integer CORDIC kernel for angles and magnitudes.
+*
+*   The vectoring mode rotates the vector (x, y) onto the positive X axis
+*   with shifts and adds only, accumulating the angle of the rotation:
+*   one evaluation gives atan2(y, x) and sqrt(x^2 + y^2) together, with
+*   no division, no table of the full function and no floating point.
+*
+*   Angles are binary: a full turn is 2^32, so that an int32_t covers
+*   [-180; +180) degrees and wraps like an angle. Each iteration adds about
+*   one bit of precision, as long as the coordinates have enough bits for
+*   the shifts: with the default 16 iterations and vectors longer than
+*   2^20 the angle is within 0.002 degrees of atan2() on the host, at 2^10
+*   only within 0.2 degrees. Scale small inputs up before the call.
+*
+*   Only <stdint.h> is included, so that the kernel also builds on the
+*   host for Host_Tools/cordic_bench.c.
+*/
+
+#ifndef __CORDIC_H
+    #define __CORDIC_H
+    
+    #include <stdint.h>
+    
+    /**
+    *   \brief Iterations of each evaluation, between 8 and 24.
+    */
+    #ifndef CORDIC_ITERATIONS
+        #define CORDIC_ITERATIONS 16
+    #endif
+    
+    /**
+    *   \brief Largest absolute value of the coordinates.
+    *
+    *   The vector grows by the CORDIC gain (1.647) during the iterations,
+    *   which must not overflow an int32_t.
+    */
+    #define CORDIC_INPUT_MAX (1L << 29)
+    
+    /**
+    *   \brief Binary angle of 90 degrees.
+    */
+    #define CORDIC_ANGLE_90 ((int32_t)0x40000000L)
+    
+    /**
+    *   \brief Angle and magnitude of a vector.
+    *
+    *   \param x X coordinate, |x| < CORDIC_INPUT_MAX.
+    *   \param y Y coordinate, |y| < CORDIC_INPUT_MAX.
+    *   \param magnitude Length of the vector in the units of x and y, the
+    *   gain of the iterations compensated. NULL if not needed.
+    *   \retval Binary angle of atan2(y, x), 0 for the null vector.
+    */
+    int32_t Cordic_Vector(int32_t x, int32_t y, uint32_t* magnitude);
+    
+    /**
+    *   \brief Convert a binary angle to hundredths of a degree, rounded.
+    */
+    int16_t Cordic_ToCentidegrees(int32_t angle);
+
+#endif // __CORDIC_H
+/* [] END OF FILE */
@@ -0,0 +1,477 @@
+/*
+* This file includes the event detector and the paged log of the
+* events in the emulated EEPROM.
+*/
+
+#include "EventLog.h"
+#include "CRC.h"
+#include "Frame.h"
+#include "Profile.h"
+#include "Timebase.h"
+#include "cy_em_eeprom.h"
+#include <stddef.h>
+#include <string.h>
+
+/**
+*   \brief Logical size of the emulated EEPROM: the pages and the boot row.
+*/
+#define EVENTLOG_EEPROM_SIZE ((EVENTLOG_PAGES + 1u)*EVENTLOG_PAGE_SIZE)
+
+/**
+*   \brief Address of the boot counter in the emulated EEPROM, after the pages.
+*/
+#define EVENTLOG_BOOT_ADDRESS ((uint32_t)EVENTLOG_PAGES*EVENTLOG_PAGE_SIZE)
+
+/**
+*   \brief Records held by the log.
+*/
+#define EVENTLOG_CAPACITY (EVENTLOG_PAGES*EVENTLOG_PAGE_RECORDS)
+
+/**
+*   \brief Squared thresholds, compared without square root.
+*/
+#define EVENTLOG_SHOCK_SQ ((uint32_t)EVENTLOG_SHOCK_MG*EVENTLOG_SHOCK_MG)
+#define EVENTLOG_FREE_FALL_SQ ((uint32_t)EVENTLOG_FREE_FALL_MG*EVENTLOG_FREE_FALL_MG)
+
+/**
+*   \brief No event condition on the sample.
+*/
+#define EVENTLOG_TYPE_NONE 0xFF
+
+/**
+*   \brief Unit of the duration of the records in ms.
+*/
+#define EVENTLOG_DURATION_UNIT_MS 10u
+
+/**
+*   \brief Bytes of the information frame payload.
+*/
+#define EVENTLOG_INFO_SIZE (2 + 2 + 1 + 2 + 2 + 2 + 4 + 2)
+
+/**
+*   \brief Record stored in the emulated EEPROM.
+*/
+typedef struct {
+    uint32_t timestamp_ms;
+    uint16_t sequence;
+    uint16_t boot;
+    int16_t peak_mg[EVENTLOG_AXES];
+    uint8_t type;
+    uint8_t duration;
+    uint16_t crc;
+} EventRecord;
+
+/**
+*   \brief Boot counter stored in the emulated EEPROM.
+*/
+typedef struct {
+    uint16_t boot;
+    uint16_t crc;
+} EventBoot;
+
+// Flash area of the emulated EEPROM, aligned to a flash row
+CY_ALIGN(CY_FLASH_SIZEOF_ROW)
+static const uint8_t log_flash[CY_EM_EEPROM_GET_PHYSICAL_SIZE(EVENTLOG_EEPROM_SIZE, EVENTLOG_WEAR_LEVELING, 0u)] = {0u};
+
+static cy_stc_eeprom_context_t eeprom_context;
+static uint8_t eeprom_ready;
+static uint16_t boot_count;
+
+// Page being filled, written at page_index; free slots are erased (0xFF)
+static EventRecord page[EVENTLOG_PAGE_RECORDS];
+static uint8_t page_index;
+static uint8_t page_count;
+static uint8_t page_written;
+static uint32_t first_pending_ms;
+static uint8_t full_pages;
+static uint16_t next_sequence;
+
+// Page writes and their stall of the CPU
+static uint16_t page_writes;
+static uint16_t last_write_ms;
+static uint16_t worst_write_ms;
+
+// Event being detected
+static uint8_t event_type = EVENTLOG_TYPE_NONE;
+static uint32_t event_start_ms;
+static uint32_t event_last_ms;
+static int16_t event_peak[EVENTLOG_AXES];
+static uint8_t falling;
+static uint32_t fall_start_ms;
+
+    /*
+    *   Check the CRC of a record read from flash.
+    */
+    static uint8_t EventLog_IsValid(const EventRecord* record)
+    {
+        return record->crc == CRC16_Update(CRC16_INIT, (const uint8_t*)record,
+                                           offsetof(EventRecord, crc));
+    }
+    
+    /*
+    *   Write the boot counter to its row of the emulated EEPROM.
+    */
+    static ErrorCode EventLog_SaveBoot(void)
+    {
+        EventBoot stored;
+        
+        stored.boot = boot_count;
+        stored.crc = CRC16_Update(CRC16_INIT, (const uint8_t*)&stored, offsetof(EventBoot, crc));
+        if (Cy_Em_EEPROM_Write(EVENTLOG_BOOT_ADDRESS, &stored, sizeof(stored),
+                               &eeprom_context) != CY_EM_EEPROM_SUCCESS)
+        {
+            return ERROR;
+        }
+        return NO_ERROR;
+    }
+    
+    /*
+    *   Start an empty page at the next position of the circle.
+    */
+    static void EventLog_NextPage(void)
+    {
+        page_index = (page_index + 1) % EVENTLOG_PAGES;
+        page_count = 0;
+        page_written = 0;
+        memset(page, 0xFF, sizeof(page));
+    }
+    
+    /*
+    *   Write the page to the emulated EEPROM, then move to the next one if
+    *   it is full.
+    */
+    static ErrorCode EventLog_Flush(void)
+    {
+        uint32_t start_ms;
+        cy_en_em_eeprom_status_t status = CY_EM_EEPROM_SUCCESS;
+        
+        if (eeprom_ready)
+        {
+            start_ms = Timebase_GetMs();
+            PROFILE_BEGIN(PROFILE_STAGE_FLASH);
+            status = Cy_Em_EEPROM_Write((uint32_t)page_index*EVENTLOG_PAGE_SIZE, page,
+                                        sizeof(page), &eeprom_context);
+            PROFILE_END(PROFILE_STAGE_FLASH);
+            last_write_ms = (uint16_t)(Timebase_GetMs() - start_ms);
+            if (last_write_ms > worst_write_ms)
+            {
+                worst_write_ms = last_write_ms;
+            }
+            page_writes++;
+        }
+        if (status != CY_EM_EEPROM_SUCCESS)
+        {
+            // Tried again after EVENTLOG_FLUSH_MS, not on every call
+            first_pending_ms = Timebase_GetMs();
+            return ERROR;
+        }
+        
+        page_written = page_count;
+        if (page_count == EVENTLOG_PAGE_RECORDS)
+        {
+            if (full_pages < EVENTLOG_PAGES - 1)
+            {
+                full_pages++;
+            }
+            EventLog_NextPage();
+        }
+        return NO_ERROR;
+    }
+    
+    /*
+    *   Append the closed event to the page.
+    */
+    static void EventLog_Append(void)
+    {
+        EventRecord* record;
+        uint32_t duration = (event_last_ms - event_start_ms)/EVENTLOG_DURATION_UNIT_MS;
+        
+        // A full page is left only when a write failed: try once more,
+        // then the new record is dropped
+        if (page_count == EVENTLOG_PAGE_RECORDS && EventLog_Flush() != NO_ERROR)
+        {
+            return;
+        }
+        
+        record = &page[page_count];
+        record->timestamp_ms = event_start_ms;
+        record->sequence = next_sequence++;
+        record->boot = boot_count;
+        memcpy(record->peak_mg, event_peak, sizeof(event_peak));
+        record->type = event_type;
+        record->duration = (uint8_t)(duration > 0xFF ? 0xFF : duration);
+        record->crc = CRC16_Update(CRC16_INIT, (const uint8_t*)record, offsetof(EventRecord, crc));
+        
+        if (page_count == page_written)
+        {
+            first_pending_ms = Timebase_GetMs();
+        }
+        page_count++;
+    }
+    
+    /*
+    *   Start an event with the current sample.
+    */
+    static void EventLog_Open(uint8_t type, uint32_t start_ms)
+    {
+        event_type = type;
+        event_start_ms = start_ms;
+        memset(event_peak, 0, sizeof(event_peak));
+    }
+    
+    ErrorCode EventLog_Init(void)
+    {
+        cy_stc_eeprom_config_t config;
+        uint8_t index;
+        uint8_t slot;
+        uint8_t found = 0;
+        uint8_t pages_used = 0;
+        uint8_t newest_page = 0;
+        uint8_t newest_slot = 0;
+        uint16_t newest_sequence = 0;
+        EventBoot stored;
+        ErrorCode error = NO_ERROR;
+        
+        page_index = EVENTLOG_PAGES - 1;
+        EventLog_NextPage();
+        full_pages = 0;
+        next_sequence = 0;
+        boot_count = 0;
+        
+        config.eepromSize = EVENTLOG_EEPROM_SIZE;
+        config.wearLevelingFactor = EVENTLOG_WEAR_LEVELING;
+        config.redundantCopy = 0u;
+        config.blockingWrite = 1u;
+        config.userFlashStartAddr = (uint32_t)log_flash;
+        
+        eeprom_ready = (Cy_Em_EEPROM_Init(&config, &eeprom_context) == CY_EM_EEPROM_SUCCESS);
+        if (!eeprom_ready)
+        {
+            return ERROR;
+        }
+        
+        // One more start since the log was created: 0 on the first one
+        if (Cy_Em_EEPROM_Read(EVENTLOG_BOOT_ADDRESS, &stored, sizeof(stored),
+                              &eeprom_context) == CY_EM_EEPROM_SUCCESS &&
+            stored.crc == CRC16_Update(CRC16_INIT, (const uint8_t*)&stored, offsetof(EventBoot, crc)))
+        {
+            boot_count = stored.boot + 1;
+        }
+        error = EventLog_SaveBoot();
+        
+        // The page buffer is used to scan the log: the newest record has the
+        // highest sequence number, in serial number arithmetic
+        for (index = 0; index < EVENTLOG_PAGES; index++)
+        {
+            uint8_t valid = 0;
+            if (Cy_Em_EEPROM_Read((uint32_t)index*EVENTLOG_PAGE_SIZE, page, sizeof(page),
+                                  &eeprom_context) != CY_EM_EEPROM_SUCCESS)
+            {
+                continue;
+            }
+            for (slot = 0; slot < EVENTLOG_PAGE_RECORDS; slot++)
+            {
+                if (!EventLog_IsValid(&page[slot]))
+                {
+                    continue;
+                }
+                valid = 1;
+                if (!found || (int16_t)(page[slot].sequence - newest_sequence) > 0)
+                {
+                    found = 1;
+                    newest_sequence = page[slot].sequence;
+                    newest_page = index;
+                    newest_slot = slot;
+                }
+            }
+            pages_used += valid;
+        }
+        
+        memset(page, 0xFF, sizeof(page));
+        if (!found)
+        {
+            return error;
+        }
+        
+        // Appending goes on in the page of the newest record
+        next_sequence = newest_sequence + 1;
+        full_pages = pages_used - 1;
+        page_index = newest_page;
+        if (Cy_Em_EEPROM_Read((uint32_t)page_index*EVENTLOG_PAGE_SIZE, page, sizeof(page),
+                              &eeprom_context) != CY_EM_EEPROM_SUCCESS)
+        {
+            return ERROR;
+        }
+        page_count = newest_slot + 1;
+        page_written = page_count;
+        memset(&page[page_count], 0xFF, sizeof(page) - page_count*sizeof(EventRecord));
+        if (page_count == EVENTLOG_PAGE_RECORDS)
+        {
+            if (full_pages < EVENTLOG_PAGES - 1)
+            {
+                full_pages++;
+            }
+            EventLog_NextPage();
+        }
+        return error;
+    }
+    
+    void EventLog_AddSample(const int16_t* sample_mg)
+    {
+        uint32_t now = Timebase_GetMs();
+        uint32_t magnitude_sq = (uint32_t)((int32_t)sample_mg[0]*sample_mg[0]) +
+                                (uint32_t)((int32_t)sample_mg[1]*sample_mg[1]) +
+                                (uint32_t)((int32_t)sample_mg[2]*sample_mg[2]);
+        uint8_t type = EVENTLOG_TYPE_NONE;
+        uint8_t axis;
+        
+        if (magnitude_sq > EVENTLOG_SHOCK_SQ)
+        {
+            type = EVENTLOG_TYPE_SHOCK;
+        }
+        else if (magnitude_sq < EVENTLOG_FREE_FALL_SQ)
+        {
+            // A free fall counts only once it lasted EVENTLOG_FREE_FALL_MS
+            if (!falling)
+            {
+                falling = 1;
+                fall_start_ms = now;
+            }
+            if (now - fall_start_ms >= EVENTLOG_FREE_FALL_MS)
+            {
+                type = EVENTLOG_TYPE_FREE_FALL;
+            }
+        }
+        if (magnitude_sq >= EVENTLOG_FREE_FALL_SQ)
+        {
+            falling = 0;
+        }
+        
+        // The impact at the end of a fall closes the fall and opens a shock
+        if (event_type != EVENTLOG_TYPE_NONE &&
+            ((type != EVENTLOG_TYPE_NONE && type != event_type) ||
+             (type == EVENTLOG_TYPE_NONE && now - event_last_ms >= EVENTLOG_HOLDOFF_MS)))
+        {
+            EventLog_Append();
+            event_type = EVENTLOG_TYPE_NONE;
+        }
+        if (type == EVENTLOG_TYPE_NONE)
+        {
+            return;
+        }
+        if (event_type == EVENTLOG_TYPE_NONE)
+        {
+            EventLog_Open(type, type == EVENTLOG_TYPE_FREE_FALL ? fall_start_ms : now);
+        }
+        
+        event_last_ms = now;
+        for (axis = 0; axis < EVENTLOG_AXES; axis++)
+        {
+            int16_t value = sample_mg[axis];
+            if ((value < 0 ? -(int32_t)value : value) >
+                (event_peak[axis] < 0 ? -(int32_t)event_peak[axis] : event_peak[axis]))
+            {
+                event_peak[axis] = value;
+            }
+        }
+    }
+    
+    void EventLog_Service(void)
+    {
+        // Never while an event is open, its samples would be lost in the stall
+        if (event_type != EVENTLOG_TYPE_NONE || page_written == page_count)
+        {
+            return;
+        }
+        if (page_count == EVENTLOG_PAGE_RECORDS ||
+            Timebase_GetMs() - first_pending_ms >= EVENTLOG_FLUSH_MS)
+        {
+            EventLog_Flush();
+        }
+    }
+    
+    ErrorCode EventLog_Dump(uint8_t clear)
+    {
+        uint8_t payload[EVENTLOG_PAGE_RECORDS*EVENTLOG_FRAME_RECORD_SIZE];
+        EventRecord stored[EVENTLOG_PAGE_RECORDS];
+        const EventRecord* records;
+        uint8_t* field;
+        uint8_t count;
+        uint8_t index;
+        uint8_t slot;
+        ErrorCode error = NO_ERROR;
+        
+        if (page_written != page_count)
+        {
+            error = EventLog_Flush();
+        }
+        
+        field = Frame_Put16(payload, (uint16_t)(full_pages*EVENTLOG_PAGE_RECORDS + page_written));
+        field = Frame_Put16(field, EVENTLOG_CAPACITY);
+        *field++ = page_count - page_written;
+        field = Frame_Put16(field, page_writes);
+        field = Frame_Put16(field, last_write_ms);
+        field = Frame_Put16(field, worst_write_ms);
+        field = Frame_Put32(field, Timebase_GetMs());
+        field = Frame_Put16(field, boot_count);
+        Frame_Send(FRAME_HEADER_LOG_INFO, payload, EVENTLOG_INFO_SIZE);
+        
+        // From the page after the current one, the oldest, to the current one
+        for (index = 1; index <= EVENTLOG_PAGES; index++)
+        {
+            uint8_t position = (page_index + index) % EVENTLOG_PAGES;
+            if (position == page_index)
+            {
+                records = page;
+            }
+            else if (eeprom_ready &&
+                     Cy_Em_EEPROM_Read((uint32_t)position*EVENTLOG_PAGE_SIZE, stored, sizeof(stored),
+                                       &eeprom_context) == CY_EM_EEPROM_SUCCESS)
+            {
+                records = stored;
+            }
+            else
+            {
+                continue;
+            }
+        
+            count = 0;
+            field = payload;
+            for (slot = 0; slot < EVENTLOG_PAGE_RECORDS; slot++)
+            {
+                if (!EventLog_IsValid(&records[slot]))
+                {
+                    continue;
+                }
+                field = Frame_Put32(field, records[slot].timestamp_ms);
+                field = Frame_Put16(field, records[slot].sequence);
+                field = Frame_Put16(field, records[slot].boot);
+                field = Frame_Put16(field, (uint16_t)records[slot].peak_mg[0]);
+                field = Frame_Put16(field, (uint16_t)records[slot].peak_mg[1]);
+                field = Frame_Put16(field, (uint16_t)records[slot].peak_mg[2]);
+                *field++ = records[slot].type;
+                *field++ = records[slot].duration;
+                count++;
+            }
+            if (count > 0)
+            {
+                Frame_Send(FRAME_HEADER_LOG_RECORDS, payload, (uint8_t)(field - payload));
+            }
+        }
+        
+        if (clear)
+        {
+            // The erase takes the boot counter too, it is written back
+            if (eeprom_ready && (Cy_Em_EEPROM_Erase(&eeprom_context) != CY_EM_EEPROM_SUCCESS ||
+                                 EventLog_SaveBoot() != NO_ERROR))
+            {
+                error = ERROR;
+            }
+            page_index = EVENTLOG_PAGES - 1;
+            EventLog_NextPage();
+            full_pages = 0;
+        }
+        return error;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,172 @@
+/**
+*   \file EventLog.h
+*   \brief Shock and free fall history kept in the emulated EEPROM.
+*
+*   Every calibrated sample goes through a detector of two event types:
+*   - shock: magnitude of the acceleration above EVENTLOG_SHOCK_MG;
+*   - free fall: magnitude below EVENTLOG_FREE_FALL_MG for at least
+*     EVENTLOG_FREE_FALL_MS.
+*   An event lasts until the condition has been false for
+*   EVENTLOG_HOLDOFF_MS, then a record with its start time, its duration
+*   and the peak value of each axis is appended to the log, whatever the
+*   state of the link with the host.
+*
+*   Records are batched in a RAM page of EVENTLOG_PAGE_SIZE bytes, the data
+*   of one flash row of the emulated EEPROM, and the page is written when it
+*   is full or EVENTLOG_FLUSH_MS after its first pending record. Each write
+*   stalls the CPU for the programming of a row, so it is never done while
+*   an event is open, and its duration is reported in the log information
+*   frame and in the PROFILE_STAGE_FLASH stage of the profiling frame.
+*
+*   The pages are written in a circle, so each row is rewritten only once per
+*   lap of the log (plus the partial flushes of its page), and the emulated
+*   EEPROM spreads every logical row on EVENTLOG_WEAR_LEVELING physical
+*   ones. When the log is full the oldest page is overwritten.
+*   At start the newest record is found from the sequence numbers.
+*
+*   The timestamps are in ms since the start of the run that logged them, so
+*   each record also carries the boot counter of its run: a row of the
+*   emulated EEPROM after the pages holds the counter, incremented and
+*   written by EventLog_Init() and kept across the erase of the log. It is 0
+*   on the first start and in the records kept in RAM only. Two records
+*   with the same boot counter can be compared by timestamp, the last record
+*   of a run and the uptime of the information frame give a lower bound of
+*   the length of that run.
+*
+*   Information frame payload (little endian): records in the log (16 bit),
+*   capacity (16 bit), records not yet in flash (8 bit), page writes since
+*   start (16 bit), duration of the last and of the longest page write in
+*   ms (16 bit each), uptime in ms (32 bit), boot counter (16 bit).
+*   Records frame payload: up to one page of records from the oldest, each
+*   made of timestamp in ms (32 bit), sequence number (16 bit), boot counter
+*   (16 bit), peak X, Y and Z in mg (16 bit signed), type (8 bit), duration
+*   in units of 10 ms (8 bit, saturated).
+*/
+
+#ifndef __EVENT_LOG_H
+    #define __EVENT_LOG_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    
+    /**
+    *   \brief Number of axes of the samples.
+    */
+    #define EVENTLOG_AXES 3
+    
+    /**
+    *   \brief Record of a shock.
+    */
+    #define EVENTLOG_TYPE_SHOCK 0
+    
+    /**
+    *   \brief Record of a free fall.
+    */
+    #define EVENTLOG_TYPE_FREE_FALL 1
+    
+    /**
+    *   \brief Magnitude threshold of the shocks in mg (gravity included).
+    */
+    #ifndef EVENTLOG_SHOCK_MG
+        #define EVENTLOG_SHOCK_MG 2000
+    #endif
+    
+    /**
+    *   \brief Magnitude threshold of the free falls in mg.
+    */
+    #ifndef EVENTLOG_FREE_FALL_MG
+        #define EVENTLOG_FREE_FALL_MG 350
+    #endif
+    
+    /**
+    *   \brief Shortest free fall logged in ms (50 ms is a drop of about 1 cm).
+    */
+    #ifndef EVENTLOG_FREE_FALL_MS
+        #define EVENTLOG_FREE_FALL_MS 50u
+    #endif
+    
+    /**
+    *   \brief Time without the condition of an event that closes it, in ms.
+    */
+    #ifndef EVENTLOG_HOLDOFF_MS
+        #define EVENTLOG_HOLDOFF_MS 100u
+    #endif
+    
+    /**
+    *   \brief Longest time a record waits in RAM before its page is written, in ms.
+    */
+    #ifndef EVENTLOG_FLUSH_MS
+        #define EVENTLOG_FLUSH_MS 10000u
+    #endif
+    
+    /**
+    *   \brief Pages of the log.
+    */
+    #ifndef EVENTLOG_PAGES
+        #define EVENTLOG_PAGES 8u
+    #endif
+    
+    /**
+    *   \brief Physical copies of each row of the emulated EEPROM.
+    */
+    #ifndef EVENTLOG_WEAR_LEVELING
+        #define EVENTLOG_WEAR_LEVELING 2u
+    #endif
+    
+    /**
+    *   \brief Bytes of a page, the data held by a row of the emulated EEPROM.
+    */
+    #define EVENTLOG_PAGE_SIZE (CY_FLASH_SIZEOF_ROW/2u)
+    
+    /**
+    *   \brief Bytes of a record in flash, CRC and alignment padding included.
+    */
+    #define EVENTLOG_RECORD_SIZE 20u
+    
+    /**
+    *   \brief Records of a page.
+    */
+    #define EVENTLOG_PAGE_RECORDS (EVENTLOG_PAGE_SIZE/EVENTLOG_RECORD_SIZE)
+    
+    /**
+    *   \brief Bytes of a record in the records frame.
+    */
+    #define EVENTLOG_FRAME_RECORD_SIZE 16u
+    
+    /**
+    *   \brief Open the emulated EEPROM, count the start and find the newest
+    *   record.
+    *
+    *   \retval Returns ERROR if the emulated EEPROM can't be used, only the
+    *   records of the current page are then kept, in RAM, or if the boot
+    *   counter could not be written.
+    */
+    ErrorCode EventLog_Init(void);
+    
+    /**
+    *   \brief Run a sample through the detector.
+    *
+    *   \param sample_mg Array of EVENTLOG_AXES calibrated accelerations in mg.
+    */
+    void EventLog_AddSample(const int16_t* sample_mg);
+    
+    /**
+    *   \brief Write the pending page when due.
+    *
+    *   To be called from the main loop, right after a sample so that the
+    *   write has the most time before the next one.
+    */
+    void EventLog_Service(void);
+    
+    /**
+    *   \brief Send the information frame and the records, from the oldest.
+    *
+    *   The pending records are written first, so that the dump shows the log
+    *   as it is in flash.
+    *   \param clear Erase the log after the dump.
+    *   \retval Returns ERROR if a write to the emulated EEPROM failed.
+    */
+    ErrorCode EventLog_Dump(uint8_t clear);
+
+#endif // __EVENT_LOG_H
+/* [] END OF FILE */
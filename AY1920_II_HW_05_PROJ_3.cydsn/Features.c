@@ -0,0 +1,220 @@
+/*
+* This file includes the computation of the vibration features
+* over windows of acceleration samples.
+*/
+
+#include "Features.h"
+#include "Frame.h"
+#include "IntMath.h"
+
+/**
+*   \brief Size of the full circle in the sine table.
+*/
+#define FEATURES_TRIG_POINTS 128
+
+/**
+*   \brief Fractional bits of the twiddle factors.
+*/
+#define FEATURES_TRIG_SHIFT 15
+
+#if (FEATURES_WINDOW > FEATURES_TRIG_POINTS) || (FEATURES_WINDOW & (FEATURES_WINDOW - 1))
+    #error "FEATURES_WINDOW must be a power of 2 not greater than 128"
+#endif
+
+/*
+*   First quarter of sin(2*pi*i/128) in Q1.15.
+*/
+static const int16_t quarter_sine[FEATURES_TRIG_POINTS/4 + 1] = {
+        0,  1608,  3212,  4808,  6393,  7962,  9512, 11039,
+    12539, 14010, 15446, 16846, 18204, 19519, 20787, 22005,
+    23170, 24279, 25329, 26319, 27245, 28105, 28898, 29621,
+    30273, 30852, 31356, 31785, 32137, 32412, 32609, 32728,
+    32767
+};
+
+static const uint8_t band_edges[FEATURES_BANDS + 1] = FEATURES_BAND_EDGES;
+
+// Samples of the current window
+static int16_t window[FEATURES_AXES][FEATURES_WINDOW];
+static uint8_t window_count;
+static uint16_t window_sequence;
+
+// FFT working buffers, shared by the axes
+static int32_t fft_re[FEATURES_WINDOW];
+static int32_t fft_im[FEATURES_WINDOW];
+
+    /*
+    *   sin(2*pi*index/128) in Q1.15, index in [0; 127].
+    */
+    static int32_t Features_Sin(uint8_t index)
+    {
+        index &= (FEATURES_TRIG_POINTS - 1);
+        if (index <= 32)
+        {
+            return quarter_sine[index];
+        }
+        if (index <= 64)
+        {
+            return quarter_sine[64 - index];
+        }
+        if (index <= 96)
+        {
+            return -quarter_sine[index - 64];
+        }
+        return -quarter_sine[128 - index];
+    }
+    
+    /*
+    *   In place radix-2 decimation in time FFT on fft_re/fft_im.
+    *   The inputs are mg values without their mean, below 2^16 in
+    *   magnitude (int16 samples up to full scale after calibration). Each
+    *   value of a stage is a partial DFT of at most N inputs, so its parts
+    *   stay below N*2^16 = 2^23 for N = 128: 8 bits of headroom in 32 bits
+    *   and no per-stage scaling. The twiddle products are computed in 64
+    *   bits before the Q1.15 shift.
+    */
+    static void Features_FFT(void)
+    {
+        uint16_t i, j, k;
+        
+        // Bit reversal permutation
+        for (i = 1, j = 0; i < FEATURES_WINDOW; i++)
+        {
+            uint16_t bit = FEATURES_WINDOW >> 1;
+            while (j & bit)
+            {
+                j ^= bit;
+                bit >>= 1;
+            }
+            j |= bit;
+            if (i < j)
+            {
+                int32_t tmp = fft_re[i];
+                fft_re[i] = fft_re[j];
+                fft_re[j] = tmp;
+                tmp = fft_im[i];
+                fft_im[i] = fft_im[j];
+                fft_im[j] = tmp;
+            }
+        }
+        
+        // Butterflies
+        uint16_t size;
+        for (size = 2; size <= FEATURES_WINDOW; size <<= 1)
+        {
+            uint16_t half = size >> 1;
+            uint8_t step = FEATURES_TRIG_POINTS / size;
+            for (k = 0; k < half; k++)
+            {
+                // W = cos(2*pi*k/size) - j*sin(2*pi*k/size)
+                int32_t wr = Features_Sin(k*step + FEATURES_TRIG_POINTS/4);
+                int32_t wi = -Features_Sin(k*step);
+                for (i = k; i < FEATURES_WINDOW; i += size)
+                {
+                    uint16_t m = i + half;
+                    int32_t tr = (int32_t)(((int64_t)wr*fft_re[m] - (int64_t)wi*fft_im[m]) >> FEATURES_TRIG_SHIFT);
+                    int32_t ti = (int32_t)(((int64_t)wr*fft_im[m] + (int64_t)wi*fft_re[m]) >> FEATURES_TRIG_SHIFT);
+                    fft_re[m] = fft_re[i] - tr;
+                    fft_im[m] = fft_im[i] - ti;
+                    fft_re[i] += tr;
+                    fft_im[i] += ti;
+                }
+            }
+        }
+    }
+
+    void Features_Init(void)
+    {
+        window_count = 0;
+        window_sequence = 0;
+    }
+    
+    uint8_t Features_AddSample(const int16_t* sample_mg)
+    {
+        uint8_t axis;
+        for (axis = 0; axis < FEATURES_AXES; axis++)
+        {
+            window[axis][window_count] = sample_mg[axis];
+        }
+        window_count++;
+        return (window_count >= FEATURES_WINDOW);
+    }
+    
+    uint8_t Features_BuildFrame(uint8_t* frame)
+    {
+        uint8_t* p = frame;
+        uint8_t axis;
+        uint16_t i;
+        
+        *p++ = FEATURES_FRAME_HEADER;
+        p = Frame_Put16(p, window_sequence++);
+        
+        for (axis = 0; axis < FEATURES_AXES; axis++)
+        {
+            const int16_t* x = window[axis];
+            int32_t sum = 0;
+            int64_t sum_sq = 0;
+            int16_t min = x[0];
+            int16_t max = x[0];
+            
+            for (i = 0; i < FEATURES_WINDOW; i++)
+            {
+                sum += x[i];
+                sum_sq += (int32_t)x[i]*x[i];
+                if (x[i] < min) min = x[i];
+                if (x[i] > max) max = x[i];
+            }
+            
+            // RMS of the signal without its mean value
+            int32_t mean = sum / FEATURES_WINDOW;
+            int64_t variance = sum_sq / FEATURES_WINDOW - (int64_t)mean*mean;
+            uint16_t rms = IntMath_Sqrt(variance > 0 ? (uint32_t)variance : 0);
+            
+            // Crest factor, Q8.8
+            int32_t peak = max - mean;
+            if (mean - min > peak)
+            {
+                peak = mean - min;
+            }
+            uint32_t crest = rms ? ((uint32_t)peak << 8) / rms : 0;
+            if (crest > UINT16_MAX)
+            {
+                crest = UINT16_MAX;
+            }
+            
+            p = Frame_Put16(p, rms);
+            p = Frame_Put16(p, (uint16_t)(max - min));
+            p = Frame_Put16(p, (uint16_t)crest);
+            
+            // Spectrum of the window without its mean value
+            for (i = 0; i < FEATURES_WINDOW; i++)
+            {
+                fft_re[i] = x[i] - mean;
+                fft_im[i] = 0;
+            }
+            Features_FFT();
+            
+            // Band RMS from Parseval: 2*sum(|X[k]|^2)/N^2 over the one-sided band
+            uint8_t band;
+            for (band = 0; band < FEATURES_BANDS; band++)
+            {
+                uint64_t energy = 0;
+                for (i = band_edges[band]; i < band_edges[band + 1]; i++)
+                {
+                    energy += (uint64_t)((int64_t)fft_re[i]*fft_re[i]) +
+                              (uint64_t)((int64_t)fft_im[i]*fft_im[i]);
+                }
+                energy = (energy * 2) / ((uint32_t)FEATURES_WINDOW*FEATURES_WINDOW);
+                p = Frame_Put16(p, IntMath_Sqrt(energy > UINT32_MAX ? UINT32_MAX : (uint32_t)energy));
+            }
+        }
+        
+        *p++ = FEATURES_FRAME_FOOTER;
+        
+        // Restart the window
+        window_count = 0;
+        
+        return (uint8_t)(p - frame);
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,94 @@
+/**
+*   \file Features.h
+*   \brief Windowed vibration features of the acceleration signal.
+*
+*   Samples are accumulated in windows of FEATURES_WINDOW samples per axis.
+*   At the end of each window the module computes, for every axis:
+*   - the RMS of the signal without its mean value;
+*   - the peak-to-peak value;
+*   - the crest factor (peak / RMS);
+*   - the RMS in FEATURES_BANDS frequency bands, from a fixed-point
+*     radix-2 FFT of the window.
+*
+*   Only one compact feature frame per window is transmitted instead of
+*   the full raw stream.
+*/
+
+#ifndef __FEATURES_H
+    #define __FEATURES_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Number of axes processed.
+    */
+    #define FEATURES_AXES 3
+    
+    /**
+    *   \brief Samples per window, power of 2 between 8 and 128.
+    */
+    #ifndef FEATURES_WINDOW
+        #define FEATURES_WINDOW 128
+    #endif
+    
+    /**
+    *   \brief Edges of the frequency bands, as FFT bin indexes.
+    *
+    *   Band i covers the bins [edge i; edge i+1). The last edge must not
+    *   exceed FEATURES_WINDOW/2. With a 100 Hz ODR and 128 samples each bin
+    *   is 0.78 Hz wide.
+    */
+    #ifndef FEATURES_BAND_EDGES
+        #define FEATURES_BAND_EDGES { 1, 8, 16, 32, 64 }
+    #endif
+    
+    /**
+    *   \brief Number of bands, one less than the number of edges.
+    */
+    #ifndef FEATURES_BANDS
+        #define FEATURES_BANDS 4
+    #endif
+    
+    /**
+    *   \brief Header of the feature frame.
+    */
+    #define FEATURES_FRAME_HEADER 0xA1
+    
+    /**
+    *   \brief Footer of the feature frame.
+    */
+    #define FEATURES_FRAME_FOOTER 0xC0
+    
+    /**
+    *   \brief Size of the feature frame in bytes.
+    *
+    *   Header, 16-bit window counter, per axis RMS, peak-to-peak, crest
+    *   factor and band RMS (16 bits each), footer.
+    */
+    #define FEATURES_FRAME_SIZE (1 + 2 + FEATURES_AXES*2*(3 + FEATURES_BANDS) + 1)
+    
+    /**
+    *   \brief Clear the window.
+    */
+    void Features_Init(void);
+    
+    /**
+    *   \brief Add a sample to the current window.
+    *
+    *   \param sample_mg Array of FEATURES_AXES accelerations in mg.
+    *   \retval Returns 1 when the window is full and a frame can be built.
+    */
+    uint8_t Features_AddSample(const int16_t* sample_mg);
+    
+    /**
+    *   \brief Compute the features of the full window and pack them.
+    *
+    *   Values are little endian: RMS, peak-to-peak and band RMS in mg,
+    *   crest factor in Q8.8. The window is restarted.
+    *   \param frame Buffer of at least FEATURES_FRAME_SIZE bytes.
+    *   \retval Number of bytes written in the frame.
+    */
+    uint8_t Features_BuildFrame(uint8_t* frame);
+    
+#endif // __FEATURES_H
+/* [] END OF FILE */
@@ -0,0 +1,176 @@
+/*
+* This file includes the fixed-point implementation of the
+* filter chain applied to the acceleration samples.
+*/
+
+#include "Filter.h"
+
+/**
+*   \brief Fractional bits of the biquad coefficients.
+*/
+#define FILTER_COEFF_SHIFT 30
+
+/**
+*   \brief Extra fractional bits carried by the DC-removal and biquad state.
+*
+*   Keeps the requantization noise fed back through the poles well below
+*   one LSB of the 16-bit sample: with integer state, the truncation of the
+*   DC-removal feedback alone offsets the output by about 100 LSB.
+*/
+#define FILTER_STATE_SHIFT 8
+
+/**
+*   \brief Coefficients of a biquad section, Q2.30.
+*
+*   y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] - a1*y[n-1] - a2*y[n-2]
+*/
+typedef struct {
+    int32_t b0, b1, b2, a1, a2;
+} Biquad_Coeffs;
+
+/**
+*   \brief Direct form I state of a biquad section.
+*/
+typedef struct {
+    int32_t x1, x2, y1, y2;
+} Biquad_State;
+
+/*
+*   Coefficient tables. Butterworth sections designed with the bilinear
+*   transform, sections ordered by increasing Q to limit internal gain.
+*/
+#if (FILTER_CONFIG == FILTER_CONFIG_LP_020_DEC2)
+    #define FILTER_SECTIONS 1
+    #define FILTER_DECIMATION 2
+    static const Biquad_Coeffs filter_coeffs[FILTER_SECTIONS] = {
+        { 221805086, 443610172, 221805086,  -396777000, 210255520 }
+    };
+#elif (FILTER_CONFIG == FILTER_CONFIG_LP_010_DEC4)
+    #define FILTER_SECTIONS 2
+    #define FILTER_DECIMATION 4
+    static const Biquad_Coeffs filter_coeffs[FILTER_SECTIONS] = {
+        {  66448722, 132897445,  66448722, -1125925222, 317978288 },
+        {  83704983, 167409966,  83704983, -1418319996, 679398104 }
+    };
+#elif (FILTER_CONFIG == FILTER_CONFIG_LP_005_DEC8)
+    #define FILTER_SECTIONS 2
+    #define FILTER_DECIMATION 8
+    static const Biquad_Coeffs filter_coeffs[FILTER_SECTIONS] = {
+        {  20440642,  40881285,  20440642, -1588788093, 596808838 },
+        {  23497607,  46995214,  23497607, -1826396544, 846645148 }
+    };
+#else
+    #define FILTER_SECTIONS 0
+    #define FILTER_DECIMATION 1
+#endif
+
+#if (FILTER_SECTIONS > 0)
+    static Biquad_State filter_state[FILTER_AXES][FILTER_SECTIONS];
+#endif
+
+#if (FILTER_DC_REMOVAL)
+    static int32_t dc_x1[FILTER_AXES];
+    static int32_t dc_y1[FILTER_AXES];
+#endif
+
+static uint8_t decimation_counter;
+
+    /*
+    *   Saturate a 32-bit value to the int16 range.
+    */
+    static CY_INLINE int16_t Filter_Saturate(int32_t value)
+    {
+        if (value > INT16_MAX)
+        {
+            return INT16_MAX;
+        }
+        if (value < INT16_MIN)
+        {
+            return INT16_MIN;
+        }
+        return (int16_t)value;
+    }
+    
+    void Filter_Init(void)
+    {
+        uint8_t axis;
+        for (axis = 0; axis < FILTER_AXES; axis++)
+        {
+        #if (FILTER_SECTIONS > 0)
+            uint8_t section;
+            for (section = 0; section < FILTER_SECTIONS; section++)
+            {
+                filter_state[axis][section] = (Biquad_State){ 0, 0, 0, 0 };
+            }
+        #endif
+        #if (FILTER_DC_REMOVAL)
+            dc_x1[axis] = 0;
+            dc_y1[axis] = 0;
+        #endif
+        }
+        decimation_counter = 0;
+    }
+    
+    uint8_t Filter_Process(int16_t* sample)
+    {
+        uint8_t axis;
+        for (axis = 0; axis < FILTER_AXES; axis++)
+        {
+            int32_t x = sample[axis];
+        
+        #if (FILTER_DC_REMOVAL || FILTER_SECTIONS > 0)
+            x <<= FILTER_STATE_SHIFT;
+        #endif
+        
+        #if (FILTER_DC_REMOVAL)
+            // y[n] = x[n] - x[n-1] + p*y[n-1]
+            int32_t y = x - dc_x1[axis] +
+                        (int32_t)(((int64_t)FILTER_DC_POLE_Q15 * dc_y1[axis] + (1 << 14)) >> 15);
+            dc_x1[axis] = x;
+            dc_y1[axis] = y;
+            x = y;
+        #endif
+        
+        #if (FILTER_SECTIONS > 0)
+            uint8_t section;
+            for (section = 0; section < FILTER_SECTIONS; section++)
+            {
+                const Biquad_Coeffs* c = &filter_coeffs[section];
+                Biquad_State* s = &filter_state[axis][section];
+                // 64-bit accumulator maps on the SMLAL instruction
+                int64_t acc = (int64_t)c->b0 * x
+                            + (int64_t)c->b1 * s->x1
+                            + (int64_t)c->b2 * s->x2
+                            - (int64_t)c->a1 * s->y1
+                            - (int64_t)c->a2 * s->y2;
+                int32_t y = (int32_t)((acc + (1LL << (FILTER_COEFF_SHIFT - 1))) >> FILTER_COEFF_SHIFT);
+                s->x2 = s->x1;
+                s->x1 = x;
+                s->y2 = s->y1;
+                s->y1 = y;
+                x = y;
+            }
+        #endif
+        
+        #if (FILTER_DC_REMOVAL || FILTER_SECTIONS > 0)
+            x = (x + (1 << (FILTER_STATE_SHIFT - 1))) >> FILTER_STATE_SHIFT;
+        #endif
+        
+            sample[axis] = Filter_Saturate(x);
+        }
+        
+        // Release one sample every FILTER_DECIMATION inputs
+        if (++decimation_counter < FILTER_DECIMATION)
+        {
+            return 0;
+        }
+        decimation_counter = 0;
+        return 1;
+    }
+    
+    uint8_t Filter_GetDecimation(void)
+    {
+        return FILTER_DECIMATION;
+    }
+
+/* [] END OF FILE */
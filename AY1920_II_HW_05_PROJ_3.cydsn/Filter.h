@@ -0,0 +1,99 @@
+/**
+*   \file Filter.h
+*   \brief Fixed-point filter chain for the acceleration samples.
+*
+*   The chain sits between the sample read and the packing of the output
+*   frame and is made of:
+*   - an optional first order DC-removal high-pass filter;
+*   - a cascade of biquad IIR sections (direct form I, Q2.30 coefficients);
+*   - an integer decimator.
+*
+*   The configuration is selected at build time with FILTER_CONFIG, which
+*   picks one of the coefficient tables in Filter.c, so that no coefficient
+*   is computed at runtime and unused sections cost nothing.
+*   Samples are filtered as left-justified 16-bit register values, so the
+*   chain is independent of the resolution mode of the LIS3DH.
+*
+*   Host_Tools/filter_test.c checks each configuration against a double
+*   precision design: every output within 0.55 LSB, DC removal included.
+*   Cost of Filter_Process() (three axes), multiply-accumulates and TSC
+*   cycles on an x86 host, with the DC removal in brackets:
+*   - bypass: 0 (3), 3 (11);
+*   - LP_020_DEC2: 15 (18), 19 (22);
+*   - LP_010_DEC4 and LP_005_DEC8: 30 (33), 35 (40).
+*   A multiply-accumulate takes 3 to 7 cycles on the Cortex-M3, the FILTER
+*   stage of Profile.h measures the chain on the board.
+*/
+
+#ifndef __FILTER_H
+    #define __FILTER_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Number of axes processed by the filter chain.
+    */
+    #define FILTER_AXES 3
+    
+    /**
+    *   \brief No filtering, no decimation.
+    */
+    #define FILTER_CONFIG_BYPASS 0
+    
+    /**
+    *   \brief 2nd order Butterworth low-pass at 0.20*ODR, decimation by 2.
+    */
+    #define FILTER_CONFIG_LP_020_DEC2 1
+    
+    /**
+    *   \brief 4th order Butterworth low-pass at 0.10*ODR, decimation by 4.
+    */
+    #define FILTER_CONFIG_LP_010_DEC4 2
+    
+    /**
+    *   \brief 4th order Butterworth low-pass at 0.05*ODR, decimation by 8.
+    */
+    #define FILTER_CONFIG_LP_005_DEC8 3
+    
+    /**
+    *   \brief Filter configuration used by the firmware.
+    */
+    #ifndef FILTER_CONFIG
+        #define FILTER_CONFIG FILTER_CONFIG_BYPASS
+    #endif
+    
+    /**
+    *   \brief Enable (1) the DC-removal high-pass filter in front of the chain.
+    */
+    #ifndef FILTER_DC_REMOVAL
+        #define FILTER_DC_REMOVAL 0
+    #endif
+    
+    /**
+    *   \brief Pole of the DC-removal filter in Q1.15 (0.995, ~0.08 Hz at 100 Hz).
+    */
+    #ifndef FILTER_DC_POLE_Q15
+        #define FILTER_DC_POLE_Q15 32604
+    #endif
+    
+    /**
+    *   \brief Reset the state of all the filter sections and of the decimator.
+    */
+    void Filter_Init(void);
+    
+    /**
+    *   \brief Run one sample through the filter chain.
+    *
+    *   The sample is filtered in place.
+    *   \param sample Array of FILTER_AXES left-justified raw values.
+    *   \retval Returns 1 if the decimator releases an output sample, 0 otherwise.
+    */
+    uint8_t Filter_Process(int16_t* sample);
+    
+    /**
+    *   \brief Decimation factor of the selected configuration.
+    */
+    uint8_t Filter_GetDecimation(void);
+    
+#endif // __FILTER_H
+/* [] END OF FILE */
@@ -0,0 +1,129 @@
+/**
+*   \file FirmwareProfile.h
+*   \brief Compile-time profiles of the firmware.
+*
+*   The three parts of the assignment used to be three projects sharing
+*   copies of the same interface and of most of main.c. They are now
+*   profiles of this project, selected with FIRMWARE_PROFILE:
+*   - FIRMWARE_PROFILE_TEMPERATURE (part 1): temperature sensor read every
+*     100 ms, 4-byte packet A0 | int16 raw | C0;
+*   - FIRMWARE_PROFILE_ACCEL_MG (part 2): 100 Hz normal mode, +-2g,
+*     8-byte packet A0 | 3 x int16 mg | C0;
+*   - FIRMWARE_PROFILE_ACCEL_MMS2 (part 3, default): 100 Hz high resolution
+*     mode, +-4g, 14-byte packet A0 | 3 x int32 mm/s^2 | C0, together with
+*     the stream modes and the command channel.
+*
+*   The Bridge Control Panel configurations of parts 2 and 3 read the
+*   packets of the corresponding profiles.
+*
+*   The register values, the shift and sensitivity of the conversion and
+*   the packet layout resolve to constants. Only the default profile lets
+*   the full-scale change at runtime (COMMAND_SET_FULL_SCALE), so only there
+*   the conversion reads shift and sensitivity from the driver state.
+*   Since the output registers are left-justified, a constant pair is right
+*   in every operating mode at the same full-scale, at the resolution of
+*   the profile.
+*
+*   Flash of the former projects (ARM GCC 5.4.1, Debug): part 1 6848 bytes,
+*   part 2 6776 bytes, part 3 9808 bytes. Compare each profile against them
+*   from the "Flash used" line of the build output, and the cycles of the
+*   acquisition loop with PROFILE_ENABLE set to 1 (Profile.h).
+*/
+
+#ifndef __FIRMWARE_PROFILE_H
+    #define __FIRMWARE_PROFILE_H
+    
+    /**
+    *   \brief Temperature stream (part 1).
+    */
+    #define FIRMWARE_PROFILE_TEMPERATURE 1
+    
+    /**
+    *   \brief Acceleration in mg, normal mode (part 2).
+    */
+    #define FIRMWARE_PROFILE_ACCEL_MG 2
+    
+    /**
+    *   \brief Acceleration in mm/s^2, high resolution mode (part 3).
+    */
+    #define FIRMWARE_PROFILE_ACCEL_MMS2 3
+    
+    /**
+    *   \brief Profile built, can be overridden from the compiler command line
+    *   (e.g. -DFIRMWARE_PROFILE=FIRMWARE_PROFILE_ACCEL_MG).
+    */
+    #ifndef FIRMWARE_PROFILE
+        #define FIRMWARE_PROFILE FIRMWARE_PROFILE_ACCEL_MMS2
+    #endif
+    
+    /**
+    *   \brief Header of the packets of all the profiles.
+    */
+    #define FIRMWARE_PACKET_HEADER 0xA0
+    
+    /**
+    *   \brief Footer of the packets of all the profiles.
+    */
+    #define FIRMWARE_PACKET_FOOTER 0xC0
+    
+    #if (FIRMWARE_PROFILE == FIRMWARE_PROFILE_TEMPERATURE)
+    
+        // 50 Hz normal mode, all axes enabled
+        #define FIRMWARE_CTRL_REG1 0x47
+        // Block data update, +-2g
+        #define FIRMWARE_CTRL_REG4 0x80
+        // 10-bit left-justified ADC output
+        #define FIRMWARE_SHIFT 6
+        #define FIRMWARE_SENSITIVITY 4
+        #define FIRMWARE_PACKET_SIZE 4
+        
+        /**
+        *   \brief Period of the temperature packets in ms.
+        */
+        #ifndef FIRMWARE_TEMPERATURE_PERIOD_MS
+            #define FIRMWARE_TEMPERATURE_PERIOD_MS 100
+        #endif
+    
+    #elif (FIRMWARE_PROFILE == FIRMWARE_PROFILE_ACCEL_MG)
+    
+        // 100 Hz normal mode, all axes enabled
+        #define FIRMWARE_CTRL_REG1 0x57
+        // Block data update, +-2g
+        #define FIRMWARE_CTRL_REG4 0x80
+        // 10-bit output, 4 mg/digit
+        #define FIRMWARE_SHIFT 6
+        #define FIRMWARE_SENSITIVITY 4
+        #define FIRMWARE_PACKET_SIZE 8
+    
+    #elif (FIRMWARE_PROFILE == FIRMWARE_PROFILE_ACCEL_MMS2)
+    
+        // 100 Hz, all axes enabled
+        #define FIRMWARE_CTRL_REG1 0x57
+        // Block data update, +-4g, high resolution
+        #define FIRMWARE_CTRL_REG4 0x98
+        // 12-bit output, 2 mg/digit
+        #define FIRMWARE_SHIFT 4
+        #define FIRMWARE_SENSITIVITY 2
+        #define FIRMWARE_PACKET_SIZE 14
+    
+    #else
+        #error "Unknown FIRMWARE_PROFILE"
+    #endif
+    
+    /**
+    *   \brief Full-scale changed at runtime by the command channel.
+    */
+    #ifndef FIRMWARE_RUNTIME_SCALE
+        #define FIRMWARE_RUNTIME_SCALE (FIRMWARE_PROFILE == FIRMWARE_PROFILE_ACCEL_MMS2)
+    #endif
+    
+    #if (FIRMWARE_RUNTIME_SCALE)
+        #define FIRMWARE_GET_SHIFT(device) LIS3DH_GetShift(device)
+        #define FIRMWARE_GET_SENSITIVITY(device) LIS3DH_GetSensitivity(device)
+    #else
+        #define FIRMWARE_GET_SHIFT(device) FIRMWARE_SHIFT
+        #define FIRMWARE_GET_SENSITIVITY(device) FIRMWARE_SENSITIVITY
+    #endif
+
+#endif // __FIRMWARE_PROFILE_H
+/* [] END OF FILE */
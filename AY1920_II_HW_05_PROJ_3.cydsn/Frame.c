@@ -0,0 +1,82 @@
+/*
+* This file includes the framing of the packets sent on UART_Debug.
+*/
+
+#include "Frame.h"
+#include "CRC.h"
+#include "CyLib.h"
+#include "UART_Debug.h"
+#include "UART_Debug_IntClock.h"
+
+static uint32_t tx_bytes;
+static uint8_t tx_high_watermark;
+
+    void Frame_Write(const uint8_t* data, uint8_t length)
+    {
+        uint8_t level = UART_Debug_GetTxBufferSize();
+        if (level > tx_high_watermark)
+        {
+            tx_high_watermark = level;
+        }
+        tx_bytes += length;
+        UART_Debug_PutArray(data, length);
+    }
+    
+    void Frame_Send(uint8_t header, const uint8_t* payload, uint8_t length)
+    {
+        uint8_t trailer[3];
+        uint16_t crc = CRC16_Update(CRC16_INIT, &header, 1);
+        crc = CRC16_Update(crc, payload, length);
+        
+        trailer[0] = (uint8_t)(crc & 0xFF);
+        trailer[1] = (uint8_t)(crc >> 8);
+        trailer[2] = FRAME_FOOTER;
+        
+        Frame_Write(&header, 1);
+        Frame_Write(payload, length);
+        Frame_Write(trailer, sizeof(trailer));
+    }
+    
+    uint32_t Frame_GetUartBaud(void)
+    {
+        // The divider register holds the division minus one
+        uint32_t divider = (uint32_t)UART_Debug_IntClock_GetDividerRegister() + 1u;
+        return BCLK__BUS_CLK__HZ/divider/UART_Debug_OVER_SAMPLE_COUNT;
+    }
+    
+    uint8_t Frame_IsUartBaudNominal(void)
+    {
+        uint32_t baud = Frame_GetUartBaud();
+        uint32_t tolerance = FRAME_UART_BAUD/50u;
+        return (baud + tolerance >= FRAME_UART_BAUD) && (baud <= FRAME_UART_BAUD + tolerance);
+    }
+    
+    uint32_t Frame_GetTxBytes(void)
+    {
+        return tx_bytes;
+    }
+    
+    uint8_t Frame_TakeTxHighWatermark(void)
+    {
+        uint8_t level = tx_high_watermark;
+        tx_high_watermark = 0;
+        return level;
+    }
+    
+    uint8_t* Frame_Put16(uint8_t* buffer, uint16_t value)
+    {
+        buffer[0] = (uint8_t)(value & 0xFF);
+        buffer[1] = (uint8_t)(value >> 8);
+        return buffer + 2;
+    }
+    
+    uint8_t* Frame_Put32(uint8_t* buffer, uint32_t value)
+    {
+        buffer[0] = (uint8_t)(value & 0xFF);
+        buffer[1] = (uint8_t)(value >> 8);
+        buffer[2] = (uint8_t)(value >> 16);
+        buffer[3] = (uint8_t)(value >> 24);
+        return buffer + 4;
+    }
+
+/* [] END OF FILE */
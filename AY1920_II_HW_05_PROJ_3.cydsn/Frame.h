@@ -0,0 +1,213 @@
+/**
+*   \file Frame.h
+*   \brief Framing of the variable length packets sent on UART_Debug.
+*
+*   Besides the fixed 0xA0 acceleration frame, the firmware sends packets
+*   whose length depends on the configuration. They are framed as
+*
+*       header | payload | CRC-16 (LSB first) | footer
+*
+*   where the CRC covers header and payload, so that the host can
+*   resynchronize on the header and discard corrupted packets.
+*/
+
+#ifndef __FRAME_H
+    #define __FRAME_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Footer of all the frames.
+    */
+    #define FRAME_FOOTER 0xC0
+    
+    /**
+    *   \brief Bytes added by the framing to the payload.
+    */
+    #define FRAME_OVERHEAD 4
+    
+    /**
+    *   \brief Header of the capture information frame.
+    */
+    #define FRAME_HEADER_CAPTURE_INFO 0xA2
+    
+    /**
+    *   \brief Header of the capture data frame.
+    */
+    #define FRAME_HEADER_CAPTURE_DATA 0xA3
+    
+    /**
+    *   \brief Header of the triggered event information frame.
+    */
+    #define FRAME_HEADER_EVENT_INFO 0xA4
+    
+    /**
+    *   \brief Header of the triggered event data frame.
+    */
+    #define FRAME_HEADER_EVENT_DATA 0xA5
+    
+    /**
+    *   \brief Header of the heartbeat frame sent while no motion is detected.
+    */
+    #define FRAME_HEADER_HEARTBEAT 0xA6
+    
+    /**
+    *   \brief Header of the acceleration frame tagged with the output data rate.
+    */
+    #define FRAME_HEADER_TAGGED_DATA 0xA7
+    
+    /**
+    *   \brief Header of the frame sent when the output data rate changes.
+    */
+    #define FRAME_HEADER_RATE_CHANGE 0xA8
+    
+    /**
+    *   \brief Header of the auxiliary ADC frame (temperature and ADC inputs).
+    */
+    #define FRAME_HEADER_AUX_ADC 0xA9
+    
+    /**
+    *   \brief Header of the acceleration frame tagged with the device.
+    */
+    #define FRAME_HEADER_DEVICE_DATA 0xAA
+    
+    /**
+    *   \brief Header of the per-device throughput frame.
+    */
+    #define FRAME_HEADER_DEVICE_STATS 0xAB
+    
+    /**
+    *   \brief Header of the command acknowledge frame.
+    */
+    #define FRAME_HEADER_COMMAND_ACK 0xAC
+    
+    /**
+    *   \brief Header of the stream statistics frame.
+    */
+    #define FRAME_HEADER_STREAM_STATS 0xAD
+    
+    /**
+    *   \brief Header of the profiling frame.
+    */
+    #define FRAME_HEADER_PROFILE 0xAE
+    
+    /**
+    *   \brief Header of the runtime telemetry frame.
+    */
+    #define FRAME_HEADER_TELEMETRY 0xAF
+    
+    /**
+    *   \brief Header of the tilt frame (0xB0 is the sync byte of the commands).
+    */
+    #define FRAME_HEADER_TILT 0xB1
+    
+    /**
+    *   \brief Header of the acceleration frame of a multi-rate channel.
+    */
+    #define FRAME_HEADER_CHANNEL_DATA 0xB2
+    
+    /**
+    *   \brief Header of the event log information frame.
+    */
+    #define FRAME_HEADER_LOG_INFO 0xB3
+    
+    /**
+    *   \brief Header of the event log records frame.
+    */
+    #define FRAME_HEADER_LOG_RECORDS 0xB4
+    
+    /**
+    *   \brief Header of the bus trace information frame.
+    */
+    #define FRAME_HEADER_TRACE_INFO 0xB5
+    
+    /**
+    *   \brief Header of the bus trace entries frame.
+    */
+    #define FRAME_HEADER_TRACE_ENTRIES 0xB6
+    
+    /**
+    *   \brief Header of the latency frame of the bus priority classes.
+    */
+    #define FRAME_HEADER_BUS_CLASSES 0xB7
+    
+    /**
+    *   \brief Baud rate of UART_Debug set in the TopDesign (19200, see the
+    *   note of the schematic), for the link budgets fixed at compile time.
+    *
+    *   Frame_GetUartBaud() gives the rate the UART actually runs at, from
+    *   its generated clock; the firmware warns at start if they differ.
+    */
+    #ifndef FRAME_UART_BAUD
+        #define FRAME_UART_BAUD 19200u
+    #endif
+    
+    /**
+    *   \brief Bit times of a byte on UART_Debug (8N1).
+    */
+    #define FRAME_UART_BITS_PER_BYTE 10u
+    
+    /**
+    *   \brief Bytes per second UART_Debug can carry.
+    */
+    #define FRAME_UART_BYTES_PER_S (FRAME_UART_BAUD/FRAME_UART_BITS_PER_BYTE)
+    
+    /**
+    *   \brief Baud rate of UART_Debug from its generated clock: bus clock
+    *   over the divider of UART_Debug_IntClock and the oversampling of the
+    *   component.
+    */
+    uint32_t Frame_GetUartBaud(void);
+    
+    /**
+    *   \brief Whether the UART runs within 2% of FRAME_UART_BAUD.
+    */
+    uint8_t Frame_IsUartBaudNominal(void);
+    
+    /**
+    *   \brief Send a framed packet on UART_Debug.
+    *
+    *   \param header Header identifying the packet.
+    *   \param payload Payload of the packet.
+    *   \param length Number of bytes of the payload.
+    */
+    void Frame_Send(uint8_t header, const uint8_t* payload, uint8_t length);
+    
+    /**
+    *   \brief Send bytes on UART_Debug without framing.
+    *
+    *   Used for the fixed 0xA0 and 0xA1 frames, so that every byte of the
+    *   stream goes through the transmit counters.
+    *   \param data Bytes to be sent.
+    *   \param length Number of bytes.
+    */
+    void Frame_Write(const uint8_t* data, uint8_t length);
+    
+    /**
+    *   \brief Bytes sent since reset, free running.
+    */
+    uint32_t Frame_GetTxBytes(void);
+    
+    /**
+    *   \brief Highest level of the TX buffer of UART_Debug found before a
+    *   write since the previous call, which clears it.
+    *
+    *   With the 4-byte hardware FIFO only the component reports 0 (empty),
+    *   1 (not full) or 4 (full): 4 means that the writes blocked on the UART.
+    */
+    uint8_t Frame_TakeTxHighWatermark(void);
+    
+    /**
+    *   \brief Write a 16-bit value little endian.
+    *   \retval Pointer past the written bytes.
+    */
+    uint8_t* Frame_Put16(uint8_t* buffer, uint16_t value);
+    
+    /**
+    *   \brief Write a 32-bit value little endian.
+    *   \retval Pointer past the written bytes.
+    */
+    uint8_t* Frame_Put32(uint8_t* buffer, uint32_t value);
+    
+#endif // __FRAME_H
+/* [] END OF FILE */
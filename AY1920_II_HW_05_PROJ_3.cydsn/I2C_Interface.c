@@ -1,6 +1,8 @@
 /*
 * This file includes all the required source code to interface
-* the I2C peripheral.
+* the I2C peripheral. All the transactions go through a queue and
+* are run with the buffer functions of the I2C_Master component,
+* advanced by its interrupt.
 */
 
 /**
@@ -17,13 +19,304 @@
     #define DEVICE_UNCONNECTED 0
 #endif
 
-#include "I2C_Interface.h" 
+#include "I2C_Interface.h"
 #include "I2C_Master.h"
+#include "Timebase.h"
+#include "BusTrace.h"
 
-    ErrorCode I2C_Peripheral_Start(void) 
+/**
+*   \brief Bit times of a byte on the I2C bus, acknowledge included.
+*/
+#define I2C_BITS_PER_BYTE 9
+
+/**
+*   \brief Phases of the transaction on the bus.
+*/
+#define I2C_PHASE_ADDRESS 0         ///< Register address of a read being written
+#define I2C_PHASE_DATA 1            ///< Registers being read after the restart
+#define I2C_PHASE_WRITE 2           ///< Register address and data being written
+
+static BusStats stats;
+static BusClassStats class_stats[BUS_CLASSES];
+
+// Deadline of each class in ms
+static const uint16_t class_deadline_ms[BUS_CLASSES] = {
+    BUS_DEADLINE_SAMPLE_MS, BUS_DEADLINE_CONFIG_MS, BUS_DEADLINE_DIAGNOSTIC_MS
+};
+
+// Transactions waiting for the bus, in order of submission
+static BusTransaction* queue[I2C_QUEUE_DEPTH];
+static uint8_t queued;
+
+// Transaction on the bus and its phase
+static BusTransaction* volatile active;
+static uint8_t active_phase;
+static uint8_t active_register;
+static uint8_t write_buffer[1 + I2C_WRITE_MAX];
+
+// Class of the transactions of the blocking functions
+static BusClass blocking_class = BUS_CLASS_CONFIG;
+
+    /*
+    *   Cause of a failure reported by the I2C_Master component, whose
+    *   status codes are enumerated values and not bit flags.
+    */
+    static BusError I2C_Peripheral_Cause(uint8_t error)
+    {
+        switch (error)
+        {
+            case I2C_Master_MSTR_ERR_LB_NAK:
+                return BUS_ERROR_NAK;
+            case I2C_Master_MSTR_ERR_ARB_LOST:
+                return BUS_ERROR_ARBITRATION;
+            case I2C_Master_MSTR_BUS_BUSY:
+            case I2C_Master_MSTR_NOT_READY:
+                return BUS_ERROR_NOT_READY;
+            default:
+                return BUS_ERROR_OTHER;
+        }
+    }
+    
+    /*
+    *   Account a transaction of the given number of bytes (slave address
+    *   included) and conditions, and convert the status of the I2C_Master
+    *   component to an error code.
+    */
+    static ErrorCode I2C_Peripheral_Account(uint8_t error, uint8_t bytes, uint8_t conditions)
+    {
+        stats.transactions++;
+        stats.bits += (uint32_t)bytes*I2C_BITS_PER_BYTE + conditions;
+        
+        if (error == I2C_Master_MSTR_NO_ERROR)
+        {
+            return NO_ERROR;
+        }
+        stats.errors[I2C_Peripheral_Cause(error)]++;
+        return ERROR;
+    }
+    
+    /*
+    *   Convert the status at the end of a buffer transfer to the error of
+    *   the functions that start it.
+    */
+    static uint8_t I2C_Peripheral_StatusError(uint8_t status)
+    {
+        if (!(status & I2C_Master_MSTAT_ERR_XFER))
+        {
+            return I2C_Master_MSTR_NO_ERROR;
+        }
+        if (status & I2C_Master_MSTAT_ERR_ADDR_NAK)
+        {
+            return I2C_Master_MSTR_ERR_LB_NAK;
+        }
+        if (status & I2C_Master_MSTAT_ERR_ARB_LOST)
+        {
+            return I2C_Master_MSTR_ERR_ARB_LOST;
+        }
+        return I2C_Master_MSTR_ERR_ABORT_START_GEN;
+    }
+    
+    static void I2C_Peripheral_Dispatch(void);
+    
+    /*
+    *   End the active transaction, update the counters of its class and
+    *   start the next one. Called with the interrupts disabled.
+    */
+    static void I2C_Peripheral_Complete(uint8_t error)
+    {
+        BusTransaction* transaction = active;
+        uint32_t latency = Timebase_GetMs() - transaction->submitted_ms;
+        BusClassStats* counters = &class_stats[transaction->bus_class];
+        
+        if (transaction->write && transaction->register_count == 0)
+        {
+            // Probes of the bus scan, a missing device is not a bus error
+            transaction->error = (error == I2C_Master_MSTR_NO_ERROR) ? NO_ERROR : ERROR;
+        }
+        else if (transaction->write)
+        {
+            transaction->error = I2C_Peripheral_Account(error, 2 + transaction->register_count, 2);
+        }
+        else
+        {
+            transaction->error = I2C_Peripheral_Account(error, 3 + transaction->register_count, 3);
+        }
+        
+        // Probes included, a missing device is traced as not acknowledged
+        BUS_TRACE_END(transaction->device_address, transaction->register_address,
+                      transaction->register_count, transaction->write, transaction->bus_class,
+                      error == I2C_Master_MSTR_NO_ERROR ? BUS_TRACE_OK : BUS_TRACE_FAILED(I2C_Peripheral_Cause(error)));
+        
+        counters->transactions++;
+        if (latency > counters->worst_ms)
+        {
+            counters->worst_ms = (latency > 0xFFFF) ? 0xFFFF : (uint16_t)latency;
+        }
+        if (latency > class_deadline_ms[transaction->bus_class] && counters->missed < 0xFFFF)
+        {
+            counters->missed++;
+        }
+        
+        active = NULL;
+        transaction->state = BUS_TRANSACTION_DONE;
+        // The callback may queue the next transaction of a chain
+        if (transaction->done != NULL)
+        {
+            transaction->done(transaction);
+        }
+        I2C_Peripheral_Dispatch();
+    }
+    
+    /*
+    *   Start the next transaction, if the bus is free: the first one passed
+    *   over BUS_MAX_BYPASS times, or else the oldest one of the highest
+    *   class. Called with the interrupts disabled.
+    */
+    static void I2C_Peripheral_Dispatch(void)
+    {
+        uint8_t next = 0;
+        uint8_t i;
+        uint8_t error;
+        
+        if (active != NULL || queued == 0)
+        {
+            return;
+        }
+        for (i = 0; i < queued; i++)
+        {
+            if (queue[i]->bypassed >= BUS_MAX_BYPASS)
+            {
+                next = i;
+                break;
+            }
+            if (queue[i]->bus_class < queue[next]->bus_class)
+            {
+                next = i;
+            }
+        }
+        active = queue[next];
+        for (i = next; i + 1 < queued; i++)
+        {
+            queue[i] = queue[i + 1];
+        }
+        queued--;
+        // Only the lower classes are passed over, the same class keeps its order
+        for (i = 0; i < queued; i++)
+        {
+            if (queue[i]->bus_class > active->bus_class)
+            {
+                queue[i]->bypassed++;
+            }
+        }
+        
+        active->state = BUS_TRANSACTION_ACTIVE;
+        BUS_TRACE_BEGIN();
+        I2C_Master_MasterClearStatus();
+        if (active->write)
+        {
+            uint8_t count = active->register_count;
+            // Auto-increment of the register address when more than one is written
+            write_buffer[0] = active->register_address | (count > 1 ? 0x80 : 0x00);
+            for (i = 0; i < count; i++)
+            {
+                write_buffer[1 + i] = active->data[i];
+            }
+            active_phase = I2C_PHASE_WRITE;
+            // The probes only send the slave address
+            error = I2C_Master_MasterWriteBuf(active->device_address, write_buffer,
+                                              count > 0 ? count + 1 : 0,
+                                              I2C_Master_MODE_COMPLETE_XFER);
+        }
+        else
+        {
+            // Address of the first register with the MSB equal to 1 for the auto-increment
+            active_register = active->register_address | 0x80;
+            active_phase = I2C_PHASE_ADDRESS;
+            error = I2C_Master_MasterWriteBuf(active->device_address, &active_register, 1,
+                                              I2C_Master_MODE_NO_STOP);
+        }
+        if (error != I2C_Master_MSTR_NO_ERROR)
+        {
+            I2C_Peripheral_Complete(error);
+        }
+    }
+    
+    /*
+    *   Move the active transaction to its next phase when the I2C_Master
+    *   component reports the end of the current one. Called from the
+    *   interrupt of the component and, with the interrupts disabled, from
+    *   the polls.
+    */
+    static void I2C_Peripheral_Advance(void)
+    {
+        uint8_t status;
+        
+        if (active == NULL)
+        {
+            return;
+        }
+        status = I2C_Master_MasterStatus();
+        if (status & I2C_Master_MSTAT_ERR_XFER)
+        {
+            I2C_Peripheral_Complete(I2C_Peripheral_StatusError(status));
+        }
+        else if (active_phase == I2C_PHASE_ADDRESS && (status & I2C_Master_MSTAT_WR_CMPLT))
+        {
+            // The bus is held after the register address, read with a restart
+            I2C_Master_MasterClearStatus();
+            active_phase = I2C_PHASE_DATA;
+            uint8_t error = I2C_Master_MasterReadBuf(active->device_address, active->data,
+                                                     active->register_count,
+                                                     I2C_Master_MODE_REPEAT_START);
+            if (error != I2C_Master_MSTR_NO_ERROR)
+            {
+                I2C_Peripheral_Complete(error);
+            }
+        }
+        else if ((active_phase == I2C_PHASE_DATA && (status & I2C_Master_MSTAT_RD_CMPLT)) ||
+                 (active_phase == I2C_PHASE_WRITE && (status & I2C_Master_MSTAT_WR_CMPLT)))
+        {
+            I2C_Peripheral_Complete(I2C_Master_MSTR_NO_ERROR);
+        }
+    }
+    
+    #ifdef I2C_Master_ISR_EXIT_CALLBACK
+    /*
+    *   The next phase or transaction starts from the interrupt, without
+    *   waiting for the next poll.
+    */
+    void I2C_Master_ISR_ExitCallback(void)
+    {
+        I2C_Peripheral_Advance();
+    }
+    #endif
+    
+    /*
+    *   Queue a transaction of the blocking functions and wait for its end.
+    */
+    static ErrorCode I2C_Peripheral_Run(uint8_t device_address, uint8_t register_address,
+                                        uint8_t register_count, uint8_t write, uint8_t* data)
+    {
+        BusTransaction transaction;
+        
+        transaction.device_address = device_address;
+        transaction.register_address = register_address;
+        transaction.register_count = register_count;
+        transaction.write = write;
+        transaction.data = data;
+        transaction.bus_class = blocking_class;
+        transaction.done = NULL;
+        I2C_Peripheral_Submit(&transaction);
+        while (!I2C_Peripheral_Poll(&transaction))
+        {
+        }
+        return transaction.error;
+    }
+    
+    ErrorCode I2C_Peripheral_Start(void)
     {
         // Start I2C peripheral
-        I2C_Master_Start();  
+        I2C_Master_Start();
         
         // Return no error since start function does not return any error
         return NO_ERROR;
@@ -32,39 +325,24 @@
     
     ErrorCode I2C_Peripheral_Stop(void)
     {
+        // Let the queued transactions end
+        while (active != NULL || queued > 0)
+        {
+            uint8 interrupts = CyEnterCriticalSection();
+            I2C_Peripheral_Advance();
+            CyExitCriticalSection(interrupts);
+        }
         // Stop I2C peripheral
         I2C_Master_Stop();
         // Return no error since stop function does not return any error
         return NO_ERROR;
     }
-
-    ErrorCode I2C_Peripheral_ReadRegister(uint8_t device_address, 
+    
+    ErrorCode I2C_Peripheral_ReadRegister(uint8_t device_address,
                                             uint8_t register_address,
                                             uint8_t* data)
     {
-        // Send start condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address,I2C_Master_WRITE_XFER_MODE);
-        if (error == I2C_Master_MSTR_NO_ERROR)
-        {
-            // Write address of register to be read
-            error = I2C_Master_MasterWriteByte(register_address);
-            if (error == I2C_Master_MSTR_NO_ERROR)
-            {
-                // Send restart condition
-                error = I2C_Master_MasterSendRestart(device_address, I2C_Master_READ_XFER_MODE);
-                if (error == I2C_Master_MSTR_NO_ERROR)
-                {
-                    // Read data without acknowledgement
-                    *data = I2C_Master_MasterReadByte(I2C_Master_NAK_DATA);
-                    // Send stop condition and return no error
-                    I2C_Master_MasterSendStop();
-                }
-            }
-        }
-        // Send stop condition if something went wrong
-        I2C_Master_MasterSendStop();
-        // Return error code
-        return error ? ERROR : NO_ERROR;
+        return I2C_Peripheral_Run(device_address, register_address, 1, 0, data);
     }
     
     ErrorCode I2C_Peripheral_ReadRegisterMulti(uint8_t device_address,
@@ -72,59 +350,18 @@
                                                 uint8_t register_count,
                                                 uint8_t* data)
     {
-        // Send start condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address,I2C_Master_WRITE_XFER_MODE);
-        if (error == I2C_Master_MSTR_NO_ERROR)
+        if (register_count == 0)
         {
-            // Write address of register to be read with the MSB equal to 1
-            register_address |= 0x80;
-            error = I2C_Master_MasterWriteByte(register_address);
-            if (error == I2C_Master_MSTR_NO_ERROR)
-            {
-                // Send restart condition
-                error = I2C_Master_MasterSendRestart(device_address, I2C_Master_READ_XFER_MODE);
-                if (error == I2C_Master_MSTR_NO_ERROR)
-                {
-                    // Continue reading until we have register to read
-                    uint8_t counter = register_count;
-                    while(counter>1)
-                    {
-                        data[register_count-counter] =
-                            I2C_Master_MasterReadByte(I2C_Master_ACK_DATA);
-                        counter--;
-                    }
-                    // Read last data without acknowledgement
-                    data[register_count-1]
-                        = I2C_Master_MasterReadByte(I2C_Master_NAK_DATA);
-                }
-            }
+            return ERROR;
         }
-        // Send stop condition
-        I2C_Master_MasterSendStop();
-        // Return error code
-        return error ? ERROR : NO_ERROR;
+        return I2C_Peripheral_Run(device_address, register_address, register_count, 0, data);
     }
     
     ErrorCode I2C_Peripheral_WriteRegister(uint8_t device_address,
                                             uint8_t register_address,
                                             uint8_t data)
     {
-        // Send start condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
-        if (error == I2C_Master_MSTR_NO_ERROR)
-        {
-            // Write register address
-            error = I2C_Master_MasterWriteByte(register_address);
-            if (error == I2C_Master_MSTR_NO_ERROR)
-            {
-                // Write byte of interest
-                error = I2C_Master_MasterWriteByte(data);
-            }
-        }
-        // Send stop condition
-        I2C_Master_MasterSendStop();
-        // Return error code
-        return error ? ERROR : NO_ERROR;
+        return I2C_Peripheral_Run(device_address, register_address, 1, 1, &data);
     }
     
     ErrorCode I2C_Peripheral_WriteRegisterMulti(uint8_t device_address,
@@ -132,49 +369,70 @@
                                             uint8_t register_count,
                                             uint8_t* data)
     {
-        // Send start condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
-        if (error == I2C_Master_MSTR_NO_ERROR)
+        if (register_count == 0 || register_count > I2C_WRITE_MAX)
         {
-            // Write register address
-            error = I2C_Master_MasterWriteByte(register_address);
-            if (error == I2C_Master_MSTR_NO_ERROR)
-            {
-                // Continue writing until we have data to write
-                uint8_t counter = register_count;
-                while(counter >= 0)
-                {
-                     error =
-                        I2C_Master_MasterWriteByte(data[register_count-counter]);
-                    if (error != I2C_Master_MSTR_NO_ERROR)
-                    {
-                        // Send stop condition
-                        I2C_Master_MasterSendStop();
-                        // Return error code
-                        return ERROR;
-                    }
-                    counter--;
-                }
-            }
+            return ERROR;
         }
-        // Send stop condition in case something didn't work out correctly
-        I2C_Master_MasterSendStop();
-        // Return error code
-        return error ? ERROR : NO_ERROR;
+        return I2C_Peripheral_Run(device_address, register_address, register_count, 1, data);
     }
     
     
     uint8_t I2C_Peripheral_IsDeviceConnected(uint8_t device_address)
     {
-        // Send a start condition followed by a stop condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
-        I2C_Master_MasterSendStop();
-        // If no error generated during stop, device is connected
-        if (error == I2C_Master_MSTR_NO_ERROR)
+        // Slave address only, acknowledged if the device is connected
+        if (I2C_Peripheral_Run(device_address, 0, 0, 1, NULL) == NO_ERROR)
         {
             return DEVICE_CONNECTED;
         }
         return DEVICE_UNCONNECTED;
     }
+    
+    ErrorCode I2C_Peripheral_Submit(BusTransaction* transaction)
+    {
+        uint8 interrupts = CyEnterCriticalSection();
+        
+        transaction->submitted_ms = Timebase_GetMs();
+        transaction->bypassed = 0;
+        if (queued >= I2C_QUEUE_DEPTH ||
+            (transaction->write && transaction->register_count > I2C_WRITE_MAX))
+        {
+            transaction->error = ERROR;
+            transaction->state = BUS_TRANSACTION_DONE;
+            CyExitCriticalSection(interrupts);
+            return ERROR;
+        }
+        transaction->state = BUS_TRANSACTION_QUEUED;
+        queue[queued++] = transaction;
+        I2C_Peripheral_Dispatch();
+        
+        CyExitCriticalSection(interrupts);
+        return NO_ERROR;
+    }
+    
+    uint8_t I2C_Peripheral_Poll(BusTransaction* transaction)
+    {
+        uint8 interrupts = CyEnterCriticalSection();
+        I2C_Peripheral_Advance();
+        CyExitCriticalSection(interrupts);
+        
+        return transaction->state == BUS_TRANSACTION_DONE;
+    }
+    
+    BusClass I2C_Peripheral_SetClass(BusClass bus_class)
+    {
+        BusClass previous = blocking_class;
+        blocking_class = bus_class;
+        return previous;
+    }
+    
+    const BusClassStats* I2C_Peripheral_GetClassStats(void)
+    {
+        return class_stats;
+    }
+    
+    const BusStats* I2C_Peripheral_GetStats(void)
+    {
+        return &stats;
+    }
 
-/* [] END OF FILE */
\ No newline at end of file
+/* [] END OF FILE */
@@ -15,6 +15,32 @@
     
     #include "cytypes.h"
     #include "ErrorCodes.h"
+    #include "BusStats.h"
+    #include "BusTransaction.h"
+    
+    /**
+    *   \brief Data rate of the I2C_Master component in bit/s.
+    *
+    *   Only used to report the load of the bus: keep it equal to the
+    *   data rate set in the TopDesign.
+    */
+    #ifndef I2C_PERIPHERAL_BIT_RATE
+        #define I2C_PERIPHERAL_BIT_RATE 100000u
+    #endif
+    
+    /**
+    *   \brief Transactions waiting for the bus at the same time.
+    */
+    #ifndef I2C_QUEUE_DEPTH
+        #define I2C_QUEUE_DEPTH 8
+    #endif
+    
+    /**
+    *   \brief Longest write, in registers.
+    */
+    #ifndef I2C_WRITE_MAX
+        #define I2C_WRITE_MAX 8
+    #endif
     
     /** \brief Start the I2C peripheral.
     *   
@@ -75,7 +101,8 @@
     *   registers
     *   \param device_address I2C address of the device to talk to.
     *   \param register_address Address of the first register to be written.
-    *   \param register_count Number of registers that need to be written.
+    *   \param register_count Number of registers that need to be written, at most
+    *   I2C_WRITE_MAX.
     *   \param data Array of data to be written
     */
     ErrorCode I2C_Peripheral_WriteRegisterMulti(uint8_t device_address,
@@ -92,5 +119,49 @@
     */
     uint8_t I2C_Peripheral_IsDeviceConnected(uint8_t device_address);
     
+    /**
+    *   \brief Queue a transaction on the I2C bus.
+    *
+    *   The transaction is run from the interrupt of the I2C_Master component
+    *   when its turn comes (BusTransaction.h), this function does not wait
+    *   for it. The functions above queue their transaction in the class set
+    *   with I2C_Peripheral_SetClass() and wait for its end.
+    *   \param transaction Transaction to be run, owned by the caller until
+    *   its state is BUS_TRANSACTION_DONE.
+    *   \retval Returns ERROR if the queue is full, the transaction is then
+    *   done with an error.
+    */
+    ErrorCode I2C_Peripheral_Submit(BusTransaction* transaction);
+    
+    /**
+    *   \brief Check the end of a queued transaction.
+    *
+    *   \retval Returns true (>0) if the transaction is over.
+    */
+    uint8_t I2C_Peripheral_Poll(BusTransaction* transaction);
+    
+    /**
+    *   \brief Set the class of the transactions of the blocking functions.
+    *
+    *   \param bus_class Class of the next transactions, BUS_CLASS_CONFIG at start.
+    *   \retval Returns the previous class, to be restored by the caller.
+    */
+    BusClass I2C_Peripheral_SetClass(BusClass bus_class);
+    
+    /**
+    *   \brief Latency counters of each class (array of BUS_CLASSES).
+    */
+    const BusClassStats* I2C_Peripheral_GetClassStats(void);
+    
+    /**
+    *   \brief Traffic and error counters of the I2C bus.
+    *
+    *   Every byte counts 9 bit times (8 data bits and the acknowledge), every
+    *   start, restart and stop condition one more. The probes of
+    *   I2C_Peripheral_IsDeviceConnected() are not counted, since a missing
+    *   device is an expected answer of the bus scan.
+    */
+    const BusStats* I2C_Peripheral_GetStats(void);
+    
 #endif // I2C_Interface_H
 /* [] END OF FILE */
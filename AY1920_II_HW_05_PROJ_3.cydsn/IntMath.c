@@ -0,0 +1,32 @@
+/*
+* This file includes the integer helpers shared by the
+* processing modules.
+*/
+
+#include "IntMath.h"
+
+    uint16_t IntMath_Sqrt(uint32_t value)
+    {
+        uint32_t result = 0;
+        uint32_t bit = 1UL << 30;
+        while (bit > value)
+        {
+            bit >>= 2;
+        }
+        while (bit)
+        {
+            if (value >= result + bit)
+            {
+                value -= result + bit;
+                result = (result >> 1) + bit;
+            }
+            else
+            {
+                result >>= 1;
+            }
+            bit >>= 2;
+        }
+        return (uint16_t)result;
+    }
+
+/* [] END OF FILE */
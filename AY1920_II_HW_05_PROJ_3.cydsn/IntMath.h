@@ -0,0 +1,25 @@
+/**
+*   \file IntMath.h
+*   \brief Integer helpers shared by the processing modules.
+*
+*   Only <stdint.h> is included, so that the helpers also build on the
+*   host with the modules that use them.
+*/
+
+#ifndef __INT_MATH_H
+    #define __INT_MATH_H
+    
+    #include <stdint.h>
+    
+    /**
+    *   \brief Integer square root, rounded down.
+    *
+    *   Bit by bit, with shifts and adds only: 16 iterations at most, no
+    *   division and no table.
+    *   \param value Value of which the square root is computed.
+    *   \retval Returns floor(sqrt(value)).
+    */
+    uint16_t IntMath_Sqrt(uint32_t value);
+    
+#endif // __INT_MATH_H
+/* [] END OF FILE */
@@ -0,0 +1,348 @@
+/*
+* This file includes the driver of the LIS3DH accelerometer.
+*/
+
+#include "LIS3DH.h"
+#include "Sensor_Bus.h"
+
+/**
+*   \brief Position of the ODR field in CTRL_REG1.
+*/
+#define LIS3DH_ODR_SHIFT 4
+
+/**
+*   \brief Position of the FS field in CTRL_REG4.
+*/
+#define LIS3DH_FS_SHIFT 4
+
+/**
+*   \brief Mask of the FS field in CTRL_REG4.
+*/
+#define LIS3DH_FS_MASK 0x30
+
+/**
+*   \brief Position of the FM field in FIFO_CTRL_REG.
+*/
+#define LIS3DH_FM_SHIFT 6
+
+/**
+*   \brief Mask of the FTH field in FIFO_CTRL_REG.
+*/
+#define LIS3DH_FTH_MASK 0x1F
+
+// Output data rates in Hz, normal/high resolution and low power mode
+static const uint16_t odr_hz[2][10] = {
+    { 0, 1, 10, 25, 50, 100, 200, 400,    0, 1344 },
+    { 0, 1, 10, 25, 50, 100, 200, 400, 1600, 5376 }
+};
+
+// Sensitivity in mg/digit by mode and full-scale (AN3308)
+static const uint8_t sensitivity_mg[3][4] = {
+    { 16, 32, 64, 192 },    // low power, 8 bit
+    {  4,  8, 16,  48 },    // normal, 10 bit
+    {  1,  2,  4,  12 }     // high resolution, 12 bit
+};
+
+// INT1_THS step in mg by full-scale
+static const uint8_t int1_threshold_step_mg[4] = { 16, 32, 62, 186 };
+
+// Right shift of the left-justified output by mode
+static const uint8_t output_shift[3] = { 8, 6, 4 };
+
+    ErrorCode LIS3DH_Init(LIS3DH_Device* device, uint8_t address)
+    {
+        device->address = address;
+        ErrorCode error = SensorBus_ReadRegister(address, LIS3DH_CTRL_REG1, &device->ctrl_reg1);
+        if (error == NO_ERROR)
+        {
+            error = SensorBus_ReadRegister(address, LIS3DH_CTRL_REG4, &device->ctrl_reg4);
+        }
+        if (error == NO_ERROR)
+        {
+            error = SensorBus_ReadRegister(address, LIS3DH_CTRL_REG5, &device->ctrl_reg5);
+        }
+        if (error == NO_ERROR)
+        {
+            error = SensorBus_ReadRegister(address, LIS3DH_FIFO_CTRL_REG, &device->fifo_ctrl_reg);
+        }
+        return error;
+    }
+    
+    ErrorCode LIS3DH_SetODR(LIS3DH_Device* device, LIS3DH_ODR odr)
+    {
+        uint8_t value = (uint8_t)((device->ctrl_reg1 & 0x0F) | (odr << LIS3DH_ODR_SHIFT));
+        ErrorCode error = SensorBus_WriteRegister(device->address, LIS3DH_CTRL_REG1, value);
+        if (error == NO_ERROR)
+        {
+            device->ctrl_reg1 = value;
+        }
+        return error;
+    }
+    
+    ErrorCode LIS3DH_SetMode(LIS3DH_Device* device, LIS3DH_Mode mode)
+    {
+        // LPen=1 HR=0: low power, LPen=0 HR=0: normal, LPen=0 HR=1: high resolution
+        uint8_t reg1 = device->ctrl_reg1 & ~LIS3DH_CTRL_REG1_LPEN;
+        uint8_t reg4 = device->ctrl_reg4 & ~LIS3DH_CTRL_REG4_HR;
+        if (mode == LIS3DH_MODE_LOW_POWER)
+        {
+            reg1 |= LIS3DH_CTRL_REG1_LPEN;
+        }
+        else if (mode == LIS3DH_MODE_HIGH_RES)
+        {
+            reg4 |= LIS3DH_CTRL_REG4_HR;
+        }
+        
+        // Clear the bit being removed first, LPen and HR must never be both set
+        ErrorCode error = NO_ERROR;
+        if (mode == LIS3DH_MODE_LOW_POWER)
+        {
+            error = SensorBus_WriteRegister(device->address, LIS3DH_CTRL_REG4, reg4);
+            if (error == NO_ERROR)
+            {
+                error = SensorBus_WriteRegister(device->address, LIS3DH_CTRL_REG1, reg1);
+            }
+        }
+        else
+        {
+            error = SensorBus_WriteRegister(device->address, LIS3DH_CTRL_REG1, reg1);
+            if (error == NO_ERROR)
+            {
+                error = SensorBus_WriteRegister(device->address, LIS3DH_CTRL_REG4, reg4);
+            }
+        }
+        if (error == NO_ERROR)
+        {
+            device->ctrl_reg1 = reg1;
+            device->ctrl_reg4 = reg4;
+        }
+        return error;
+    }
+    
+    ErrorCode LIS3DH_SetFullScale(LIS3DH_Device* device, LIS3DH_FullScale full_scale)
+    {
+        uint8_t value = (uint8_t)((device->ctrl_reg4 & ~LIS3DH_FS_MASK) | (full_scale << LIS3DH_FS_SHIFT));
+        ErrorCode error = SensorBus_WriteRegister(device->address, LIS3DH_CTRL_REG4, value);
+        if (error == NO_ERROR)
+        {
+            device->ctrl_reg4 = value;
+        }
+        return error;
+    }
+    
+    LIS3DH_ODR LIS3DH_GetODR(const LIS3DH_Device* device)
+    {
+        return (LIS3DH_ODR)(device->ctrl_reg1 >> LIS3DH_ODR_SHIFT);
+    }
+    
+    LIS3DH_Mode LIS3DH_GetMode(const LIS3DH_Device* device)
+    {
+        if (device->ctrl_reg1 & LIS3DH_CTRL_REG1_LPEN)
+        {
+            return LIS3DH_MODE_LOW_POWER;
+        }
+        if (device->ctrl_reg4 & LIS3DH_CTRL_REG4_HR)
+        {
+            return LIS3DH_MODE_HIGH_RES;
+        }
+        return LIS3DH_MODE_NORMAL;
+    }
+    
+    LIS3DH_FullScale LIS3DH_GetFullScale(const LIS3DH_Device* device)
+    {
+        return (LIS3DH_FullScale)((device->ctrl_reg4 & LIS3DH_FS_MASK) >> LIS3DH_FS_SHIFT);
+    }
+    
+    uint16_t LIS3DH_GetODRHz(const LIS3DH_Device* device)
+    {
+        uint8_t odr = LIS3DH_GetODR(device);
+        if (odr > LIS3DH_ODR_1344HZ)
+        {
+            return 0;
+        }
+        return odr_hz[LIS3DH_GetMode(device) == LIS3DH_MODE_LOW_POWER][odr];
+    }
+    
+    uint8_t LIS3DH_GetShift(const LIS3DH_Device* device)
+    {
+        return output_shift[LIS3DH_GetMode(device)];
+    }
+    
+    uint8_t LIS3DH_GetSensitivity(const LIS3DH_Device* device)
+    {
+        return sensitivity_mg[LIS3DH_GetMode(device)][LIS3DH_GetFullScale(device)];
+    }
+    
+    ErrorCode LIS3DH_ReadSample(LIS3DH_Device* device, int16_t* raw)
+    {
+        uint8_t data[LIS3DH_SAMPLE_BYTES];
+        BusClass previous = SensorBus_SetClass(BUS_CLASS_SAMPLE);
+        ErrorCode error = SensorBus_ReadRegisterMulti(device->address, LIS3DH_OUT_X_L,
+                                                      LIS3DH_SAMPLE_BYTES, data);
+        SensorBus_SetClass(previous);
+        if (error == NO_ERROR)
+        {
+            uint8_t axis;
+            for (axis = 0; axis < LIS3DH_AXES; axis++)
+            {
+                raw[axis] = (int16_t)(data[2*axis] | (data[2*axis + 1] << 8));
+            }
+        }
+        return error;
+    }
+    
+    ErrorCode LIS3DH_SetFifo(LIS3DH_Device* device, LIS3DH_FifoMode mode, uint8_t watermark)
+    {
+        uint8_t reg5 = device->ctrl_reg5 & ~LIS3DH_CTRL_REG5_FIFO_EN;
+        uint8_t fifo_ctrl = (uint8_t)((device->fifo_ctrl_reg & ~(0xC0 | LIS3DH_FTH_MASK)) |
+                                      (mode << LIS3DH_FM_SHIFT) | (watermark & LIS3DH_FTH_MASK));
+        if (mode != LIS3DH_FIFO_BYPASS)
+        {
+            reg5 |= LIS3DH_CTRL_REG5_FIFO_EN;
+        }
+        
+        // Going through bypass mode resets the FIFO content
+        ErrorCode error = SensorBus_WriteRegister(device->address, LIS3DH_FIFO_CTRL_REG,
+                                                  fifo_ctrl & (uint8_t)~0xC0);
+        if (error == NO_ERROR)
+        {
+            error = SensorBus_WriteRegister(device->address, LIS3DH_CTRL_REG5, reg5);
+        }
+        if (error == NO_ERROR && mode != LIS3DH_FIFO_BYPASS)
+        {
+            error = SensorBus_WriteRegister(device->address, LIS3DH_FIFO_CTRL_REG, fifo_ctrl);
+        }
+        if (error == NO_ERROR)
+        {
+            device->ctrl_reg5 = reg5;
+            device->fifo_ctrl_reg = fifo_ctrl;
+        }
+        return error;
+    }
+    
+    ErrorCode LIS3DH_ReadFifo(LIS3DH_Device* device, int16_t* raw, uint8_t max_samples,
+                              uint8_t* count, uint8_t* overrun)
+    {
+        uint8_t fifo_src;
+        uint8_t data[LIS3DH_FIFO_DEPTH*LIS3DH_SAMPLE_BYTES];
+        
+        *count = 0;
+        // The drains go before the configuration and the diagnostics
+        BusClass previous = SensorBus_SetClass(BUS_CLASS_SAMPLE);
+        ErrorCode error = SensorBus_ReadRegister(device->address, LIS3DH_FIFO_SRC_REG, &fifo_src);
+        if (error != NO_ERROR)
+        {
+            SensorBus_SetClass(previous);
+            return error;
+        }
+        if (overrun)
+        {
+            *overrun = (fifo_src & LIS3DH_FIFO_SRC_OVRN) ? 1 : 0;
+        }
+        
+        // With overrun set the FIFO is full and FSS wraps to 0
+        uint8_t samples = (fifo_src & LIS3DH_FIFO_SRC_OVRN) ? LIS3DH_FIFO_DEPTH : (fifo_src & LIS3DH_FIFO_SRC_FSS);
+        if (samples > max_samples)
+        {
+            samples = max_samples;
+        }
+        if (samples == 0)
+        {
+            SensorBus_SetClass(previous);
+            return NO_ERROR;
+        }
+        
+        // With the FIFO enabled the address rolls back from OUT_Z_H to OUT_X_L
+        error = SensorBus_ReadRegisterMulti(device->address, LIS3DH_OUT_X_L,
+                                            samples*LIS3DH_SAMPLE_BYTES, data);
+        SensorBus_SetClass(previous);
+        if (error == NO_ERROR)
+        {
+            uint8_t i;
+            for (i = 0; i < samples*LIS3DH_AXES; i++)
+            {
+                raw[i] = (int16_t)(data[2*i] | (data[2*i + 1] << 8));
+            }
+            *count = samples;
+        }
+        return error;
+    }
+    
+    ErrorCode LIS3DH_ConfigureInt1(LIS3DH_Device* device, uint8_t int1_cfg, uint16_t threshold_mg,
+                                   uint8_t duration, uint8_t high_pass)
+    {
+        uint16_t threshold = threshold_mg / int1_threshold_step_mg[LIS3DH_GetFullScale(device)];
+        if (threshold > 0x7F)
+        {
+            threshold = 0x7F;
+        }
+        uint8_t reg5 = device->ctrl_reg5 & ~LIS3DH_CTRL_REG5_LIR_INT1;
+        if (int1_cfg)
+        {
+            reg5 |= LIS3DH_CTRL_REG5_LIR_INT1;
+        }
+        
+        ErrorCode error = SensorBus_WriteRegister(device->address, LIS3DH_CTRL_REG2,
+                                                  high_pass ? LIS3DH_CTRL_REG2_HPIS1 : 0x00);
+        if (error == NO_ERROR)
+        {
+            error = SensorBus_WriteRegister(device->address, LIS3DH_INT1_THS, (uint8_t)threshold);
+        }
+        if (error == NO_ERROR)
+        {
+            error = SensorBus_WriteRegister(device->address, LIS3DH_INT1_DURATION, duration & 0x7F);
+        }
+        if (error == NO_ERROR)
+        {
+            error = SensorBus_WriteRegister(device->address, LIS3DH_CTRL_REG5, reg5);
+        }
+        if (error == NO_ERROR)
+        {
+            device->ctrl_reg5 = reg5;
+            error = SensorBus_WriteRegister(device->address, LIS3DH_INT1_CFG, int1_cfg);
+        }
+        if (error == NO_ERROR)
+        {
+            error = SensorBus_WriteRegister(device->address, LIS3DH_CTRL_REG3,
+                                            int1_cfg ? LIS3DH_CTRL_REG3_I1_IA1 : 0x00);
+        }
+        return error;
+    }
+    
+    ErrorCode LIS3DH_ReadInt1Source(LIS3DH_Device* device, uint8_t* source)
+    {
+        BusClass previous = SensorBus_SetClass(BUS_CLASS_DIAGNOSTIC);
+        ErrorCode error = SensorBus_ReadRegister(device->address, LIS3DH_INT1_SRC, source);
+        SensorBus_SetClass(previous);
+        return error;
+    }
+    
+    ErrorCode LIS3DH_EnableAdc(LIS3DH_Device* device, uint8_t enable, uint8_t temperature)
+    {
+        uint8_t temp_cfg = 0;
+        if (enable)
+        {
+            temp_cfg = LIS3DH_TEMP_CFG_ADC_EN | (temperature ? LIS3DH_TEMP_CFG_TEMP_EN : 0);
+        }
+        return SensorBus_WriteRegister(device->address, LIS3DH_TEMP_CFG_REG, temp_cfg);
+    }
+    
+    ErrorCode LIS3DH_ReadAdc(LIS3DH_Device* device, int16_t* raw)
+    {
+        uint8_t data[2*LIS3DH_ADC_CHANNELS];
+        BusClass previous = SensorBus_SetClass(BUS_CLASS_DIAGNOSTIC);
+        ErrorCode error = SensorBus_ReadRegisterMulti(device->address, LIS3DH_OUT_ADC_1L,
+                                                      2*LIS3DH_ADC_CHANNELS, data);
+        SensorBus_SetClass(previous);
+        if (error == NO_ERROR)
+        {
+            uint8_t channel;
+            for (channel = 0; channel < LIS3DH_ADC_CHANNELS; channel++)
+            {
+                raw[channel] = (int16_t)(data[2*channel] | (data[2*channel + 1] << 8));
+            }
+        }
+        return error;
+    }
+
+/* [] END OF FILE */
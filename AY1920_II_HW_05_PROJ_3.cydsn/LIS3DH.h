@@ -0,0 +1,403 @@
+/**
+*   \file LIS3DH.h
+*   \brief Register map and driver of the LIS3DH accelerometer.
+*
+*   The driver keeps a shadow copy of the control registers of each device,
+*   so that a single setting (ODR, resolution mode, full-scale, FIFO) can be
+*   changed with one write and no read-modify-write on the bus. All the
+*   transactions go through the sensor bus interface.
+*/
+
+#ifndef __LIS3DH_H
+    #define __LIS3DH_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    
+    /**
+    *   \brief 7-bit I2C address of the slave device.
+    */
+    #define LIS3DH_DEVICE_ADDRESS 0x18
+    
+    /**
+    *   \brief 7-bit I2C address of a second device with SA0 tied high.
+    */
+    #define LIS3DH_DEVICE_ADDRESS_SA0_HIGH 0x19
+    
+    /**
+    *   \brief Address of the WHO AM I register
+    */
+    #define LIS3DH_WHO_AM_I_REG_ADDR 0x0F
+    
+    /**
+    *   \brief Content of the WHO AM I register
+    */
+    #define LIS3DH_WHO_AM_I 0x33
+    
+    /**
+    *   \brief Address of the ADC output 1 LSB register
+    */
+    #define LIS3DH_OUT_ADC_1L 0x08
+    
+    /**
+    *   \brief Address of the ADC output 3 LSB register (temperature)
+    */
+    #define LIS3DH_OUT_ADC_3L 0x0C
+    
+    /**
+    *   \brief Address of the temperature sensor configuration register
+    */
+    #define LIS3DH_TEMP_CFG_REG 0x1F
+    
+    /**
+    *   \brief Address of the Control register 1
+    */
+    #define LIS3DH_CTRL_REG1 0x20
+    
+    /**
+    *   \brief Address of the Control register 2
+    */
+    #define LIS3DH_CTRL_REG2 0x21
+    
+    /**
+    *   \brief Address of the Control register 3
+    */
+    #define LIS3DH_CTRL_REG3 0x22
+    
+    /**
+    *   \brief Address of the Control register 4
+    */
+    #define LIS3DH_CTRL_REG4 0x23
+    
+    /**
+    *   \brief Address of the Control register 5
+    */
+    #define LIS3DH_CTRL_REG5 0x24
+    
+    /**
+    *   \brief Address of the Status register
+    */
+    #define LIS3DH_STATUS_REG 0x27
+    
+    /**
+    *   \brief Address of the out_x_l register
+    */
+    #define LIS3DH_OUT_X_L 0x28
+    
+    /**
+    *   \brief Address of the out_y_l register
+    */
+    #define LIS3DH_OUT_Y_L 0x2A
+    
+    /**
+    *   \brief Address of the out_z_l register
+    */
+    #define LIS3DH_OUT_Z_L 0x2C
+    
+    /**
+    *   \brief Address of the FIFO control register
+    */
+    #define LIS3DH_FIFO_CTRL_REG 0x2E
+    
+    /**
+    *   \brief Address of the FIFO source register
+    */
+    #define LIS3DH_FIFO_SRC_REG 0x2F
+    
+    /**
+    *   \brief Address of the INT1 configuration register
+    */
+    #define LIS3DH_INT1_CFG 0x30
+    
+    /**
+    *   \brief Address of the INT1 source register
+    */
+    #define LIS3DH_INT1_SRC 0x31
+    
+    /**
+    *   \brief Address of the INT1 threshold register
+    */
+    #define LIS3DH_INT1_THS 0x32
+    
+    /**
+    *   \brief Address of the INT1 duration register
+    */
+    #define LIS3DH_INT1_DURATION 0x33
+    
+    /**
+    *   \brief New data available on all the axes (STATUS_REG).
+    */
+    #define LIS3DH_STATUS_ZYXDA 0x08
+    
+    /**
+    *   \brief A sample has been overwritten before being read (STATUS_REG).
+    */
+    #define LIS3DH_STATUS_ZYXOR 0x80
+    
+    /**
+    *   \brief ADC enable bit (TEMP_CFG_REG).
+    */
+    #define LIS3DH_TEMP_CFG_ADC_EN 0x80
+    
+    /**
+    *   \brief Temperature sensor on ADC channel 3 enable bit (TEMP_CFG_REG).
+    */
+    #define LIS3DH_TEMP_CFG_TEMP_EN 0x40
+    
+    /**
+    *   \brief Low power enable bit (CTRL_REG1).
+    */
+    #define LIS3DH_CTRL_REG1_LPEN 0x08
+    
+    /**
+    *   \brief X, Y and Z axes enable bits (CTRL_REG1).
+    */
+    #define LIS3DH_CTRL_REG1_XYZ_EN 0x07
+    
+    /**
+    *   \brief High-pass filter enabled on the interrupt 1 generator (CTRL_REG2).
+    */
+    #define LIS3DH_CTRL_REG2_HPIS1 0x01
+    
+    /**
+    *   \brief Interrupt generator 1 routed to the INT1 pin (CTRL_REG3).
+    */
+    #define LIS3DH_CTRL_REG3_I1_IA1 0x40
+    
+    /**
+    *   \brief Block data update bit (CTRL_REG4).
+    */
+    #define LIS3DH_CTRL_REG4_BDU 0x80
+    
+    /**
+    *   \brief High resolution bit (CTRL_REG4).
+    */
+    #define LIS3DH_CTRL_REG4_HR 0x08
+    
+    /**
+    *   \brief FIFO enable bit (CTRL_REG5).
+    */
+    #define LIS3DH_CTRL_REG5_FIFO_EN 0x40
+    
+    /**
+    *   \brief Latch of the interrupt 1 request (CTRL_REG5).
+    */
+    #define LIS3DH_CTRL_REG5_LIR_INT1 0x08
+    
+    /**
+    *   \brief OR combination of high events on X, Y and Z (INT1_CFG).
+    */
+    #define LIS3DH_INT1_CFG_XYZ_HIGH 0x2A
+    
+    /**
+    *   \brief AND combination of low events on X, Y and Z (INT1_CFG).
+    */
+    #define LIS3DH_INT1_CFG_XYZ_LOW 0x95
+    
+    /**
+    *   \brief Interrupt active flag (INT1_SRC).
+    */
+    #define LIS3DH_INT1_SRC_IA 0x40
+    
+    /**
+    *   \brief FIFO overrun flag (FIFO_SRC_REG).
+    */
+    #define LIS3DH_FIFO_SRC_OVRN 0x40
+    
+    /**
+    *   \brief Mask of the number of unread samples (FIFO_SRC_REG).
+    */
+    #define LIS3DH_FIFO_SRC_FSS 0x1F
+    
+    /**
+    *   \brief Depth of the FIFO in samples.
+    */
+    #define LIS3DH_FIFO_DEPTH 32
+    
+    /**
+    *   \brief Number of axes.
+    */
+    #define LIS3DH_AXES 3
+    
+    /**
+    *   \brief Bytes of a sample (X, Y and Z, 16 bits each).
+    */
+    #define LIS3DH_SAMPLE_BYTES 6
+    
+    /**
+    *   \brief Auxiliary ADC channels, the third one measures the temperature.
+    */
+    #define LIS3DH_ADC_CHANNELS 3
+    
+    /**
+    *   \brief Output data rates (ODR field of CTRL_REG1).
+    */
+    typedef enum {
+        LIS3DH_ODR_POWER_DOWN,  ///< Power down
+        LIS3DH_ODR_1HZ,         ///< 1 Hz
+        LIS3DH_ODR_10HZ,        ///< 10 Hz
+        LIS3DH_ODR_25HZ,        ///< 25 Hz
+        LIS3DH_ODR_50HZ,        ///< 50 Hz
+        LIS3DH_ODR_100HZ,       ///< 100 Hz
+        LIS3DH_ODR_200HZ,       ///< 200 Hz
+        LIS3DH_ODR_400HZ,       ///< 400 Hz
+        LIS3DH_ODR_1600HZ_LP,   ///< 1.6 kHz, low power mode only
+        LIS3DH_ODR_1344HZ       ///< 1.344 kHz (5.376 kHz in low power mode)
+    } LIS3DH_ODR;
+    
+    /**
+    *   \brief Resolution modes.
+    */
+    typedef enum {
+        LIS3DH_MODE_LOW_POWER,  ///< 8-bit output
+        LIS3DH_MODE_NORMAL,     ///< 10-bit output
+        LIS3DH_MODE_HIGH_RES    ///< 12-bit output
+    } LIS3DH_Mode;
+    
+    /**
+    *   \brief Full-scale ranges (FS field of CTRL_REG4).
+    */
+    typedef enum {
+        LIS3DH_FS_2G,           ///< +-2 g
+        LIS3DH_FS_4G,           ///< +-4 g
+        LIS3DH_FS_8G,           ///< +-8 g
+        LIS3DH_FS_16G           ///< +-16 g
+    } LIS3DH_FullScale;
+    
+    /**
+    *   \brief FIFO modes (FM field of FIFO_CTRL_REG).
+    */
+    typedef enum {
+        LIS3DH_FIFO_BYPASS,         ///< FIFO disabled
+        LIS3DH_FIFO_FIFO,           ///< Stops collecting when full
+        LIS3DH_FIFO_STREAM,         ///< Oldest samples overwritten when full
+        LIS3DH_FIFO_STREAM_TO_FIFO  ///< Stream until trigger, then FIFO
+    } LIS3DH_FifoMode;
+    
+    /**
+    *   \brief State of a LIS3DH device.
+    */
+    typedef struct {
+        uint8_t address;        ///< Bus address of the device
+        uint8_t ctrl_reg1;      ///< Shadow of CTRL_REG1
+        uint8_t ctrl_reg4;      ///< Shadow of CTRL_REG4
+        uint8_t ctrl_reg5;      ///< Shadow of CTRL_REG5
+        uint8_t fifo_ctrl_reg;  ///< Shadow of FIFO_CTRL_REG
+    } LIS3DH_Device;
+    
+    /**
+    *   \brief Bind a device to its address and load the shadow registers.
+    *
+    *   \param device Device to initialize.
+    *   \param address Bus address of the device.
+    */
+    ErrorCode LIS3DH_Init(LIS3DH_Device* device, uint8_t address);
+    
+    /**
+    *   \brief Set the output data rate.
+    */
+    ErrorCode LIS3DH_SetODR(LIS3DH_Device* device, LIS3DH_ODR odr);
+    
+    /**
+    *   \brief Set the resolution mode.
+    */
+    ErrorCode LIS3DH_SetMode(LIS3DH_Device* device, LIS3DH_Mode mode);
+    
+    /**
+    *   \brief Set the full-scale range.
+    */
+    ErrorCode LIS3DH_SetFullScale(LIS3DH_Device* device, LIS3DH_FullScale full_scale);
+    
+    /**
+    *   \brief Current output data rate.
+    */
+    LIS3DH_ODR LIS3DH_GetODR(const LIS3DH_Device* device);
+    
+    /**
+    *   \brief Current resolution mode.
+    */
+    LIS3DH_Mode LIS3DH_GetMode(const LIS3DH_Device* device);
+    
+    /**
+    *   \brief Current full-scale range.
+    */
+    LIS3DH_FullScale LIS3DH_GetFullScale(const LIS3DH_Device* device);
+    
+    /**
+    *   \brief Output data rate in Hz for the current mode.
+    */
+    uint16_t LIS3DH_GetODRHz(const LIS3DH_Device* device);
+    
+    /**
+    *   \brief Right shift from the left-justified output to digits.
+    */
+    uint8_t LIS3DH_GetShift(const LIS3DH_Device* device);
+    
+    /**
+    *   \brief Sensitivity in mg/digit for the current mode and full-scale.
+    */
+    uint8_t LIS3DH_GetSensitivity(const LIS3DH_Device* device);
+    
+    /**
+    *   \brief Read X, Y and Z in a single transaction.
+    *
+    *   \param raw Array of LIS3DH_AXES left-justified values.
+    */
+    ErrorCode LIS3DH_ReadSample(LIS3DH_Device* device, int16_t* raw);
+    
+    /**
+    *   \brief Configure the FIFO.
+    *
+    *   \param mode FIFO mode, LIS3DH_FIFO_BYPASS disables the FIFO.
+    *   \param watermark Watermark level in samples.
+    */
+    ErrorCode LIS3DH_SetFifo(LIS3DH_Device* device, LIS3DH_FifoMode mode, uint8_t watermark);
+    
+    /**
+    *   \brief Drain the FIFO with a single burst transaction.
+    *
+    *   \param raw Array of max_samples*LIS3DH_AXES left-justified values.
+    *   \param max_samples Maximum number of samples to read.
+    *   \param count Number of samples read.
+    *   \param overrun Set to 1 if the FIFO has overflowed, may be NULL.
+    */
+    ErrorCode LIS3DH_ReadFifo(LIS3DH_Device* device, int16_t* raw, uint8_t max_samples,
+                              uint8_t* count, uint8_t* overrun);
+    
+    /**
+    *   \brief Configure the interrupt 1 generator.
+    *
+    *   The interrupt is latched and routed to the INT1 pin.
+    *   \param int1_cfg Value of INT1_CFG, 0 disables the generator.
+    *   \param threshold_mg Threshold in mg, converted for the current full-scale.
+    *   \param duration Minimum duration of the event, in 1/ODR steps.
+    *   \param high_pass 1 to remove gravity with the internal high-pass filter.
+    */
+    ErrorCode LIS3DH_ConfigureInt1(LIS3DH_Device* device, uint8_t int1_cfg, uint16_t threshold_mg,
+                                   uint8_t duration, uint8_t high_pass);
+    
+    /**
+    *   \brief Read (and clear, if latched) the interrupt 1 source register.
+    */
+    ErrorCode LIS3DH_ReadInt1Source(LIS3DH_Device* device, uint8_t* source);
+    
+    /**
+    *   \brief Configure the auxiliary ADC.
+    *
+    *   The ADC is updated at the output data rate and its outputs are
+    *   consistent only with block data update enabled in CTRL_REG4.
+    *   \param enable 1 to enable the ADC, 0 to disable it.
+    *   \param temperature 1 to connect the temperature sensor to channel 3.
+    */
+    ErrorCode LIS3DH_EnableAdc(LIS3DH_Device* device, uint8_t enable, uint8_t temperature);
+    
+    /**
+    *   \brief Read the three ADC channels in a single transaction.
+    *
+    *   \param raw Array of LIS3DH_ADC_CHANNELS left-justified values, 10 bits
+    *   (8 bits in low power mode). The temperature change is 1 digit/degC.
+    */
+    ErrorCode LIS3DH_ReadAdc(LIS3DH_Device* device, int16_t* raw);
+    
+#endif // __LIS3DH_H
+/* [] END OF FILE */
@@ -0,0 +1,247 @@
+/*
+* This file includes the cascade of decimation stages and the
+* channel frames of the multi-rate stream.
+*/
+
+#include "MultiRate.h"
+#include "Filter.h"
+
+/**
+*   \brief Fractional bits of the filter taps.
+*/
+#define MULTIRATE_TAP_SHIFT 15
+
+/**
+*   \brief Taps of the longest filter.
+*/
+#define MULTIRATE_MAX_LENGTH 39
+
+/**
+*   \brief Symmetric low-pass filter of a decimation stage.
+*
+*   Only the nonzero taps of the first half are stored: tap k of the
+*   table is at position k*stride, its mirror at length-1-k*stride.
+*/
+typedef struct {
+    uint8_t decimation;         ///< Input samples per output sample
+    uint8_t length;             ///< Taps, odd
+    uint8_t stride;             ///< Step between the stored taps
+    uint8_t tap_count;          ///< Taps stored, center excluded
+    const int16_t* taps;        ///< Taps of the first half, Q1.15
+    int16_t center;             ///< Center tap, Q1.15
+} MultiRate_Filter;
+
+/**
+*   \brief State of a decimation stage.
+*
+*   Each sample is written twice, the length of the filter apart, so
+*   that the last length samples are always contiguous: line[position + age].
+*/
+typedef struct {
+    int16_t line[MULTIRATE_AXES][2*MULTIRATE_MAX_LENGTH];
+    uint8_t position;
+    uint8_t phase;
+} MultiRate_Stage;
+
+/*
+*   Kaiser windowed sinc designs, DC gain 1. Half-band: cutoff at 1/4 of
+*   the input rate, beta 6; every other tap is zero. Fifth-band: cutoff at
+*   1/10 of the input rate, beta 7.
+*/
+static const int16_t half_band_taps[] = { -22, 417, -2055, 9856 };
+static const int16_t fifth_band_taps[] = {
+       -5,  -17,  -30,  -31,    0,   71,  164,  229,  193,    0,
+     -342, -723, -942, -758,    0, 1345, 3072, 4801, 6080
+};
+
+static const MultiRate_Filter filters[] = {
+    { 2, 15, 2, sizeof(half_band_taps)/sizeof(half_band_taps[0]), half_band_taps, 16376 },
+    { 5, 39, 1, sizeof(fifth_band_taps)/sizeof(fifth_band_taps[0]), fifth_band_taps, 6554 }
+};
+
+static const uint8_t stage_filters[MULTIRATE_STAGE_COUNT] = MULTIRATE_STAGES;
+static const uint8_t channel_stages[MULTIRATE_CHANNELS] = MULTIRATE_CHANNEL_STAGES;
+
+// State of the cascade, shared by all the channels
+static MultiRate_Stage stages[MULTIRATE_STAGE_COUNT];
+
+// Decimation from the ODR, samples sent and link budget of each channel
+static uint16_t channel_decimation[MULTIRATE_CHANNELS];
+static uint16_t channel_sequence[MULTIRATE_CHANNELS];
+static uint8_t channel_enabled[MULTIRATE_CHANNELS];
+
+    /*
+    *   Saturate a 32-bit value to the int16 range.
+    */
+    static int16_t MultiRate_Saturate(int32_t value)
+    {
+        if (value > INT16_MAX)
+        {
+            return INT16_MAX;
+        }
+        if (value < INT16_MIN)
+        {
+            return INT16_MIN;
+        }
+        return (int16_t)value;
+    }
+    
+    /*
+    *   Store a sample in a stage and, once every decimation samples,
+    *   replace it with the output of the stage.
+    */
+    static uint8_t MultiRate_Decimate(MultiRate_Stage* stage, const MultiRate_Filter* filter, int16_t* sample)
+    {
+        uint8_t axis;
+        uint8_t k;
+        
+        stage->position = (stage->position == 0 ? filter->length : stage->position) - 1;
+        for (axis = 0; axis < MULTIRATE_AXES; axis++)
+        {
+            stage->line[axis][stage->position] = sample[axis];
+            stage->line[axis][stage->position + filter->length] = sample[axis];
+        }
+        
+        // Polyphase: the other phases of the filter are never computed
+        if (++stage->phase < filter->decimation)
+        {
+            return 0;
+        }
+        stage->phase = 0;
+        
+        for (axis = 0; axis < MULTIRATE_AXES; axis++)
+        {
+            const int16_t* x = &stage->line[axis][stage->position];
+            // |sum of the taps| < 2, so the sum of the products fits 32 bits
+            int32_t acc = (int32_t)filter->center * x[filter->length/2];
+            for (k = 0; k < filter->tap_count; k++)
+            {
+                uint8_t age = k*filter->stride;
+                acc += (int32_t)filter->taps[k] * ((int32_t)x[age] + x[filter->length - 1 - age]);
+            }
+            sample[axis] = MultiRate_Saturate((acc + (1L << (MULTIRATE_TAP_SHIFT - 1))) >> MULTIRATE_TAP_SHIFT);
+        }
+        return 1;
+    }
+    
+    /*
+    *   Send the sample on the channels taken at the output of a stage.
+    */
+    static uint8_t MultiRate_Send(uint8_t stage, const int16_t* sample)
+    {
+        uint8_t payload[MULTIRATE_PAYLOAD_SIZE];
+        uint8_t* field;
+        uint8_t channel;
+        uint8_t axis;
+        uint8_t frames = 0;
+        
+        for (channel = 0; channel < MULTIRATE_CHANNELS; channel++)
+        {
+            if (channel_stages[channel] != stage || !channel_enabled[channel])
+            {
+                continue;
+            }
+            payload[0] = channel;
+            field = Frame_Put16(&payload[1], channel_decimation[channel]);
+            field = Frame_Put16(field, channel_sequence[channel]++);
+            for (axis = 0; axis < MULTIRATE_AXES; axis++)
+            {
+                field = Frame_Put16(field, (uint16_t)sample[axis]);
+            }
+            Frame_Send(FRAME_HEADER_CHANNEL_DATA, payload, MULTIRATE_PAYLOAD_SIZE);
+            frames++;
+        }
+        return frames;
+    }
+    
+    ErrorCode MultiRate_Init(uint16_t odr_hz)
+    {
+        uint32_t budget = (FRAME_UART_BYTES_PER_S*MULTIRATE_LINK_SHARE)/100u;
+        uint32_t load = 0;
+        uint8_t stage;
+        uint8_t channel;
+        uint8_t considered[MULTIRATE_CHANNELS];
+        uint8_t slowest;
+        uint8_t enabled = 0;
+        uint8_t axis;
+        uint8_t i;
+        
+        for (stage = 0; stage < MULTIRATE_STAGE_COUNT; stage++)
+        {
+            for (axis = 0; axis < MULTIRATE_AXES; axis++)
+            {
+                for (i = 0; i < 2*MULTIRATE_MAX_LENGTH; i++)
+                {
+                    stages[stage].line[axis][i] = 0;
+                }
+            }
+            stages[stage].position = 0;
+            stages[stage].phase = 0;
+        }
+        
+        for (channel = 0; channel < MULTIRATE_CHANNELS; channel++)
+        {
+            // The cascade runs on the output of the filter chain
+            channel_decimation[channel] = Filter_GetDecimation();
+            for (stage = 0; stage < channel_stages[channel] && stage < MULTIRATE_STAGE_COUNT; stage++)
+            {
+                channel_decimation[channel] *= filters[stage_filters[stage]].decimation;
+            }
+            channel_sequence[channel] = 0;
+            channel_enabled[channel] = 0;
+            considered[channel] = 0;
+        }
+        
+        // From the slowest channel, each one is enabled if its frames fit
+        // in what the slower ones left of the budget
+        for (i = 0; i < MULTIRATE_CHANNELS; i++)
+        {
+            uint32_t bytes_per_s;
+            slowest = MULTIRATE_CHANNELS;
+            for (channel = 0; channel < MULTIRATE_CHANNELS; channel++)
+            {
+                if (!considered[channel] &&
+                    (slowest == MULTIRATE_CHANNELS || channel_decimation[channel] > channel_decimation[slowest]))
+                {
+                    slowest = channel;
+                }
+            }
+            considered[slowest] = 1;
+            bytes_per_s = ((uint32_t)odr_hz*MULTIRATE_FRAME_BYTES + channel_decimation[slowest] - 1)/
+                          channel_decimation[slowest];
+            if (load + bytes_per_s <= budget)
+            {
+                load += bytes_per_s;
+                channel_enabled[slowest] = 1;
+                enabled++;
+            }
+        }
+        return (enabled > 0) ? NO_ERROR : ERROR;
+    }
+    
+    uint8_t MultiRate_AddSample(const int16_t* sample_mg)
+    {
+        int16_t sample[MULTIRATE_AXES];
+        uint8_t axis;
+        uint8_t stage;
+        uint8_t frames;
+        
+        for (axis = 0; axis < MULTIRATE_AXES; axis++)
+        {
+            sample[axis] = sample_mg[axis];
+        }
+        frames = MultiRate_Send(0, sample);
+        
+        // Each stage runs on the outputs of the previous one only
+        for (stage = 0; stage < MULTIRATE_STAGE_COUNT; stage++)
+        {
+            if (!MultiRate_Decimate(&stages[stage], &filters[stage_filters[stage]], sample))
+            {
+                break;
+            }
+            frames += MultiRate_Send(stage + 1, sample);
+        }
+        return frames;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,129 @@
+/**
+*   \file MultiRate.h
+*   \brief Several output rates of the same signal from one cascade of
+*   polyphase decimators.
+*
+*   The calibrated samples go through a cascade of FIR decimation stages,
+*   each one anti-aliased by its own low-pass filter:
+*   - half-band stage: decimation by 2, 15 taps (5 multiplications per
+*     output thanks to the zero taps and the symmetry), aliases at -63 dB;
+*   - fifth-band stage: decimation by 5, 39 taps (20 multiplications per
+*     output thanks to the symmetry), aliases at -72 dB.
+*   Each channel takes its samples at the output of one stage, so the
+*   channels share the state of the cascade: with the default stages at
+*   100 Hz the 2.5 Hz channel is computed from the 25 Hz one, not from
+*   the full rate again. The stages are evaluated in polyphase form, only
+*   the phase of the filter aligned with the kept output is computed, and
+*   the passband of every channel is flat (0.01 dB) up to 0.2 times its
+*   output rate.
+*
+*   Channel frame (Frame.h), payload little endian: channel (8 bit),
+*   decimation from the ODR (16 bit), sample counter of the channel
+*   (16 bit), X, Y and Z in mg (16 bit signed). The decimation includes the
+*   one of the filter chain (Filter.h). The delay of each stage is
+*   (taps - 1) / 2 of its input samples.
+*
+*   Each channel frame is MULTIRATE_FRAME_BYTES on the wire and the channels
+*   must fit in MULTIRATE_LINK_SHARE percent of FRAME_UART_BYTES_PER_S: at
+*   19200 baud that is about 100 frames/s. MultiRate_Init() enables the
+*   channels from the slowest and leaves out the ones that don't fit, so
+*   that Frame_Send() never stalls the loop on the TX FIFO. The default
+*   channels take 77.5 frames/s (1163 B/s) at the boot ODR of 100 Hz; at
+*   400 Hz only the 10 Hz channel is left.
+*/
+
+#ifndef __MULTIRATE_H
+    #define __MULTIRATE_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "Frame.h"
+    
+    /**
+    *   \brief Number of axes of the samples.
+    */
+    #define MULTIRATE_AXES 3
+    
+    /**
+    *   \brief Half-band decimation stage, by 2.
+    */
+    #define MULTIRATE_HALF_BAND 0
+    
+    /**
+    *   \brief Fifth-band decimation stage, by 5.
+    */
+    #define MULTIRATE_FIFTH_BAND 1
+    
+    /**
+    *   \brief Stages of the cascade, from the full rate.
+    *
+    *   With the default stages a 100 Hz ODR gives 50, 25, 12.5 and 2.5 Hz at
+    *   their outputs.
+    */
+    #ifndef MULTIRATE_STAGES
+        #define MULTIRATE_STAGES { MULTIRATE_HALF_BAND, MULTIRATE_HALF_BAND, MULTIRATE_HALF_BAND, MULTIRATE_FIFTH_BAND }
+    #endif
+    
+    /**
+    *   \brief Number of stages.
+    */
+    #ifndef MULTIRATE_STAGE_COUNT
+        #define MULTIRATE_STAGE_COUNT 4
+    #endif
+    
+    /**
+    *   \brief Stage output taken by each channel, 0 for the full rate.
+    *
+    *   The default channels are the outputs of the first, the second and the
+    *   fourth stage: 50, 25 and 2.5 Hz at 100 Hz.
+    */
+    #ifndef MULTIRATE_CHANNEL_STAGES
+        #define MULTIRATE_CHANNEL_STAGES { 1, 2, 4 }
+    #endif
+    
+    /**
+    *   \brief Number of channels.
+    */
+    #ifndef MULTIRATE_CHANNELS
+        #define MULTIRATE_CHANNELS 3
+    #endif
+    
+    /**
+    *   \brief Bytes of the payload of the channel frame.
+    */
+    #define MULTIRATE_PAYLOAD_SIZE (1 + 2 + 2 + 2*MULTIRATE_AXES)
+    
+    /**
+    *   \brief Bytes of the channel frame on the wire.
+    */
+    #define MULTIRATE_FRAME_BYTES (MULTIRATE_PAYLOAD_SIZE + FRAME_OVERHEAD)
+    
+    /**
+    *   \brief Percentage of the UART link given to the channel frames.
+    *
+    *   The rest is left to the telemetry and command frames.
+    */
+    #ifndef MULTIRATE_LINK_SHARE
+        #define MULTIRATE_LINK_SHARE 80u
+    #endif
+    
+    /**
+    *   \brief Clear the cascade and the sample counters of the channels and
+    *   enable the channels that fit the link.
+    *
+    *   \param odr_hz Output data rate of the device.
+    *   \retval Returns ERROR if not even the slowest channel fits the link.
+    */
+    ErrorCode MultiRate_Init(uint16_t odr_hz);
+    
+    /**
+    *   \brief Run a sample through the cascade and send a frame on every
+    *   channel with a new sample.
+    *
+    *   \param sample_mg Array of MULTIRATE_AXES calibrated accelerations in mg.
+    *   \retval Number of frames sent.
+    */
+    uint8_t MultiRate_AddSample(const int16_t* sample_mg);
+
+#endif // __MULTIRATE_H
+/* [] END OF FILE */
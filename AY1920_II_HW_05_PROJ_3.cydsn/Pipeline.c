@@ -0,0 +1,192 @@
+/*
+* This file includes the chain of data ready polls and sample reads of
+* the pipelined acquisition, run from the end of each bus transaction.
+*/
+
+#include "Pipeline.h"
+#include "Sensor_Bus.h"
+#include "LIS3DH.h"
+#include "Telemetry.h"
+#include "CyLib.h"
+
+/**
+*   \brief Bytes of the output registers of a sample.
+*/
+#define PIPELINE_SAMPLE_SIZE (2*PIPELINE_AXES)
+
+/**
+*   \brief Samples waiting between the bus stage and the decode stage.
+*/
+#define PIPELINE_BUFFERS 2
+
+static BusTransaction poll_transaction;
+static BusTransaction read_transaction;
+static volatile uint8_t running;
+
+// Bus stage: status of the last poll and samples read, filled from the interrupt
+static uint8_t status_buffer;
+static uint8_t sample_buffer[PIPELINE_BUFFERS][PIPELINE_SAMPLE_SIZE];
+static uint8_t sample_status[PIPELINE_BUFFERS];
+static uint8_t fill_index;
+static uint8_t take_index;
+static volatile uint8_t ready_count;
+
+// Events of the interrupt, moved to the telemetry by Pipeline_Service()
+static volatile uint16_t polls;
+static volatile uint8_t poll_errors;
+static volatile uint8_t read_errors;
+
+    /*
+    *   Check if a transaction is waiting for the bus or on it.
+    */
+    static uint8_t Pipeline_IsPending(const BusTransaction* transaction)
+    {
+        return transaction->state == BUS_TRANSACTION_QUEUED ||
+               transaction->state == BUS_TRANSACTION_ACTIVE;
+    }
+    
+    /*
+    *   Start a poll of the data ready flag, unless stopped or both stage
+    *   buffers are full: Pipeline_Service() starts it again.
+    */
+    static void Pipeline_Poll(void)
+    {
+        if (running && ready_count < PIPELINE_BUFFERS)
+        {
+            SensorBus_Submit(&poll_transaction);
+        }
+    }
+    
+    static void Pipeline_PollDone(BusTransaction* transaction)
+    {
+        polls++;
+        if (transaction->error != NO_ERROR)
+        {
+            poll_errors++;
+        }
+        else if (running && (status_buffer & LIS3DH_STATUS_ZYXDA))
+        {
+            // The three axes are read as soon as they are all available
+            sample_status[fill_index] = status_buffer;
+            read_transaction.data = sample_buffer[fill_index];
+            SensorBus_Submit(&read_transaction);
+            return;
+        }
+        Pipeline_Poll();
+    }
+    
+    static void Pipeline_ReadDone(BusTransaction* transaction)
+    {
+        if (transaction->error != NO_ERROR)
+        {
+            // The sample is lost, the next one is read on the next data ready
+            read_errors++;
+        }
+        else
+        {
+            fill_index = (fill_index + 1) % PIPELINE_BUFFERS;
+            ready_count++;
+        }
+        Pipeline_Poll();
+    }
+    
+    void Pipeline_Init(uint8_t device_address)
+    {
+        poll_transaction.device_address = device_address;
+        poll_transaction.register_address = LIS3DH_STATUS_REG;
+        poll_transaction.register_count = 1;
+        poll_transaction.write = 0;
+        poll_transaction.data = &status_buffer;
+        poll_transaction.bus_class = BUS_CLASS_SAMPLE;
+        poll_transaction.done = Pipeline_PollDone;
+        
+        read_transaction = poll_transaction;
+        read_transaction.register_address = LIS3DH_OUT_X_L;
+        read_transaction.register_count = PIPELINE_SAMPLE_SIZE;
+        read_transaction.done = Pipeline_ReadDone;
+        
+        Pipeline_Stop();
+    }
+    
+    void Pipeline_Stop(void)
+    {
+        // Nothing is submitted by the callbacks any more
+        running = 0;
+        while (Pipeline_IsPending(&poll_transaction))
+        {
+            SensorBus_Poll(&poll_transaction);
+        }
+        while (Pipeline_IsPending(&read_transaction))
+        {
+            SensorBus_Poll(&read_transaction);
+        }
+        fill_index = 0;
+        take_index = 0;
+        ready_count = 0;
+    }
+    
+    uint8_t Pipeline_Service(int16_t* raw)
+    {
+        uint8_t axis;
+        uint8_t status;
+        
+        // Advances the bus if the interrupt does not
+        SensorBus_Poll(&poll_transaction);
+        
+        uint8 interrupts = CyEnterCriticalSection();
+        uint16_t new_polls = polls;
+        uint8_t new_poll_errors = poll_errors;
+        uint8_t new_read_errors = read_errors;
+        polls = 0;
+        poll_errors = 0;
+        read_errors = 0;
+        if (!running)
+        {
+            // First call after a stop, the chain starts with a poll
+            running = 1;
+            Pipeline_Poll();
+        }
+        CyExitCriticalSection(interrupts);
+        
+        while (new_polls > 0)
+        {
+            Telemetry_CountPoll();
+            new_polls--;
+        }
+        if (new_read_errors > 0)
+        {
+            Telemetry_CountSamples(0, new_read_errors);
+        }
+        if (new_poll_errors > 0 || new_read_errors > 0)
+        {
+            return PIPELINE_BUS_ERROR;
+        }
+        if (ready_count == 0)
+        {
+            return PIPELINE_NONE;
+        }
+        
+        // Decode stage: the bus buffer is released once copied
+        for (axis = 0; axis < PIPELINE_AXES; axis++)
+        {
+            raw[axis] = (int16)(sample_buffer[take_index][2*axis] |
+                                (sample_buffer[take_index][2*axis+1]<<8));
+        }
+        status = sample_status[take_index];
+        take_index = (take_index + 1) % PIPELINE_BUFFERS;
+        
+        interrupts = CyEnterCriticalSection();
+        ready_count--;
+        // With both buffers full the chain was left without a transaction
+        if (!Pipeline_IsPending(&poll_transaction) && !Pipeline_IsPending(&read_transaction))
+        {
+            Pipeline_Poll();
+        }
+        CyExitCriticalSection(interrupts);
+        
+        // The overrun flag means that at least one sample was overwritten before this one
+        Telemetry_CountSamples(1, (status & LIS3DH_STATUS_ZYXOR) ? 1 : 0);
+        return PIPELINE_SAMPLE;
+    }
+
+/* [] END OF FILE */
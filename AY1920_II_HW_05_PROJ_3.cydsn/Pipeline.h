@@ -0,0 +1,93 @@
+/**
+*   \file Pipeline.h
+*   \brief Acquisition of the samples overlapped with their processing.
+*
+*   The sequential loop blocks on the sensor bus for the data ready poll
+*   and for the read of the sample, then filters, packs and transmits the
+*   sample: bus time and CPU time add up. The pipeline chains the bus
+*   transactions from the end of the previous one instead, in the sample
+*   class of the bus queue (BusTransaction.h): while sample N goes through
+*   the filter, the conversion and UART_Debug, the bus is already polling
+*   the data ready flag and reading sample N+1.
+*
+*   The stages hand the sample over through their own buffers:
+*   - bus stage: two sample buffers filled from the interrupt, the chain
+*     pauses when both are full until Pipeline_Service() takes one, so it
+*     stops by itself in the stream modes that do not use it;
+*   - decode stage: left-justified raw values copied by Pipeline_Service()
+*     into the array of the caller, which releases the bus buffer;
+*   - pack and transmit stages: the packet buffer of the loop and the
+*     transmit buffer of UART_Debug.
+*
+*   Both loops read the three axes in a single auto-increment transaction:
+*   at 100 kbit/s a sample takes 123 bit times on the bus (poll included)
+*   instead of 183 with one transaction per axis.
+*
+*   At the 19200 baud of UART_Debug (TopDesign) the link, not the bus,
+*   bounds both loops: a 14-byte packet takes 7.3 ms, so at most 137
+*   packets/s. Host_Tools/pipeline_model.c (14-byte packets, 100 to 400 us
+*   of processing per sample, blocking writes into the 4-byte FIFO) gives
+*   the same figures for the two loops: both keep up up to 100 Hz (73% of
+*   the link), at 200 Hz and above both send about 137 samples/s and drop
+*   the rest, at 100 and at 400 kbit/s alike. The pipeline only pays off
+*   with a faster link: at 115200 baud and 1344 Hz it sends about 820
+*   samples/s, against 425 of the sequential loop; both keep up up to
+*   400 Hz.
+*   Compare on the board with the acquired and dropped counters of the
+*   telemetry frames, with PIPELINED_ACQUISITION set to 0 and 1 (main.c).
+*/
+
+#ifndef __PIPELINE_H
+    #define __PIPELINE_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Axes of each sample.
+    */
+    #define PIPELINE_AXES 3
+    
+    /**
+    *   \brief No new sample yet, the bus is busy or the sensor has no new data.
+    */
+    #define PIPELINE_NONE 0
+    
+    /**
+    *   \brief A new sample has been copied to the array of the caller.
+    */
+    #define PIPELINE_SAMPLE 1
+    
+    /**
+    *   \brief A transaction of the chain failed since the previous call.
+    */
+    #define PIPELINE_BUS_ERROR 2
+    
+    /**
+    *   \brief Set the device read by the pipeline.
+    *
+    *   The chain is started by the first call to Pipeline_Service().
+    */
+    void Pipeline_Init(uint8_t device_address);
+    
+    /**
+    *   \brief Stop the chain, wait for the end of its transaction and drop the
+    *   samples not taken yet.
+    *
+    *   To be called before the configuration of the device changes, so that
+    *   no sample read with the old one is returned afterwards.
+    */
+    void Pipeline_Stop(void);
+    
+    /**
+    *   \brief Take the oldest sample read by the chain.
+    *
+    *   The chain is started again after Pipeline_Stop(), and the polls and
+    *   samples are counted in the telemetry.
+    *   \param raw Array of PIPELINE_AXES left-justified raw values, written
+    *   only when PIPELINE_SAMPLE is returned.
+    *   \retval PIPELINE_NONE, PIPELINE_SAMPLE or PIPELINE_BUS_ERROR.
+    */
+    uint8_t Pipeline_Service(int16_t* raw);
+
+#endif // __PIPELINE_H
+/* [] END OF FILE */
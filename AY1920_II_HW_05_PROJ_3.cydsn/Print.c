@@ -0,0 +1,109 @@
+/*
+* This file includes the number formatting of the text messages
+* sent on UART_Debug.
+*/
+
+#include "Print.h"
+#include "Frame.h"
+#include <string.h>
+
+/**
+*   \brief Longest decimal output: sign, 10 digits and the point.
+*/
+#define PRINT_DECIMAL_SIZE 12
+
+/**
+*   \brief Longest hexadecimal output.
+*/
+#define PRINT_HEX_SIZE 8
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+    /*
+    *   Write a magnitude in decimal, with the point before the last
+    *   decimals digits and the sign in front if negative.
+    */
+    static void Print_Decimal(uint32_t magnitude, uint8_t negative, uint8_t decimals)
+    {
+        char buffer[PRINT_DECIMAL_SIZE];
+        uint8_t index = sizeof(buffer);
+        uint8_t digit;
+        
+        // Digits are produced from the least significant one
+        for (digit = 0; digit < decimals; digit++)
+        {
+            buffer[--index] = (char)('0' + magnitude % 10);
+            magnitude /= 10;
+        }
+        if (decimals > 0)
+        {
+            buffer[--index] = '.';
+        }
+        do
+        {
+            buffer[--index] = (char)('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude > 0);
+        if (negative)
+        {
+            buffer[--index] = '-';
+        }
+        Frame_Write((const uint8_t*)&buffer[index], (uint8_t)(sizeof(buffer) - index));
+    }
+    
+    void Print_String(const char* string)
+    {
+        size_t length = strlen(string);
+        // Frame_Write() takes at most 255 bytes at a time
+        while (length > 0)
+        {
+            uint8_t chunk = (uint8_t)(length > 0xFF ? 0xFF : length);
+            Frame_Write((const uint8_t*)string, chunk);
+            string += chunk;
+            length -= chunk;
+        }
+    }
+    
+    void Print_Char(char character)
+    {
+        Frame_Write((const uint8_t*)&character, 1);
+    }
+    
+    void Print_Hex(uint32_t value, uint8_t digits)
+    {
+        char buffer[PRINT_HEX_SIZE];
+        uint8_t index = sizeof(buffer);
+        
+        if (digits > PRINT_HEX_SIZE)
+        {
+            digits = PRINT_HEX_SIZE;
+        }
+        do
+        {
+            buffer[--index] = hex_digits[value & 0x0F];
+            value >>= 4;
+        } while (value > 0 || (uint8_t)(sizeof(buffer) - index) < digits);
+        Frame_Write((const uint8_t*)&buffer[index], (uint8_t)(sizeof(buffer) - index));
+    }
+    
+    void Print_Unsigned(uint32_t value)
+    {
+        Print_Decimal(value, 0, 0);
+    }
+    
+    void Print_Signed(int32_t value)
+    {
+        // The magnitude of INT32_MIN only fits the unsigned type
+        Print_Decimal(value < 0 ? 0u - (uint32_t)value : (uint32_t)value, value < 0, 0);
+    }
+    
+    void Print_Fixed(int32_t value, uint8_t decimals)
+    {
+        if (decimals > PRINT_MAX_DECIMALS)
+        {
+            decimals = PRINT_MAX_DECIMALS;
+        }
+        Print_Decimal(value < 0 ? 0u - (uint32_t)value : (uint32_t)value, value < 0, decimals);
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,65 @@
+/**
+*   \file Print.h
+*   \brief Formatting of text messages on UART_Debug without printf.
+*
+*   One function per type writes its value straight to the UART: digits
+*   are built in a small buffer on the stack, sized for the largest value
+*   of the type, so no format string is parsed and no buffer can overflow.
+*   The bytes go through Frame_Write(), so they are part of the transmit
+*   counters like the binary frames.
+*
+*   A message is written with a sequence of calls, e.g.
+*
+*       Print_String("STATUS REGISTER: 0x");
+*       Print_Hex(status_register, 2);
+*       Print_String("\r\n");
+*/
+
+#ifndef __PRINT_H
+    #define __PRINT_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Maximum number of decimals of Print_Fixed().
+    */
+    #define PRINT_MAX_DECIMALS 9
+    
+    /**
+    *   \brief Write a null terminated string.
+    */
+    void Print_String(const char* string);
+    
+    /**
+    *   \brief Write a single character.
+    */
+    void Print_Char(char character);
+    
+    /**
+    *   \brief Write a value in upper case hexadecimal, without prefix.
+    *
+    *   \param value Value to be written.
+    *   \param digits Minimum number of digits, zero padded (at most 8).
+    */
+    void Print_Hex(uint32_t value, uint8_t digits);
+    
+    /**
+    *   \brief Write an unsigned value in decimal.
+    */
+    void Print_Unsigned(uint32_t value);
+    
+    /**
+    *   \brief Write a signed value in decimal.
+    */
+    void Print_Signed(int32_t value);
+    
+    /**
+    *   \brief Write a fixed-point value in decimal.
+    *
+    *   \param value Value multiplied by 10^decimals (e.g. 9810 and 3 for 9.810).
+    *   \param decimals Digits after the point, at most PRINT_MAX_DECIMALS.
+    */
+    void Print_Fixed(int32_t value, uint8_t decimals);
+
+#endif // __PRINT_H
+/* [] END OF FILE */
@@ -0,0 +1,111 @@
+/*
+* This file includes the table of the stage durations and the
+* profiling frame.
+*/
+
+#include "Profile.h"
+
+#if (PROFILE_ENABLE)
+
+#include "Frame.h"
+#include "Timebase.h"
+#if defined(PROFILE_HOST)
+    #include <time.h>
+#endif
+
+/**
+*   \brief Statistics of a stage.
+*/
+typedef struct {
+    uint32_t count;     ///< Runs of the stage
+    uint32_t min;       ///< Shortest run
+    uint32_t max;       ///< Longest run
+    uint64_t sum;       ///< Total, for the mean
+} ProfileEntry;
+
+uint32_t profile_start[PROFILE_STAGES];
+
+static ProfileEntry table[PROFILE_STAGES];
+static uint32_t last_report_ms;
+
+    /*
+    *   Clear the statistics of all the stages.
+    */
+    static void Profile_Clear(void)
+    {
+        uint8_t stage;
+        for (stage = 0; stage < PROFILE_STAGES; stage++)
+        {
+            table[stage].count = 0;
+            table[stage].min = 0xFFFFFFFFu;
+            table[stage].max = 0;
+            table[stage].sum = 0;
+        }
+    }
+
+#if defined(PROFILE_HOST)
+    uint32_t Profile_HostNow(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint32_t)((uint64_t)ts.tv_sec*1000000000u + (uint64_t)ts.tv_nsec);
+    }
+#endif
+
+    void Profile_Start(void)
+    {
+    #if !defined(PROFILE_HOST)
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    #endif
+        Profile_Clear();
+        last_report_ms = Timebase_GetMs();
+    }
+    
+    void Profile_Record(ProfileStage stage, uint32_t cycles)
+    {
+        ProfileEntry* entry = &table[stage];
+        entry->count++;
+        entry->sum += cycles;
+        if (cycles < entry->min)
+        {
+            entry->min = cycles;
+        }
+        if (cycles > entry->max)
+        {
+            entry->max = cycles;
+        }
+    }
+    
+    void Profile_Service(void)
+    {
+        uint8_t payload[4 + 15*PROFILE_STAGES];
+        uint8_t* p = payload;
+        uint8_t stage;
+        
+        if ((Timebase_GetMs() - last_report_ms) < PROFILE_REPORT_MS)
+        {
+            return;
+        }
+        
+        p = Frame_Put32(p, PROFILE_CLOCK_HZ);
+        for (stage = 0; stage < PROFILE_STAGES; stage++)
+        {
+            ProfileEntry* entry = &table[stage];
+            *p++ = stage;
+            p = Frame_Put16(p, (uint16_t)(entry->count > 0xFFFF ? 0xFFFF : entry->count));
+            p = Frame_Put32(p, entry->count ? entry->min : 0);
+            p = Frame_Put32(p, entry->max);
+            p = Frame_Put32(p, entry->count ? (uint32_t)(entry->sum / entry->count) : 0);
+        }
+        Frame_Send(FRAME_HEADER_PROFILE, payload, (uint8_t)(p - payload));
+        
+        // The frame itself is not part of the next period
+        Profile_Clear();
+        last_report_ms = Timebase_GetMs();
+    }
+
+#endif
+
+/* [] END OF FILE */
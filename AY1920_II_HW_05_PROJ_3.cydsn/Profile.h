@@ -0,0 +1,100 @@
+/**
+*   \file Profile.h
+*   \brief Cycle profiling of the stages of the acquisition loop.
+*
+*   PROFILE_BEGIN() and PROFILE_END() around a stage read the DWT cycle
+*   counter of the Cortex-M3 and keep the minimum, maximum and mean duration
+*   of the stage in a fixed table. PROFILE_SERVICE() sends the table every
+*   PROFILE_REPORT_MS and clears it.
+*
+*   With PROFILE_ENABLE set to 0 (default) the macros expand to nothing. With
+*   PROFILE_HOST defined the counter is the monotonic clock of the host in
+*   nanoseconds, so that the profiles of a host build of the same sources are
+*   reported in the same frame with their own clock (Host_Tools/profile_bench.c).
+*/
+
+#ifndef __PROFILE_H
+    #define __PROFILE_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Compile the instrumentation.
+    */
+    #ifndef PROFILE_ENABLE
+        #define PROFILE_ENABLE 0
+    #endif
+    
+    /**
+    *   \brief Period of the profiling frames in ms.
+    */
+    #ifndef PROFILE_REPORT_MS
+        #define PROFILE_REPORT_MS 1000u
+    #endif
+    
+    /**
+    *   \brief Stages of the acquisition loop.
+    */
+    typedef enum {
+        PROFILE_STAGE_STATUS,       ///< Data ready poll on the sensor bus
+        PROFILE_STAGE_READ,         ///< Reading of the sample on the sensor bus
+        PROFILE_STAGE_FILTER,       ///< Filter chain
+        PROFILE_STAGE_CONVERT,      ///< Conversion to mg and calibration
+        PROFILE_STAGE_PROCESS,      ///< Processing of the stream mode
+        PROFILE_STAGE_PACK,         ///< Conversion to mm/s^2 and byte packing
+        PROFILE_STAGE_UART,         ///< Transmission on UART_Debug
+        PROFILE_STAGE_FLASH,        ///< Page write of the event log (EventLog.h)
+        PROFILE_STAGES
+    } ProfileStage;
+    
+    #if (PROFILE_ENABLE)
+        #if defined(PROFILE_HOST)
+            /**
+            *   \brief Monotonic clock of the host, in ns.
+            */
+            uint32_t Profile_HostNow(void);
+            #define PROFILE_NOW() Profile_HostNow()
+            #define PROFILE_CLOCK_HZ 1000000000u
+        #else
+            #include "CyLib.h"
+            #define PROFILE_NOW() (DWT->CYCCNT)
+            #define PROFILE_CLOCK_HZ BCLK__BUS_CLK__HZ
+        #endif
+        
+        /**
+        *   \brief Counter value at the beginning of each stage.
+        */
+        extern uint32_t profile_start[PROFILE_STAGES];
+        
+        /**
+        *   \brief Add a duration to the statistics of a stage.
+        */
+        void Profile_Record(ProfileStage stage, uint32_t cycles);
+        
+        /**
+        *   \brief Start the cycle counter and clear the table.
+        */
+        void Profile_Start(void);
+        
+        /**
+        *   \brief Send the profiling frame when due.
+        *
+        *   Payload (little endian): counter clock in Hz (32 bit), then for each
+        *   stage the id (8 bit), the number of runs (16 bit), the minimum,
+        *   maximum and mean duration in counts (32 bit each).
+        */
+        void Profile_Service(void);
+        
+        #define PROFILE_START() Profile_Start()
+        #define PROFILE_BEGIN(stage) (profile_start[(stage)] = PROFILE_NOW())
+        #define PROFILE_END(stage) Profile_Record((stage), PROFILE_NOW() - profile_start[(stage)])
+        #define PROFILE_SERVICE() Profile_Service()
+    #else
+        #define PROFILE_START()
+        #define PROFILE_BEGIN(stage)
+        #define PROFILE_END(stage)
+        #define PROFILE_SERVICE()
+    #endif
+    
+#endif // __PROFILE_H
+/* [] END OF FILE */
@@ -0,0 +1,291 @@
+/*
+* This file includes all the required source code to interface
+* the SPI peripheral. It is compiled only when the SPI transport
+* is selected in Sensor_Bus.h, so that projects without the SPIM
+* component in the TopDesign still build.
+*/
+
+#include "Sensor_Bus.h"
+
+#if (SENSOR_BUS_TRANSPORT == SENSOR_BUS_SPI)
+
+#include "SPIM.h"
+#include "SPI_CS.h"
+#include "BusTrace.h"
+
+/**
+*   \brief Value returned if device present on SPI bus.
+*/
+#ifndef DEVICE_CONNECTED
+    #define DEVICE_CONNECTED 1
+#endif
+
+/**
+*   \brief Value returned if device not present on SPI bus.
+*/
+#ifndef DEVICE_UNCONNECTED
+    #define DEVICE_UNCONNECTED 0
+#endif
+
+/**
+*   \brief Read/write flag of the first SPI byte (1 = read).
+*/
+#define SPI_READ_FLAG 0x80
+
+/**
+*   \brief Address auto-increment flag of the first SPI byte.
+*/
+#define SPI_MS_FLAG 0x40
+
+/**
+*   \brief Mask of the register address in the first SPI byte.
+*/
+#define SPI_ADDRESS_MASK 0x3F
+
+/**
+*   \brief Depth of the SPIM hardware FIFOs.
+*/
+#define SPI_FIFO_DEPTH 4
+
+/**
+*   \brief Address of the WHO AM I register, used to probe the device.
+*/
+#define SPI_WHO_AM_I_REG_ADDR 0x0F
+
+static BusStats stats;
+static BusClassStats class_stats[BUS_CLASSES];
+
+// Class of the transactions of the blocking functions
+static BusClass blocking_class = BUS_CLASS_CONFIG;
+
+// Transaction run by SPI_Peripheral_Submit(), reported by the next poll
+static BusTransaction* finished;
+
+    /*
+    *   Exchange register_count bytes after the command byte while keeping
+    *   the TX FIFO full, so that the bus never idles between bytes.
+    *   tx_data may be NULL (dummy bytes are sent) and rx_data may be
+    *   NULL (received bytes are discarded).
+    */
+    static void SPI_Peripheral_Transfer(uint8_t command,
+                                        uint8_t register_count,
+                                        uint8_t* tx_data,
+                                        uint8_t* rx_data)
+    {
+        uint16_t total = (uint16_t)register_count + 1;
+        uint16_t sent = 0;
+        uint16_t received = 0;
+        
+        stats.transactions++;
+        stats.bits += 8*total;
+        class_stats[blocking_class].transactions++;
+        
+        BUS_TRACE_BEGIN();
+        SPIM_ClearRxBuffer();
+        // Assert chip select for the whole transfer
+        SPI_CS_Write(0);
+        
+        while (received < total)
+        {
+            // Refill TX FIFO without overflowing the RX one
+            if ((sent < total) && (sent - received < SPI_FIFO_DEPTH) &&
+                (SPIM_ReadTxStatus() & SPIM_STS_TX_FIFO_NOT_FULL))
+            {
+                if (sent == 0)
+                {
+                    SPIM_WriteTxData(command);
+                }
+                else
+                {
+                    SPIM_WriteTxData(tx_data ? tx_data[sent-1] : 0x00);
+                }
+                sent++;
+            }
+            // Drain RX FIFO, first byte is clocked in during the command
+            if (SPIM_GetRxBufferSize())
+            {
+                uint8_t byte = SPIM_ReadRxData();
+                if (received > 0 && rx_data)
+                {
+                    rx_data[received-1] = byte;
+                }
+                received++;
+            }
+        }
+        
+        // Release chip select
+        SPI_CS_Write(1);
+        BUS_TRACE_END(SPI_PERIPHERAL_DEVICE_ADDRESS, command & SPI_ADDRESS_MASK, register_count,
+                      !(command & SPI_READ_FLAG), blocking_class, BUS_TRACE_OK);
+    }
+    
+    ErrorCode SPI_Peripheral_Start(void) 
+    {
+        // Chip select idle high before the first edge
+        SPI_CS_Write(1);
+        // Start SPI peripheral
+        SPIM_Start();
+        
+        // Return no error since start function does not return any error
+        return NO_ERROR;
+    }
+    
+    
+    ErrorCode SPI_Peripheral_Stop(void)
+    {
+        // Stop SPI peripheral
+        SPIM_Stop();
+        SPI_CS_Write(1);
+        // Return no error since stop function does not return any error
+        return NO_ERROR;
+    }
+    
+    ErrorCode SPI_Peripheral_ReadRegister(uint8_t device_address, 
+                                          uint8_t register_address,
+                                          uint8_t* data)
+    {
+        return SPI_Peripheral_ReadRegisterMulti(device_address, register_address, 1, data);
+    }
+    
+    ErrorCode SPI_Peripheral_ReadRegisterMulti(uint8_t device_address,
+                                               uint8_t register_address,
+                                               uint8_t register_count,
+                                               uint8_t* data)
+    {
+        if (device_address != SPI_PERIPHERAL_DEVICE_ADDRESS || register_count == 0)
+        {
+            stats.errors[BUS_ERROR_OTHER]++;
+            return ERROR;
+        }
+        // Read command, with auto-increment if more than one register is needed
+        uint8_t command = SPI_READ_FLAG | (register_address & SPI_ADDRESS_MASK);
+        if (register_count > 1)
+        {
+            command |= SPI_MS_FLAG;
+        }
+        SPI_Peripheral_Transfer(command, register_count, NULL, data);
+        return NO_ERROR;
+    }
+    
+    ErrorCode SPI_Peripheral_WriteRegister(uint8_t device_address,
+                                           uint8_t register_address,
+                                           uint8_t data)
+    {
+        return SPI_Peripheral_WriteRegisterMulti(device_address, register_address, 1, &data);
+    }
+    
+    ErrorCode SPI_Peripheral_WriteRegisterMulti(uint8_t device_address,
+                                                uint8_t register_address,
+                                                uint8_t register_count,
+                                                uint8_t* data)
+    {
+        if (device_address != SPI_PERIPHERAL_DEVICE_ADDRESS || register_count == 0)
+        {
+            stats.errors[BUS_ERROR_OTHER]++;
+            return ERROR;
+        }
+        // Write command, with auto-increment if more than one register is written
+        uint8_t command = register_address & SPI_ADDRESS_MASK;
+        if (register_count > 1)
+        {
+            command |= SPI_MS_FLAG;
+        }
+        SPI_Peripheral_Transfer(command, register_count, data, NULL);
+        return NO_ERROR;
+    }
+    
+    
+    uint8_t SPI_Peripheral_IsDeviceConnected(uint8_t device_address)
+    {
+        uint8_t who_am_i = 0;
+        // Other addresses are answered without a transfer, so that a bus scan
+        // does not count as errors
+        if (device_address != SPI_PERIPHERAL_DEVICE_ADDRESS)
+        {
+            return DEVICE_UNCONNECTED;
+        }
+        if (SPI_Peripheral_ReadRegister(device_address, SPI_WHO_AM_I_REG_ADDR, &who_am_i) != NO_ERROR)
+        {
+            return DEVICE_UNCONNECTED;
+        }
+        // A floating or shorted MISO line reads back all ones or all zeros
+        if (who_am_i == 0x00 || who_am_i == 0xFF)
+        {
+            return DEVICE_UNCONNECTED;
+        }
+        return DEVICE_CONNECTED;
+    }
+    
+    /*
+    *   Report the end of the transaction run last, so that the transaction
+    *   submitted by its done function runs on the next poll.
+    */
+    static void SPI_Peripheral_Finish(void)
+    {
+        BusTransaction* transaction = finished;
+        
+        if (transaction != NULL)
+        {
+            finished = NULL;
+            transaction->state = BUS_TRANSACTION_DONE;
+            if (transaction->done != NULL)
+            {
+                transaction->done(transaction);
+            }
+        }
+    }
+    
+    ErrorCode SPI_Peripheral_Submit(BusTransaction* transaction)
+    {
+        // Counted in the class of the transaction
+        BusClass previous = SPI_Peripheral_SetClass(transaction->bus_class);
+        
+        SPI_Peripheral_Finish();
+        transaction->bypassed = 0;
+        transaction->submitted_ms = 0;
+        if (transaction->write)
+        {
+            transaction->error = SPI_Peripheral_WriteRegisterMulti(transaction->device_address,
+                                                                   transaction->register_address,
+                                                                   transaction->register_count,
+                                                                   transaction->data);
+        }
+        else
+        {
+            transaction->error = SPI_Peripheral_ReadRegisterMulti(transaction->device_address,
+                                                                  transaction->register_address,
+                                                                  transaction->register_count,
+                                                                  transaction->data);
+        }
+        SPI_Peripheral_SetClass(previous);
+        transaction->state = BUS_TRANSACTION_ACTIVE;
+        finished = transaction;
+        return NO_ERROR;
+    }
+    
+    uint8_t SPI_Peripheral_Poll(BusTransaction* transaction)
+    {
+        SPI_Peripheral_Finish();
+        return transaction->state == BUS_TRANSACTION_DONE;
+    }
+    
+    BusClass SPI_Peripheral_SetClass(BusClass bus_class)
+    {
+        BusClass previous = blocking_class;
+        blocking_class = bus_class;
+        return previous;
+    }
+    
+    const BusClassStats* SPI_Peripheral_GetClassStats(void)
+    {
+        return class_stats;
+    }
+    
+    const BusStats* SPI_Peripheral_GetStats(void)
+    {
+        return &stats;
+    }
+
+#endif // SENSOR_BUS_TRANSPORT == SENSOR_BUS_SPI
+
+/* [] END OF FILE */
@@ -0,0 +1,156 @@
+/** 
+ * \file SPI_Interface.h
+ * \brief Hardware specific SPI interface.
+ *
+ * This is the SPI counterpart of I2C_Interface.h. It exposes the same
+ * set of functions on top of the SPIM component (mode 3, MSB first)
+ * and of the SPI_CS pin, which is driven by firmware so that multi-byte
+ * transfers of any length are kept inside a single chip select window.
+ *
+ * The LIS3DH SPI protocol uses bit 7 of the first byte as R/W flag and
+ * bit 6 as MS flag, which enables the address auto-increment during
+ * multi-byte transfers.
+*/
+
+#ifndef SPI_Interface_H
+    #define SPI_Interface_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "BusStats.h"
+    #include "BusTransaction.h"
+    
+    /**
+    *   \brief Address answering on the SPI bus.
+    *
+    *   SPI has no addressing: the only device wired to SPI_CS answers to the
+    *   same address it would have over I2C, so that upper layers can keep using
+    *   the same device address whatever the transport is.
+    */
+    #ifndef SPI_PERIPHERAL_DEVICE_ADDRESS
+        #define SPI_PERIPHERAL_DEVICE_ADDRESS 0x18
+    #endif
+    
+    /**
+    *   \brief Clock of the SPIM component in bit/s.
+    *
+    *   Only used to report the load of the bus: keep it equal to the
+    *   data rate set in the TopDesign.
+    */
+    #ifndef SPI_PERIPHERAL_BIT_RATE
+        #define SPI_PERIPHERAL_BIT_RATE 1000000u
+    #endif
+    
+    /** \brief Start the SPI peripheral.
+    *   
+    *   This function starts the SPI peripheral so that it is ready to work.
+    */
+    ErrorCode SPI_Peripheral_Start(void);
+    
+    /** \brief Stop the SPI peripheral.
+    *   
+    *   This function stops the SPI peripheral from working.
+    */
+    ErrorCode SPI_Peripheral_Stop(void);
+    
+    /**
+    *   \brief Read one byte over SPI.
+    *   
+    *   \param device_address Address of the device to talk to.
+    *   \param register_address Address of the register to be read.
+    *   \param data Pointer to a variable where the byte will be saved.
+    */
+    ErrorCode SPI_Peripheral_ReadRegister(uint8_t device_address, 
+                                          uint8_t register_address,
+                                          uint8_t* data);
+    
+    /** 
+    *   \brief Read multiple bytes over SPI.
+    *   
+    *   The MS bit is set so that the device auto-increments the register
+    *   address after each byte.
+    *   \param device_address Address of the device to talk to.
+    *   \param register_address Address of the first register to be read.
+    *   \param register_count Number of registers we want to read.
+    *   \param data Pointer to an array where data will be saved.
+    */
+    ErrorCode SPI_Peripheral_ReadRegisterMulti(uint8_t device_address,
+                                               uint8_t register_address,
+                                               uint8_t register_count,
+                                               uint8_t* data);
+    /** 
+    *   \brief Write a byte over SPI.
+    *   
+    *   \param device_address Address of the device to talk to.
+    *   \param register_address Address of the register to be written.
+    *   \param data Data to be written
+    */
+    ErrorCode SPI_Peripheral_WriteRegister(uint8_t device_address,
+                                           uint8_t register_address,
+                                           uint8_t data);
+    
+    /** 
+    *   \brief Write multiple bytes over SPI.
+    *   
+    *   \param device_address Address of the device to talk to.
+    *   \param register_address Address of the first register to be written.
+    *   \param register_count Number of registers that need to be written.
+    *   \param data Array of data to be written
+    */
+    ErrorCode SPI_Peripheral_WriteRegisterMulti(uint8_t device_address,
+                                                uint8_t register_address,
+                                                uint8_t register_count,
+                                                uint8_t* data);
+    
+    /**
+    *   \brief Check if device is connected over SPI.
+    *
+    *   SPI has no acknowledge: the device is considered connected if the
+    *   address matches SPI_PERIPHERAL_DEVICE_ADDRESS and the WHO AM I
+    *   register reads back something different from a floating MISO line.
+    *   \param device_address Address of the device to be checked.
+    *   \retval Returns true (>0) if device is connected.
+    */
+    uint8_t SPI_Peripheral_IsDeviceConnected(uint8_t device_address);
+    
+    /**
+    *   \brief Run a transaction, with the interface of the I2C queue.
+    *
+    *   A transaction of a few registers takes a few tens of us at the SPI
+    *   data rate, less than the bookkeeping of an interrupt driven queue:
+    *   the transaction is run right away and its end, done function
+    *   included, is reported by the next SPI_Peripheral_Poll(). The priority
+    *   class only selects the counters.
+    */
+    ErrorCode SPI_Peripheral_Submit(BusTransaction* transaction);
+    
+    /**
+    *   \brief Check the end of a transaction.
+    *
+    *   \retval Returns true (>0) if the transaction is over.
+    */
+    uint8_t SPI_Peripheral_Poll(BusTransaction* transaction);
+    
+    /**
+    *   \brief Set the class of the transactions of the blocking functions.
+    *
+    *   \retval Returns the previous class, to be restored by the caller.
+    */
+    BusClass SPI_Peripheral_SetClass(BusClass bus_class);
+    
+    /**
+    *   \brief Transaction counters of each class (array of BUS_CLASSES), the
+    *   latency is always below 1 ms.
+    */
+    const BusClassStats* SPI_Peripheral_GetClassStats(void);
+    
+    /**
+    *   \brief Traffic and error counters of the SPI bus.
+    *
+    *   Every byte counts 8 bit times, command byte included. SPI has no
+    *   acknowledge, so the only errors are requests to a wrong address.
+    */
+    const BusStats* SPI_Peripheral_GetStats(void);
+    
+#endif // SPI_Interface_H
+/* [] END OF FILE */
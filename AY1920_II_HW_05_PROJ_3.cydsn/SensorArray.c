@@ -0,0 +1,223 @@
+/*
+* This file includes the device table built from the bus scan and the
+* round-robin acquisition of the devices.
+*/
+
+#include "SensorArray.h"
+#include "Sensor_Bus.h"
+#include "Frame.h"
+#include "Telemetry.h"
+#include "Timebase.h"
+
+/**
+*   \brief Bytes of the data frame header (id, sequence number, count).
+*/
+#define SENSOR_ARRAY_DATA_HEADER 4
+
+/**
+*   \brief Configuration of a device.
+*/
+typedef struct {
+    uint8_t address;                ///< Bus address of the device
+    LIS3DH_ODR odr;                 ///< Output data rate
+    LIS3DH_Mode mode;               ///< Resolution mode
+    LIS3DH_FullScale full_scale;    ///< Full-scale range
+} SensorArrayConfig;
+
+/*
+*   Configuration of each supported address, the same as the single device
+*   stream by default.
+*/
+static const SensorArrayConfig configs[SENSOR_ARRAY_MAX_DEVICES] = {
+    {LIS3DH_DEVICE_ADDRESS, LIS3DH_ODR_100HZ, LIS3DH_MODE_HIGH_RES, LIS3DH_FS_4G},
+    {LIS3DH_DEVICE_ADDRESS_SA0_HIGH, LIS3DH_ODR_100HZ, LIS3DH_MODE_HIGH_RES, LIS3DH_FS_4G}
+};
+
+/**
+*   \brief State of a device of the table.
+*/
+typedef struct {
+    LIS3DH_Device device;           ///< Driver state
+    const SensorArrayConfig* config;///< Configuration
+    uint16_t sequence;              ///< Sequence number of the data frames
+    uint16_t samples;               ///< Samples of the report period
+    uint8_t overruns;               ///< FIFO overruns of the report period
+    uint8_t errors;                 ///< Bus errors of the report period
+} SensorArrayEntry;
+
+static SensorArrayEntry entries[SENSOR_ARRAY_MAX_DEVICES];
+static uint8_t device_count;
+static uint8_t next_device;
+static uint32_t last_report_ms;
+
+    /*
+    *   Increment without wrapping, for the statistics.
+    */
+    static CY_INLINE void SensorArray_Count(uint8_t* counter)
+    {
+        if (*counter < 0xFF)
+        {
+            (*counter)++;
+        }
+    }
+    
+    /*
+    *   Send the throughput of the report period and clear it.
+    */
+    static void SensorArray_Report(uint32_t now)
+    {
+        uint8_t payload[2 + 6*SENSOR_ARRAY_MAX_DEVICES];
+        uint8_t* p = payload;
+        uint8_t id;
+        
+        p = Frame_Put16(p, (uint16_t)(now - last_report_ms));
+        for (id = 0; id < device_count; id++)
+        {
+            SensorArrayEntry* entry = &entries[id];
+            *p++ = id;
+            *p++ = entry->device.address;
+            p = Frame_Put16(p, entry->samples);
+            *p++ = entry->overruns;
+            *p++ = entry->errors;
+            entry->samples = 0;
+            entry->overruns = 0;
+            entry->errors = 0;
+        }
+        Frame_Send(FRAME_HEADER_DEVICE_STATS, payload, (uint8_t)(p - payload));
+        last_report_ms = now;
+    }
+
+    uint8_t SensorArray_Probe(uint8_t address)
+    {
+        uint8_t i;
+        uint8_t who_am_i;
+        
+        if (device_count >= SENSOR_ARRAY_MAX_DEVICES)
+        {
+            return 0;
+        }
+        for (i = 0; i < SENSOR_ARRAY_MAX_DEVICES; i++)
+        {
+            if (configs[i].address == address)
+            {
+                break;
+            }
+        }
+        // Other devices on the bus are not accelerometers
+        if (i == SENSOR_ARRAY_MAX_DEVICES ||
+            SensorBus_ReadRegister(address, LIS3DH_WHO_AM_I_REG_ADDR, &who_am_i) != NO_ERROR ||
+            who_am_i != LIS3DH_WHO_AM_I)
+        {
+            return 0;
+        }
+        
+        SensorArrayEntry* entry = &entries[device_count];
+        if (LIS3DH_Init(&entry->device, address) != NO_ERROR)
+        {
+            return 0;
+        }
+        entry->config = &configs[i];
+        entry->sequence = 0;
+        device_count++;
+        return 1;
+    }
+    
+    uint8_t SensorArray_GetCount(void)
+    {
+        return device_count;
+    }
+    
+    ErrorCode SensorArray_Start(void)
+    {
+        ErrorCode result = NO_ERROR;
+        uint8_t id;
+        
+        for (id = 0; id < device_count; id++)
+        {
+            SensorArrayEntry* entry = &entries[id];
+            ErrorCode error = LIS3DH_SetFullScale(&entry->device, entry->config->full_scale);
+            if (error == NO_ERROR)
+            {
+                error = LIS3DH_SetMode(&entry->device, entry->config->mode);
+            }
+            if (error == NO_ERROR)
+            {
+                error = LIS3DH_SetODR(&entry->device, entry->config->odr);
+            }
+            if (error == NO_ERROR)
+            {
+                error = LIS3DH_SetFifo(&entry->device, LIS3DH_FIFO_STREAM, 0);
+            }
+            if (error != NO_ERROR)
+            {
+                result = ERROR;
+            }
+            entry->samples = 0;
+            entry->overruns = 0;
+            entry->errors = 0;
+        }
+        next_device = 0;
+        last_report_ms = Timebase_GetMs();
+        return result;
+    }
+    
+    void SensorArray_Service(void)
+    {
+        int16_t raw[LIS3DH_FIFO_DEPTH*LIS3DH_AXES];
+        uint8_t payload[SENSOR_ARRAY_DATA_HEADER + LIS3DH_FIFO_DEPTH*LIS3DH_SAMPLE_BYTES];
+        uint8_t count;
+        uint8_t overrun;
+        uint8_t i;
+        
+        if (device_count == 0)
+        {
+            return;
+        }
+        
+        uint8_t id = next_device;
+        SensorArrayEntry* entry = &entries[id];
+        if (++next_device >= device_count)
+        {
+            next_device = 0;
+        }
+        
+        // FIFO_SRC_REG is the data ready poll of the FIFO drains
+        Telemetry_CountPoll();
+        if (LIS3DH_ReadFifo(&entry->device, raw, LIS3DH_FIFO_DEPTH, &count, &overrun) != NO_ERROR)
+        {
+            SensorArray_Count(&entry->errors);
+        }
+        else
+        {
+            if (overrun)
+            {
+                SensorArray_Count(&entry->overruns);
+            }
+            Telemetry_CountSamples(count, overrun ? 1 : 0);
+            if (count > 0)
+            {
+                uint8_t shift = LIS3DH_GetShift(&entry->device);
+                uint8_t sensitivity = LIS3DH_GetSensitivity(&entry->device);
+                uint8_t* p = payload;
+                
+                *p++ = id;
+                p = Frame_Put16(p, entry->sequence++);
+                *p++ = count;
+                for (i = 0; i < count*LIS3DH_AXES; i++)
+                {
+                    p = Frame_Put16(p, (uint16_t)((raw[i] >> shift)*sensitivity));
+                }
+                Frame_Send(FRAME_HEADER_DEVICE_DATA, payload, (uint8_t)(p - payload));
+                Telemetry_CountSent(count);
+                entry->samples += count;
+            }
+        }
+        
+        uint32_t now = Timebase_GetMs();
+        if ((now - last_report_ms) >= SENSOR_ARRAY_REPORT_MS)
+        {
+            SensorArray_Report(now);
+        }
+    }
+
+/* [] END OF FILE */
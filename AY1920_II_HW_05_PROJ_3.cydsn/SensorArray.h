@@ -0,0 +1,64 @@
+/**
+*   \file SensorArray.h
+*   \brief Several LIS3DH devices on the same sensor bus.
+*
+*   The devices found by the startup bus scan at the two SA0-selectable
+*   addresses are added to a table, each one with its own configuration
+*   and driver state. Every device runs with the FIFO in stream mode and
+*   the acquisition drains one FIFO per call in round-robin order, so that
+*   a slow transaction on one device never makes another one overflow as
+*   long as a full round takes less than LIS3DH_FIFO_DEPTH samples.
+*/
+
+#ifndef __SENSOR_ARRAY_H
+    #define __SENSOR_ARRAY_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH.h"
+    
+    /**
+    *   \brief Maximum number of devices, one per SA0 level.
+    */
+    #define SENSOR_ARRAY_MAX_DEVICES 2
+    
+    /**
+    *   \brief Period of the throughput frames in ms.
+    */
+    #ifndef SENSOR_ARRAY_REPORT_MS
+        #define SENSOR_ARRAY_REPORT_MS 1000u
+    #endif
+    
+    /**
+    *   \brief Add the device at the given address if it is a LIS3DH.
+    *
+    *   To be called for each address that answers the bus scan.
+    *   \retval Returns 1 if the device has been added.
+    */
+    uint8_t SensorArray_Probe(uint8_t address);
+    
+    /**
+    *   \brief Number of devices in the table.
+    */
+    uint8_t SensorArray_GetCount(void);
+    
+    /**
+    *   \brief Apply the configuration of each device and start the FIFOs.
+    */
+    ErrorCode SensorArray_Start(void);
+    
+    /**
+    *   \brief Drain the FIFO of the next device.
+    *
+    *   The samples are sent in a frame whose payload (little endian) is the
+    *   device id (8 bit), the sequence number of the device (16 bit), the
+    *   number of samples (8 bit) and the samples as X, Y, Z in mg (16 bit
+    *   each). Every SENSOR_ARRAY_REPORT_MS a throughput frame is sent with
+    *   the elapsed time in ms (16 bit) and, for each device, the id (8 bit),
+    *   the address (8 bit), the samples (16 bit), the FIFO overruns (8 bit)
+    *   and the bus errors (8 bit) of the period.
+    */
+    void SensorArray_Service(void);
+    
+#endif // __SENSOR_ARRAY_H
+/* [] END OF FILE */
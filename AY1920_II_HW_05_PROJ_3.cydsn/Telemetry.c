@@ -0,0 +1,171 @@
+/*
+* This file includes the counters of the acquisition and the
+* telemetry frame.
+*/
+
+#include "Telemetry.h"
+#include "Frame.h"
+#include "Sensor_Bus.h"
+#include "Timebase.h"
+#include "CyLib.h"
+
+/**
+*   \brief Bytes of the telemetry payload.
+*/
+#define TELEMETRY_PAYLOAD (2*6 + 2*BUS_ERROR_TYPES + 2 + 4 + 2 + 1)
+
+/**
+*   \brief Bytes of the counters of a class in the bus classes payload.
+*/
+#define TELEMETRY_CLASS_SIZE (4 + 2 + 2)
+
+// Counters of the current period
+static uint32_t polls;
+static uint32_t acquired_samples;
+static uint32_t sent_samples;
+static uint32_t dropped_samples;
+
+// Free running counters at the beginning of the period
+static BusStats last_bus;
+static uint32_t last_tx_bytes;
+static uint32_t last_period_ms;
+
+// Baud rate of UART_Debug, from its clock
+static uint32_t uart_baud;
+
+    /*
+    *   Saturate a counter to its 16-bit field.
+    */
+    static uint16_t Telemetry_Clamp16(uint32_t value)
+    {
+        return (uint16_t)(value > 0xFFFF ? 0xFFFF : value);
+    }
+    
+    /*
+    *   Share of the capacity of a link used in the period, in per mille.
+    */
+    static uint16_t Telemetry_Load(uint32_t bits, uint32_t bit_rate, uint32_t elapsed_ms)
+    {
+        uint64_t capacity = (uint64_t)bit_rate*elapsed_ms;
+        if (capacity == 0)
+        {
+            return 0;
+        }
+        return Telemetry_Clamp16((uint32_t)(((uint64_t)bits*1000u*1000u)/capacity));
+    }
+    
+    /*
+    *   Copy of the bus counters, updated by the bus interrupt at the end
+    *   of each transaction.
+    */
+    static void Telemetry_CopyBusStats(BusStats* copy)
+    {
+        uint8 interrupts = CyEnterCriticalSection();
+        *copy = *SensorBus_GetStats();
+        CyExitCriticalSection(interrupts);
+    }
+    
+    /*
+    *   Clear the counters of the period and take the free running ones
+    *   as reference. bus is the copy of the bus counters at the end of the
+    *   period, so that no transaction falls between two periods.
+    */
+    static void Telemetry_Clear(uint32_t now, const BusStats* bus)
+    {
+        polls = 0;
+        acquired_samples = 0;
+        sent_samples = 0;
+        dropped_samples = 0;
+        last_bus = *bus;
+        last_tx_bytes = Frame_GetTxBytes();
+        Frame_TakeTxHighWatermark();
+        last_period_ms = now;
+    }
+    
+    void Telemetry_Start(void)
+    {
+        BusStats bus;
+        
+        uart_baud = Frame_GetUartBaud();
+        Telemetry_CopyBusStats(&bus);
+        Telemetry_Clear(Timebase_GetMs(), &bus);
+    }
+    
+    void Telemetry_CountPoll(void)
+    {
+        polls++;
+    }
+    
+    void Telemetry_CountSamples(uint8_t acquired, uint8_t dropped)
+    {
+        acquired_samples += acquired;
+        dropped_samples += dropped;
+    }
+    
+    void Telemetry_CountSent(uint8_t sent)
+    {
+        sent_samples += sent;
+    }
+    
+    void Telemetry_Service(void)
+    {
+        uint8_t payload[TELEMETRY_PAYLOAD];
+        uint8_t* p = payload;
+        uint8_t error;
+        BusStats bus;
+        uint32_t now = Timebase_GetMs();
+        uint32_t elapsed = now - last_period_ms;
+        
+        if (elapsed < TELEMETRY_PERIOD_MS)
+        {
+            return;
+        }
+        
+        Telemetry_CopyBusStats(&bus);
+        uint32_t tx_bytes = Frame_GetTxBytes() - last_tx_bytes;
+        
+        p = Frame_Put16(p, Telemetry_Clamp16(elapsed));
+        p = Frame_Put16(p, Telemetry_Clamp16(acquired_samples));
+        p = Frame_Put16(p, Telemetry_Clamp16(sent_samples));
+        p = Frame_Put16(p, Telemetry_Clamp16(dropped_samples));
+        p = Frame_Put16(p, Telemetry_Clamp16(polls));
+        p = Frame_Put16(p, Telemetry_Clamp16(bus.transactions - last_bus.transactions));
+        for (error = 0; error < BUS_ERROR_TYPES; error++)
+        {
+            p = Frame_Put16(p, (uint16_t)(bus.errors[error] - last_bus.errors[error]));
+        }
+        p = Frame_Put16(p, Telemetry_Load(bus.bits - last_bus.bits, SENSOR_BUS_BIT_RATE, elapsed));
+        p = Frame_Put32(p, tx_bytes);
+        p = Frame_Put16(p, Telemetry_Load(tx_bytes*FRAME_UART_BITS_PER_BYTE, uart_baud, elapsed));
+        *p++ = Frame_TakeTxHighWatermark();
+        
+        // Clear before sending, the frame itself belongs to the next period
+        Telemetry_Clear(now, &bus);
+        Frame_Send(FRAME_HEADER_TELEMETRY, payload, (uint8_t)(p - payload));
+    }
+    
+    void Telemetry_SendBusClasses(void)
+    {
+        BusClassStats classes[BUS_CLASSES];
+        uint8_t payload[BUS_CLASSES*TELEMETRY_CLASS_SIZE];
+        uint8_t* p = payload;
+        uint8_t bus_class;
+        
+        // Updated by the bus interrupt, like the counters of Telemetry_CopyBusStats()
+        uint8 interrupts = CyEnterCriticalSection();
+        for (bus_class = 0; bus_class < BUS_CLASSES; bus_class++)
+        {
+            classes[bus_class] = SensorBus_GetClassStats()[bus_class];
+        }
+        CyExitCriticalSection(interrupts);
+        
+        for (bus_class = 0; bus_class < BUS_CLASSES; bus_class++)
+        {
+            p = Frame_Put32(p, classes[bus_class].transactions);
+            p = Frame_Put16(p, classes[bus_class].worst_ms);
+            p = Frame_Put16(p, classes[bus_class].missed);
+        }
+        Frame_Send(FRAME_HEADER_BUS_CLASSES, payload, (uint8_t)(p - payload));
+    }
+
+/* [] END OF FILE */
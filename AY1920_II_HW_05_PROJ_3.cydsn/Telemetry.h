@@ -0,0 +1,77 @@
+/**
+*   \file Telemetry.h
+*   \brief Runtime statistics of the acquisition, interleaved with the stream.
+*
+*   The acquisition loop counts the STATUS_REG polls and the samples
+*   acquired, sent and dropped; the sensor bus interface and the framing
+*   layer count their own traffic and errors. Every TELEMETRY_PERIOD_MS the
+*   counters of the period are sent in one frame, together with the load of
+*   the sensor bus and of UART_Debug estimated from the bits they carried,
+*   so that the health of the link can be followed while streaming. The
+*   UART load is taken against the baud rate of its generated clock
+*   (Frame_GetUartBaud()), so that it follows the TopDesign.
+*
+*   A sample is dropped when the STATUS_REG (or FIFO_SRC_REG) overrun flag
+*   shows that it has been overwritten before being read, or when its
+*   reading fails. Samples are sent when their values leave the device,
+*   one by one or in event and FIFO blocks; features and snapshot captures
+*   carry their own counters in their frames.
+*/
+
+#ifndef __TELEMETRY_H
+    #define __TELEMETRY_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Period of the telemetry frames in ms.
+    */
+    #ifndef TELEMETRY_PERIOD_MS
+        #define TELEMETRY_PERIOD_MS 1000u
+    #endif
+    
+    /**
+    *   \brief Clear the counters and start the first period.
+    */
+    void Telemetry_Start(void);
+    
+    /**
+    *   \brief Count one poll of the data ready flag.
+    */
+    void Telemetry_CountPoll(void);
+    
+    /**
+    *   \brief Count the samples read from the sensor.
+    *
+    *   \param acquired Samples read.
+    *   \param dropped Samples lost before or while reading.
+    */
+    void Telemetry_CountSamples(uint8_t acquired, uint8_t dropped);
+    
+    /**
+    *   \brief Count the samples sent on UART_Debug.
+    */
+    void Telemetry_CountSent(uint8_t sent);
+    
+    /**
+    *   \brief Send the telemetry frame when due.
+    *
+    *   Payload (little endian, counters of the period, 16-bit fields
+    *   saturated): period in ms, samples acquired, sent and dropped,
+    *   STATUS_REG polls, bus transactions, bus errors by BusError (4 x 16
+    *   bit), bus load in per mille, bytes sent (32 bit), UART load in
+    *   per mille, TX buffer high-watermark (8 bit).
+    */
+    void Telemetry_Service(void);
+    
+    /**
+    *   \brief Send the latency counters of the bus priority classes.
+    *
+    *   Payload (little endian, free running counters, BusTransaction.h), for
+    *   each BusClass from BUS_CLASS_SAMPLE: transactions (32 bit), worst
+    *   latency in ms (16 bit), transactions over the deadline (16 bit).
+    */
+    void Telemetry_SendBusClasses(void);
+
+#endif // __TELEMETRY_H
+/* [] END OF FILE */
@@ -0,0 +1,67 @@
+/*
+* This file includes the decimation, rate limiting and formatting
+* of the text stream.
+*/
+
+#include "TextStream.h"
+#include "Print.h"
+#include "Timebase.h"
+
+static uint8_t text_decimation;
+static uint8_t skipped;
+static uint32_t last_line_ms;
+
+    void TextStream_Configure(uint8_t decimation)
+    {
+        text_decimation = decimation;
+        // The first sample after the switch is rendered
+        skipped = decimation;
+        last_line_ms = Timebase_GetMs() - TEXT_STREAM_MIN_INTERVAL_MS;
+        if (decimation > 0)
+        {
+            Print_String("\r\nms,x_mg,y_mg,z_mg\r\n");
+        }
+    }
+    
+    uint8_t TextStream_IsEnabled(void)
+    {
+        return text_decimation > 0;
+    }
+    
+    uint8_t TextStream_AddSample(const int16_t* sample_mg)
+    {
+        uint8_t axis;
+        uint32_t now;
+        
+        if (text_decimation == 0)
+        {
+            return 0;
+        }
+        // Decimation first, then the rate limit on the samples left
+        if (skipped < text_decimation)
+        {
+            skipped++;
+        }
+        if (skipped < text_decimation)
+        {
+            return 0;
+        }
+        now = Timebase_GetMs();
+        if ((now - last_line_ms) < TEXT_STREAM_MIN_INTERVAL_MS)
+        {
+            return 0;
+        }
+        skipped = 0;
+        last_line_ms = now;
+        
+        Print_Unsigned(now);
+        for (axis = 0; axis < TEXT_STREAM_AXES; axis++)
+        {
+            Print_Char(',');
+            Print_Signed(sample_mg[axis]);
+        }
+        Print_String("\r\n");
+        return 1;
+    }
+
+/* [] END OF FILE */
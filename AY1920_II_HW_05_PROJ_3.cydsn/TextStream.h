@@ -0,0 +1,75 @@
+/**
+*   \file TextStream.h
+*   \brief Human-readable rendering of the acceleration samples.
+*
+*   Selected at runtime with COMMAND_SET_TEXT, the text stream replaces the
+*   0xA0 packets with CSV lines that can be read with any terminal:
+*
+*       milliseconds,x_mg,y_mg,z_mg
+*
+*   The header line is sent each time the stream is enabled. One sample
+*   out of the decimation set by the command is rendered, and never more
+*   than one line every TEXT_STREAM_MIN_INTERVAL_MS. The longest line
+*   ("4294967295,-32768,-32768,-32768\r\n") takes TEXT_STREAM_LINE_MS on
+*   the UART, 18 ms at 19200 baud, while the loop waits on the 4-byte TX
+*   FIFO; the interval is four line times, so that the transmission takes
+*   at most a quarter of the loop and the acquisition the rest. Above
+*   about 50 Hz a sample can still be overwritten in the data registers
+*   while a line goes out.
+*
+*   The text stream is meant for the raw stream mode: while it is enabled
+*   the telemetry and auxiliary ADC frames are paused, while the frames of
+*   the other stream modes and the command acknowledges stay binary.
+*/
+
+#ifndef __TEXT_STREAM_H
+    #define __TEXT_STREAM_H
+    
+    #include "cytypes.h"
+    #include "Frame.h"
+    
+    /**
+    *   \brief Bytes of the longest line.
+    */
+    #define TEXT_STREAM_LINE_SIZE 33u
+    
+    /**
+    *   \brief Time of the longest line on UART_Debug in ms, rounded up.
+    */
+    #define TEXT_STREAM_LINE_MS ((TEXT_STREAM_LINE_SIZE*FRAME_UART_BITS_PER_BYTE*1000u + FRAME_UART_BAUD - 1u)/FRAME_UART_BAUD)
+    
+    /**
+    *   \brief Minimum time between two lines in ms.
+    */
+    #ifndef TEXT_STREAM_MIN_INTERVAL_MS
+        #define TEXT_STREAM_MIN_INTERVAL_MS (4u*TEXT_STREAM_LINE_MS)
+    #endif
+    
+    /**
+    *   \brief Axes of each line.
+    */
+    #define TEXT_STREAM_AXES 3
+    
+    /**
+    *   \brief Enable or disable the text stream.
+    *
+    *   \param decimation One sample rendered every decimation, 0 to go
+    *   back to the binary packets.
+    */
+    void TextStream_Configure(uint8_t decimation);
+    
+    /**
+    *   \brief Check if the samples are rendered as text.
+    */
+    uint8_t TextStream_IsEnabled(void);
+    
+    /**
+    *   \brief Render a sample, if due.
+    *
+    *   \param sample_mg Array of TEXT_STREAM_AXES accelerations in mg.
+    *   \retval 1 if a line has been sent.
+    */
+    uint8_t TextStream_AddSample(const int16_t* sample_mg);
+
+#endif // __TEXT_STREAM_H
+/* [] END OF FILE */
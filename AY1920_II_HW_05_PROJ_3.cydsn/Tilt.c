@@ -0,0 +1,100 @@
+/*
+* This file includes the low-pass filter of the gravity vector and
+* the tilt frame.
+*/
+
+#include "Tilt.h"
+#include "Cordic.h"
+#include "Frame.h"
+#include "Timebase.h"
+
+/**
+*   \brief Fractional bits of the filter state, in mg.
+*/
+#define TILT_FRACTION_BITS 8
+
+/**
+*   \brief Left shift of the filter state into the CORDIC coordinates.
+*
+*   Full-scale values (32768 mg on three axes) stay below
+*   CORDIC_INPUT_MAX: 2^15 * sqrt(3) * 2^(8+5) < 2^29.
+*/
+#define TILT_CORDIC_SHIFT 5
+
+// Filtered acceleration in mg, TILT_FRACTION_BITS fractional bits
+static int32_t gravity[TILT_AXES];
+static uint8_t filter_started;
+
+// Frame rate
+static uint16_t period_ms = TILT_PERIOD_MS;
+static uint32_t last_frame_ms;
+static uint16_t frame_sequence;
+
+    void Tilt_Init(void)
+    {
+        filter_started = 0;
+        last_frame_ms = Timebase_GetMs();
+    }
+    
+    void Tilt_SetPeriod(uint16_t new_period_ms)
+    {
+        period_ms = new_period_ms;
+    }
+    
+    uint8_t Tilt_AddSample(const int16_t* sample_mg)
+    {
+        uint8_t axis;
+        int32_t input;
+        
+        for (axis = 0; axis < TILT_AXES; axis++)
+        {
+            input = (int32_t)sample_mg[axis]*(1 << TILT_FRACTION_BITS);
+            if (!filter_started)
+            {
+                // Started on the first sample instead of settling from zero
+                gravity[axis] = input;
+            }
+            else
+            {
+                gravity[axis] += (input - gravity[axis]) >> TILT_FILTER_SHIFT;
+            }
+        }
+        filter_started = 1;
+        
+        return (uint32_t)(Timebase_GetMs() - last_frame_ms) >= period_ms;
+    }
+    
+    void Tilt_SendFrame(void)
+    {
+        uint8_t payload[TILT_PAYLOAD_SIZE];
+        uint8_t* field;
+        uint32_t yz_magnitude;
+        uint32_t magnitude;
+        int32_t roll;
+        int32_t pitch;
+        
+        last_frame_ms = Timebase_GetMs();
+        
+        // Roll in the YZ plane, then pitch between X and the YZ plane
+        roll = Cordic_Vector(gravity[2]*(1 << TILT_CORDIC_SHIFT),
+                             gravity[1]*(1 << TILT_CORDIC_SHIFT),
+                             &yz_magnitude);
+        pitch = Cordic_Vector((int32_t)yz_magnitude,
+                              -gravity[0]*(1 << TILT_CORDIC_SHIFT),
+                              &magnitude);
+        
+        field = Frame_Put16(payload, frame_sequence++);
+        field = Frame_Put16(field, (uint16_t)Cordic_ToCentidegrees(pitch));
+        field = Frame_Put16(field, (uint16_t)Cordic_ToCentidegrees(roll));
+        #if (TILT_MAGNITUDE)
+        // Rounded to the mg
+        magnitude = (magnitude + (1UL << (TILT_FRACTION_BITS + TILT_CORDIC_SHIFT - 1))) >>
+                    (TILT_FRACTION_BITS + TILT_CORDIC_SHIFT);
+        field = Frame_Put16(field, (uint16_t)(magnitude > 0xFFFF ? 0xFFFF : magnitude));
+        #else
+        (void)magnitude;
+        #endif
+        Frame_Send(FRAME_HEADER_TILT, payload, (uint8_t)(field - payload));
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,96 @@
+/**
+*   \file Tilt.h
+*   \brief Inclinometer output: pitch and roll from the gravity vector.
+*
+*   The calibrated samples are low-pass filtered to keep the static
+*   gravity vector only, then every tilt period the angles are computed
+*   with two CORDIC evaluations (Cordic.h):
+*   - roll = atan2(y, z), which also gives sqrt(y^2 + z^2);
+*   - pitch = atan2(-x, sqrt(y^2 + z^2)), which also gives the total
+*     magnitude of the vector.
+*   Only the angle frame is sent, instead of three axes at the full rate,
+*   and the host needs no trigonometry. The angles are those of a still
+*   board: linear accelerations show up as tilt errors, less the longer
+*   the time constant of the filter. Host_Tools/cordic_bench.c checks the
+*   computation against libm: pitch and roll within 0.012 degrees and the
+*   magnitude within 0.5 mg, the resolution of the frame included.
+*
+*   Tilt frame (Frame.h), payload little endian: frame counter (16 bit),
+*   pitch and roll in hundredths of a degree (16 bit signed), and with
+*   TILT_MAGNITUDE the magnitude of the filtered vector in mg (16 bit).
+*/
+
+#ifndef __TILT_H
+    #define __TILT_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Number of axes of the samples.
+    */
+    #define TILT_AXES 3
+    
+    /**
+    *   \brief Time constant of the low-pass filter, as a power of 2 of the
+    *   sample period.
+    *
+    *   With 3 the filter averages about 8 samples: 80 ms at 100 Hz.
+    */
+    #ifndef TILT_FILTER_SHIFT
+        #define TILT_FILTER_SHIFT 3
+    #endif
+    
+    /**
+    *   \brief Period of the tilt frames at boot in ms, changed with
+    *   COMMAND_SET_TILT_PERIOD.
+    */
+    #ifndef TILT_PERIOD_MS
+        #define TILT_PERIOD_MS 100u
+    #endif
+    
+    /**
+    *   \brief Unit of the argument of COMMAND_SET_TILT_PERIOD in ms.
+    */
+    #define TILT_PERIOD_UNIT_MS 10u
+    
+    /**
+    *   \brief Add the magnitude of the vector to the tilt frame, 0 to send
+    *   the angles only.
+    */
+    #ifndef TILT_MAGNITUDE
+        #define TILT_MAGNITUDE 1
+    #endif
+    
+    /**
+    *   \brief Bytes of the payload of the tilt frame.
+    */
+    #define TILT_PAYLOAD_SIZE (2 + 2 + 2 + (TILT_MAGNITUDE ? 2 : 0))
+    
+    /**
+    *   \brief Clear the filter, the next sample starts it.
+    */
+    void Tilt_Init(void);
+    
+    /**
+    *   \brief Set the period of the tilt frames.
+    *
+    *   Frames are never sent faster than the samples arrive.
+    *   \param period_ms Period in ms, greater than 0.
+    */
+    void Tilt_SetPeriod(uint16_t period_ms);
+    
+    /**
+    *   \brief Filter a sample.
+    *
+    *   \param sample_mg Array of TILT_AXES calibrated accelerations in mg.
+    *   \retval Returns 1 when a tilt frame is due.
+    */
+    uint8_t Tilt_AddSample(const int16_t* sample_mg);
+    
+    /**
+    *   \brief Compute the angles of the filtered vector and send them.
+    */
+    void Tilt_SendFrame(void);
+
+#endif // __TILT_H
+/* [] END OF FILE */
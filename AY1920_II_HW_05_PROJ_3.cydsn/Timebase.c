@@ -0,0 +1,36 @@
+/*
+* This file includes the millisecond counter driven by the
+* SysTick interrupt.
+*/
+
+#include "Timebase.h"
+#include "CyLib.h"
+
+/**
+*   \brief SysTick callback slot used by the time base.
+*/
+#define TIMEBASE_CALLBACK_SLOT 0u
+
+static volatile uint32_t milliseconds;
+
+    /*
+    *   Called by the SysTick interrupt every millisecond.
+    */
+    static void Timebase_Tick(void)
+    {
+        milliseconds++;
+    }
+
+    void Timebase_Start(void)
+    {
+        milliseconds = 0;
+        CySysTickStart();
+        CySysTickSetCallback(TIMEBASE_CALLBACK_SLOT, Timebase_Tick);
+    }
+    
+    uint32_t Timebase_GetMs(void)
+    {
+        return milliseconds;
+    }
+
+/* [] END OF FILE */
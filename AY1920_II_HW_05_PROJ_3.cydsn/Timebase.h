@@ -0,0 +1,26 @@
+/**
+*   \file Timebase.h
+*   \brief Millisecond time base.
+*
+*   The SysTick timer of the Cortex-M3 is configured by cy_boot with a
+*   1 ms period: a callback counts the elapsed milliseconds, used to
+*   timestamp data and to measure rates.
+*/
+
+#ifndef __TIMEBASE_H
+    #define __TIMEBASE_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Start the SysTick timer and the millisecond counter.
+    */
+    void Timebase_Start(void);
+    
+    /**
+    *   \brief Milliseconds elapsed since Timebase_Start().
+    */
+    uint32_t Timebase_GetMs(void);
+    
+#endif // __TIMEBASE_H
+/* [] END OF FILE */
@@ -0,0 +1,200 @@
+/*
+* This file includes the circular pre-trigger buffer and the
+* transmission of the triggered events.
+*/
+
+#include "Trigger.h"
+#include "Frame.h"
+#include "IntMath.h"
+#include "Telemetry.h"
+#include "Timebase.h"
+
+/**
+*   \brief Samples of the circular buffer.
+*/
+#define TRIGGER_WINDOW (TRIGGER_PRE_SAMPLES + TRIGGER_POST_SAMPLES)
+
+/**
+*   \brief Samples of each data frame.
+*/
+#define TRIGGER_CHUNK_SAMPLES 32u
+
+/**
+*   \brief Bytes of the data frame header (event id and sequence number).
+*/
+#define TRIGGER_DATA_HEADER 4
+
+/**
+*   \brief Squared magnitude threshold, compared without square root.
+*/
+#define TRIGGER_THRESHOLD_SQ ((uint32_t)TRIGGER_THRESHOLD_MG*TRIGGER_THRESHOLD_MG)
+
+/**
+*   \brief States of the trigger.
+*/
+typedef enum {
+    TRIGGER_ARMED,      ///< Filling the pre-trigger buffer
+    TRIGGER_POST,       ///< Collecting the post-trigger samples
+    TRIGGER_READY       ///< Window frozen, waiting to be sent
+} TriggerState;
+
+static int16_t ring[TRIGGER_WINDOW][LIS3DH_AXES];
+static uint16_t write_index;
+static uint16_t pre_count;
+static uint16_t post_count;
+static TriggerState state;
+
+static LIS3DH_Device* trigger_device;
+static uint16_t event_id;
+static uint32_t event_timestamp;
+static uint32_t event_peak_sq;
+
+    /*
+    *   Squared magnitude of a sample, unsigned since three full-scale axes
+    *   exceed the range of an int32_t.
+    */
+    static CY_INLINE uint32_t Trigger_MagnitudeSq(const int16_t* sample_mg)
+    {
+        return (uint32_t)((int32_t)sample_mg[0]*sample_mg[0]) +
+               (uint32_t)((int32_t)sample_mg[1]*sample_mg[1]) +
+               (uint32_t)((int32_t)sample_mg[2]*sample_mg[2]);
+    }
+    
+    /*
+    *   Check the trigger source.
+    */
+    static uint8_t Trigger_Fired(uint32_t magnitude_sq)
+    {
+    #if (TRIGGER_SOURCE == TRIGGER_SOURCE_INT1)
+        uint8_t source;
+        (void)magnitude_sq;
+        // Reading the latched source also re-arms the generator
+        return (LIS3DH_ReadInt1Source(trigger_device, &source) == NO_ERROR) &&
+               (source & LIS3DH_INT1_SRC_IA);
+    #else
+        return (magnitude_sq > TRIGGER_THRESHOLD_SQ);
+    #endif
+    }
+    
+    /*
+    *   Restart the acquisition of the pre-trigger samples.
+    */
+    static void Trigger_Arm(void)
+    {
+        write_index = 0;
+        pre_count = 0;
+        post_count = 0;
+        state = TRIGGER_ARMED;
+    }
+
+    ErrorCode Trigger_Init(LIS3DH_Device* device)
+    {
+        trigger_device = device;
+        event_id = 0;
+        Trigger_Arm();
+        
+    #if (TRIGGER_SOURCE == TRIGGER_SOURCE_INT1)
+        uint8_t source;
+        ErrorCode error = LIS3DH_ConfigureInt1(device, LIS3DH_INT1_CFG_XYZ_HIGH,
+                                               TRIGGER_INT1_THRESHOLD_MG, 0, 1);
+        // Clear a request latched before the configuration
+        if (error == NO_ERROR)
+        {
+            error = LIS3DH_ReadInt1Source(device, &source);
+        }
+        return error;
+    #else
+        return NO_ERROR;
+    #endif
+    }
+    
+    uint8_t Trigger_AddSample(const int16_t* sample_mg)
+    {
+        if (state == TRIGGER_READY)
+        {
+            return 1;
+        }
+        
+        int16_t* slot = ring[write_index];
+        slot[0] = sample_mg[0];
+        slot[1] = sample_mg[1];
+        slot[2] = sample_mg[2];
+        if (++write_index >= TRIGGER_WINDOW)
+        {
+            write_index = 0;
+        }
+        
+        uint32_t magnitude_sq = Trigger_MagnitudeSq(sample_mg);
+        
+        if (state == TRIGGER_ARMED)
+        {
+            if (!Trigger_Fired(magnitude_sq))
+            {
+                // Only the last TRIGGER_PRE_SAMPLES samples are kept before the trigger
+                if (pre_count < TRIGGER_PRE_SAMPLES)
+                {
+                    pre_count++;
+                }
+                return 0;
+            }
+            state = TRIGGER_POST;
+            event_timestamp = Timebase_GetMs();
+            event_peak_sq = 0;
+        }
+        
+        if (magnitude_sq > event_peak_sq)
+        {
+            event_peak_sq = magnitude_sq;
+        }
+        if (++post_count < TRIGGER_POST_SAMPLES)
+        {
+            return 0;
+        }
+        state = TRIGGER_READY;
+        return 1;
+    }
+    
+    void Trigger_Dump(void)
+    {
+        uint8_t payload[TRIGGER_DATA_HEADER + TRIGGER_CHUNK_SAMPLES*LIS3DH_SAMPLE_BYTES];
+        uint8_t* p = payload;
+        
+        p = Frame_Put16(p, event_id);
+        *p++ = TRIGGER_SOURCE;
+        p = Frame_Put16(p, pre_count);
+        p = Frame_Put16(p, post_count);
+        p = Frame_Put32(p, event_timestamp);
+        p = Frame_Put16(p, IntMath_Sqrt(event_peak_sq));
+        Frame_Send(FRAME_HEADER_EVENT_INFO, payload, (uint8_t)(p - payload));
+        
+        // Oldest sample of the window
+        uint16_t total = pre_count + post_count;
+        uint16_t index = (write_index + TRIGGER_WINDOW - total) % TRIGGER_WINDOW;
+        uint16_t sent = 0;
+        uint16_t sequence = 0;
+        while (sent < total)
+        {
+            p = Frame_Put16(payload, event_id);
+            p = Frame_Put16(p, sequence++);
+            uint8_t count = 0;
+            while (count < TRIGGER_CHUNK_SAMPLES && sent < total)
+            {
+                p = Frame_Put16(p, (uint16_t)ring[index][0]);
+                p = Frame_Put16(p, (uint16_t)ring[index][1]);
+                p = Frame_Put16(p, (uint16_t)ring[index][2]);
+                if (++index >= TRIGGER_WINDOW)
+                {
+                    index = 0;
+                }
+                count++;
+                sent++;
+            }
+            Frame_Send(FRAME_HEADER_EVENT_DATA, payload, (uint8_t)(p - payload));
+            Telemetry_CountSent(count);
+        }
+        
+        event_id++;
+        Trigger_Arm();
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,99 @@
+/**
+*   \file Trigger.h
+*   \brief Oscilloscope-style triggered capture of shock events.
+*
+*   The samples of the acquisition loop are stored in a circular buffer.
+*   When the trigger fires, TRIGGER_PRE_SAMPLES samples before the trigger
+*   are frozen, TRIGGER_POST_SAMPLES more samples (trigger sample included)
+*   are collected and the whole window is sent as a framed event. Nothing is
+*   sent while waiting for a trigger.
+*
+*   Trigger sources:
+*   - TRIGGER_SOURCE_MAGNITUDE: magnitude of the acceleration vector in mg
+*     above TRIGGER_THRESHOLD_MG;
+*   - TRIGGER_SOURCE_INT1: activity detected by the interrupt 1 generator of
+*     the LIS3DH on the high-pass filtered signal, above
+*     TRIGGER_INT1_THRESHOLD_MG on any axis.
+*/
+
+#ifndef __TRIGGER_H
+    #define __TRIGGER_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH.h"
+    
+    /**
+    *   \brief Trigger on the magnitude computed by the firmware.
+    */
+    #define TRIGGER_SOURCE_MAGNITUDE 0
+    
+    /**
+    *   \brief Trigger on the INT1 activity of the LIS3DH.
+    */
+    #define TRIGGER_SOURCE_INT1 1
+    
+    /**
+    *   \brief Trigger source.
+    */
+    #ifndef TRIGGER_SOURCE
+        #define TRIGGER_SOURCE TRIGGER_SOURCE_MAGNITUDE
+    #endif
+    
+    /**
+    *   \brief Magnitude threshold in mg (gravity included).
+    */
+    #ifndef TRIGGER_THRESHOLD_MG
+        #define TRIGGER_THRESHOLD_MG 2000
+    #endif
+    
+    /**
+    *   \brief INT1 threshold in mg (gravity removed).
+    */
+    #ifndef TRIGGER_INT1_THRESHOLD_MG
+        #define TRIGGER_INT1_THRESHOLD_MG 1000
+    #endif
+    
+    /**
+    *   \brief Samples kept before the trigger.
+    */
+    #ifndef TRIGGER_PRE_SAMPLES
+        #define TRIGGER_PRE_SAMPLES 256u
+    #endif
+    
+    /**
+    *   \brief Samples collected from the trigger on.
+    */
+    #ifndef TRIGGER_POST_SAMPLES
+        #define TRIGGER_POST_SAMPLES 256u
+    #endif
+    
+    /**
+    *   \brief Arm the trigger and configure the trigger source.
+    *
+    *   \param device Device providing the samples.
+    */
+    ErrorCode Trigger_Init(LIS3DH_Device* device);
+    
+    /**
+    *   \brief Add a sample to the circular buffer.
+    *
+    *   \param sample_mg Array of LIS3DH_AXES accelerations in mg.
+    *   \retval Returns 1 when an event window is complete.
+    */
+    uint8_t Trigger_AddSample(const int16_t* sample_mg);
+    
+    /**
+    *   \brief Send the frozen event window and re-arm the trigger.
+    *
+    *   Information frame payload (little endian): event id (16 bit), trigger
+    *   source (8 bit), samples before the trigger (16 bit), samples from the
+    *   trigger (16 bit), timestamp of the trigger in ms (32 bit), peak
+    *   magnitude in mg (16 bit).
+    *   Data frame payload: event id (16 bit), sequence number (16 bit),
+    *   samples as X, Y, Z in mg (16 bit each).
+    */
+    void Trigger_Dump(void);
+    
+#endif // __TRIGGER_H
+/* [] END OF FILE */
@@ -15,6 +15,10 @@
 
     /*Define your macro callbacks here */
     /*For more information, refer to the Writing Code topic in the PSoC Creator Help.*/
+    
+    /* Transaction queue of I2C_Interface.c, advanced at the end of each I2C_Master interrupt */
+    #define I2C_Master_ISR_EXIT_CALLBACK
+    void I2C_Master_ISR_ExitCallback(void);
 
     
 #endif /* CYAPICALLBACKS_H */   
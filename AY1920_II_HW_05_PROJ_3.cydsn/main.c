@@ -9,63 +9,233 @@
 * \date , 2020*/
 
 // Include required header files
-#include "I2C_Interface.h"
+#include "Sensor_Bus.h"
+#include "LIS3DH.h"
+#include "Filter.h"
+#include "Features.h"
+#include "Tilt.h"
+#include "MultiRate.h"
+#include "EventLog.h"
+#include "Calibration.h"
+#include "Capture.h"
+#include "Trigger.h"
+#include "Activity.h"
+#include "AdaptiveRate.h"
+#include "AuxAdc.h"
+#include "SensorArray.h"
+#include "Command.h"
+#include "Frame.h"
+#include "Profile.h"
+#include "BusTrace.h"
+#include "Telemetry.h"
+#include "Pipeline.h"
+#include "TextStream.h"
+#include "Timebase.h"
+#include "FirmwareProfile.h"
 #include "project.h"
-#include "stdio.h"
+#include "Print.h"
 
-//brief 7-bit I2C address of the slave device.
-#define LIS3DH_DEVICE_ADDRESS 0x18
+//brief Stream of the packets of the firmware profile, mm/s^2 by default (header 0xA0, FirmwareProfile.h)
+#define STREAM_MODE_RAW 0
 
-//brief Address of the WHO AM I register
-#define LIS3DH_WHO_AM_I_REG_ADDR 0x0F
+//brief One frame of vibration features per window (header 0xA1)
+#define STREAM_MODE_FEATURES 1
 
-//brief Address of the Status register
-#define LIS3DH_STATUS_REG 0x27
+//brief Repeated burst captures at maximum ODR (headers 0xA2, 0xA3), with CAPTURE_ENABLE set to 1 (Capture.h)
+#define STREAM_MODE_SNAPSHOT 2
 
-//brief Address of the Control register 1
-#define LIS3DH_CTRL_REG1 0x20
+//brief Pre/post-trigger windows of shock events only (headers 0xA4, 0xA5)
+#define STREAM_MODE_TRIGGERED 3
 
-//brief Hex value to set high resolution mode 100Hz to the accelerator
-#define LIS3DH_NORMAL_MODE_100_CTRL_REG1 0x57
+//brief Raw stream while motion is present, heartbeat while idle (headers 0xA0, 0xA6)
+#define STREAM_MODE_ACTIVITY 4
 
-//brief Address of the Control register 4
-#define LIS3DH_CTRL_REG4 0x23
+//brief Rate-tagged stream with output data rate driven by the signal (headers 0xA7, 0xA8)
+#define STREAM_MODE_ADAPTIVE 5
 
-//output registers updated after MSB and LSB reading, FSR [-4g;+4g], high resolution mode
-#define LIS3DH_CTRL_REG4_BDU_ACTIVE 0x98 
+//brief Round-robin FIFO drains of every LIS3DH found by the bus scan (headers 0xAA, 0xAB)
+#define STREAM_MODE_MULTI 6
 
-//brief Address of the out_x_l register
-#define LIS3DH_OUT_X_L  0x28
+//brief Pitch and roll of the low-pass filtered gravity vector every tilt period (header 0xB1)
+#define STREAM_MODE_TILT 7
 
-//brief Address of the out_y_l register
-#define LIS3DH_OUT_Y_L  0x2A
+//brief Decimated channels of the same signal from one filter cascade, as many as fit the link (header 0xB2)
+#define STREAM_MODE_MULTIRATE 8
 
-//brief Address of the out_z_l register
-#define LIS3DH_OUT_Z_L  0x2C
+//brief Number of stream modes
+#define STREAM_MODES 9
+
+//brief Output produced by the firmware at boot, then changed with COMMAND_SET_STREAM
+#ifndef STREAM_MODE
+    #define STREAM_MODE STREAM_MODE_RAW
+#endif
+
+#if (STREAM_MODE == STREAM_MODE_SNAPSHOT) && !(CAPTURE_ENABLE)
+    #error "STREAM_MODE_SNAPSHOT needs CAPTURE_ENABLE set to 1 (Capture.h)"
+#endif
+
+//brief Auxiliary ADC frames (header 0xA9, temperature by default) interleaved with the acceleration stream, 0 to disable
+//(off in the profiles of parts 1 and 2, whose stream is made of the bare packets only)
+#ifndef AUX_ADC_STREAM
+    #define AUX_ADC_STREAM (FIRMWARE_PROFILE == FIRMWARE_PROFILE_ACCEL_MMS2)
+#endif
+
+//brief Telemetry frames (header 0xAF) with the counters of the acquisition, the bus and the UART, 0 to disable
+#ifndef TELEMETRY_STREAM
+    #define TELEMETRY_STREAM (FIRMWARE_PROFILE == FIRMWARE_PROFILE_ACCEL_MMS2)
+#endif
+
+//brief Shocks and free falls recorded in the emulated EEPROM (EventLog.h) and sent on COMMAND_DUMP_LOG, 0 to disable
+#ifndef EVENT_LOG
+    #define EVENT_LOG (FIRMWARE_PROFILE == FIRMWARE_PROFILE_ACCEL_MMS2)
+#endif
+
+//brief Bus transactions of the next sample overlapped with the processing of the current one (Pipeline.h),
+//0 for the sequential loop that waits for each transaction
+#ifndef PIPELINED_ACQUISITION
+    #define PIPELINED_ACQUISITION 1
+#endif
+
+//brief Calibration procedure run at boot, CALIBRATION_NONE to use the stored coefficients
+#ifndef CALIBRATION_ON_BOOT
+    #define CALIBRATION_ON_BOOT CALIBRATION_NONE
+#endif
+
+/*
+* Bring the accelerometer back to the given rate and resolution, with the FIFO and the
+* interrupt generator off, then start the modules used by the stream mode.
+*/
+static ErrorCode EnterStreamMode(uint8_t mode, LIS3DH_Device* device, LIS3DH_ODR odr, LIS3DH_Mode resolution)
+{
+    //no sample read with the previous configuration is processed with the new one
+    Pipeline_Stop();
+    
+    ErrorCode error = LIS3DH_SetFifo(device, LIS3DH_FIFO_BYPASS, 0);
+    if (error == NO_ERROR)
+    {
+        error = LIS3DH_ConfigureInt1(device, 0, 0, 0, 0);
+    }
+    if (error == NO_ERROR)
+    {
+        //CTRL_REG4 is rewritten from the shadow, the multi mode configures the device on its own
+        error = LIS3DH_SetFullScale(device, LIS3DH_GetFullScale(device));
+    }
+    if (error == NO_ERROR)
+    {
+        error = LIS3DH_SetMode(device, resolution);
+    }
+    if (error == NO_ERROR)
+    {
+        error = LIS3DH_SetODR(device, odr);
+    }
+    Filter_Init();
+    if (error != NO_ERROR)
+    {
+        return error;
+    }
+    
+    switch (mode)
+    {
+        case STREAM_MODE_FEATURES:
+            Features_Init();
+            break;
+        case STREAM_MODE_TILT:
+            Tilt_Init();
+            break;
+        case STREAM_MODE_MULTIRATE:
+            //the channels that don't fit the link are left out
+            error = MultiRate_Init(LIS3DH_GetODRHz(device));
+            break;
+        case STREAM_MODE_TRIGGERED:
+            error = Trigger_Init(device);
+            break;
+        case STREAM_MODE_ACTIVITY:
+            error = Activity_Init(device);
+            break;
+        case STREAM_MODE_ADAPTIVE:
+            error = AdaptiveRate_Init(device);
+            break;
+        case STREAM_MODE_MULTI:
+            //each device gets its own configuration
+            error = SensorArray_Start();
+            break;
+        default:
+            break;
+    }
+    return error;
+}
+
+#if (FIRMWARE_PROFILE == FIRMWARE_PROFILE_TEMPERATURE)
+/*
+* Send the temperature sensor output every FIRMWARE_TEMPERATURE_PERIOD_MS, never returns.
+*/
+static void StreamTemperature(LIS3DH_Device* device)
+{
+    uint8_t OutArray[FIRMWARE_PACKET_SIZE];
+    uint8_t TemperatureData[2];
+    int16_t OutTemp;
+    
+    OutArray[0] = FIRMWARE_PACKET_HEADER;
+    OutArray[FIRMWARE_PACKET_SIZE-1] = FIRMWARE_PACKET_FOOTER;
+    
+    if (LIS3DH_EnableAdc(device, 1, 1) != NO_ERROR)
+    {
+        Print_String("Error occurred while enabling the temperature sensor\r\n");
+    }
+    
+    for(;;)
+    {
+        CyDelay(FIRMWARE_TEMPERATURE_PERIOD_MS);
+        //LSB and MSB in one auto-increment transaction, so BDU keeps them from the same conversion
+        if(SensorBus_ReadRegisterMulti(device->address, LIS3DH_OUT_ADC_3L, 2, TemperatureData) == NO_ERROR)
+        {
+            OutTemp = (int16)(TemperatureData[0] | (TemperatureData[1]<<8))>>FIRMWARE_SHIFT;
+            Frame_Put16(&OutArray[1], (uint16_t)OutTemp);
+            Frame_Write(OutArray, FIRMWARE_PACKET_SIZE);
+        }
+    }
+}
+#endif
 
 int main(void)
 {
     CyGlobalIntEnable; /* Enable global interrupts. */
-
+    
     /* Place your initialization/startup code here (e.g. MyInst_Start()) */
-    I2C_Peripheral_Start(); //I2C enabled
+    BUS_TRACE_START(); //bus transactions traced from the first one, nothing when BUS_TRACE_ENABLE is 0
+    SensorBus_Start(); //sensor bus enabled
     UART_Debug_Start(); // UART enabled
+    Timebase_Start(); // millisecond counter enabled
     
     CyDelay(5); //"The boot procedure is complete about 5 milliseconds after device power-up."
     
-    // String to print out messages on the UART
-    char message[50];
-
-    // Check which devices are present on the I2C bus
+    //the link budgets of the stream modes assume FRAME_UART_BAUD
+    if (!Frame_IsUartBaudNominal())
+    {
+        Print_String("UART_Debug runs at ");
+        Print_Unsigned(Frame_GetUartBaud());
+        Print_String(" baud, the firmware is built for ");
+        Print_Unsigned(FRAME_UART_BAUD);
+        Print_String("\r\n");
+    }
+    
+    // Check which devices are present on the sensor bus
     for (int i = 0 ; i < 128; i++)
     {
-        if (I2C_Peripheral_IsDeviceConnected(i))
+        if (SensorBus_IsDeviceConnected(i))
         {
             // print out the address is hex format
-            sprintf(message, "Device 0x%02X is connected\r\n", i);
-            UART_Debug_PutString(message); 
-        }
+            Print_String("Device 0x");
+            Print_Hex(i, 2);
+            Print_String(" is connected\r\n");
         
+            //the accelerometers found by the scan form the device table of the multi mode
+            if (SensorArray_Probe(i))
+            {
+                Print_String("LIS3DH added to the device table\r\n");
+            }
+        }
+    
     }
     
     /******************************************/
@@ -74,140 +244,147 @@ int main(void)
     
     /* Read WHO AM I REGISTER register */
     uint8_t who_am_i_reg;
-    ErrorCode error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                                  LIS3DH_WHO_AM_I_REG_ADDR, 
-                                                  &who_am_i_reg);
+    ErrorCode error = SensorBus_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+                                             LIS3DH_WHO_AM_I_REG_ADDR, 
+                                             &who_am_i_reg);
     if (error == NO_ERROR)
     {
-        sprintf(message, "WHO AM I REG: 0x%02X [Expected: 0x33]\r\n", who_am_i_reg);
-        UART_Debug_PutString(message); 
+        Print_String("WHO AM I REG: 0x");
+        Print_Hex(who_am_i_reg, 2);
+        Print_String(" [Expected: 0x33]\r\n");
     }
     else
     {
-        UART_Debug_PutString("Error occurred during I2C comm\r\n");   
+        Print_String("Error occurred during I2C comm\r\n");   
     }
     
     /*      I2C Reading Status Register       */
     
     uint8_t status_register; 
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_STATUS_REG,
-                                        &status_register);
+    error = SensorBus_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+                                   LIS3DH_STATUS_REG,
+                                   &status_register);
     
     if (error == NO_ERROR)
     {
-        sprintf(message, "STATUS REGISTER: 0x%02X\r\n", status_register);
-        UART_Debug_PutString(message); 
+        Print_String("STATUS REGISTER: 0x");
+        Print_Hex(status_register, 2);
+        Print_String("\r\n");
     }
     else
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read status register\r\n");   
+        Print_String("Error occurred during I2C comm to read status register\r\n");   
     }
     
     /******************************************/
     /*        Read Control Register 1         */
     /******************************************/
     uint8_t ctrl_reg1; 
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG1,
-                                        &ctrl_reg1);
+    error = SensorBus_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+                                   LIS3DH_CTRL_REG1,
+                                   &ctrl_reg1);
     
     if (error == NO_ERROR)
     {
-        sprintf(message, "CONTROL REGISTER 1: 0x%02X\r\n", ctrl_reg1);
-        UART_Debug_PutString(message); 
+        Print_String("CONTROL REGISTER 1: 0x");
+        Print_Hex(ctrl_reg1, 2);
+        Print_String("\r\n");
     }
     else
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register 1\r\n");   
+        Print_String("Error occurred during I2C comm to read control register 1\r\n");   
     }
     
     /******************************************/
     /*            I2C Writing                 */
     /******************************************/
     
-        
-    UART_Debug_PutString("\r\nWriting new values..\r\n");
-    
-    if (ctrl_reg1 != LIS3DH_NORMAL_MODE_100_CTRL_REG1)
-    {
-        ctrl_reg1 = LIS3DH_NORMAL_MODE_100_CTRL_REG1;
     
-        error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                             LIS3DH_CTRL_REG1,
-                                             ctrl_reg1);
+    Print_String("\r\nWriting new values..\r\n");
     
+    if (ctrl_reg1 != FIRMWARE_CTRL_REG1)
+    {
+        ctrl_reg1 = FIRMWARE_CTRL_REG1;
+        
+        error = SensorBus_WriteRegister(LIS3DH_DEVICE_ADDRESS,
+                                        LIS3DH_CTRL_REG1,
+                                        ctrl_reg1);
+        
         if (error == NO_ERROR)
         {
-            sprintf(message, "CONTROL REGISTER 1 successfully written as: 0x%02X\r\n", ctrl_reg1);
-            UART_Debug_PutString(message); 
+            Print_String("CONTROL REGISTER 1 successfully written as: 0x");
+            Print_Hex(ctrl_reg1, 2);
+            Print_String("\r\n");
         }
         else
         {
-            UART_Debug_PutString("Error occurred during I2C comm to set control register 1\r\n");   
+            Print_String("Error occurred during I2C comm to set control register 1\r\n");   
         }
     }
     
     /******************************************/
     /*     Read Control Register 1 again      */
     /******************************************/
-
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG1,
-                                        &ctrl_reg1);
+    
+    error = SensorBus_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+                                   LIS3DH_CTRL_REG1,
+                                   &ctrl_reg1);
     
     if (error == NO_ERROR)
     {
-        sprintf(message, "CONTROL REGISTER 1 after overwrite operation: 0x%02X\r\n", ctrl_reg1);
-        UART_Debug_PutString(message); 
+        Print_String("CONTROL REGISTER 1 after overwrite operation: 0x");
+        Print_Hex(ctrl_reg1, 2);
+        Print_String("\r\n");
     }
     else
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register 1\r\n");   
+        Print_String("Error occurred during I2C comm to read control register 1\r\n");   
     }
     
      /******************************************/
      /* Read Control Register 4 */
      /******************************************/
-
+    
     
     
     uint8_t ctrl_reg4;
-
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG4,
-                                        &ctrl_reg4);
+    
+    error = SensorBus_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+                                   LIS3DH_CTRL_REG4,
+                                   &ctrl_reg4);
     
     if (error == NO_ERROR)
     {
-        sprintf(message, "CONTROL REGISTER 4: 0x%02X\r\n", ctrl_reg4);
-        UART_Debug_PutString(message); 
+        Print_String("CONTROL REGISTER 4: 0x");
+        Print_Hex(ctrl_reg4, 2);
+        Print_String("\r\n");
     }
     else
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register4\r\n");   
+        Print_String("Error occurred during I2C comm to read control register4\r\n");   
     }
     
     
-    ctrl_reg4 = LIS3DH_CTRL_REG4_BDU_ACTIVE; 
+    ctrl_reg4 = FIRMWARE_CTRL_REG4;
     
-    error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                         LIS3DH_CTRL_REG4,
-                                         ctrl_reg4);
+    error = SensorBus_WriteRegister(LIS3DH_DEVICE_ADDRESS,
+                                    LIS3DH_CTRL_REG4,
+                                    ctrl_reg4);
     
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG4,
-                                        &ctrl_reg4);
+    error = SensorBus_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+                                   LIS3DH_CTRL_REG4,
+                                   &ctrl_reg4);
     
     
     if (error == NO_ERROR)
     {
-        sprintf(message, "CONTROL REGISTER 4 after being updated: 0x%02X\r\n", ctrl_reg4);
-        UART_Debug_PutString(message); 
+        Print_String("CONTROL REGISTER 4 after being updated: 0x");
+        Print_Hex(ctrl_reg4, 2);
+        Print_String("\r\n");
     }
     else
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register4\r\n");   
+        Print_String("Error occurred during I2C comm to read control register4\r\n");   
     }
     
     //variables to save the registers output value in digit
@@ -215,103 +392,517 @@ int main(void)
     int16_t Out_Y;
     int16_t Out_Z;
     
-    //variables to save the output value in mg
-    int16_t Out_X_mg; 
-    int16_t Out_Y_mg;
-    int16_t Out_Z_mg;
-    
-    //float variables to save the output value in m/s^2
-    float32 Out_X_ms2;
-    float32 Out_Y_ms2;
-    float32 Out_Z_ms2;
+    //output values in mg, calibrated in place
+    int16_t Sample_mg[CALIBRATION_AXES];
     
-    //int  variables for the casting of the float values, the obtained results are acceleration
-    //values in mm/s^2
+    #if (FIRMWARE_PROFILE == FIRMWARE_PROFILE_ACCEL_MMS2)
+    //acceleration values in mm/s^2
     int32_t Out_X_mms2;
     int32_t Out_Y_mms2;
     int32_t Out_Z_mms2;
-    
-    uint8_t header = 0xA0;
-    uint8_t footer = 0xC0;
-    uint8_t OutArray[14]; 
-    uint8_t X_Data[2];
-    uint8_t Y_Data[2];
-    uint8_t Z_Data[2];
+    #endif
+    
+    //packet of the profile, header and footer set once
+    uint8_t OutArray[FIRMWARE_PACKET_SIZE];
+    #if (FIRMWARE_PROFILE != FIRMWARE_PROFILE_TEMPERATURE)
+    uint8_t* packet;
+    #endif
+    #if (PIPELINED_ACQUISITION)
+    uint8_t pipeline_result;
+    #else
+    uint8_t Sample_Data[LIS3DH_SAMPLE_BYTES];
     uint8_t status_reg;
+    BusClass bus_class;
+    #endif
+    
+    //left-justified raw values of the three axes, filtered before the conversion
+    int16_t Raw[FILTER_AXES];
+    
+    //frame of the feature mode
+    uint8_t FeatureFrame[FEATURES_FRAME_SIZE];
+    
+    //payload of the statistics frame
+    uint8_t StatsPayload[18];
+    uint8_t* stats;
+    
+    //stream state, changed by the commands received on UART_Debug
+    uint8_t stream_mode = STREAM_MODE;
+    uint8_t streaming = 1;
+    uint32_t samples_streamed = 0;
+    uint16_t bus_errors = 0;
+    Command command;
+    uint8_t command_status;
+    
+    OutArray[0] = FIRMWARE_PACKET_HEADER;
+    OutArray[FIRMWARE_PACKET_SIZE-1] = FIRMWARE_PACKET_FOOTER;
+    
+    //driver state of the accelerometer, loaded with the configuration written above
+    LIS3DH_Device Accelerometer;
+    error = LIS3DH_Init(&Accelerometer, LIS3DH_DEVICE_ADDRESS);
+    
+    #if (FIRMWARE_PROFILE == FIRMWARE_PROFILE_TEMPERATURE)
+    //part 1 streams the temperature sensor only
+    StreamTemperature(&Accelerometer);
+    #endif
+    
+    #if (AUX_ADC_STREAM)
+    if (AuxAdc_Init(&Accelerometer) != NO_ERROR)
+    {
+        Print_String("Error occurred while enabling the auxiliary ADC\r\n");
+    }
+    #endif
+    
+    //the pipeline reads the same device as the sequential loop
+    Pipeline_Init(LIS3DH_DEVICE_ADDRESS);
+    
+    //rate and resolution restored each time a stream mode is entered
+    LIS3DH_ODR stream_odr = LIS3DH_GetODR(&Accelerometer);
+    LIS3DH_Mode stream_resolution = LIS3DH_GetMode(&Accelerometer);
+    
+    if (EnterStreamMode(stream_mode, &Accelerometer, stream_odr, stream_resolution) != NO_ERROR)
+    {
+        Print_String("Error occurred while entering the stream mode\r\n");
+    }
+    
+    //coefficients stored in the emulated EEPROM
+    if (Calibration_Init() == NO_ERROR)
+    {
+        Print_String("Calibration coefficients loaded\r\n");
+    }
+    else
+    {
+        Print_String("No valid calibration, using nominal sensitivity\r\n");
+    }
+    
+    #if (EVENT_LOG)
+    //appending goes on after the newest record found in flash
+    if (EventLog_Init() != NO_ERROR)
+    {
+        Print_String("Event log not available, events kept in RAM only\r\n");
+    }
+    #endif
+    
+    #if (CALIBRATION_ON_BOOT == CALIBRATION_STATIC_LEVEL)
+    Print_String("Calibration: keep the board still with Z axis up\r\n");
+    Calibration_Start(CALIBRATION_STATIC_LEVEL);
+    #elif (CALIBRATION_ON_BOOT == CALIBRATION_SIX_POSITION)
+    Print_String("Calibration: keep the board still with each axis up and down\r\n");
+    Calibration_Start(CALIBRATION_SIX_POSITION);
+    #endif
     
-    OutArray[0] = header;
-    OutArray[13] = footer;
+    Command_Start();
+    Telemetry_Start();
+    PROFILE_START();
     
     for(;;)
-    {error= I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, //read the status register
-                                        LIS3DH_STATUS_REG,
-                                        &status_reg);
+    {
+        //profiling frame every PROFILE_REPORT_MS, nothing when PROFILE_ENABLE is 0
+        PROFILE_SERVICE();
+        
+        #if (TELEMETRY_STREAM)
+        //telemetry frame every TELEMETRY_PERIOD_MS, whatever the stream mode
+        //(paused while the terminal shows the text stream)
+        if(!TextStream_IsEnabled())
+        {
+            Telemetry_Service();
+        }
+        #endif
+        
+        #if (EVENT_LOG)
+        //the pending page of the event log is written between two samples, never during an event
+        EventLog_Service();
+        #endif
+        
+        //commands are executed between two samples, the stream goes on with the new settings
+        while(Command_Get(&command))
+        {
+            command_status = COMMAND_STATUS_OK;
+            switch(command.opcode)
+            {
+                case COMMAND_SET_ODR:
+                    //power down would stop the data ready polling, COMMAND_STOP is used instead
+                    //the 1.6 kHz code is not a valid rate outside the low power mode
+                    if(command.argument == LIS3DH_ODR_POWER_DOWN || command.argument > LIS3DH_ODR_1344HZ ||
+                       (command.argument == LIS3DH_ODR_1600HZ_LP && stream_resolution != LIS3DH_MODE_LOW_POWER))
+                    {
+                        command_status = COMMAND_STATUS_INVALID;
+                        break;
+                    }
+                    stream_odr = (LIS3DH_ODR)command.argument;
+                    if(EnterStreamMode(stream_mode, &Accelerometer, stream_odr, stream_resolution) != NO_ERROR)
+                    {
+                        command_status = COMMAND_STATUS_BUS_ERROR;
+                    }
+                    break;
+                case COMMAND_SET_FULL_SCALE:
+                    //the conversion of the fixed-scale profiles is resolved at compile time
+                    if(!FIRMWARE_RUNTIME_SCALE || command.argument > LIS3DH_FS_16G)
+                    {
+                        command_status = COMMAND_STATUS_INVALID;
+                        break;
+                    }
+                    //the thresholds of the interrupt generator depend on the full-scale
+                    if(LIS3DH_SetFullScale(&Accelerometer, (LIS3DH_FullScale)command.argument) != NO_ERROR ||
+                       EnterStreamMode(stream_mode, &Accelerometer, stream_odr, stream_resolution) != NO_ERROR)
+                    {
+                        command_status = COMMAND_STATUS_BUS_ERROR;
+                    }
+                    break;
+                case COMMAND_SET_MODE:
+                    if(command.argument > LIS3DH_MODE_HIGH_RES ||
+                       (stream_odr == LIS3DH_ODR_1600HZ_LP && command.argument != LIS3DH_MODE_LOW_POWER))
+                    {
+                        command_status = COMMAND_STATUS_INVALID;
+                        break;
+                    }
+                    stream_resolution = (LIS3DH_Mode)command.argument;
+                    if(EnterStreamMode(stream_mode, &Accelerometer, stream_odr, stream_resolution) != NO_ERROR)
+                    {
+                        command_status = COMMAND_STATUS_BUS_ERROR;
+                    }
+                    break;
+                case COMMAND_SET_STREAM:
+                    //without the capture buffer there is no snapshot mode
+                    if(command.argument >= STREAM_MODES || (!CAPTURE_ENABLE && command.argument == STREAM_MODE_SNAPSHOT))
+                    {
+                        command_status = COMMAND_STATUS_INVALID;
+                        break;
+                    }
+                    stream_mode = command.argument;
+                    if(EnterStreamMode(stream_mode, &Accelerometer, stream_odr, stream_resolution) != NO_ERROR)
+                    {
+                        command_status = COMMAND_STATUS_BUS_ERROR;
+                    }
+                    break;
+                case COMMAND_START:
+                    streaming = 1;
+                    break;
+                case COMMAND_STOP:
+                    streaming = 0;
+                    //the chain would otherwise keep the samples read before the stop for the next start
+                    Pipeline_Stop();
+                    break;
+                case COMMAND_SET_TEXT:
+                    TextStream_Configure(command.argument);
+                    break;
+                case COMMAND_DUMP_LOG:
+                    #if (EVENT_LOG)
+                    if(command.argument > 1)
+                    {
+                        command_status = COMMAND_STATUS_INVALID;
+                        break;
+                    }
+                    if(EventLog_Dump(command.argument) != NO_ERROR)
+                    {
+                        command_status = COMMAND_STATUS_BUS_ERROR;
+                    }
+                    #else
+                    command_status = COMMAND_STATUS_UNKNOWN;
+                    #endif
+                    break;
+                case COMMAND_DUMP_TRACE:
+                    #if (BUS_TRACE_ENABLE)
+                    if(command.argument > 1)
+                    {
+                        command_status = COMMAND_STATUS_INVALID;
+                        break;
+                    }
+                    BusTrace_Dump(command.argument);
+                    #else
+                    command_status = COMMAND_STATUS_UNKNOWN;
+                    #endif
+                    break;
+                case COMMAND_CALIBRATE:
+                    //the procedures take the converted samples of the single sensor loop
+                    if(command.argument > CALIBRATION_SIX_POSITION || stream_mode != STREAM_MODE_RAW)
+                    {
+                        command_status = COMMAND_STATUS_INVALID;
+                        break;
+                    }
+                    Calibration_Start((CalibrationProcedure)command.argument);
+                    break;
+                case COMMAND_SET_TILT_PERIOD:
+                    if(command.argument == 0)
+                    {
+                        command_status = COMMAND_STATUS_INVALID;
+                        break;
+                    }
+                    Tilt_SetPeriod((uint16_t)(command.argument*TILT_PERIOD_UNIT_MS));
+                    break;
+                case COMMAND_GET_STATS:
+                    //uptime, stream settings, samples and errors, little endian
+                    stats = StatsPayload;
+                    stats = Frame_Put32(stats, Timebase_GetMs());
+                    *stats++ = stream_mode;
+                    *stats++ = streaming;
+                    stats = Frame_Put16(stats, LIS3DH_GetODRHz(&Accelerometer));
+                    *stats++ = LIS3DH_GetFullScale(&Accelerometer);
+                    *stats++ = LIS3DH_GetMode(&Accelerometer);
+                    stats = Frame_Put32(stats, samples_streamed);
+                    stats = Frame_Put16(stats, bus_errors);
+                    stats = Frame_Put16(stats, Command_GetErrors());
+                    Frame_Send(FRAME_HEADER_STREAM_STATS, StatsPayload, (uint8_t)(stats - StatsPayload));
+                    //latency and missed deadlines of each bus priority class
+                    Telemetry_SendBusClasses();
+                    break;
+                default:
+                    command_status = COMMAND_STATUS_UNKNOWN;
+                    break;
+            }
+            Command_Reply(&command, command_status);
+        }
+        
+        if(!streaming)
+        {
+            continue;
+        }
+        
+        #if (CAPTURE_ENABLE)
+        if(stream_mode == STREAM_MODE_SNAPSHOT)
+        {
+            //fill the RAM buffer at maximum ODR, then send it at link speed
+            if(Capture_Record(&Accelerometer) == NO_ERROR)
+            {
+                Capture_Dump();
+            }
+            else
+            {
+                //the capture or the restore of the configuration failed on the bus
+                bus_errors++;
+            }
+            continue;
+        }
+        #endif
+        if(stream_mode == STREAM_MODE_MULTI)
+        {
+            //the FIFOs give each device LIS3DH_FIFO_DEPTH samples of slack while the others are drained
+            SensorArray_Service();
+            #if (AUX_ADC_STREAM)
+            AuxAdc_Service();
+            #endif
+            continue;
+        }
+        //no sample is read while idle, only heartbeat frames are sent
+        else if(stream_mode == STREAM_MODE_ACTIVITY && !Activity_IsActive())
+        {
+            //the calibration at boot needs samples while the board is still, at the active rate and resolution
+            //(Activity_Update() puts the device back to idle after the procedure if there is no motion)
+            if(Calibration_IsRunning() ? (Activity_Wake() == NO_ERROR) : Activity_Idle())
+            {
+                //the filter state and the samples buffered by the pipeline refer to the time before the idle period
+                Filter_Init();
+                Pipeline_Stop();
+            }
+            #if (AUX_ADC_STREAM)
+            AuxAdc_Service();
+            #endif
+            continue;
+        }
+        
+        #if (PIPELINED_ACQUISITION)
+        //the bus polls and reads the next sample from the I2C interrupt while this one is processed
+        PROFILE_BEGIN(PROFILE_STAGE_READ);
+        pipeline_result = Pipeline_Service(Raw);
+        PROFILE_END(PROFILE_STAGE_READ);
+        if(pipeline_result == PIPELINE_BUS_ERROR)
+        {
+            bus_errors++;
+            continue;
+        }
+        if(pipeline_result != PIPELINE_SAMPLE)
+        {
+            //commands are served while waiting for the next sample
+            continue;
+        }
+        #else
+        //the data ready poll and the sample go before the configuration and the diagnostics
+        bus_class = SensorBus_SetClass(BUS_CLASS_SAMPLE);
+        PROFILE_BEGIN(PROFILE_STAGE_STATUS);
+        error= SensorBus_ReadRegister(LIS3DH_DEVICE_ADDRESS, //read the status register
+                                   LIS3DH_STATUS_REG,
+                                   &status_reg);
+        PROFILE_END(PROFILE_STAGE_STATUS);
+        SensorBus_SetClass(bus_class);
+        Telemetry_CountPoll();
         //CyDelay(5); //output data at 100Hz = data available every 10ms, so the delay must be lower
-        while(!(status_reg & 0x08))//check if new data is available on all axes
+        if(error == NO_ERROR && !(status_reg & LIS3DH_STATUS_ZYXDA))//check if new data is available on all axes
+        {
+            //commands are served while waiting for the next sample
+            continue;
+        }
+        if(error != NO_ERROR)
+        {
+            bus_errors++;
+            continue;
+        }
+        bus_class = SensorBus_SetClass(BUS_CLASS_SAMPLE);
+        PROFILE_BEGIN(PROFILE_STAGE_READ);
+        //one burst from OUT_X_L to OUT_Z_H with auto-increment, so no axis is read from another sample
+        error = SensorBus_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS,
+                                   LIS3DH_OUT_X_L,
+                                   LIS3DH_SAMPLE_BYTES,
+                                   &Sample_Data[0]);
+        PROFILE_END(PROFILE_STAGE_READ);
+        SensorBus_SetClass(bus_class);
+        if(error != NO_ERROR)
+        {
+            bus_errors++;
+            //the sample is lost, the next one is read on the next data ready
+            Telemetry_CountSamples(0, 1);
+            continue;
+        }
+        //the overrun flag means that at least one sample was overwritten before this one
+        Telemetry_CountSamples(1, (status_reg & LIS3DH_STATUS_ZYXOR) ? 1 : 0);
+        Raw[0] = (int16)(Sample_Data[0] | (Sample_Data[1]<<8));
+        Raw[1] = (int16)(Sample_Data[2] | (Sample_Data[3]<<8));
+        Raw[2] = (int16)(Sample_Data[4] | (Sample_Data[5]<<8));
+        #endif
         
-        {error= I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, //read the status register until new data is available
-                                            LIS3DH_STATUS_REG,
-                                           &status_reg);}
-        if (error==NO_ERROR)
-         {
-            error = I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS,
-                                            LIS3DH_OUT_X_L,
-                                            2,
-                                            &X_Data[0]);
-            
-            error = I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS,
-                                            LIS3DH_OUT_Y_L,
-                                            2,
-                                            &Y_Data[0]);
-            
-            error = I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS,
-                                            LIS3DH_OUT_Z_L,
-                                            2,
-                                            &Z_Data[0]);
-                
-             
-            /*if (error == NO_ERROR)
-            {sprintf(message, "OUT_Z_L: 0x%02X\r\n", Z_Data[0]);
-             UART_Debug_PutString(message); 
-             sprintf(message, "OUT_Z_H: 0x%02X\r\n", Z_Data[1]);
-             UART_Debug_PutString(message); 
-            }*/
-            if(error == NO_ERROR)
-              {
-               Out_X = (int16)((X_Data[0] | (X_Data[1]<<8)))>>4;//out_x in digit (12bit)
-               Out_X_mg = Out_X*2;//out_x in mg, the sensitivity is 2mg/digit in this operation mode (13 bits needed [-4096;+4095])
-               Out_X_ms2 = Out_X_mg*9.81/1000;//out_x in m/s^2 (float variable)
-
-     //cast of the float variable to int that mantains the first 3 decimals. now the value is in mm/s^2
-               Out_X_mms2 = (int32)((Out_X_ms2*1000));//int32 needed since this value can exceed the ones covered by an int16
-               OutArray[1] = (uint8_t)(Out_X_mms2 & 0xFF);
-               OutArray[2] = (uint8_t)(Out_X_mms2 >> 8);
-               OutArray[3] = (uint8_t)(Out_X_mms2 >> 16);
-               OutArray[4] = (uint8_t)(Out_X_mms2 >> 24);
-             
-               
-               Out_Y = (int16)((Y_Data[0] | (Y_Data[1]<<8)))>>4;//out_y in digit (12bit)
-               Out_Y_mg = Out_Y*2;//out_y in mg (13 bits needed)
-               Out_Y_ms2 = Out_Y_mg*9.81/1000;
-               Out_Y_mms2 = (int32)((Out_Y_ms2*1000));
-               OutArray[5] = (uint8_t)(Out_Y_mms2 & 0xFF);
-               OutArray[6] = (uint8_t)(Out_Y_mms2 >> 8);
-               OutArray[7] = (uint8_t)(Out_Y_mms2 >> 16);
-               OutArray[8] = (uint8_t)(Out_Y_mms2 >> 24);
-            
-               Out_Z = (int16)((Z_Data[0] | (Z_Data[1]<<8)))>>4;//out_z in digit (12bit)
-               Out_Z_mg= Out_Z*2;//out_z in mg (13 bits needed)
-               Out_Z_ms2=Out_Z_mg*9.81/1000;
-               Out_Z_mms2= (int32)((Out_Z_ms2*1000));
-               OutArray[9] = (uint8_t)(Out_X_mms2 & 0xFF);
-               OutArray[10] = (uint8_t)(Out_Z_mms2>> 8);
-               OutArray[11] = (uint8_t)(Out_Z_mms2>> 16);
-               OutArray[12] = (uint8_t) (Out_Z_mms2 >> 24);
-               //sprintf(message, "OUT_Z_mms2: %d\r\n OUT_Z_mg: %d\r\n" ,Out_z_mms2, Out_Z_mg);
-                //UART_Debug_PutString(message);
-               UART_Debug_PutArray(OutArray, 14);
-              }
+        #if (AUX_ADC_STREAM)
+        //the slow channel uses the bus slot right after the sample, before the next one is due
+        //(paused while the terminal shows the text stream)
+        if(!TextStream_IsEnabled())
+        {
+            AuxAdc_Service();
+        }
+        #endif
+        
+        //the decimator releases one sample every Filter_GetDecimation() readings
+        PROFILE_BEGIN(PROFILE_STAGE_FILTER);
+        if(!Filter_Process(Raw))
+        {
+            PROFILE_END(PROFILE_STAGE_FILTER);
+            continue;
+        }
+        PROFILE_END(PROFILE_STAGE_FILTER);
+        
+        PROFILE_BEGIN(PROFILE_STAGE_CONVERT);
+        //shift and sensitivity follow the resolution and full-scale set by the commands
+        //(12bit and 2mg/digit with the boot configuration)
+        Out_X = Raw[0]>>FIRMWARE_GET_SHIFT(&Accelerometer);//out_x in digit
+        Sample_mg[0] = Out_X*FIRMWARE_GET_SENSITIVITY(&Accelerometer);//out_x in mg
+        Out_Y = Raw[1]>>FIRMWARE_GET_SHIFT(&Accelerometer);//out_y in digit
+        Sample_mg[1] = Out_Y*FIRMWARE_GET_SENSITIVITY(&Accelerometer);//out_y in mg
+        Out_Z = Raw[2]>>FIRMWARE_GET_SHIFT(&Accelerometer);//out_z in digit
+        Sample_mg[2] = Out_Z*FIRMWARE_GET_SENSITIVITY(&Accelerometer);//out_z in mg
+        
+        if(Calibration_IsRunning())
+        {
+            //samples are used by the calibration procedure and not streamed
+            Calibration_AddSample(Sample_mg);
+            //the conversion of the calibration samples is profiled too
+            PROFILE_END(PROFILE_STAGE_CONVERT);
+            if(!Calibration_IsRunning())
+            {
+                //the coefficients are applied anyway, a failed save only loses them at the next start
+                if(Calibration_GetSaveResult() == NO_ERROR)
+                {
+                    Print_String("Calibration completed\r\n");
+                }
+                else
+                {
+                    Print_String("Calibration completed, coefficients not saved\r\n");
+                }
             }
-         }
-   }
+            continue;
+        }
+        //fixed-point offset and gain correction
+        Calibration_Apply(Sample_mg);
+        samples_streamed++;
+        PROFILE_END(PROFILE_STAGE_CONVERT);
+        
+        #if (EVENT_LOG)
+        //shocks and falls are recorded whatever the stream mode and the link with the host
+        EventLog_AddSample(Sample_mg);
+        #endif
+        
+        PROFILE_BEGIN(PROFILE_STAGE_PROCESS);
+        if(stream_mode == STREAM_MODE_ACTIVITY)
+        {
+            //back to idle after ACTIVITY_HOLD_MS without motion
+            Activity_Update();
+        }
+        
+        if(stream_mode == STREAM_MODE_FEATURES)
+        {
+            //only one frame per window is sent, no conversion to mm/s^2 needed
+            if(Features_AddSample(Sample_mg))
+            {
+                Frame_Write(FeatureFrame, Features_BuildFrame(FeatureFrame));
+            }
+            PROFILE_END(PROFILE_STAGE_PROCESS);
+            continue;
+        }
+        else if(stream_mode == STREAM_MODE_TRIGGERED)
+        {
+            //nothing is sent until an event window is complete
+            if(Trigger_AddSample(Sample_mg))
+            {
+                Trigger_Dump();
+            }
+            PROFILE_END(PROFILE_STAGE_PROCESS);
+            continue;
+        }
+        else if(stream_mode == STREAM_MODE_TILT)
+        {
+            //the angles are computed only when a frame is due, not for every sample
+            if(Tilt_AddSample(Sample_mg))
+            {
+                Tilt_SendFrame();
+            }
+            PROFILE_END(PROFILE_STAGE_PROCESS);
+            continue;
+        }
+        else if(stream_mode == STREAM_MODE_MULTIRATE)
+        {
+            //one frame per channel with a new sample, the slow channels reuse the state of the fast ones
+            Telemetry_CountSent(MultiRate_AddSample(Sample_mg));
+            PROFILE_END(PROFILE_STAGE_PROCESS);
+            continue;
+        }
+        else if(stream_mode == STREAM_MODE_ADAPTIVE)
+        {
+            //the sample is tagged with the rate it was acquired at, then the rate is updated
+            AdaptiveRate_SendSample(Sample_mg);
+            Telemetry_CountSent(1);
+            if(AdaptiveRate_AddSample(Sample_mg))
+            {
+                //the filter state refers to the previous rate
+                Filter_Init();
+            }
+            PROFILE_END(PROFILE_STAGE_PROCESS);
+            continue;
+        }
+        PROFILE_END(PROFILE_STAGE_PROCESS);
+        
+        if(TextStream_IsEnabled())
+        {
+            //one line every few samples, in place of the binary packets
+            TextStream_AddSample(Sample_mg);
+            continue;
+        }
+        
+        PROFILE_BEGIN(PROFILE_STAGE_PACK);
+        #if (FIRMWARE_PROFILE == FIRMWARE_PROFILE_ACCEL_MG)
+        //values in mg, 12 bits needed [-2048;+2048]
+        packet = Frame_Put16(&OutArray[1], (uint16_t)Sample_mg[0]);
+        packet = Frame_Put16(packet, (uint16_t)Sample_mg[1]);
+        Frame_Put16(packet, (uint16_t)Sample_mg[2]);
+        #elif (FIRMWARE_PROFILE == FIRMWARE_PROFILE_ACCEL_MMS2)
+        //values in mm/s^2 (1 mg = 9.81 mm/s^2) in integer arithmetic, int32 needed since they
+        //can exceed the ones covered by an int16
+        Out_X_mms2 = (int32_t)Sample_mg[0]*981/100;
+        Out_Y_mms2 = (int32_t)Sample_mg[1]*981/100;
+        Out_Z_mms2 = (int32_t)Sample_mg[2]*981/100;
+        packet = Frame_Put32(&OutArray[1], (uint32_t)Out_X_mms2);
+        packet = Frame_Put32(packet, (uint32_t)Out_Y_mms2);
+        Frame_Put32(packet, (uint32_t)Out_Z_mms2);
+        #endif
+        PROFILE_END(PROFILE_STAGE_PACK);
+        PROFILE_BEGIN(PROFILE_STAGE_UART);
+        Frame_Write(OutArray, FIRMWARE_PACKET_SIZE);
+        Telemetry_CountSent(1);
+        PROFILE_END(PROFILE_STAGE_UART);
+    }
+}
 /* [] END OF FILE */
@@ -0,0 +1,303 @@
+/**
+*   \file adaptive_rate_sim.c
+*   \brief Rates selected by AdaptiveRate.c and load of UART_Debug.
+*
+*   Builds the firmware AdaptiveRate.c and Filter.c unchanged, with the
+*   device, the frame layer and the time base replaced by a model, and
+*   feeds them synthetic signals at the rate the controller selects:
+*   - rest: gravity and 3 mg of noise;
+*   - walk: a 2 Hz, 300 mg swing;
+*   - vibration: a 40 Hz, 150 mg tone;
+*   - impacts: rest with a 2 g, 5 ms impulse every 10 s.
+*   For each signal, the time spent at each rate, the samples sent, the
+*   rate changes, and the bytes of the 0xA7 and 0xA8 frames per
+*   second, on average and over the worst second, against the
+*   FRAME_UART_BYTES_PER_S that UART_Debug can carry. The load of each step
+*   of the rate table comes first, with the steps the link cannot carry.
+*
+*   Usage:
+*       adaptive_rate_sim [seconds]
+*
+*   Build on Linux or macOS with:
+*       cc -O2 -Ipsoc_stubs -I../AY1920_II_HW_05_PROJ_3.cydsn -o adaptive_rate_sim adaptive_rate_sim.c ../AY1920_II_HW_05_PROJ_3.cydsn/AdaptiveRate.c ../AY1920_II_HW_05_PROJ_3.cydsn/Filter.c -lm
+*   Add -DFILTER_CONFIG=3 to run with the decimation by 8 of the filter
+*   chain.
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "AdaptiveRate.h"
+#include "Filter.h"
+#include "Frame.h"
+#include "Timebase.h"
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+/**
+*   \brief Shift from mg to the left-justified register value (high
+*   resolution, +-2 g, 1 mg/digit).
+*/
+#define SIM_MG_SHIFT 4
+
+/**
+*   \brief Rates of the table of AdaptiveRate.c.
+*/
+static const uint16_t table_hz[] = {10, 25, 50, 100, 200, 400, 1344};
+#define TABLE_STEPS (sizeof(table_hz)/sizeof(table_hz[0]))
+
+/**
+*   \brief Output data rate in Hz by register value, normal and low power.
+*/
+static const uint16_t odr_hz[2][10] = {
+    { 0, 1, 10, 25, 50, 100, 200, 400,    0, 1344 },
+    { 0, 1, 10, 25, 50, 100, 200, 400, 1600, 5376 }
+};
+
+typedef enum {
+    SIGNAL_REST,
+    SIGNAL_WALK,
+    SIGNAL_VIBRATION,
+    SIGNAL_IMPACTS,
+    SIGNALS
+} Signal;
+
+static const char* signal_names[SIGNALS] = {"rest", "walk", "vibration", "impacts"};
+
+// Model of the device and of the link
+static LIS3DH_ODR device_odr = LIS3DH_ODR_100HZ;
+static LIS3DH_Mode device_mode = LIS3DH_MODE_HIGH_RES;
+static double now_s;
+static uint64_t wire_bytes;
+static uint32_t rate_changes;
+
+// Bytes sent in each second of the run, for the worst second
+static uint32_t* second_bytes;
+static uint32_t seconds;
+
+/*
+*   Firmware interfaces used by AdaptiveRate.c.
+*/
+ErrorCode LIS3DH_SetODR(LIS3DH_Device* device, LIS3DH_ODR odr)
+{
+    (void)device;
+    device_odr = odr;
+    return NO_ERROR;
+}
+
+ErrorCode LIS3DH_SetMode(LIS3DH_Device* device, LIS3DH_Mode mode)
+{
+    (void)device;
+    device_mode = mode;
+    return NO_ERROR;
+}
+
+LIS3DH_ODR LIS3DH_GetODR(const LIS3DH_Device* device)
+{
+    (void)device;
+    return device_odr;
+}
+
+uint16_t LIS3DH_GetODRHz(const LIS3DH_Device* device)
+{
+    (void)device;
+    return odr_hz[device_mode == LIS3DH_MODE_LOW_POWER][device_odr];
+}
+
+uint32_t Timebase_GetMs(void)
+{
+    return (uint32_t)(now_s*1000.0);
+}
+
+void Frame_Send(uint8_t header, const uint8_t* payload, uint8_t length)
+{
+    uint32_t second = (uint32_t)now_s;
+    (void)payload;
+    wire_bytes += length + FRAME_OVERHEAD;
+    if (second < seconds)
+    {
+        second_bytes[second] += length + FRAME_OVERHEAD;
+    }
+    if (header == FRAME_HEADER_RATE_CHANGE)
+    {
+        rate_changes++;
+    }
+}
+
+uint8_t* Frame_Put16(uint8_t* buffer, uint16_t value)
+{
+    *buffer++ = (uint8_t)value;
+    *buffer++ = (uint8_t)(value >> 8);
+    return buffer;
+}
+
+uint8_t* Frame_Put32(uint8_t* buffer, uint32_t value)
+{
+    buffer = Frame_Put16(buffer, (uint16_t)value);
+    return Frame_Put16(buffer, (uint16_t)(value >> 16));
+}
+
+    /*
+    *   Uniform noise in [-amplitude, amplitude].
+    */
+    static double noise(double amplitude)
+    {
+        return amplitude*(2.0*rand()/RAND_MAX - 1.0);
+    }
+    
+    /*
+    *   Acceleration in mg of the signal at time t.
+    */
+    static void signal_at(Signal signal, double t, double* mg)
+    {
+        mg[0] = noise(3.0);
+        mg[1] = noise(3.0);
+        mg[2] = 1000.0 + noise(3.0);
+        switch (signal)
+        {
+            case SIGNAL_WALK:
+                mg[0] += 300.0*sin(2.0*M_PI*2.0*t);
+                break;
+            case SIGNAL_VIBRATION:
+                mg[1] += 150.0*sin(2.0*M_PI*40.0*t);
+                break;
+            case SIGNAL_IMPACTS:
+                if (fmod(t, 10.0) >= 5.0 && fmod(t, 10.0) < 5.005)
+                {
+                    mg[0] += 2000.0;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    
+    /*
+    *   Run the controller on a signal for the given time, as main.c does in
+    *   the adaptive stream mode.
+    */
+    static void run(Signal signal, uint32_t run_s)
+    {
+        LIS3DH_Device device;
+        double time_at[TABLE_STEPS] = {0};
+        uint64_t samples = 0;
+        uint32_t worst = 0;
+        uint32_t second;
+        uint8_t step;
+        
+        memset(&device, 0, sizeof(device));
+        device_odr = LIS3DH_ODR_100HZ;
+        device_mode = LIS3DH_MODE_HIGH_RES;
+        now_s = 0.0;
+        wire_bytes = 0;
+        rate_changes = 0;
+        memset(second_bytes, 0, seconds*sizeof(second_bytes[0]));
+        srand(1);
+        
+        Filter_Init();
+        AdaptiveRate_Init(&device);
+        while (now_s < run_s)
+        {
+            uint16_t hz = LIS3DH_GetODRHz(&device);
+            double mg[3];
+            int16_t raw[3];
+            int16_t sample_mg[3];
+            uint8_t axis;
+        
+            signal_at(signal, now_s, mg);
+            for (axis = 0; axis < 3; axis++)
+            {
+                raw[axis] = (int16_t)lrint(mg[axis]*(1 << SIM_MG_SHIFT));
+            }
+            for (step = 0; step < TABLE_STEPS && table_hz[step] != hz; step++)
+            {
+            }
+            if (step < TABLE_STEPS)
+            {
+                time_at[step] += 1.0/hz;
+            }
+            now_s += 1.0/hz;
+        
+            if (!Filter_Process(raw))
+            {
+                continue;
+            }
+            for (axis = 0; axis < 3; axis++)
+            {
+                sample_mg[axis] = (int16_t)(raw[axis] >> SIM_MG_SHIFT);
+            }
+            AdaptiveRate_SendSample(sample_mg);
+            samples++;
+            if (AdaptiveRate_AddSample(sample_mg))
+            {
+                Filter_Init();
+            }
+        }
+        
+        for (second = 0; second < run_s && second < seconds; second++)
+        {
+            if (second_bytes[second] > worst)
+            {
+                worst = second_bytes[second];
+            }
+        }
+        printf("%-10s", signal_names[signal]);
+        for (step = 0; step < TABLE_STEPS; step++)
+        {
+            printf(" %5.1f%%", 100.0*time_at[step]/now_s);
+        }
+        printf(" %8llu %6u %7.0f %6.1f%% %6u %6.1f%%\n", (unsigned long long)samples,
+               rate_changes, wire_bytes/now_s, 100.0*wire_bytes/now_s/FRAME_UART_BYTES_PER_S,
+               worst, 100.0*worst/FRAME_UART_BYTES_PER_S);
+    }
+
+int main(int argc, char** argv)
+{
+    uint32_t run_s = (argc > 1) ? (uint32_t)atol(argv[1]) : 600u;
+    uint8_t decimation = Filter_GetDecimation();
+    uint32_t frame_bytes = 11u + FRAME_OVERHEAD;
+    uint8_t step;
+    Signal signal;
+    
+    if (run_s == 0)
+    {
+        fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+        return 1;
+    }
+    seconds = run_s;
+    second_bytes = calloc(seconds, sizeof(second_bytes[0]));
+    if (second_bytes == NULL)
+    {
+        return 1;
+    }
+    
+    printf("UART_Debug %u baud, %u B/s, %u%% for the tagged frames, decimation %u\n\n",
+           FRAME_UART_BAUD, FRAME_UART_BYTES_PER_S, ADAPTIVE_RATE_LINK_SHARE, decimation);
+    printf("%8s %10s %8s\n", "rate Hz", "frames B/s", "load");
+    for (step = 0; step < TABLE_STEPS; step++)
+    {
+        uint32_t bytes = table_hz[step]*frame_bytes/decimation;
+        printf("%8u %10u %7.1f%%%s\n", table_hz[step], bytes,
+               100.0*bytes/FRAME_UART_BYTES_PER_S,
+               (bytes*100u > FRAME_UART_BYTES_PER_S*ADAPTIVE_RATE_LINK_SHARE) ? "  skipped" : "");
+    }
+    
+    printf("\n%u s of each signal, time at each rate:\n%-10s", run_s, "signal");
+    for (step = 0; step < TABLE_STEPS; step++)
+    {
+        printf(" %6u", table_hz[step]);
+    }
+    printf(" %8s %6s %7s %7s %6s %7s\n", "samples", "changes", "B/s", "load", "worst", "load");
+    for (signal = SIGNAL_REST; signal < SIGNALS; signal++)
+    {
+        run(signal, run_s);
+    }
+    free(second_bytes);
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,511 @@
+/**
+*   \file bus_queue_test.c
+*   \brief Order and latency of the transaction queue of the sensor bus.
+*
+*   Builds the firmware I2C_Interface.c unchanged over a model of the
+*   I2C_Master component: each buffer transfer takes its bit times at the
+*   bus rate and ends with the interrupt exit callback, as on the board.
+*   - order: with the bus busy, transactions of the three classes queued
+*     together run by class, in order of submission within a class, and a
+*     transaction passed over BUS_MAX_BYPASS times goes next;
+*   - bypass: a diagnostic read submitted during a continuous chain of
+*     sample reads waits exactly BUS_MAX_BYPASS of them;
+*   - queue full: the transaction past I2C_QUEUE_DEPTH is refused;
+*   - latency: the poll and read chain of Pipeline.c at the given output
+*     data rate, with configuration writes and diagnostic reads submitted
+*     at random times. The worst latency of each class, measured in us,
+*     is checked against its deadline and against the bound of the queue,
+*     and the counters of I2C_Peripheral_GetClassStats() against the
+*     measurements.
+*   Exits with 1 if a check fails.
+*
+*   Usage:
+*       bus_queue_test [seconds] [bus bit/s] [ODR Hz]
+*
+*   Build on Linux or macOS with:
+*       cc -O2 -Ipsoc_stubs -I../AY1920_II_HW_05_PROJ_3.cydsn -o bus_queue_test bus_queue_test.c ../AY1920_II_HW_05_PROJ_3.cydsn/I2C_Interface.c
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "I2C_Interface.h"
+#include "I2C_Master.h"
+#include "Timebase.h"
+
+/**
+*   \brief Bus address of the LIS3DH (SDO high).
+*/
+#define DEVICE_ADDRESS 0x18
+
+/**
+*   \brief Bytes of a sample read of the pipelined chain.
+*/
+#define SAMPLE_BYTES 6
+
+/**
+*   \brief Mean interval of the configuration writes and of the
+*   diagnostic reads of the latency test, in us.
+*/
+#define CONFIG_INTERVAL_US 50000u
+#define DIAGNOSTIC_INTERVAL_US 20000u
+
+/**
+*   \brief Transactions of the order test.
+*/
+#define ORDER_TRANSACTIONS 8
+
+// Model of the bus: time, rate and transfer on the bus
+static uint64_t now_us;
+static uint32_t bus_rate = 100000;
+static uint8_t master_status;
+static uint8_t transfer_active;
+static uint8_t transfer_read;
+static uint64_t transfer_end_us;
+
+// Completion order of the transactions of a test
+static const BusTransaction* completed[64];
+static uint8_t completed_count;
+static uint8_t failures;
+
+/*
+*   Firmware interfaces used by I2C_Interface.c.
+*/
+uint8 CyEnterCriticalSection(void)
+{
+    return 0;
+}
+
+void CyExitCriticalSection(uint8 savedIntrStatus)
+{
+    (void)savedIntrStatus;
+}
+
+uint32_t Timebase_GetMs(void)
+{
+    return (uint32_t)(now_us/1000u);
+}
+
+void I2C_Master_Start(void)
+{
+}
+
+void I2C_Master_Stop(void)
+{
+}
+
+/*
+*   A transfer of the given bytes, slave address included: start or
+*   restart, 9 bit times per byte, and the stop if the bus is released.
+*/
+static uint8 Model_Transfer(uint8 bytes, uint8 mode, uint8 read)
+{
+    uint32_t bits = 1u + 9u*bytes + (mode == I2C_Master_MODE_NO_STOP ? 0u : 1u);
+    if (transfer_active)
+    {
+        return I2C_Master_MSTR_BUS_BUSY;
+    }
+    transfer_active = 1;
+    transfer_read = read;
+    transfer_end_us = now_us + ((uint64_t)bits*1000000u + bus_rate - 1)/bus_rate;
+    master_status = I2C_Master_MSTAT_XFER_INP;
+    return I2C_Master_MSTR_NO_ERROR;
+}
+
+uint8 I2C_Master_MasterWriteBuf(uint8 slaveAddress, uint8* wrData, uint8 cnt, uint8 mode)
+{
+    (void)slaveAddress;
+    (void)wrData;
+    return Model_Transfer((uint8)(1 + cnt), mode, 0);
+}
+
+uint8 I2C_Master_MasterReadBuf(uint8 slaveAddress, uint8* rdData, uint8 cnt, uint8 mode)
+{
+    (void)slaveAddress;
+    memset(rdData, 0, cnt);
+    return Model_Transfer((uint8)(1 + cnt), mode, 1);
+}
+
+uint8 I2C_Master_MasterStatus(void)
+{
+    return master_status;
+}
+
+uint8 I2C_Master_MasterClearStatus(void)
+{
+    uint8 status = master_status;
+    master_status &= (uint8)~(I2C_Master_MSTAT_RD_CMPLT | I2C_Master_MSTAT_WR_CMPLT);
+    return status;
+}
+
+    /*
+    *   End the transfer on the bus and run the interrupt of the component.
+    */
+    static void bus_step(void)
+    {
+        now_us = transfer_end_us;
+        transfer_active = 0;
+        master_status = transfer_read ? I2C_Master_MSTAT_RD_CMPLT : I2C_Master_MSTAT_WR_CMPLT;
+        I2C_Master_ISR_ExitCallback();
+    }
+    
+    /*
+    *   Run the bus until no transfer is left.
+    */
+    static void bus_drain(void)
+    {
+        while (transfer_active)
+        {
+            bus_step();
+        }
+    }
+    
+    static void record_done(BusTransaction* transaction)
+    {
+        if (completed_count < sizeof(completed)/sizeof(completed[0]))
+        {
+            completed[completed_count++] = transaction;
+        }
+    }
+    
+    static void check(int condition, const char* what)
+    {
+        printf("  %-58s %s\n", what, condition ? "ok" : "FAILED");
+        if (!condition)
+        {
+            failures++;
+        }
+    }
+    
+    static void init_transaction(BusTransaction* transaction, BusClass bus_class,
+                                 uint8_t write, uint8_t count, uint8_t* data)
+    {
+        memset(transaction, 0, sizeof(*transaction));
+        transaction->device_address = DEVICE_ADDRESS;
+        transaction->register_address = 0x28;
+        transaction->register_count = count;
+        transaction->write = write;
+        transaction->data = data;
+        transaction->bus_class = bus_class;
+        transaction->done = record_done;
+    }
+    
+    /*
+    *   Time of a transfer, rounded up to the us as Model_Transfer() does.
+    */
+    static uint64_t transfer_us(uint32_t bits)
+    {
+        return ((uint64_t)bits*1000000u + bus_rate - 1)/bus_rate;
+    }
+    
+    /*
+    *   Time of a register transaction: one transfer for a write, the
+    *   register address and the data after a restart for a read.
+    */
+    static uint64_t transaction_us(uint8_t write, uint8_t count)
+    {
+        return write ? transfer_us(2u + 9u*(2u + count)) :
+                       transfer_us(1u + 9u*2u) + transfer_us(2u + 9u*(1u + count));
+    }
+    
+    /*
+    *   Classes queued together behind a busy bus.
+    */
+    static void test_order(void)
+    {
+        static const BusClass classes[ORDER_TRANSACTIONS] = {
+            BUS_CLASS_DIAGNOSTIC,   // on the bus first
+            BUS_CLASS_DIAGNOSTIC, BUS_CLASS_CONFIG, BUS_CLASS_SAMPLE, BUS_CLASS_CONFIG,
+            BUS_CLASS_SAMPLE, BUS_CLASS_DIAGNOSTIC, BUS_CLASS_SAMPLE
+        };
+        // D0, the samples and C2, then D1 and D6 passed over 4 times go before C4
+        static const uint8_t expected[ORDER_TRANSACTIONS] = { 0, 3, 5, 7, 2, 1, 6, 4 };
+        BusTransaction transactions[ORDER_TRANSACTIONS];
+        uint8_t data[ORDER_TRANSACTIONS][2];
+        uint8_t i;
+        uint8_t in_order = 1;
+        
+        printf("order\n");
+        completed_count = 0;
+        for (i = 0; i < ORDER_TRANSACTIONS; i++)
+        {
+            init_transaction(&transactions[i], classes[i], 0, 2, data[i]);
+            I2C_Peripheral_Submit(&transactions[i]);
+        }
+        bus_drain();
+        for (i = 0; i < ORDER_TRANSACTIONS; i++)
+        {
+            in_order &= (i < completed_count && completed[i] == &transactions[expected[i]]);
+        }
+        check(completed_count == ORDER_TRANSACTIONS, "all the transactions are over");
+        check(in_order, "by class, in order of submission, bypass after 4");
+    }
+    
+    // Continuous sample chain of the bypass test
+    static BusTransaction chain;
+    static uint8_t chain_data[SAMPLE_BYTES];
+    static uint32_t chain_runs;
+    static uint8_t chain_running;
+    
+    static void chain_done(BusTransaction* transaction)
+    {
+        chain_runs++;
+        if (chain_running)
+        {
+            I2C_Peripheral_Submit(transaction);
+        }
+    }
+    
+    /*
+    *   A diagnostic read behind a chain that never leaves the bus free.
+    */
+    static void test_bypass(void)
+    {
+        BusTransaction diagnostic;
+        uint8_t data;
+        uint32_t runs_before;
+        
+        printf("bypass\n");
+        completed_count = 0;
+        init_transaction(&chain, BUS_CLASS_SAMPLE, 0, SAMPLE_BYTES, chain_data);
+        chain.done = chain_done;
+        chain_running = 1;
+        chain_runs = 0;
+        I2C_Peripheral_Submit(&chain);
+        
+        init_transaction(&diagnostic, BUS_CLASS_DIAGNOSTIC, 0, 1, &data);
+        runs_before = chain_runs;
+        I2C_Peripheral_Submit(&diagnostic);
+        while (diagnostic.state != BUS_TRANSACTION_DONE && transfer_active)
+        {
+            bus_step();
+        }
+        // The chain read on the bus when the diagnostic was queued is not a bypass
+        check(diagnostic.state == BUS_TRANSACTION_DONE, "diagnostic read over");
+        check(chain_runs - runs_before == 1u + BUS_MAX_BYPASS, "waited BUS_MAX_BYPASS sample reads");
+        chain_running = 0;
+        bus_drain();
+    }
+    
+    /*
+    *   Transactions past the depth of the queue.
+    */
+    static void test_queue_full(void)
+    {
+        BusTransaction transactions[I2C_QUEUE_DEPTH + 2];
+        uint8_t data[I2C_QUEUE_DEPTH + 2];
+        uint8_t accepted = 0;
+        uint8_t i;
+        ErrorCode last;
+        
+        printf("queue full\n");
+        // One on the bus, I2C_QUEUE_DEPTH waiting
+        for (i = 0; i < I2C_QUEUE_DEPTH + 1; i++)
+        {
+            init_transaction(&transactions[i], BUS_CLASS_CONFIG, 0, 1, &data[i]);
+            accepted += (I2C_Peripheral_Submit(&transactions[i]) == NO_ERROR);
+        }
+        init_transaction(&transactions[i], BUS_CLASS_SAMPLE, 0, 1, &data[i]);
+        last = I2C_Peripheral_Submit(&transactions[i]);
+        check(accepted == I2C_QUEUE_DEPTH + 1, "I2C_QUEUE_DEPTH transactions queued");
+        check(last == ERROR && transactions[i].state == BUS_TRANSACTION_DONE &&
+              transactions[i].error == ERROR, "the next one refused and over");
+        bus_drain();
+    }
+    
+    // Pipelined chain of the latency test
+    static BusTransaction poll_transaction;
+    static BusTransaction read_transaction;
+    static uint8_t status_data;
+    static uint8_t sample_data[SAMPLE_BYTES];
+    static uint32_t odr_hz = 400;
+    static uint64_t next_sample_us;
+    static uint64_t worst_us[BUS_CLASSES];
+    static uint64_t longest_us;
+    static uint64_t submitted_us[2 + 2];
+    
+    /*
+    *   Latency of a transaction of the test, from its submission in us.
+    */
+    static void measure(const BusTransaction* transaction, uint64_t submitted)
+    {
+        uint64_t latency = now_us - submitted;
+        if (latency > worst_us[transaction->bus_class])
+        {
+            worst_us[transaction->bus_class] = latency;
+        }
+    }
+    
+    static void poll_done(BusTransaction* transaction)
+    {
+        measure(transaction, submitted_us[0]);
+        // Data ready once the next sample of the device is out
+        if (now_us >= next_sample_us)
+        {
+            next_sample_us += 1000000u/odr_hz;
+            submitted_us[1] = now_us;
+            I2C_Peripheral_Submit(&read_transaction);
+        }
+        else
+        {
+            submitted_us[0] = now_us;
+            I2C_Peripheral_Submit(&poll_transaction);
+        }
+    }
+    
+    static void read_done(BusTransaction* transaction)
+    {
+        measure(transaction, submitted_us[1]);
+        submitted_us[0] = now_us;
+        I2C_Peripheral_Submit(&poll_transaction);
+    }
+    
+    static void other_done(BusTransaction* transaction)
+    {
+        measure(transaction, submitted_us[transaction->bus_class == BUS_CLASS_CONFIG ? 2 : 3]);
+    }
+    
+    /*
+    *   Next time of a transaction submitted at random, within twice the
+    *   mean interval.
+    */
+    static uint64_t next_random(uint64_t from, uint32_t mean_us)
+    {
+        return from + 1u + (uint64_t)rand() % (2u*mean_us);
+    }
+    
+    static void test_latency(uint32_t run_s)
+    {
+        static const uint16_t deadline_ms[BUS_CLASSES] = {
+            BUS_DEADLINE_SAMPLE_MS, BUS_DEADLINE_CONFIG_MS, BUS_DEADLINE_DIAGNOSTIC_MS
+        };
+        static const char* names[BUS_CLASSES] = { "sample", "config", "diagnostic" };
+        BusClassStats before[BUS_CLASSES];
+        BusTransaction config;
+        BusTransaction diagnostic;
+        uint8_t config_data[I2C_WRITE_MAX];
+        uint8_t diagnostic_data[2];
+        uint64_t next_config;
+        uint64_t next_diagnostic;
+        uint64_t end_us = now_us + (uint64_t)run_s*1000000u;
+        uint64_t bound_us[BUS_CLASSES];
+        uint8_t bus_class;
+        
+        printf("latency, %u s at %u Hz, bus %u bit/s\n", run_s, odr_hz, bus_rate);
+        memcpy(before, I2C_Peripheral_GetClassStats(), sizeof(before));
+        memset(worst_us, 0, sizeof(worst_us));
+        init_transaction(&poll_transaction, BUS_CLASS_SAMPLE, 0, 1, &status_data);
+        poll_transaction.done = poll_done;
+        init_transaction(&read_transaction, BUS_CLASS_SAMPLE, 0, SAMPLE_BYTES, sample_data);
+        read_transaction.done = read_done;
+        init_transaction(&config, BUS_CLASS_CONFIG, 1, I2C_WRITE_MAX, config_data);
+        config.done = other_done;
+        init_transaction(&diagnostic, BUS_CLASS_DIAGNOSTIC, 0, 2, diagnostic_data);
+        diagnostic.done = other_done;
+        // Configuration writes as long as the queue allows, the longest transaction
+        longest_us = transaction_us(1, I2C_WRITE_MAX);
+        
+        next_sample_us = now_us;
+        submitted_us[0] = now_us;
+        I2C_Peripheral_Submit(&poll_transaction);
+        next_config = next_random(now_us, CONFIG_INTERVAL_US);
+        next_diagnostic = next_random(now_us, DIAGNOSTIC_INTERVAL_US);
+        while (now_us < end_us)
+        {
+            // Submissions from the main loop happen between two bus events
+            uint64_t next_event = transfer_end_us;
+            if (next_config < next_event)
+            {
+                now_us = next_config;
+                if (config.state != BUS_TRANSACTION_QUEUED && config.state != BUS_TRANSACTION_ACTIVE)
+                {
+                    submitted_us[2] = now_us;
+                    I2C_Peripheral_Submit(&config);
+                }
+                next_config = next_random(now_us, CONFIG_INTERVAL_US);
+                continue;
+            }
+            if (next_diagnostic < next_event)
+            {
+                now_us = next_diagnostic;
+                if (diagnostic.state != BUS_TRANSACTION_QUEUED && diagnostic.state != BUS_TRANSACTION_ACTIVE)
+                {
+                    submitted_us[3] = now_us;
+                    I2C_Peripheral_Submit(&diagnostic);
+                }
+                next_diagnostic = next_random(now_us, DIAGNOSTIC_INTERVAL_US);
+                continue;
+            }
+            bus_step();
+        }
+        // The chain stops at the next poll
+        poll_transaction.done = NULL;
+        read_transaction.done = NULL;
+        bus_drain();
+        
+        // Every class waits for the transaction on the bus and for the
+        // lower ones passed over BUS_MAX_BYPASS times (one per class here),
+        // the lower classes also for BUS_MAX_BYPASS of the higher ones
+        bound_us[BUS_CLASS_SAMPLE] = longest_us + transaction_us(1, I2C_WRITE_MAX) +
+                                     transaction_us(0, 2) + transaction_us(0, SAMPLE_BYTES);
+        bound_us[BUS_CLASS_CONFIG] = longest_us + BUS_MAX_BYPASS*transaction_us(0, SAMPLE_BYTES) +
+                                     transaction_us(0, 2) + transaction_us(1, I2C_WRITE_MAX);
+        bound_us[BUS_CLASS_DIAGNOSTIC] = longest_us + BUS_MAX_BYPASS*longest_us + transaction_us(0, 2);
+        printf("  %-10s %12s %10s %10s %8s %10s %8s\n", "class", "transactions", "worst us",
+               "bound us", "worst ms", "deadline", "missed");
+        for (bus_class = 0; bus_class < BUS_CLASSES; bus_class++)
+        {
+            const BusClassStats* after = &I2C_Peripheral_GetClassStats()[bus_class];
+            printf("  %-10s %12u %10llu %10llu %8u %10u %8u\n", names[bus_class],
+                   after->transactions - before[bus_class].transactions,
+                   (unsigned long long)worst_us[bus_class], (unsigned long long)bound_us[bus_class],
+                   after->worst_ms, deadline_ms[bus_class],
+                   (unsigned)(uint16_t)(after->missed - before[bus_class].missed));
+        }
+        for (bus_class = 0; bus_class < BUS_CLASSES; bus_class++)
+        {
+            const BusClassStats* after = &I2C_Peripheral_GetClassStats()[bus_class];
+            char what[80];
+            snprintf(what, sizeof(what), "%s: worst within the bound", names[bus_class]);
+            check(worst_us[bus_class] <= bound_us[bus_class], what);
+            snprintf(what, sizeof(what), "%s: no deadline missed", names[bus_class]);
+            check(worst_us[bus_class] <= deadline_ms[bus_class]*1000u &&
+                  after->missed == before[bus_class].missed, what);
+            // The firmware counts whole ms of Timebase_GetMs()
+            snprintf(what, sizeof(what), "%s: counted worst agrees with the measured one", names[bus_class]);
+            check(after->worst_ms <= worst_us[bus_class]/1000u + 1u, what);
+        }
+    }
+
+int main(int argc, char** argv)
+{
+    uint32_t run_s = (argc > 1) ? (uint32_t)atol(argv[1]) : 60u;
+    
+    if (argc > 2)
+    {
+        bus_rate = (uint32_t)atol(argv[2]);
+    }
+    if (argc > 3)
+    {
+        odr_hz = (uint32_t)atol(argv[3]);
+    }
+    if (run_s == 0 || bus_rate == 0 || odr_hz == 0)
+    {
+        fprintf(stderr, "usage: %s [seconds] [bus bit/s] [ODR Hz]\n", argv[0]);
+        return 2;
+    }
+    srand(1);
+    I2C_Peripheral_Start();
+    
+    // First, the worst latencies of the firmware counters are not cleared
+    test_latency(run_s);
+    test_order();
+    test_bypass();
+    test_queue_full();
+    
+    printf("%s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,585 @@
+/**
+*   \file bus_trace.c
+*   \brief Timeline and latency histograms of the sensor bus trace of the
+*   PROJ_3 firmware.
+*
+*   Asks the firmware built with BUS_TRACE_ENABLE for the ring of the bus
+*   transactions described in BusTrace.h, then prints:
+*   - the timeline: start of each transaction from the oldest one, its
+*     duration on the bus, the idle time before it, the device, register,
+*     direction, number of registers, class and result;
+*   - for each device, register and direction: count, errors, minimum, mean
+*     and maximum duration and a histogram of the durations in power of 2
+*     buckets of microseconds;
+*   - the share of the traced time the bus was busy and the longest idle
+*     time.
+*
+*   Usage:
+*       bus_trace [-b baud] <port> [clear] [csv]
+*       bus_trace - [csv] < capture.bin
+*
+*   The port is opened at 19200 baud, the rate of UART_Debug in the
+*   TopDesign (FRAME_UART_BAUD in Frame.h); -b sets another rate.
+*
+*   With clear the ring is cleared after the dump, so that the next dump
+*   only shows the new transactions. With csv the timeline is printed as
+*   comma separated values and the histograms are left out. "-" reads a
+*   stream recorded on standard input, e.g. while sending the command with
+*   command_client.
+*
+*   Build on Linux or macOS with: cc -O2 -o bus_trace bus_trace.c serial_frame.c
+*/
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "serial_frame.h"
+
+/**
+*   \brief Values shared with the firmware (Command.h, Frame.h, BusTrace.h,
+*   BusTransaction.h, BusStats.h).
+*/
+#define COMMAND_SYNC 0xB0
+#define COMMAND_DUMP_TRACE 0x0B
+#define FRAME_HEADER_COMMAND_ACK 0xAC
+#define FRAME_HEADER_TRACE_INFO 0xB5
+#define FRAME_HEADER_TRACE_ENTRIES 0xB6
+#define FRAME_FOOTER 0xC0
+#define ACK_PAYLOAD 3
+#define INFO_PAYLOAD 12
+#define ENTRY_SIZE 12
+#define FRAME_ENTRIES 20
+#define FLAG_WRITE 0x80
+#define CLASS_SHIFT 4
+#define RESULT_MASK 0x0F
+#define BUS_CLASSES 3
+#define BUS_ERROR_TYPES 4
+
+/**
+*   \brief Timeout of the dump in ms, from the command to the acknowledge.
+*/
+#define DUMP_TIMEOUT_MS 5000
+
+/**
+*   \brief Buckets of the histograms: below 1 us, then [2^(b-1), 2^b) us,
+*   the last one open.
+*/
+#define BUCKETS 17
+
+/**
+*   \brief Transaction of the trace.
+*/
+typedef struct {
+    uint32_t index;
+    uint32_t start;
+    uint32_t end;
+    uint8_t device_address;
+    uint8_t register_address;
+    uint8_t register_count;
+    uint8_t flags;
+} Entry;
+
+/**
+*   \brief Durations of the transactions on one register.
+*/
+typedef struct {
+    uint8_t device_address;
+    uint8_t register_address;
+    uint8_t write;
+    uint32_t count;
+    uint32_t errors;
+    double min_us;
+    double max_us;
+    double sum_us;
+    uint32_t buckets[BUCKETS];
+} Latency;
+
+static const char* const class_names[BUS_CLASSES] = { "sample", "config", "diag" };
+static const char* const result_names[1 + BUS_ERROR_TYPES] = { "ok", "nak", "arbitration", "not ready", "other" };
+
+// Rate of the serial port, the firmware runs UART_Debug at 19200 baud (FRAME_UART_BAUD)
+static speed_t baud = SERIAL_DEFAULT_BAUD;
+
+// Sliding window used to find the frames in the received bytes
+static uint8_t window[1 + 4 + FRAME_ENTRIES*ENTRY_SIZE + 3];
+static size_t window_count;
+
+// Content of the information frame
+static int have_info;
+static uint32_t clock_hz;
+static uint32_t recorded;
+static uint16_t in_ring;
+static uint16_t missed;
+
+// Entries received, in order of arrival
+static Entry* entries;
+static size_t entry_count;
+static size_t entry_capacity;
+static int acknowledged;
+
+    static uint64_t now_ms(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec*1000u + (uint64_t)ts.tv_nsec/1000000u;
+    }
+    
+    /*
+    *   Check if the window ends with a valid frame of the given header and payload length.
+    */
+    static const uint8_t* match_frame(uint8_t header, size_t payload)
+    {
+        size_t length = 1 + payload + 3;
+        if (window_count < length)
+        {
+            return NULL;
+        }
+        const uint8_t* frame = window + window_count - length;
+        if (frame[0] != header || frame[length - 1] != FRAME_FOOTER)
+        {
+            return NULL;
+        }
+        uint16_t crc = serial_crc16(frame, 1 + payload);
+        if (frame[1 + payload] != (crc & 0xFF) || frame[2 + payload] != (crc >> 8))
+        {
+            return NULL;
+        }
+        return frame + 1;
+    }
+    
+    static void add_entries(const uint8_t* p, size_t count)
+    {
+        uint32_t index = serial_get32(p);
+        p += 4;
+        for (size_t i = 0; i < count; i++, p += ENTRY_SIZE)
+        {
+            if (entry_count == entry_capacity)
+            {
+                entry_capacity = entry_capacity ? 2*entry_capacity : 256;
+                entries = realloc(entries, entry_capacity*sizeof(Entry));
+                if (entries == NULL)
+                {
+                    perror("realloc");
+                    exit(1);
+                }
+            }
+            Entry* entry = &entries[entry_count++];
+            entry->index = index + (uint32_t)i;
+            entry->start = serial_get32(p);
+            entry->end = serial_get32(p + 4);
+            entry->device_address = p[8];
+            entry->register_address = p[9];
+            entry->register_count = p[10];
+            entry->flags = p[11];
+        }
+    }
+    
+    /*
+    *   Add a received byte and decode the frame it ends, if any. The
+    *   entries frames are tried from the longest, since their length
+    *   depends on the entries left in the ring.
+    */
+    static void receive(uint8_t byte)
+    {
+        const uint8_t* found;
+        
+        if (window_count == sizeof(window))
+        {
+            memmove(window, window + 1, sizeof(window) - 1);
+            window_count--;
+        }
+        window[window_count++] = byte;
+        if (byte != FRAME_FOOTER)
+        {
+            return;
+        }
+        
+        if ((found = match_frame(FRAME_HEADER_TRACE_INFO, INFO_PAYLOAD)) != NULL)
+        {
+            have_info = 1;
+            clock_hz = serial_get32(found);
+            recorded = serial_get32(found + 4);
+            in_ring = (uint16_t)(found[8] | found[9] << 8);
+            missed = (uint16_t)(found[10] | found[11] << 8);
+            // A new dump replaces the previous one
+            entry_count = 0;
+            window_count = 0;
+            return;
+        }
+        for (size_t count = FRAME_ENTRIES; count > 0; count--)
+        {
+            if ((found = match_frame(FRAME_HEADER_TRACE_ENTRIES, 4 + count*ENTRY_SIZE)) != NULL)
+            {
+                add_entries(found, count);
+                window_count = 0;
+                return;
+            }
+        }
+        if ((found = match_frame(FRAME_HEADER_COMMAND_ACK, ACK_PAYLOAD)) != NULL &&
+            found[0] == COMMAND_DUMP_TRACE)
+        {
+            acknowledged = 1 + found[1];
+            window_count = 0;
+        }
+    }
+    
+    /*
+    *   Send the dump command and collect the frames until its acknowledge.
+    */
+    static int dump(int fd, int clear)
+    {
+        uint8_t command[4] = { COMMAND_SYNC, COMMAND_DUMP_TRACE, (uint8_t)(clear ? 1 : 0), 0 };
+        command[3] = (uint8_t)(command[0] ^ command[1] ^ command[2]);
+        if (write(fd, command, sizeof(command)) != (ssize_t)sizeof(command))
+        {
+            perror("write");
+            return -1;
+        }
+        
+        uint64_t deadline = now_ms() + DUMP_TIMEOUT_MS;
+        uint8_t buffer[256];
+        while (!acknowledged && now_ms() < deadline)
+        {
+            fd_set set;
+            struct timeval tv = { 0, 10000 };
+            FD_ZERO(&set);
+            FD_SET(fd, &set);
+            if (select(fd + 1, &set, NULL, NULL, &tv) <= 0)
+            {
+                continue;
+            }
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            for (ssize_t i = 0; i < n && !acknowledged; i++)
+            {
+                receive(buffer[i]);
+            }
+        }
+        if (!acknowledged)
+        {
+            fprintf(stderr, "no acknowledge\n");
+            return -1;
+        }
+        if (acknowledged != 1)
+        {
+            fprintf(stderr, "dump refused, status %d (firmware built without BUS_TRACE_ENABLE?)\n",
+                    acknowledged - 1);
+            return -1;
+        }
+        return 0;
+    }
+    
+    static double to_us(uint32_t counts)
+    {
+        return counts*1e6/clock_hz;
+    }
+    
+    static const char* class_name(uint8_t flags)
+    {
+        uint8_t bus_class = (flags >> CLASS_SHIFT) & 0x03;
+        return bus_class < BUS_CLASSES ? class_names[bus_class] : "?";
+    }
+    
+    static const char* result_name(uint8_t flags)
+    {
+        uint8_t result = flags & RESULT_MASK;
+        return result <= BUS_ERROR_TYPES ? result_names[result] : "?";
+    }
+    
+    /*
+    *   Names of the LIS3DH registers (LIS3DH.h).
+    */
+    static const char* register_name(uint8_t address)
+    {
+        switch (address)
+        {
+            case 0x07: return "STATUS_REG_AUX";
+            case 0x08: return "OUT_ADC1_L";
+            case 0x0F: return "WHO_AM_I";
+            case 0x1F: return "TEMP_CFG_REG";
+            case 0x20: return "CTRL_REG1";
+            case 0x21: return "CTRL_REG2";
+            case 0x22: return "CTRL_REG3";
+            case 0x23: return "CTRL_REG4";
+            case 0x24: return "CTRL_REG5";
+            case 0x25: return "CTRL_REG6";
+            case 0x27: return "STATUS_REG";
+            case 0x28: return "OUT_X_L";
+            case 0x2E: return "FIFO_CTRL_REG";
+            case 0x2F: return "FIFO_SRC_REG";
+            case 0x30: return "INT1_CFG";
+            case 0x31: return "INT1_SRC";
+            case 0x32: return "INT1_THS";
+            case 0x33: return "INT1_DURATION";
+            default: return "";
+        }
+    }
+    
+    static int bucket(double us)
+    {
+        int b = 0;
+        while (b < BUCKETS - 1 && us >= (double)(1u << b))
+        {
+            b++;
+        }
+        return b;
+    }
+    
+    static void print_timeline(int csv)
+    {
+        double t = 0.0;
+        double previous_end = 0.0;
+        double busy = 0.0;
+        double longest_idle = 0.0;
+        
+        if (csv)
+        {
+            printf("index,start_us,duration_us,idle_us,device,register,direction,count,class,result\n");
+        }
+        else
+        {
+            printf("   index     start us  duration us    idle us  dev  reg                  dir count class  result\n");
+        }
+        for (size_t i = 0; i < entry_count; i++)
+        {
+            const Entry* entry = &entries[i];
+            // Differences of the free running counter, valid over one wrap
+            if (i > 0)
+            {
+                t += to_us(entry->start - entries[i - 1].start);
+            }
+            double duration = to_us(entry->end - entry->start);
+            double idle = i > 0 ? t - previous_end : 0.0;
+            const char* direction = (entry->flags & FLAG_WRITE) ? (entry->register_count ? "W" : "probe") : "R";
+        
+            if (idle > longest_idle)
+            {
+                longest_idle = idle;
+            }
+            busy += duration;
+            previous_end = t + duration;
+        
+            if (csv)
+            {
+                printf("%u,%.2f,%.2f,%.2f,0x%02X,0x%02X,%s,%u,%s,%s\n", entry->index, t, duration, idle,
+                       entry->device_address, entry->register_address, direction,
+                       entry->register_count, class_name(entry->flags), result_name(entry->flags));
+            }
+            else
+            {
+                printf("%8u %12.2f %12.2f %10.2f 0x%02X 0x%02X %-15s %-5s %5u %-6s %s\n", entry->index, t,
+                       duration, idle, entry->device_address, entry->register_address,
+                       register_name(entry->register_address), direction, entry->register_count,
+                       class_name(entry->flags), result_name(entry->flags));
+            }
+        }
+        if (!csv && entry_count > 0 && previous_end > 0.0)
+        {
+            printf("\nTraced %.3f ms, bus busy %.1f %%, longest idle %.2f us\n",
+                   previous_end/1000.0, 100.0*busy/previous_end, longest_idle);
+        }
+    }
+    
+    static int compare_latency(const void* a, const void* b)
+    {
+        const Latency* x = a;
+        const Latency* y = b;
+        int kx = x->device_address << 9 | x->register_address << 1 | x->write;
+        int ky = y->device_address << 9 | y->register_address << 1 | y->write;
+        return kx - ky;
+    }
+    
+    static void print_histograms(void)
+    {
+        Latency* latencies = calloc(entry_count ? entry_count : 1, sizeof(Latency));
+        size_t latency_count = 0;
+        
+        for (size_t i = 0; i < entry_count; i++)
+        {
+            const Entry* entry = &entries[i];
+            uint8_t write = (entry->flags & FLAG_WRITE) ? 1 : 0;
+            double duration = to_us(entry->end - entry->start);
+            Latency* latency = NULL;
+            for (size_t j = 0; j < latency_count; j++)
+            {
+                if (latencies[j].device_address == entry->device_address &&
+                    latencies[j].register_address == entry->register_address &&
+                    latencies[j].write == write)
+                {
+                    latency = &latencies[j];
+                    break;
+                }
+            }
+            if (latency == NULL)
+            {
+                latency = &latencies[latency_count++];
+                latency->device_address = entry->device_address;
+                latency->register_address = entry->register_address;
+                latency->write = write;
+                latency->min_us = duration;
+            }
+            latency->count++;
+            latency->errors += (entry->flags & RESULT_MASK) != 0;
+            latency->sum_us += duration;
+            if (duration < latency->min_us)
+            {
+                latency->min_us = duration;
+            }
+            if (duration > latency->max_us)
+            {
+                latency->max_us = duration;
+            }
+            latency->buckets[bucket(duration)]++;
+        }
+        qsort(latencies, latency_count, sizeof(Latency), compare_latency);
+        
+        printf("\nDuration on the bus by register, us:\n");
+        for (size_t j = 0; j < latency_count; j++)
+        {
+            const Latency* latency = &latencies[j];
+            uint32_t highest = 0;
+            printf("0x%02X 0x%02X %-15s %s  count %u, errors %u, min %.2f, mean %.2f, max %.2f\n",
+                   latency->device_address, latency->register_address,
+                   register_name(latency->register_address), latency->write ? "W" : "R",
+                   latency->count, latency->errors, latency->min_us,
+                   latency->sum_us/latency->count, latency->max_us);
+            for (int b = 0; b < BUCKETS; b++)
+            {
+                if (latency->buckets[b] > highest)
+                {
+                    highest = latency->buckets[b];
+                }
+            }
+            for (int b = 0; b < BUCKETS; b++)
+            {
+                if (latency->buckets[b] == 0)
+                {
+                    continue;
+                }
+                char range[32];
+                if (b == 0)
+                {
+                    snprintf(range, sizeof(range), "< 1");
+                }
+                else if (b == BUCKETS - 1)
+                {
+                    snprintf(range, sizeof(range), ">= %u", 1u << (b - 1));
+                }
+                else
+                {
+                    snprintf(range, sizeof(range), "%u - %u", 1u << (b - 1), 1u << b);
+                }
+                int width = (int)(40.0*latency->buckets[b]/highest + 0.5);
+                printf("    %13s %7u %.*s\n", range, latency->buckets[b], width > 0 ? width : 1,
+                       "########################################");
+            }
+        }
+        free(latencies);
+    }
+    
+    static int usage(const char* name)
+    {
+        fprintf(stderr, "usage: %s [-b baud] <port> [clear] [csv]\n"
+                        "       %s - [csv] < capture.bin\n", name, name);
+        return 2;
+    }
+
+int main(int argc, char** argv)
+{
+    int clear = 0;
+    int csv = 0;
+    
+    int option;
+    while ((option = getopt(argc, argv, "b:")) != -1)
+    {
+        if (option != 'b' || (baud = serial_baud(atol(optarg))) == 0)
+        {
+            return usage(argv[0]);
+        }
+    }
+    // Positional arguments from argv[1] on
+    argv[optind - 1] = argv[0];
+    argc -= optind - 1;
+    argv += optind - 1;
+    
+    if (argc < 2)
+    {
+        return usage(argv[0]);
+    }
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "clear") == 0)
+        {
+            clear = 1;
+        }
+        else if (strcmp(argv[i], "csv") == 0)
+        {
+            csv = 1;
+        }
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+    int fd = serial_open(argv[1], O_RDWR, baud, 0);
+    if (fd < 0)
+    {
+        return 1;
+    }
+    if (fd != STDIN_FILENO)
+    {
+        tcflush(fd, TCIOFLUSH);
+    }
+    
+    if (fd == STDIN_FILENO)
+    {
+        uint8_t buffer[256];
+        ssize_t n;
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (ssize_t i = 0; i < n; i++)
+            {
+                receive(buffer[i]);
+            }
+        }
+    }
+    else
+    {
+        int result = dump(fd, clear);
+        close(fd);
+        if (result != 0)
+        {
+            return 1;
+        }
+    }
+    
+    if (!have_info || clock_hz == 0)
+    {
+        fprintf(stderr, "no trace information frame\n");
+        return 1;
+    }
+    if (!csv)
+    {
+        printf("Counter %u Hz, %u transactions since start, %u in the ring, %u not recorded during dumps\n",
+               clock_hz, recorded, in_ring, missed);
+    }
+    if (entry_count != in_ring)
+    {
+        fprintf(stderr, "%zu of %u entries received\n", entry_count, in_ring);
+    }
+    print_timeline(csv);
+    if (!csv)
+    {
+        print_histograms();
+    }
+    free(entries);
+    return 0;
+}
+
+/* [] END OF FILE */
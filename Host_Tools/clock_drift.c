@@ -0,0 +1,317 @@
+/**
+*   \file clock_drift.c
+*   \brief Sample clock estimator and polyphase resampler, see clock_drift.h.
+*/
+
+#include <math.h>
+#include <string.h>
+#include "clock_drift.h"
+
+/**
+*   \brief Kaiser window parameter of the resampling filter.
+*/
+#define DRIFT_KAISER_BETA 8.0
+
+/**
+*   \brief Passband of the resampling filter, fraction of the lower Nyquist.
+*/
+#define DRIFT_PASSBAND 0.9
+
+#define PI 3.14159265358979323846
+
+    /*
+    *   k-th smallest of the values, reordered in place (Wirth's selection).
+    */
+    static double select_kth(double* values, uint32_t count, uint32_t k)
+    {
+        int32_t left = 0;
+        int32_t right = (int32_t)count - 1;
+        int32_t target = (int32_t)k;
+        
+        while (left < right)
+        {
+            double pivot = values[target];
+            int32_t i = left;
+            int32_t j = right;
+            do
+            {
+                while (values[i] < pivot)
+                {
+                    i++;
+                }
+                while (pivot < values[j])
+                {
+                    j--;
+                }
+                if (i <= j)
+                {
+                    double swap = values[i];
+                    values[i] = values[j];
+                    values[j] = swap;
+                    i++;
+                    j--;
+                }
+            } while (i <= j);
+            if (j < target)
+            {
+                left = i;
+            }
+            if (target < i)
+            {
+                right = j;
+            }
+        }
+        return values[target];
+    }
+    
+    /*
+    *   Modified Bessel function of order 0, for the Kaiser window.
+    */
+    static double bessel_i0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 50; k++)
+        {
+            term *= (x/(2.0*k))*(x/(2.0*k));
+            sum += term;
+            if (term < 1e-12*sum)
+            {
+                break;
+            }
+        }
+        return sum;
+    }
+    
+    void drift_init(DriftEstimator* estimator, double nominal_rate_hz)
+    {
+        memset(estimator, 0, sizeof(*estimator));
+        estimator->nominal_period_ns = nominal_rate_hz > 0.0 ? 1e9/nominal_rate_hz : 0.0;
+    }
+    
+    void drift_fit(DriftEstimator* estimator)
+    {
+        uint32_t segments = estimator->segments < DRIFT_SEGMENTS ? estimator->segments : DRIFT_SEGMENTS;
+        uint32_t slopes = 0;
+        double delay = 0.0;
+        
+        if (segments < 2)
+        {
+            return;
+        }
+        
+        // Median of the slopes between the points of the envelope
+        for (uint32_t i = 0; i < segments; i++)
+        {
+            for (uint32_t j = i + 1; j < segments; j++)
+            {
+                double dx = estimator->envelope_x[j] - estimator->envelope_x[i];
+                if (dx != 0.0)
+                {
+                    estimator->scratch[slopes++] = (estimator->envelope_y[j] - estimator->envelope_y[i])/dx;
+                }
+            }
+        }
+        if (slopes == 0)
+        {
+            return;
+        }
+        double period = select_kth(estimator->scratch, slopes, slopes/2);
+        if (!(period > 0.0))
+        {
+            return;
+        }
+        
+        // The segments caught in a stall are above the others, the median leaves them out
+        for (uint32_t s = 0; s < segments; s++)
+        {
+            estimator->scratch[s] = estimator->envelope_y[s] - period*estimator->envelope_x[s];
+            delay += estimator->envelope_delay[s];
+        }
+        
+        estimator->period_ns = period;
+        estimator->offset_ns = select_kth(estimator->scratch, segments, segments/2);
+        estimator->spread_ns = delay/segments;
+        estimator->valid = 1;
+    }
+    
+    void drift_add(DriftEstimator* estimator, uint32_t number, uint64_t arrival_ns)
+    {
+        if (estimator->count == 0)
+        {
+            estimator->origin = number;
+            estimator->origin_ns = arrival_ns;
+        }
+        estimator->count++;
+        
+        // Coordinates from the first sample, exact in doubles for years
+        double x = (double)(uint32_t)(number - estimator->origin);
+        double y = (double)(int64_t)(arrival_ns - estimator->origin_ns);
+        double period = estimator->valid ? estimator->period_ns :
+                        estimator->nominal_period_ns > 0.0 ? estimator->nominal_period_ns :
+                        x > 0.0 ? y/x : 0.0;
+        double residual = y - period*x;
+        
+        // Least delayed sample of the segment, the period only ranks the samples
+        if (estimator->filled == 0 || residual < estimator->lowest)
+        {
+            estimator->lowest = residual;
+            estimator->lowest_x = x;
+            estimator->lowest_y = y;
+        }
+        estimator->residuals += residual;
+        estimator->filled++;
+        if (estimator->filled < DRIFT_SEGMENT_SAMPLES)
+        {
+            return;
+        }
+        
+        uint32_t slot = estimator->segments % DRIFT_SEGMENTS;
+        estimator->envelope_x[slot] = estimator->lowest_x;
+        estimator->envelope_y[slot] = estimator->lowest_y;
+        estimator->envelope_delay[slot] = estimator->residuals/DRIFT_SEGMENT_SAMPLES - estimator->lowest;
+        estimator->segments++;
+        estimator->filled = 0;
+        estimator->residuals = 0.0;
+        if (estimator->segments >= DRIFT_MIN_SEGMENTS)
+        {
+            drift_fit(estimator);
+        }
+    }
+    
+    double drift_rate_hz(const DriftEstimator* estimator)
+    {
+        return estimator->valid ? 1e9/estimator->period_ns : 0.0;
+    }
+    
+    double drift_ppm(const DriftEstimator* estimator)
+    {
+        if (!estimator->valid || estimator->nominal_period_ns == 0.0)
+        {
+            return 0.0;
+        }
+        return (estimator->nominal_period_ns/estimator->period_ns - 1.0)*1e6;
+    }
+    
+    int drift_time(const DriftEstimator* estimator, double number, double* time_ns)
+    {
+        if (!estimator->valid)
+        {
+            return 0;
+        }
+        *time_ns = (double)estimator->origin_ns + estimator->offset_ns +
+                   estimator->period_ns*(number - (double)estimator->origin);
+        return 1;
+    }
+    
+    int drift_position(const DriftEstimator* estimator, uint64_t time_ns, double* number)
+    {
+        if (!estimator->valid)
+        {
+            return 0;
+        }
+        double elapsed = (double)(int64_t)(time_ns - estimator->origin_ns) - estimator->offset_ns;
+        *number = (double)estimator->origin + elapsed/estimator->period_ns;
+        return 1;
+    }
+    
+    void resampler_init(DriftResampler* resampler, double ratio)
+    {
+        double half = DRIFT_TAPS/2;
+        
+        memset(resampler, 0, sizeof(*resampler));
+        resampler->cutoff = DRIFT_PASSBAND*(ratio < 1.0 ? ratio : 1.0);
+        for (int p = 0; p <= DRIFT_PHASES; p++)
+        {
+            double fraction = (double)p/DRIFT_PHASES;
+            double sum = 0.0;
+            double taps[DRIFT_TAPS];
+            for (int k = 0; k < DRIFT_TAPS; k++)
+            {
+                // Distance of the tap from the evaluated position
+                double d = (k - half + 1) - fraction;
+                double x = resampler->cutoff*d;
+                double sinc = (fabs(x) < 1e-12) ? 1.0 : sin(PI*x)/(PI*x);
+                double r = d/half;
+                double window = (fabs(r) < 1.0) ? bessel_i0(DRIFT_KAISER_BETA*sqrt(1.0 - r*r))/bessel_i0(DRIFT_KAISER_BETA) : 0.0;
+                taps[k] = sinc*window;
+                sum += taps[k];
+            }
+            for (int k = 0; k < DRIFT_TAPS; k++)
+            {
+                resampler->table[p][k] = (float)(taps[k]/sum);
+            }
+        }
+    }
+    
+    void resampler_push(DriftResampler* resampler, uint32_t number, const float* sample)
+    {
+        if (!resampler->started)
+        {
+            resampler->next_number = number;
+            resampler->available = 0;
+            resampler->started = 1;
+        }
+        uint32_t gap = number - resampler->next_number;
+        if (gap >= 0x80000000u)
+        {
+            // Older than the last one
+            return;
+        }
+        if (gap > DRIFT_HISTORY)
+        {
+            // Nothing of the history is left around the new sample
+            resampler->next_number = number - DRIFT_HISTORY;
+            resampler->available = 0;
+            gap = DRIFT_HISTORY;
+        }
+        while (gap-- > 0)
+        {
+            const float* previous = resampler->history[(resampler->next_number - 1) & (DRIFT_HISTORY - 1)];
+            memmove(resampler->history[resampler->next_number & (DRIFT_HISTORY - 1)], previous,
+                    sizeof(resampler->history[0]));
+            resampler->next_number++;
+            resampler->available = resampler->available < DRIFT_HISTORY ? resampler->available + 1 : DRIFT_HISTORY;
+        }
+        memcpy(resampler->history[number & (DRIFT_HISTORY - 1)], sample, sizeof(resampler->history[0]));
+        resampler->next_number = number + 1;
+        if (resampler->available < DRIFT_HISTORY)
+        {
+            resampler->available++;
+        }
+    }
+    
+    int resampler_evaluate(const DriftResampler* resampler, double number, float* sample)
+    {
+        double base = floor(number);
+        // Taps from base - DRIFT_TAPS/2 + 1 to base + DRIFT_TAPS/2, relative to the next sample
+        double last = base + DRIFT_TAPS/2 - (double)resampler->next_number;
+        double first = last - (DRIFT_TAPS - 1);
+        
+        if (!resampler->started || last >= 0.0 || first < -(double)resampler->available)
+        {
+            return 0;
+        }
+        
+        double position = (number - base)*DRIFT_PHASES;
+        int phase = (int)position;
+        float t = (float)(position - phase);
+        const float* low = resampler->table[phase];
+        const float* high = resampler->table[phase + 1];
+        uint32_t index = resampler->next_number + (uint32_t)(int32_t)first;
+        float sum[DRIFT_AXES] = { 0.0f };
+        
+        for (int k = 0; k < DRIFT_TAPS; k++, index++)
+        {
+            float coefficient = low[k] + t*(high[k] - low[k]);
+            const float* input = resampler->history[index & (DRIFT_HISTORY - 1)];
+            for (int axis = 0; axis < DRIFT_AXES; axis++)
+            {
+                sum[axis] += coefficient*input[axis];
+            }
+        }
+        memcpy(sample, sum, sizeof(sum));
+        return 1;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,188 @@
+/**
+*   \file clock_drift.h
+*   \brief Sample clock estimation and resampling of the streams of the
+*   PROJ_3 boards on the host.
+*
+*   The output data rate of each board comes from the internal oscillator
+*   of its LIS3DH, so a nominal 100 Hz stream runs a few hundred ppm fast or
+*   slow and several boards recorded together slowly drift apart.
+*
+*   The estimator fits the host arrival time of the samples against their
+*   number (from the sequence numbers of the frames). The transport only
+*   delays the samples, and the serial adapters deliver them in bursts at
+*   their latency timer, so the fit follows the lower envelope of the
+*   arrivals: the least delayed sample of each segment of
+*   DRIFT_SEGMENT_SAMPLES samples is a point of the envelope, and over the
+*   last DRIFT_SEGMENTS points
+*   - slope: median of the slopes between all the pairs of points
+*     (Theil-Sen), insensitive to the stalls of the adapters;
+*   - offset: median of the residuals of the points.
+*   The window is long (164 s at 100 Hz) because the envelope steps by a
+*   fraction of the latency timer as the sample times slide against it;
+*   the drift of the oscillators with the temperature is much slower. The
+*   first fit is made after DRIFT_MIN_SEGMENTS segments, about 10 s.
+*   The slope is the true sample period in host time, its difference from
+*   the nominal period the drift of the board. The estimated times keep the
+*   shortest latency of the transport, the same for similar adapters.
+*
+*   The resampler evaluates a stream at any host time from the estimated
+*   sample times, with a polyphase windowed-sinc filter: DRIFT_TAPS taps,
+*   Kaiser window, DRIFT_PHASES phases with linear interpolation between
+*   them. The cutoff follows the lower of the input and output rates, so
+*   the same code decimates, interpolates or just realigns a stream.
+*
+*   Build with the tools that use it, e.g.
+*       cc -O2 -pthread -o stream_aggregator stream_aggregator.c clock_drift.c -lrt -lm
+*/
+
+#ifndef __CLOCK_DRIFT_H
+    #define __CLOCK_DRIFT_H
+    
+    #include <stdint.h>
+    
+    /**
+    *   \brief Samples of a segment, one point of the lower envelope each.
+    */
+    #ifndef DRIFT_SEGMENT_SAMPLES
+        #define DRIFT_SEGMENT_SAMPLES 256u
+    #endif
+    
+    /**
+    *   \brief Points of the envelope fitted.
+    */
+    #ifndef DRIFT_SEGMENTS
+        #define DRIFT_SEGMENTS 64u
+    #endif
+    
+    /**
+    *   \brief Points of the envelope needed before the first fit.
+    */
+    #ifndef DRIFT_MIN_SEGMENTS
+        #define DRIFT_MIN_SEGMENTS 4u
+    #endif
+    
+    /**
+    *   \brief Taps of the resampling filter, even.
+    */
+    #define DRIFT_TAPS 16
+    
+    /**
+    *   \brief Phases of the resampling filter table.
+    */
+    #define DRIFT_PHASES 256
+    
+    /**
+    *   \brief Samples kept by the resampler, power of 2.
+    */
+    #define DRIFT_HISTORY 1024u
+    
+    /**
+    *   \brief Axes of the samples.
+    */
+    #define DRIFT_AXES 3
+    
+    /**
+    *   \brief Sliding window fit of the arrival times of a stream.
+    */
+    typedef struct {
+        double nominal_period_ns;           ///< 0 if not known
+        uint32_t count;                     ///< Samples added
+        uint32_t origin;                    ///< Number of the first sample, origin of the fit
+        uint64_t origin_ns;                 ///< Arrival of the first sample
+        uint32_t filled;                    ///< Samples of the current segment
+        double lowest;                      ///< Lowest residual of the current segment
+        double lowest_x;
+        double lowest_y;
+        double residuals;                   ///< Sum of the residuals of the current segment
+        uint32_t segments;                  ///< Segments completed, free running
+        double envelope_x[DRIFT_SEGMENTS];  ///< Points of the envelope, from the origin
+        double envelope_y[DRIFT_SEGMENTS];
+        double envelope_delay[DRIFT_SEGMENTS];  ///< Mean delay of each segment above its point
+        double scratch[DRIFT_SEGMENTS*(DRIFT_SEGMENTS - 1)/2];
+        int valid;                          ///< The fit below can be used
+        double period_ns;                   ///< Estimated sample period
+        double offset_ns;                   ///< Time of the origin sample from origin_ns
+        double spread_ns;                   ///< Mean delay above the envelope, a measure of the jitter
+    } DriftEstimator;
+    
+    /**
+    *   \brief Polyphase resampler of a stream.
+    */
+    typedef struct {
+        float table[DRIFT_PHASES + 1][DRIFT_TAPS];  ///< Filter phases, DC gain 1 each
+        double cutoff;                              ///< Cutoff, fraction of the input Nyquist
+        float history[DRIFT_HISTORY][DRIFT_AXES];   ///< Last input samples
+        uint32_t next_number;                       ///< Number of the next input sample
+        uint32_t available;                         ///< Samples of the history received or filled
+        int started;
+    } DriftResampler;
+    
+    /**
+    *   \brief Clear the estimator.
+    *
+    *   \param nominal_rate_hz Nominal rate of the stream, 0 if not known
+    *   (the drift is then not available).
+    */
+    void drift_init(DriftEstimator* estimator, double nominal_rate_hz);
+    
+    /**
+    *   \brief Add the arrival of a sample, the fit is updated at the end of
+    *   every segment.
+    *
+    *   The numbers must grow, a gap is a lost sample.
+    */
+    void drift_add(DriftEstimator* estimator, uint32_t number, uint64_t arrival_ns);
+    
+    /**
+    *   \brief Fit the points of the envelope now.
+    */
+    void drift_fit(DriftEstimator* estimator);
+    
+    /**
+    *   \brief Estimated rate of the stream in Hz, 0 before the first fit.
+    */
+    double drift_rate_hz(const DriftEstimator* estimator);
+    
+    /**
+    *   \brief Drift from the nominal rate in ppm, positive if the stream is fast.
+    */
+    double drift_ppm(const DriftEstimator* estimator);
+    
+    /**
+    *   \brief Estimated host time of a sample, fractional numbers allowed.
+    *
+    *   \retval Returns 0 before the first fit.
+    */
+    int drift_time(const DriftEstimator* estimator, double number, double* time_ns);
+    
+    /**
+    *   \brief Fractional sample number at a host time.
+    *
+    *   \retval Returns 0 before the first fit.
+    */
+    int drift_position(const DriftEstimator* estimator, uint64_t time_ns, double* number);
+    
+    /**
+    *   \brief Build the filter table of a resampler.
+    *
+    *   \param ratio Output rate over input rate, the cutoff is lowered
+    *   below 1 to keep the decimated output free of aliases.
+    */
+    void resampler_init(DriftResampler* resampler, double ratio);
+    
+    /**
+    *   \brief Add an input sample. The numbers must grow; the samples of a
+    *   gap are filled with the last sample before it.
+    */
+    void resampler_push(DriftResampler* resampler, uint32_t number, const float* sample);
+    
+    /**
+    *   \brief Evaluate the stream at a fractional sample number.
+    *
+    *   \retval Returns 0 if the samples around the position are not all
+    *   in the history, i.e. not received yet or too old.
+    */
+    int resampler_evaluate(const DriftResampler* resampler, double number, float* sample);
+
+#endif // __CLOCK_DRIFT_H
+/* [] END OF FILE */
@@ -0,0 +1,375 @@
+/**
+*   \file command_client.c
+*   \brief Host client of the command channel of the PROJ_3 firmware.
+*
+*   Sends the binary commands described in Command.h on the serial port and
+*   waits for their acknowledge, skipping the stream frames in between.
+*
+*   Usage:
+*       command_client [-b baud] <port> <opcode> [argument]
+*       command_client [-b baud] <port> sweep [seconds]
+*       command_client [-b baud] <port> stats
+*
+*   The port is opened at 19200 baud, the rate of UART_Debug in the
+*   TopDesign (FRAME_UART_BAUD in Frame.h); -b sets another rate.
+*
+*   The sweep sets each output data rate in turn, measures the samples
+*   streamed and the bytes received for the given time (default 5 s) and
+*   prints one line per rate, for automated performance measurements.
+*
+*   stats prints the statistics frame and, for each priority class of the
+*   sensor bus (BusTransaction.h), the transactions, the worst latency and
+*   the transactions over the deadline.
+*
+*   Build on Linux or macOS with: cc -O2 -o command_client command_client.c serial_frame.c
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "serial_frame.h"
+
+/**
+*   \brief Values shared with the firmware (Command.h, Frame.h).
+*/
+#define COMMAND_SYNC 0xB0
+#define COMMAND_SET_ODR 0x01
+#define COMMAND_SET_STREAM 0x04
+#define COMMAND_GET_STATS 0x07
+#define FRAME_HEADER_COMMAND_ACK 0xAC
+#define FRAME_HEADER_STREAM_STATS 0xAD
+#define FRAME_HEADER_BUS_CLASSES 0xB7
+#define FRAME_FOOTER 0xC0
+#define ACK_PAYLOAD 3
+#define STATS_PAYLOAD 18
+#define BUS_CLASSES 3
+#define CLASSES_PAYLOAD (BUS_CLASSES*8)
+
+/**
+*   \brief Timeout of the acknowledge in ms.
+*/
+#define ACK_TIMEOUT_MS 2000
+
+/**
+*   \brief Statistics frame of the firmware.
+*/
+typedef struct {
+    uint32_t uptime_ms;
+    uint8_t stream_mode;
+    uint8_t streaming;
+    uint16_t odr_hz;
+    uint8_t full_scale;
+    uint8_t resolution;
+    uint32_t samples;
+    uint16_t bus_errors;
+    uint16_t command_errors;
+    uint8_t classes_valid;
+    uint32_t class_transactions[BUS_CLASSES];
+    uint16_t class_worst_ms[BUS_CLASSES];
+    uint16_t class_missed[BUS_CLASSES];
+} Stats;
+
+/**
+*   \brief Names of the priority classes of the sensor bus.
+*/
+static const char* class_names[BUS_CLASSES] = { "sample", "config", "diagnostic" };
+
+// Rate of the serial port, the firmware runs UART_Debug at 19200 baud (FRAME_UART_BAUD)
+static speed_t baud = SERIAL_DEFAULT_BAUD;
+
+// Sliding window used to find the frames in the received bytes
+static uint8_t window[2 + CLASSES_PAYLOAD + 3];
+static size_t window_count;
+static uint64_t bytes_received;
+
+    static uint64_t now_ms(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec*1000u + (uint64_t)ts.tv_nsec/1000000u;
+    }
+    
+    /*
+    *   Check if the window ends with a valid frame of the given header and payload length.
+    */
+    static const uint8_t* match_frame(uint8_t header, size_t payload)
+    {
+        size_t length = 1 + payload + 3;
+        if (window_count < length)
+        {
+            return NULL;
+        }
+        const uint8_t* frame = window + window_count - length;
+        if (frame[0] != header || frame[length - 1] != FRAME_FOOTER)
+        {
+            return NULL;
+        }
+        uint16_t crc = serial_crc16(frame, 1 + payload);
+        if (frame[1 + payload] != (crc & 0xFF) || frame[2 + payload] != (crc >> 8))
+        {
+            return NULL;
+        }
+        return frame + 1;
+    }
+    
+    /*
+    *   Decode the payload of a statistics frame.
+    */
+    static void parse_stats(const uint8_t* p, Stats* stats)
+    {
+        stats->uptime_ms = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+        stats->stream_mode = p[4];
+        stats->streaming = p[5];
+        stats->odr_hz = (uint16_t)(p[6] | p[7] << 8);
+        stats->full_scale = p[8];
+        stats->resolution = p[9];
+        stats->samples = (uint32_t)p[10] | (uint32_t)p[11] << 8 | (uint32_t)p[12] << 16 | (uint32_t)p[13] << 24;
+        stats->bus_errors = (uint16_t)(p[14] | p[15] << 8);
+        stats->command_errors = (uint16_t)(p[16] | p[17] << 8);
+    }
+    
+    /*
+    *   Decode the payload of the bus classes frame.
+    */
+    static void parse_classes(const uint8_t* p, Stats* stats)
+    {
+        for (int i = 0; i < BUS_CLASSES; i++, p += 8)
+        {
+            stats->class_transactions[i] = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+            stats->class_worst_ms[i] = (uint16_t)(p[4] | p[5] << 8);
+            stats->class_missed[i] = (uint16_t)(p[6] | p[7] << 8);
+        }
+        stats->classes_valid = 1;
+    }
+    
+    /*
+    *   Send a command and wait for its acknowledge, skipping the stream frames.
+    *   A statistics or bus classes frame received meanwhile is stored in
+    *   stats, if not NULL.
+    *   Returns the status of the command, or -1 on timeout.
+    */
+    static int send_command(int fd, uint8_t opcode, uint8_t argument, Stats* stats)
+    {
+        uint8_t command[4] = { COMMAND_SYNC, opcode, argument, 0 };
+        command[3] = (uint8_t)(command[0] ^ command[1] ^ command[2]);
+        if (write(fd, command, sizeof(command)) != (ssize_t)sizeof(command))
+        {
+            perror("write");
+            return -1;
+        }
+        
+        uint64_t deadline = now_ms() + ACK_TIMEOUT_MS;
+        uint8_t byte;
+        window_count = 0;
+        while (now_ms() < deadline)
+        {
+            fd_set set;
+            struct timeval tv = { 0, 10000 };
+            FD_ZERO(&set);
+            FD_SET(fd, &set);
+            if (select(fd + 1, &set, NULL, NULL, &tv) <= 0 || read(fd, &byte, 1) != 1)
+            {
+                continue;
+            }
+            bytes_received++;
+            if (window_count == sizeof(window))
+            {
+                memmove(window, window + 1, sizeof(window) - 1);
+                window_count--;
+            }
+            window[window_count++] = byte;
+        
+            const uint8_t* found = match_frame(FRAME_HEADER_STREAM_STATS, STATS_PAYLOAD);
+            if (found && stats)
+            {
+                parse_stats(found, stats);
+            }
+            found = match_frame(FRAME_HEADER_BUS_CLASSES, CLASSES_PAYLOAD);
+            if (found && stats)
+            {
+                parse_classes(found, stats);
+            }
+            found = match_frame(FRAME_HEADER_COMMAND_ACK, ACK_PAYLOAD);
+            if (found && found[0] == opcode)
+            {
+                return found[1];
+            }
+        }
+        return -1;
+    }
+    
+    /*
+    *   The statistics and bus classes frames are sent just before the
+    *   acknowledge.
+    */
+    static int get_stats(int fd, Stats* stats)
+    {
+        stats->uptime_ms = 0;
+        stats->odr_hz = 0;
+        stats->classes_valid = 0;
+        if (send_command(fd, COMMAND_GET_STATS, 0, stats) != 0 || stats->odr_hz == 0)
+        {
+            return -1;
+        }
+        return 0;
+    }
+    
+    /*
+    *   Count the bytes received for the given time.
+    */
+    static void drain(int fd, int seconds)
+    {
+        uint8_t buffer[256];
+        uint64_t deadline = now_ms() + (uint64_t)seconds*1000u;
+        while (now_ms() < deadline)
+        {
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            if (n > 0)
+            {
+                bytes_received += (uint64_t)n;
+            }
+            else
+            {
+                usleep(1000);
+            }
+        }
+    }
+    
+    static int sweep(int fd, int seconds)
+    {
+        // LIS3DH_ODR_1HZ ... LIS3DH_ODR_400HZ, LIS3DH_ODR_1344HZ
+        static const uint8_t odrs[] = { 1, 2, 3, 4, 5, 6, 7, 9 };
+        Stats before, after;
+        
+        printf("odr_hz,samples_per_s,bytes_per_s,bus_errors,command_errors\n");
+        for (size_t i = 0; i < sizeof(odrs); i++)
+        {
+            if (send_command(fd, COMMAND_SET_ODR, odrs[i], NULL) != 0 || get_stats(fd, &before) != 0)
+            {
+                fprintf(stderr, "no answer at rate index %u\n", odrs[i]);
+                return 1;
+            }
+            uint64_t bytes_start = bytes_received;
+            drain(fd, seconds);
+            uint64_t bytes = bytes_received - bytes_start;
+            if (get_stats(fd, &after) != 0)
+            {
+                fprintf(stderr, "no statistics at rate index %u\n", odrs[i]);
+                return 1;
+            }
+            double elapsed = (after.uptime_ms - before.uptime_ms)/1000.0;
+            printf("%u,%.1f,%.0f,%u,%u\n", after.odr_hz,
+                   (after.samples - before.samples)/elapsed, bytes/(double)seconds,
+                   (unsigned)(uint16_t)(after.bus_errors - before.bus_errors),
+                   (unsigned)(uint16_t)(after.command_errors - before.command_errors));
+            fflush(stdout);
+        }
+        return 0;
+    }
+    
+    static int print_stats(int fd)
+    {
+        Stats stats;
+        
+        if (get_stats(fd, &stats) != 0)
+        {
+            fprintf(stderr, "no statistics\n");
+            return 1;
+        }
+        printf("uptime %.1f s, stream mode %u%s, %u Hz, full-scale %u, resolution %u\n",
+               stats.uptime_ms/1000.0, stats.stream_mode, stats.streaming ? "" : " (stopped)",
+               stats.odr_hz, stats.full_scale, stats.resolution);
+        printf("samples %u, bus errors %u, command errors %u\n",
+               stats.samples, stats.bus_errors, stats.command_errors);
+        if (!stats.classes_valid)
+        {
+            fprintf(stderr, "no bus classes frame\n");
+            return 1;
+        }
+        printf("%-10s %12s %8s %8s\n", "class", "transactions", "worst ms", "missed");
+        for (int i = 0; i < BUS_CLASSES; i++)
+        {
+            printf("%-10s %12u %8u %8u\n", class_names[i], stats.class_transactions[i],
+                   stats.class_worst_ms[i], stats.class_missed[i]);
+        }
+        return 0;
+    }
+    
+    static int usage(const char* name)
+    {
+        fprintf(stderr, "usage: %s [-b baud] <port> <opcode> [argument]\n"
+                        "       %s [-b baud] <port> sweep [seconds]\n"
+                        "       %s [-b baud] <port> stats\n", name, name, name);
+        return 2;
+    }
+
+int main(int argc, char** argv)
+{
+    int option;
+    while ((option = getopt(argc, argv, "b:")) != -1)
+    {
+        if (option != 'b' || (baud = serial_baud(atol(optarg))) == 0)
+        {
+            return usage(argv[0]);
+        }
+    }
+    // Positional arguments from argv[1] on
+    argv[optind - 1] = argv[0];
+    argc -= optind - 1;
+    argv += optind - 1;
+    
+    if (argc < 3)
+    {
+        return usage(argv[0]);
+    }
+    int fd = serial_open(argv[1], O_RDWR, baud, 0);
+    if (fd < 0)
+    {
+        return 1;
+    }
+    tcflush(fd, TCIOFLUSH);
+    
+    int result;
+    if (strcmp(argv[2], "sweep") == 0)
+    {
+        int seconds = (argc > 3) ? atoi(argv[3]) : 5;
+        // Raw stream, so that the samples follow the output data rate
+        if (send_command(fd, COMMAND_SET_STREAM, 0, NULL) != 0)
+        {
+            fprintf(stderr, "no answer from the firmware\n");
+            return 1;
+        }
+        result = sweep(fd, seconds > 0 ? seconds : 5);
+    }
+    else if (strcmp(argv[2], "stats") == 0)
+    {
+        result = print_stats(fd);
+    }
+    else
+    {
+        uint8_t opcode = (uint8_t)strtoul(argv[2], NULL, 0);
+        uint8_t argument = (argc > 3) ? (uint8_t)strtoul(argv[3], NULL, 0) : 0;
+        int status = send_command(fd, opcode, argument, NULL);
+        if (status < 0)
+        {
+            fprintf(stderr, "no acknowledge\n");
+            result = 1;
+        }
+        else
+        {
+            printf("status %d\n", status);
+            result = (status == 0) ? 0 : 1;
+        }
+    }
+    close(fd);
+    return result;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,271 @@
+/**
+*   \file cordic_bench.c
+*   \brief Accuracy and cost of the CORDIC kernel of the PROJ_3 firmware.
+*
+*   Builds the firmware Cordic.c unchanged and compares it with atan2()
+*   and sqrt() of libm:
+*   - angle error of Cordic_Vector() over the full circle, at several
+*     magnitudes of the input;
+*   - pitch, roll and magnitude errors of the tilt computation of Tilt.c,
+*     over gravity vectors covering the sphere from 250 mg to 16 g;
+*   - time and cycles per evaluation of Cordic_Vector() and of the libm
+*     pair, on this host. Cycles are read with the time stamp counter on
+*     x86, elsewhere only the time is shown.
+*
+*   Usage:
+*       cordic_bench [evaluations]
+*
+*   Build on Linux or macOS with:
+*       cc -O2 -I../AY1920_II_HW_05_PROJ_3.cydsn -o cordic_bench cordic_bench.c ../AY1920_II_HW_05_PROJ_3.cydsn/Cordic.c -lm
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Cordic.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define HAVE_TSC 1
+#else
+    #define HAVE_TSC 0
+#endif
+
+/**
+*   \brief Scaling of Tilt.c: fractional bits of the filter and shift into
+*   the CORDIC coordinates.
+*/
+#define TILT_FRACTION_BITS 8
+#define TILT_CORDIC_SHIFT 5
+
+#define PI 3.14159265358979323846
+
+/**
+*   \brief Worst and RMS error of a quantity.
+*/
+typedef struct {
+    double worst;
+    double squares;
+    unsigned long count;
+} Error;
+
+// Keeps the compiler from dropping the timed evaluations
+static volatile int64_t sink;
+
+    static void error_add(Error* error, double value)
+    {
+        if (fabs(value) > error->worst)
+        {
+            error->worst = fabs(value);
+        }
+        error->squares += value*value;
+        error->count++;
+    }
+    
+    static double error_rms(const Error* error)
+    {
+        return error->count ? sqrt(error->squares/error->count) : 0.0;
+    }
+    
+    /*
+    *   Difference of two angles in degrees, wrapped to [-180; 180).
+    */
+    static double angle_difference(double a, double b)
+    {
+        double d = fmod(a - b + 540.0, 360.0) - 180.0;
+        return d;
+    }
+    
+    static double binary_to_degrees(int32_t angle)
+    {
+        return angle*(360.0/4294967296.0);
+    }
+    
+    static double now_ns(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec*1e9 + ts.tv_nsec;
+    }
+    
+    static uint64_t cycles(void)
+    {
+        #if HAVE_TSC
+        return __rdtsc();
+        #else
+        return 0;
+        #endif
+    }
+    
+    /*
+    *   Angle error of a single evaluation over the full circle.
+    */
+    static void check_vector(void)
+    {
+        static const double magnitudes[] = { 1 << 10, 1 << 16, 1 << 22, (1 << 29) - 1 };
+        unsigned m;
+        int step;
+        
+        printf("Cordic_Vector(), %d iterations, angle error against atan2():\n", CORDIC_ITERATIONS);
+        for (m = 0; m < sizeof(magnitudes)/sizeof(magnitudes[0]); m++)
+        {
+            Error angle = { 0 };
+            Error length = { 0 };
+            for (step = 0; step < 36000; step++)
+            {
+                double a = (step - 18000)*(PI/18000.0);
+                int32_t x = (int32_t)lrint(magnitudes[m]*cos(a));
+                int32_t y = (int32_t)lrint(magnitudes[m]*sin(a));
+                uint32_t magnitude;
+                int32_t result = Cordic_Vector(x, y, &magnitude);
+                error_add(&angle, angle_difference(binary_to_degrees(result), atan2(y, x)*180.0/PI));
+                error_add(&length, (magnitude - sqrt((double)x*x + (double)y*y))/magnitudes[m]);
+            }
+            printf("    |v| = 2^%-4.0f worst %.5f deg, rms %.5f deg, magnitude worst %.2e relative\n",
+                   log2(magnitudes[m] + 1), angle.worst, error_rms(&angle), length.worst);
+        }
+    }
+    
+    /*
+    *   Pitch, roll and magnitude as computed by Tilt_SendFrame().
+    */
+    static void tilt(double gx, double gy, double gz, double* pitch, double* roll, double* magnitude)
+    {
+        int32_t x = (int32_t)lrint(gx*(1 << TILT_FRACTION_BITS));
+        int32_t y = (int32_t)lrint(gy*(1 << TILT_FRACTION_BITS));
+        int32_t z = (int32_t)lrint(gz*(1 << TILT_FRACTION_BITS));
+        uint32_t yz_magnitude;
+        uint32_t total;
+        
+        *roll = Cordic_ToCentidegrees(Cordic_Vector(z*(1 << TILT_CORDIC_SHIFT),
+                                                    y*(1 << TILT_CORDIC_SHIFT),
+                                                    &yz_magnitude))/100.0;
+        *pitch = Cordic_ToCentidegrees(Cordic_Vector((int32_t)yz_magnitude,
+                                                     -x*(1 << TILT_CORDIC_SHIFT),
+                                                     &total))/100.0;
+        *magnitude = (total + (1UL << (TILT_FRACTION_BITS + TILT_CORDIC_SHIFT - 1))) >>
+                     (TILT_FRACTION_BITS + TILT_CORDIC_SHIFT);
+    }
+    
+    /*
+    *   Tilt errors against libm over the sphere, roll skipped near the
+    *   vertical where it is not defined. The steps are not multiples of
+    *   the frame resolution, so the errors include the rounding.
+    */
+    static void check_tilt(void)
+    {
+        static const double magnitudes[] = { 251.7, 1003.3, 4011.9, 15987.5 };
+        unsigned m;
+        int i;
+        int j;
+        
+        printf("Tilt, frame resolution 0.01 deg and 1 mg, error against atan2() and sqrt():\n");
+        for (m = 0; m < sizeof(magnitudes)/sizeof(magnitudes[0]); m++)
+        {
+            Error pitch_error = { 0 };
+            Error roll_error = { 0 };
+            Error magnitude_error = { 0 };
+            for (i = -240; i <= 240; i++)
+            {
+                for (j = -480; j < 480; j += 3)
+                {
+                    double p = i*0.3713*PI/180.0;
+                    double r = j*0.3713*PI/180.0 + 0.001;
+                    double gx = -magnitudes[m]*sin(p);
+                    double gy = magnitudes[m]*cos(p)*sin(r);
+                    double gz = magnitudes[m]*cos(p)*cos(r);
+                    double pitch, roll, magnitude;
+                    tilt(gx, gy, gz, &pitch, &roll, &magnitude);
+                    error_add(&pitch_error, pitch - atan2(-gx, sqrt(gy*gy + gz*gz))*180.0/PI);
+                    if (abs(i) < 230)
+                    {
+                        error_add(&roll_error, angle_difference(roll, atan2(gy, gz)*180.0/PI));
+                    }
+                    error_add(&magnitude_error, magnitude - sqrt(gx*gx + gy*gy + gz*gz));
+                }
+            }
+            printf("    %5.0f mg: pitch worst %.4f rms %.4f deg, roll worst %.4f rms %.4f deg, magnitude worst %.2f mg\n",
+                   magnitudes[m], pitch_error.worst, error_rms(&pitch_error),
+                   roll_error.worst, error_rms(&roll_error), magnitude_error.worst);
+        }
+    }
+    
+    /*
+    *   Time and cycles per evaluation of the kernel and of libm.
+    */
+    static void measure(long evaluations)
+    {
+        int32_t* xs = malloc(sizeof(int32_t)*1024);
+        int32_t* ys = malloc(sizeof(int32_t)*1024);
+        double start;
+        double elapsed;
+        uint64_t start_cycles;
+        uint64_t elapsed_cycles;
+        int64_t sum = 0;
+        double float_sum = 0.0;
+        long n;
+        int i;
+        
+        srand(1);
+        for (i = 0; i < 1024; i++)
+        {
+            xs[i] = (rand() % (1 << 24)) - (1 << 23);
+            ys[i] = (rand() % (1 << 24)) - (1 << 23);
+        }
+        
+        start = now_ns();
+        start_cycles = cycles();
+        for (n = 0; n < evaluations; n++)
+        {
+            uint32_t magnitude;
+            sum += Cordic_Vector(xs[n & 1023], ys[n & 1023], &magnitude);
+            sum += magnitude;
+        }
+        elapsed_cycles = cycles() - start_cycles;
+        elapsed = now_ns() - start;
+        sink = sum;
+        printf("Cordic_Vector():    %7.1f ns", elapsed/evaluations);
+        if (HAVE_TSC)
+        {
+            printf(", %6.1f TSC cycles", (double)elapsed_cycles/evaluations);
+        }
+        printf(" per evaluation\n");
+        
+        start = now_ns();
+        start_cycles = cycles();
+        for (n = 0; n < evaluations; n++)
+        {
+            double x = xs[n & 1023];
+            double y = ys[n & 1023];
+            float_sum += atan2(y, x) + sqrt(x*x + y*y);
+        }
+        elapsed_cycles = cycles() - start_cycles;
+        elapsed = now_ns() - start;
+        sink = (int64_t)float_sum;
+        printf("atan2() and sqrt(): %7.1f ns", elapsed/evaluations);
+        if (HAVE_TSC)
+        {
+            printf(", %6.1f TSC cycles", (double)elapsed_cycles/evaluations);
+        }
+        printf(" per evaluation (double, hardware FPU)\n");
+        
+        free(xs);
+        free(ys);
+    }
+
+int main(int argc, char** argv)
+{
+    long evaluations = argc > 1 ? atol(argv[1]) : 10000000L;
+    if (evaluations <= 0)
+    {
+        fprintf(stderr, "usage: %s [evaluations]\n", argv[0]);
+        return 1;
+    }
+    
+    check_vector();
+    check_tilt();
+    measure(evaluations);
+    return 0;
+}
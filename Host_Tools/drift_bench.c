@@ -0,0 +1,419 @@
+/**
+*   \file drift_bench.c
+*   \brief Accuracy and cost of the clock estimation and resampling of
+*   clock_drift.c over long recordings.
+*
+*   Simulates boards streaming at a nominal 100 Hz with sample clocks off by
+*   up to +-300 ppm, wandering by a few ppm with the temperature, behind
+*   USB serial adapters that deliver the bytes in bursts at their latency
+*   timer, with a random extra latency, occasional stalls and lost frames.
+*   Every board samples the same signal, a sum of sines. For each board:
+*   - drift: error of the estimated drift against the true one;
+*   - time: error of the estimated time of the samples against the true
+*     one; its mean is the transport latency the fit cannot see, the same
+*     for boards behind the same kind of adapter, its spread is what is
+*     left between two boards;
+*   - resampling: error of the values interpolated at the record times,
+*     against the signal at the true time of the interpolated position, as
+*     SNR and worst error;
+*   - uncorrected: time error at the end of the recording of the samples
+*     timed with the nominal rate from the first one, as the sequence
+*     alignment of stream_aggregator.c does.
+*   Then the time per sample of the estimator and of the resampler on this
+*   host, and how many times faster than real time the streams of the
+*   boards are processed.
+*
+*   Usage:
+*       drift_bench [hours] [boards]
+*
+*   Build on Linux or macOS with:
+*       cc -O2 -o drift_bench drift_bench.c clock_drift.c -lm
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "clock_drift.h"
+
+#define NOMINAL_HZ 100.0
+
+/**
+*   \brief Records of the common timebase, and their lag from the arrivals.
+*/
+#define RECORD_PERIOD_NS 10000000u
+#define RECORD_DELAY_NS 200000000u
+
+/**
+*   \brief Transport of the serial adapters: latency timer, extra latency
+*   (exponential), stalls and lost frames.
+*/
+#define FLUSH_PERIOD_NS 16000000u
+#define MIN_LATENCY_NS 300000.0
+#define MEAN_EXTRA_LATENCY_NS 1000000.0
+#define MEAN_STALL_INTERVAL_S 1200.0
+#define MAX_STALL_NS 800000000.0
+#define LOSS_PROBABILITY 1e-4
+
+/**
+*   \brief Samples before the errors are counted, for the first fits.
+*/
+#define WARMUP_SAMPLES (DRIFT_SEGMENT_SAMPLES*DRIFT_SEGMENTS)
+
+/**
+*   \brief Samples of the history of true times, power of 2.
+*/
+#define TRUE_HISTORY 4096u
+
+#define PI 3.14159265358979323846
+
+/**
+*   \brief Worst and RMS error of a quantity, and its mean.
+*/
+typedef struct {
+    double worst;
+    double sum;
+    double squares;
+    unsigned long count;
+} Error;
+
+/**
+*   \brief Simulated board and its adapter.
+*/
+typedef struct {
+    double base_ppm;
+    double wander_ppm;
+    double wander_phase;
+    double time_ns;                 ///< True time of the next sample
+    uint64_t flush_phase_ns;
+    uint64_t flush_ns;              ///< Flush of the previous sample
+    uint64_t flush_arrival_ns;      ///< Arrival of the bytes of that flush
+    uint64_t stall_start_ns;
+    uint64_t stall_end_ns;
+    uint64_t last_arrival_ns;
+    uint32_t number;
+    uint64_t random;
+} Board;
+
+/**
+*   \brief Sample of a board as seen by the host.
+*/
+typedef struct {
+    uint32_t number;
+    double time_ns;                 ///< True time
+    uint64_t arrival_ns;
+    int lost;
+    float xyz[DRIFT_AXES];
+} Arrival;
+
+// Keeps the compiler from dropping the timed evaluations
+static volatile float sink;
+
+    static void error_add(Error* error, double value)
+    {
+        if (fabs(value) > error->worst)
+        {
+            error->worst = fabs(value);
+        }
+        error->sum += value;
+        error->squares += value*value;
+        error->count++;
+    }
+    
+    static double error_mean(const Error* error)
+    {
+        return error->count ? error->sum/error->count : 0.0;
+    }
+    
+    static double error_rms(const Error* error)
+    {
+        return error->count ? sqrt(error->squares/error->count) : 0.0;
+    }
+    
+    static double error_deviation(const Error* error)
+    {
+        double mean = error_mean(error);
+        double variance = error->count ? error->squares/error->count - mean*mean : 0.0;
+        return variance > 0.0 ? sqrt(variance) : 0.0;
+    }
+    
+    static double seconds_now(void)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return now.tv_sec + now.tv_nsec*1e-9;
+    }
+    
+    /*
+    *   Uniform in [0; 1), xorshift64*.
+    */
+    static double uniform(uint64_t* state)
+    {
+        *state ^= *state >> 12;
+        *state ^= *state << 25;
+        *state ^= *state >> 27;
+        return (double)((*state*0x2545F4914F6CDD1DULL) >> 11)*(1.0/9007199254740992.0);
+    }
+    
+    static double exponential(uint64_t* state, double mean)
+    {
+        return -mean*log(1.0 - uniform(state));
+    }
+    
+    /*
+    *   Signal sampled by all the boards, in mg, at a host time.
+    */
+    static void signal_at(double time_ns, float* xyz)
+    {
+        double t = time_ns*1e-9;
+        for (int axis = 0; axis < DRIFT_AXES; axis++)
+        {
+            double phase = axis*2.1;
+            xyz[axis] = (float)(500.0*sin(2.0*PI*1.3*t + phase) + 200.0*sin(2.0*PI*7.0*t + 2.0*phase) +
+                                50.0*sin(2.0*PI*23.0*t + 3.0*phase));
+        }
+    }
+    
+    /*
+    *   True drift of a board at a host time, in ppm.
+    */
+    static double board_ppm(const Board* board, double time_ns)
+    {
+        // Wander of the oscillator with the temperature, a 3 hour cycle
+        return board->base_ppm + board->wander_ppm*sin(2.0*PI*time_ns*1e-9/10800.0 + board->wander_phase);
+    }
+    
+    static void board_init(Board* board, int index, int boards)
+    {
+        memset(board, 0, sizeof(*board));
+        board->random = 0x9E3779B97F4A7C15ULL*(uint64_t)(index + 1);
+        board->base_ppm = boards > 1 ? -300.0 + 600.0*index/(boards - 1) : 250.0;
+        board->wander_ppm = 5.0 + 10.0*uniform(&board->random);
+        board->wander_phase = 2.0*PI*uniform(&board->random);
+        // Boards started within a second of each other
+        board->time_ns = 1e9*(1.0 + uniform(&board->random));
+        board->flush_phase_ns = (uint64_t)(FLUSH_PERIOD_NS*uniform(&board->random));
+        board->stall_start_ns = (uint64_t)(1e9*exponential(&board->random, MEAN_STALL_INTERVAL_S));
+        board->stall_end_ns = board->stall_start_ns + (uint64_t)(MAX_STALL_NS*uniform(&board->random));
+    }
+    
+    /*
+    *   Next sample of a board and its arrival at the host.
+    */
+    static void board_next(Board* board, Arrival* arrival)
+    {
+        double time_ns = board->time_ns;
+        
+        arrival->number = board->number++;
+        arrival->time_ns = time_ns;
+        signal_at(time_ns, arrival->xyz);
+        board->time_ns += 1e9/(NOMINAL_HZ*(1.0 + board_ppm(board, time_ns)*1e-6));
+        
+        // The adapter sends its buffer at its latency timer
+        uint64_t ready_ns = (uint64_t)time_ns;
+        uint64_t flush_ns = ((ready_ns - board->flush_phase_ns)/FLUSH_PERIOD_NS + 1)*FLUSH_PERIOD_NS +
+                            board->flush_phase_ns;
+        if (flush_ns != board->flush_ns)
+        {
+            board->flush_ns = flush_ns;
+            board->flush_arrival_ns = flush_ns + (uint64_t)(MIN_LATENCY_NS +
+                                      exponential(&board->random, MEAN_EXTRA_LATENCY_NS));
+        }
+        uint64_t arrival_ns = board->flush_arrival_ns;
+        if (ready_ns >= board->stall_start_ns)
+        {
+            if (ready_ns < board->stall_end_ns)
+            {
+                arrival_ns = board->stall_end_ns;
+            }
+            else
+            {
+                board->stall_start_ns = board->stall_end_ns +
+                                        (uint64_t)(1e9*exponential(&board->random, MEAN_STALL_INTERVAL_S));
+                board->stall_end_ns = board->stall_start_ns + (uint64_t)(MAX_STALL_NS*uniform(&board->random));
+            }
+        }
+        if (arrival_ns < board->last_arrival_ns)
+        {
+            arrival_ns = board->last_arrival_ns;
+        }
+        board->last_arrival_ns = arrival_ns;
+        arrival->arrival_ns = arrival_ns;
+        arrival->lost = uniform(&board->random) < LOSS_PROBABILITY;
+    }
+    
+    /*
+    *   Run a board through the estimator and the resampler as the
+    *   aggregator does, with records every RECORD_PERIOD_NS.
+    */
+    static void check_board(int index, int boards, double hours, DriftEstimator* estimator,
+                            DriftResampler* resampler)
+    {
+        static double true_ns[TRUE_HISTORY];
+        Board board;
+        Arrival arrival;
+        Error ppm_error = { 0 };
+        Error time_error = { 0 };
+        Error value_error = { 0 };
+        double signal_power = 0.0;
+        uint64_t record_ns = 0;
+        double first_ns = 0.0;
+        uint64_t samples = (uint64_t)(hours*3600.0*NOMINAL_HZ);
+        
+        board_init(&board, index, boards);
+        drift_init(estimator, NOMINAL_HZ);
+        resampler_init(resampler, 1e9/RECORD_PERIOD_NS/NOMINAL_HZ);
+        
+        for (uint64_t k = 0; k < samples; k++)
+        {
+            board_next(&board, &arrival);
+            true_ns[arrival.number & (TRUE_HISTORY - 1)] = arrival.time_ns;
+            if (k == 0)
+            {
+                first_ns = arrival.time_ns;
+                record_ns = ((uint64_t)arrival.time_ns/RECORD_PERIOD_NS + 1)*RECORD_PERIOD_NS;
+            }
+            if (!arrival.lost)
+            {
+                drift_add(estimator, arrival.number, arrival.arrival_ns);
+            }
+            // All the samples, to measure the interpolation alone
+            resampler_push(resampler, arrival.number, arrival.xyz);
+        
+            if (k < WARMUP_SAMPLES || !estimator->valid)
+            {
+                continue;
+            }
+            if (k % 64 == 0)
+            {
+                error_add(&ppm_error, drift_ppm(estimator) - board_ppm(&board, arrival.time_ns));
+            }
+            double estimated_ns;
+            drift_time(estimator, arrival.number, &estimated_ns);
+            error_add(&time_error, estimated_ns - arrival.time_ns);
+        
+            // Records the aggregator would emit by now
+            while (record_ns + RECORD_DELAY_NS <= arrival.arrival_ns)
+            {
+                double number;
+                float xyz[DRIFT_AXES];
+                float expected[DRIFT_AXES];
+                if (drift_position(estimator, record_ns, &number) &&
+                    resampler_evaluate(resampler, number, xyz))
+                {
+                    // The signal where the board sampled that position
+                    uint32_t n = (uint32_t)floor(number);
+                    double fraction = number - floor(number);
+                    double at_ns = true_ns[n & (TRUE_HISTORY - 1)] +
+                                   fraction*(true_ns[(n + 1) & (TRUE_HISTORY - 1)] - true_ns[n & (TRUE_HISTORY - 1)]);
+                    signal_at(at_ns, expected);
+                    for (int axis = 0; axis < DRIFT_AXES; axis++)
+                    {
+                        error_add(&value_error, xyz[axis] - expected[axis]);
+                        signal_power += (double)expected[axis]*expected[axis];
+                    }
+                }
+                record_ns += RECORD_PERIOD_NS;
+            }
+        }
+        
+        double nominal_ns = first_ns + 1e9*(samples - 1)/NOMINAL_HZ;
+        printf("board %d: %+7.1f ppm, drift error rms %.3f worst %.3f ppm, "
+               "time error mean %.3f sd %.3f worst %.3f ms\n",
+               index, board.base_ppm, error_rms(&ppm_error), ppm_error.worst,
+               error_mean(&time_error)/1e6, error_deviation(&time_error)/1e6, time_error.worst/1e6);
+        printf("         resampled %lu values, SNR %.1f dB, worst error %.3f mg; uncorrected time error %.1f s\n",
+               value_error.count, value_error.squares > 0.0 ? 10.0*log10(signal_power/value_error.squares) : 0.0,
+               value_error.worst, (nominal_ns - arrival.time_ns)/1e9);
+    }
+    
+    /*
+    *   Time per sample of the estimator and of the resampler, on an hour of
+    *   one board generated beforehand.
+    */
+    static void measure(int boards, double hours, DriftEstimator* estimator, DriftResampler* resampler)
+    {
+        uint32_t count = (uint32_t)(3600.0*NOMINAL_HZ);
+        Arrival* arrivals = malloc(count*sizeof(Arrival));
+        double* positions = malloc(count*sizeof(double));
+        Board board;
+        
+        if (arrivals == NULL || positions == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        board_init(&board, 0, 1);
+        for (uint32_t k = 0; k < count; k++)
+        {
+            board_next(&board, &arrivals[k]);
+        }
+        
+        drift_init(estimator, NOMINAL_HZ);
+        double start = seconds_now();
+        for (uint32_t k = 0; k < count; k++)
+        {
+            drift_add(estimator, arrivals[k].number, arrivals[k].arrival_ns);
+        }
+        double estimator_s = seconds_now() - start;
+        
+        // One record per sample, half a filter behind the newest sample
+        for (uint32_t k = 0; k < count; k++)
+        {
+            positions[k] = k - DRIFT_TAPS + 0.37;
+        }
+        resampler_init(resampler, 1.0);
+        start = seconds_now();
+        for (uint32_t k = 0; k < count; k++)
+        {
+            float xyz[DRIFT_AXES];
+            resampler_push(resampler, arrivals[k].number, arrivals[k].xyz);
+            if (resampler_evaluate(resampler, positions[k], xyz))
+            {
+                sink += xyz[0];
+            }
+        }
+        double resampler_s = seconds_now() - start;
+        
+        double per_sample_ns = 1e9*(estimator_s + resampler_s)/count;
+        printf("estimator %.1f ns/sample, resampler %.1f ns/sample (push and one evaluation of 3 axes)\n",
+               1e9*estimator_s/count, 1e9*resampler_s/count);
+        printf("%d boards at %.0f Hz: %.0f times real time, %.1f s for %.0f hours\n",
+               boards, NOMINAL_HZ, 1e9/(per_sample_ns*NOMINAL_HZ*boards),
+               per_sample_ns*1e-9*NOMINAL_HZ*boards*hours*3600.0, hours);
+        free(arrivals);
+        free(positions);
+    }
+
+int main(int argc, char** argv)
+{
+    double hours = argc > 1 ? atof(argv[1]) : 24.0;
+    int boards = argc > 2 ? atoi(argv[2]) : 4;
+    if (hours <= 0.0 || boards < 1)
+    {
+        fprintf(stderr, "usage: %s [hours] [boards]\n", argv[0]);
+        return 1;
+    }
+    
+    DriftEstimator* estimator = malloc(sizeof(DriftEstimator));
+    DriftResampler* resampler = malloc(sizeof(DriftResampler));
+    if (estimator == NULL || resampler == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    printf("%d boards, %.1f hours at %.0f Hz, records every %u ms %u ms behind\n",
+           boards, hours, NOMINAL_HZ, RECORD_PERIOD_NS/1000000u, RECORD_DELAY_NS/1000000u);
+    for (int i = 0; i < boards; i++)
+    {
+        check_board(i, boards, hours, estimator, resampler);
+    }
+    measure(boards, hours, estimator, resampler);
+    free(estimator);
+    free(resampler);
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,445 @@
+/**
+*   \file filter_test.c
+*   \brief Accuracy and cost of the fixed-point filter chain of Filter.c.
+*
+*   Builds the firmware Filter.c unchanged, for the FILTER_CONFIG and
+*   FILTER_DC_REMOVAL given on the command line, and compares it with a
+*   double precision reference designed from the specification of
+*   Filter.h (Butterworth sections from the bilinear transform, the pole
+*   of FILTER_DC_POLE_Q15), not from the coefficient tables of Filter.c:
+*   - error of every output sample, in LSB of the 16-bit left-justified
+*     value, against the reference saturated to int16, on a step, sines,
+*     uniform noise and a full-scale square wave (saturation);
+*   - gain at fractions of the cutoff and at the Nyquist frequency of the
+*     decimated stream, measured through Filter.c against the design;
+*   - one sample released every Filter_GetDecimation() inputs;
+*   - time and cycles per call of Filter_Process() (three axes) on this
+*     host, read with the time stamp counter on x86, and the 32x32-bit
+*     multiply-accumulates per call. Each takes 3 to 7 cycles on the
+*     Cortex-M3 (SMLAL), the time on the board is the FILTER stage of
+*     Profile.h.
+*   Exits with 1 if an output is more than FILTER_TEST_MAX_ERROR LSB from
+*   the reference or if the decimation is wrong.
+*
+*   Usage:
+*       filter_test [calls]
+*
+*   Build on Linux or macOS with:
+*       cc -O2 -Ipsoc_stubs -I../AY1920_II_HW_05_PROJ_3.cydsn -DFILTER_CONFIG=2 -o filter_test filter_test.c ../AY1920_II_HW_05_PROJ_3.cydsn/Filter.c -lm
+*   and FILTER_CONFIG from 0 to 3, with or without -DFILTER_DC_REMOVAL=1.
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Filter.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define HAVE_TSC 1
+#else
+    #define HAVE_TSC 0
+#endif
+
+/**
+*   \brief Largest error accepted, in LSB of the 16-bit output.
+*/
+#define FILTER_TEST_MAX_ERROR 1.0
+
+/**
+*   \brief Samples of each test signal.
+*/
+#define FILTER_TEST_SAMPLES 20000
+
+/**
+*   \brief Samples skipped before measuring a gain.
+*/
+#define FILTER_TEST_SETTLE 4000
+
+#define PI 3.14159265358979323846
+
+/**
+*   \brief Specification of the configurations of Filter.h.
+*/
+typedef struct {
+    const char* name;
+    uint8_t order;          ///< Butterworth order, 0 for no low-pass
+    double cutoff;          ///< -3 dB frequency, fraction of the ODR
+    uint8_t decimation;
+} FilterSpec;
+
+static const FilterSpec specs[] = {
+    { "bypass", 0, 0.0, 1 },
+    { "2nd order low-pass at 0.20*ODR, decimation by 2", 2, 0.20, 2 },
+    { "4th order low-pass at 0.10*ODR, decimation by 4", 4, 0.10, 4 },
+    { "4th order low-pass at 0.05*ODR, decimation by 8", 4, 0.05, 8 }
+};
+
+/**
+*   \brief Double precision biquad, direct form I.
+*/
+typedef struct {
+    double b0, b1, b2, a1, a2;
+    double x1, x2, y1, y2;
+} Biquad;
+
+/**
+*   \brief Double precision reference of one axis.
+*/
+typedef struct {
+    Biquad sections[2];
+    uint8_t count;
+    double dc_x1;
+    double dc_y1;
+} Reference;
+
+/**
+*   \brief Worst and RMS error.
+*/
+typedef struct {
+    double worst;
+    double squares;
+    unsigned long count;
+} Error;
+
+static const FilterSpec* spec = &specs[FILTER_CONFIG];
+
+// Keeps the compiler from dropping the timed calls
+static volatile int32_t sink;
+
+    static void error_add(Error* error, double value)
+    {
+        if (fabs(value) > error->worst)
+        {
+            error->worst = fabs(value);
+        }
+        error->squares += value*value;
+        error->count++;
+    }
+    
+    static double error_rms(const Error* error)
+    {
+        return error->count ? sqrt(error->squares/error->count) : 0.0;
+    }
+    
+    /*
+    *   Butterworth sections from the bilinear transform, by increasing Q
+    *   as in Filter.c.
+    */
+    static void reference_init(Reference* reference)
+    {
+        double k = tan(PI*spec->cutoff);
+        uint8_t i;
+        
+        reference->count = spec->order/2;
+        for (i = 0; i < reference->count; i++)
+        {
+            Biquad* s = &reference->sections[i];
+            double q = 1.0/(2.0*cos((2*i + 1)*PI/(2.0*spec->order)));
+            double norm = 1.0/(1.0 + k/q + k*k);
+            s->b0 = k*k*norm;
+            s->b1 = 2.0*s->b0;
+            s->b2 = s->b0;
+            s->a1 = 2.0*(k*k - 1.0)*norm;
+            s->a2 = (1.0 - k/q + k*k)*norm;
+            s->x1 = s->x2 = s->y1 = s->y2 = 0.0;
+        }
+        reference->dc_x1 = 0.0;
+        reference->dc_y1 = 0.0;
+    }
+    
+    static double reference_process(Reference* reference, double x)
+    {
+        uint8_t i;
+        
+        if (FILTER_DC_REMOVAL)
+        {
+            double y = x - reference->dc_x1 + FILTER_DC_POLE_Q15/32768.0*reference->dc_y1;
+            reference->dc_x1 = x;
+            reference->dc_y1 = y;
+            x = y;
+        }
+        for (i = 0; i < reference->count; i++)
+        {
+            Biquad* s = &reference->sections[i];
+            double y = s->b0*x + s->b1*s->x1 + s->b2*s->x2 - s->a1*s->y1 - s->a2*s->y2;
+            s->x2 = s->x1;
+            s->x1 = x;
+            s->y2 = s->y1;
+            s->y1 = y;
+            x = y;
+        }
+        return x;
+    }
+    
+    /*
+    *   Magnitude of the designed response at a fraction of the ODR.
+    */
+    static double reference_gain(double frequency)
+    {
+        Reference reference;
+        double w = 2.0*PI*frequency;
+        double gain = 1.0;
+        uint8_t i;
+        
+        reference_init(&reference);
+        if (FILTER_DC_REMOVAL)
+        {
+            double p = FILTER_DC_POLE_Q15/32768.0;
+            gain *= sqrt(2.0 - 2.0*cos(w))/sqrt(1.0 - 2.0*p*cos(w) + p*p);
+        }
+        for (i = 0; i < reference.count; i++)
+        {
+            const Biquad* s = &reference.sections[i];
+            double nr = s->b0 + s->b1*cos(w) + s->b2*cos(2*w);
+            double ni = -s->b1*sin(w) - s->b2*sin(2*w);
+            double dr = 1.0 + s->a1*cos(w) + s->a2*cos(2*w);
+            double di = -s->a1*sin(w) - s->a2*sin(2*w);
+            gain *= sqrt((nr*nr + ni*ni)/(dr*dr + di*di));
+        }
+        return gain;
+    }
+    
+    static double saturate(double value)
+    {
+        if (value > INT16_MAX)
+        {
+            return INT16_MAX;
+        }
+        if (value < INT16_MIN)
+        {
+            return INT16_MIN;
+        }
+        return value;
+    }
+    
+    /*
+    *   Uniform noise in [-amplitude, amplitude].
+    */
+    static double noise(double amplitude)
+    {
+        return amplitude*(2.0*rand()/RAND_MAX - 1.0);
+    }
+    
+    /*
+    *   Input of a test signal, a different phase on each axis.
+    */
+    static double signal_at(uint8_t signal, uint8_t axis, long n)
+    {
+        switch (signal)
+        {
+            case 0:
+                return (n >= 100 + 50*axis) ? 16000.0 : -4000.0;
+            case 1:
+                return 8000.0 + 12000.0*sin(2.0*PI*0.01*n + axis);
+            case 2:
+                return 8000.0 + 12000.0*sin(2.0*PI*0.23*n + axis);
+            case 3:
+                return noise(30000.0);
+            default:
+                return ((n/(400 + 100*axis)) & 1) ? 32767.0 : -32768.0;
+        }
+    }
+    
+    /*
+    *   Every output against the reference, and the decimation.
+    */
+    static uint8_t check_accuracy(void)
+    {
+        static const char* names[] = {"step", "sine 0.01*ODR", "sine 0.23*ODR", "noise", "full-scale square"};
+        uint8_t failed = 0;
+        uint8_t signal;
+        
+        printf("Error against the double reference, LSB of the 16-bit output:\n");
+        srand(1);
+        for (signal = 0; signal < sizeof(names)/sizeof(names[0]); signal++)
+        {
+            Reference reference[FILTER_AXES];
+            Error error = { 0 };
+            long released = 0;
+            long first = -1;
+            long n;
+            uint8_t axis;
+        
+            Filter_Init();
+            for (axis = 0; axis < FILTER_AXES; axis++)
+            {
+                reference_init(&reference[axis]);
+            }
+            for (n = 0; n < FILTER_TEST_SAMPLES; n++)
+            {
+                int16_t sample[FILTER_AXES];
+                double expected[FILTER_AXES];
+        
+                for (axis = 0; axis < FILTER_AXES; axis++)
+                {
+                    double x = lrint(saturate(signal_at(signal, axis, n)));
+                    sample[axis] = (int16_t)x;
+                    expected[axis] = saturate(reference_process(&reference[axis], x));
+                }
+                if (Filter_Process(sample))
+                {
+                    if (first < 0)
+                    {
+                        first = n;
+                    }
+                    released++;
+                }
+                for (axis = 0; axis < FILTER_AXES; axis++)
+                {
+                    error_add(&error, sample[axis] - expected[axis]);
+                }
+            }
+            printf("    %-18s worst %.3f rms %.3f", names[signal], error.worst, error_rms(&error));
+            if (error.worst > FILTER_TEST_MAX_ERROR)
+            {
+                printf("  FAILED");
+                failed = 1;
+            }
+            if (released != FILTER_TEST_SAMPLES/spec->decimation || first != spec->decimation - 1)
+            {
+                printf("  decimation FAILED (%ld released, first at %ld)", released, first);
+                failed = 1;
+            }
+            printf("\n");
+        }
+        return failed;
+    }
+    
+    /*
+    *   Gain of Filter.c on a sine against the design.
+    */
+    static void check_response(void)
+    {
+        double frequencies[4];
+        uint8_t count = 0;
+        uint8_t i;
+        
+        if (spec->order > 0)
+        {
+            frequencies[count++] = 0.5*spec->cutoff;
+            frequencies[count++] = spec->cutoff;
+            frequencies[count++] = 2.0*spec->cutoff;
+        }
+        else
+        {
+            frequencies[count++] = 0.1;
+        }
+        if (spec->decimation > 1)
+        {
+            frequencies[count++] = 0.5/spec->decimation;
+        }
+        
+        printf("Gain through Filter.c against the design:\n");
+        for (i = 0; i < count; i++)
+        {
+            double squares = 0.0;
+            double amplitude = 16000.0;
+            long n;
+        
+            Filter_Init();
+            for (n = 0; n < FILTER_TEST_SAMPLES; n++)
+            {
+                int16_t sample[FILTER_AXES];
+                uint8_t axis;
+                for (axis = 0; axis < FILTER_AXES; axis++)
+                {
+                    sample[axis] = (int16_t)lrint(amplitude*sin(2.0*PI*frequencies[i]*n + 0.3));
+                }
+                Filter_Process(sample);
+                if (n >= FILTER_TEST_SETTLE)
+                {
+                    squares += (double)sample[0]*sample[0];
+                }
+            }
+            // The RMS of the input sine is amplitude/sqrt(2)
+            printf("    %.4f*ODR: %7.2f dB, design %7.2f dB\n", frequencies[i],
+                   20.0*log10(sqrt(2.0*squares/(FILTER_TEST_SAMPLES - FILTER_TEST_SETTLE))/amplitude),
+                   20.0*log10(reference_gain(frequencies[i])));
+        }
+    }
+    
+    static double now_ns(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec*1e9 + ts.tv_nsec;
+    }
+    
+    static uint64_t cycles(void)
+    {
+        #if HAVE_TSC
+        return __rdtsc();
+        #else
+        return 0;
+        #endif
+    }
+    
+    /*
+    *   Time and cycles per call of Filter_Process().
+    */
+    static void measure(long calls)
+    {
+        int16_t* inputs = malloc(sizeof(int16_t)*1024*FILTER_AXES);
+        uint8_t macs = FILTER_AXES*(5*spec->order/2 + (FILTER_DC_REMOVAL ? 1 : 0));
+        double start;
+        double elapsed;
+        uint64_t start_cycles;
+        uint64_t elapsed_cycles;
+        int32_t sum = 0;
+        long n;
+        int i;
+        
+        srand(1);
+        for (i = 0; i < 1024*FILTER_AXES; i++)
+        {
+            inputs[i] = (int16_t)noise(20000.0);
+        }
+        Filter_Init();
+        start = now_ns();
+        start_cycles = cycles();
+        for (n = 0; n < calls; n++)
+        {
+            int16_t sample[FILTER_AXES];
+            const int16_t* input = &inputs[(n & 1023)*FILTER_AXES];
+            sample[0] = input[0];
+            sample[1] = input[1];
+            sample[2] = input[2];
+            sum += Filter_Process(sample);
+            sum += sample[0];
+        }
+        elapsed_cycles = cycles() - start_cycles;
+        elapsed = now_ns() - start;
+        sink = sum;
+        printf("Filter_Process(): %6.1f ns", elapsed/calls);
+        if (HAVE_TSC)
+        {
+            printf(", %6.1f TSC cycles", (double)elapsed_cycles/calls);
+        }
+        printf(" per call, %u multiply-accumulates (%u to %u cycles on the Cortex-M3)\n",
+               macs, 3u*macs, 7u*macs);
+        free(inputs);
+    }
+
+int main(int argc, char** argv)
+{
+    long calls = argc > 1 ? atol(argv[1]) : 10000000L;
+    uint8_t failed;
+    
+    if (calls <= 0 || FILTER_CONFIG >= sizeof(specs)/sizeof(specs[0]))
+    {
+        fprintf(stderr, "usage: %s [calls]\n", argv[0]);
+        return 1;
+    }
+    
+    printf("FILTER_CONFIG %d: %s, DC removal %s\n\n", FILTER_CONFIG, spec->name,
+           FILTER_DC_REMOVAL ? "on" : "off");
+    failed = check_accuracy();
+    check_response();
+    measure(calls);
+    return failed;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,295 @@
+/**
+*   \file pipeline_model.c
+*   \brief Throughput of the sequential and pipelined acquisition loops.
+*
+*   Event model of the acquisition loop of main.c, with
+*   PIPELINED_ACQUISITION set to 0 and 1 (Pipeline.h):
+*   - the LIS3DH produces a sample every 1/ODR, a sample not read before
+*     the next one is overwritten and counted as dropped;
+*   - a register read of n bytes takes 3 + 9*(3 + n) bit times on the
+*     sensor bus (start, address, register, repeated start, address, data,
+*     stop): the data ready poll 39, the three axes read in a single
+*     auto-increment transaction 84, by both loops;
+*   - the processing of a sample (filter, conversion, packing) takes a
+*     random 100 to 400 us of CPU;
+*   - UART_Debug sends 10 bits per byte and has no software buffer: the
+*     writes of the packet block until all but the 4 bytes of the hardware
+*     FIFO are out.
+*   The sequential loop polls, reads, processes and transmits in turn. The
+*   pipelined loop chains the poll and the read on the bus, into two
+*   sample buffers, while the CPU processes and transmits the previous
+*   sample. The CPU time of the bus interrupt is not modelled.
+*
+*   For each output data rate, the samples acquired and dropped per second
+*   by the two loops and the load of UART_Debug.
+*
+*   Usage:
+*       pipeline_model [-b baud] [-i bus bit/s] [-n packet bytes] [seconds]
+*   The defaults are the TopDesign (19200 baud, I2C at 100 kbit/s) and the
+*   14-byte packet of the default profile (FirmwareProfile.h).
+*
+*   Build on Linux or macOS with:
+*       cc -O2 -o pipeline_model pipeline_model.c
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+*   \brief Bytes of the hardware FIFO of UART_Debug (TX buffer size 4).
+*/
+#define UART_FIFO_BYTES 4
+
+/**
+*   \brief Bits on the line per byte, 8N1.
+*/
+#define UART_BITS_PER_BYTE 10
+
+/**
+*   \brief Samples waiting between the bus stage and the decode stage.
+*/
+#define PIPELINE_BUFFERS 2
+
+/**
+*   \brief Processing time of a sample, in s.
+*/
+#define PROCESS_MIN_S 100e-6
+#define PROCESS_MAX_S 400e-6
+
+static const uint16_t odr_list[] = {10, 25, 50, 100, 200, 400, 1344};
+#define ODRS (sizeof(odr_list)/sizeof(odr_list[0]))
+
+/**
+*   \brief Parameters of a run.
+*/
+typedef struct {
+    double odr;             ///< Output data rate in Hz
+    double bus_bit_s;       ///< Time of a bit on the sensor bus
+    double byte_s;          ///< Time of a byte on UART_Debug
+    uint8_t packet_bytes;   ///< Bytes of each packet
+    double run_s;           ///< Time simulated
+} Model;
+
+/**
+*   \brief Results of a run.
+*/
+typedef struct {
+    uint32_t acquired;      ///< Samples read and transmitted
+    uint32_t dropped;       ///< Samples overwritten before being read
+    double uart_busy_s;     ///< Time UART_Debug has been sending
+} Result;
+
+// Completion times of the bytes in the FIFO of UART_Debug
+static double fifo_done[UART_FIFO_BYTES];
+static uint8_t fifo_head;
+static uint8_t fifo_count;
+static double line_free;
+
+    /*
+    *   Bus time of a register read of n bytes.
+    */
+    static double bus_read_s(const Model* model, uint8_t n)
+    {
+        return (3 + 9*(3 + n))*model->bus_bit_s;
+    }
+    
+    /*
+    *   Processing time of a sample.
+    */
+    static double process_s(void)
+    {
+        return PROCESS_MIN_S + (PROCESS_MAX_S - PROCESS_MIN_S)*rand()/RAND_MAX;
+    }
+    
+    /*
+    *   Index of the newest sample of the device at time t.
+    */
+    static int64_t newest_sample(const Model* model, double t)
+    {
+        return (int64_t)(t*model->odr);
+    }
+    
+    static void uart_reset(void)
+    {
+        fifo_head = 0;
+        fifo_count = 0;
+        line_free = 0.0;
+    }
+    
+    /*
+    *   Write a packet from time t, return the time the write returns.
+    */
+    static double uart_write(const Model* model, Result* result, double t, uint8_t bytes)
+    {
+        while (bytes-- > 0)
+        {
+            // Drop the bytes already sent, wait for a free place
+            while (fifo_count > 0 && fifo_done[fifo_head] <= t)
+            {
+                fifo_head = (fifo_head + 1) % UART_FIFO_BYTES;
+                fifo_count--;
+            }
+            if (fifo_count == UART_FIFO_BYTES)
+            {
+                t = fifo_done[fifo_head];
+                fifo_head = (fifo_head + 1) % UART_FIFO_BYTES;
+                fifo_count--;
+            }
+            line_free = ((line_free > t) ? line_free : t) + model->byte_s;
+            fifo_done[(fifo_head + fifo_count) % UART_FIFO_BYTES] = line_free;
+            fifo_count++;
+            result->uart_busy_s += model->byte_s;
+        }
+        return t;
+    }
+    
+    /*
+    *   Count the samples overwritten before the one read at time t.
+    */
+    static void take_sample(const Model* model, Result* result, double t, int64_t* last)
+    {
+        int64_t index = newest_sample(model, t);
+        result->dropped += (uint32_t)(index - *last - 1);
+        *last = index;
+    }
+    
+    /*
+    *   Poll, read the three axes, process and transmit, one after the other.
+    */
+    static Result run_sequential(const Model* model)
+    {
+        Result result = {0, 0, 0.0};
+        int64_t last = -1;
+        double t = 0.0;
+        
+        uart_reset();
+        while (t < model->run_s)
+        {
+            t += bus_read_s(model, 1);
+            if (newest_sample(model, t) <= last)
+            {
+                continue;
+            }
+            take_sample(model, &result, t, &last);
+            t += bus_read_s(model, 6);
+            t += process_s();
+            t = uart_write(model, &result, t, model->packet_bytes);
+            result.acquired++;
+        }
+        return result;
+    }
+    
+    /*
+    *   Bus chain and CPU advanced in time order, the chain pauses with both
+    *   buffers full until the CPU takes one.
+    */
+    static Result run_pipelined(const Model* model)
+    {
+        Result result = {0, 0, 0.0};
+        double ready_at[PIPELINE_BUFFERS];
+        uint8_t ready = 0;
+        int64_t last = -1;
+        double bus_t = 0.0;
+        double cpu_t = 0.0;
+        uint8_t bus_paused = 0;
+        
+        uart_reset();
+        while (cpu_t < model->run_s)
+        {
+            if (!bus_paused && bus_t <= cpu_t)
+            {
+                bus_t += bus_read_s(model, 1);
+                if (newest_sample(model, bus_t) > last)
+                {
+                    take_sample(model, &result, bus_t, &last);
+                    bus_t += bus_read_s(model, 2*3);
+                    ready_at[ready++] = bus_t;
+                    bus_paused = (ready == PIPELINE_BUFFERS);
+                }
+                continue;
+            }
+            if (ready > 0 && ready_at[0] <= cpu_t)
+            {
+                ready_at[0] = ready_at[1];
+                ready--;
+                if (bus_paused)
+                {
+                    bus_paused = 0;
+                    bus_t = cpu_t;
+                }
+                cpu_t += process_s();
+                cpu_t = uart_write(model, &result, cpu_t, model->packet_bytes);
+                result.acquired++;
+                continue;
+            }
+            // Nothing to take: the CPU waits for the next bus event
+            cpu_t = (ready > 0) ? ready_at[0] : bus_t;
+        }
+        return result;
+    }
+
+int main(int argc, char** argv)
+{
+    uint32_t baud = 19200;
+    uint32_t bus_rate = 100000;
+    uint8_t packet_bytes = 14;
+    double run_s = 20.0;
+    uint8_t i;
+    int opt;
+    
+    while ((opt = getopt(argc, argv, "b:i:n:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b':
+                baud = (uint32_t)atol(optarg);
+                break;
+            case 'i':
+                bus_rate = (uint32_t)atol(optarg);
+                break;
+            case 'n':
+                packet_bytes = (uint8_t)atoi(optarg);
+                break;
+            default:
+                baud = 0;
+                break;
+        }
+    }
+    if (optind < argc)
+    {
+        run_s = atof(argv[optind]);
+    }
+    if (baud == 0 || bus_rate == 0 || packet_bytes == 0 || run_s <= 0.0)
+    {
+        fprintf(stderr, "usage: %s [-b baud] [-i bus bit/s] [-n packet bytes] [seconds]\n", argv[0]);
+        return 1;
+    }
+    
+    printf("UART_Debug %u baud (%u packets/s of %u bytes), bus %u bit/s, %.0f s\n\n",
+           baud, baud/UART_BITS_PER_BYTE/packet_bytes, packet_bytes, bus_rate, run_s);
+    printf("%6s | %-24s | %-24s\n", "", "sequential", "pipelined");
+    printf("%6s | %8s %8s %6s | %8s %8s %6s\n", "ODR Hz",
+           "read/s", "drop/s", "UART", "read/s", "drop/s", "UART");
+    for (i = 0; i < ODRS; i++)
+    {
+        Model model = {odr_list[i], 1.0/bus_rate, (double)UART_BITS_PER_BYTE/baud,
+                       packet_bytes, run_s};
+        Result sequential;
+        Result pipelined;
+        
+        srand(1);
+        sequential = run_sequential(&model);
+        srand(1);
+        pipelined = run_pipelined(&model);
+        printf("%6u | %8.1f %8.1f %5.1f%% | %8.1f %8.1f %5.1f%%\n", odr_list[i],
+               sequential.acquired/run_s, sequential.dropped/run_s,
+               100.0*sequential.uart_busy_s/run_s,
+               pipelined.acquired/run_s, pipelined.dropped/run_s,
+               100.0*pipelined.uart_busy_s/run_s);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,282 @@
+/**
+*   \file profile_bench.c
+*   \brief Stage profile of the acquisition loop on the host, in the frame
+*   of the firmware.
+*
+*   Builds the firmware Profile.c, Filter.c, Frame.c and CRC.c unchanged,
+*   with PROFILE_ENABLE set to 1 and PROFILE_HOST defined, so that the
+*   counter of Profile.h is the monotonic clock of the host in ns. The
+*   stages of main.c that do not touch the hardware run between the same
+*   PROFILE_BEGIN() and PROFILE_END() over a synthetic acceleration (1 g
+*   on Z, a 5 Hz sine and noise on the three axes), at the output data
+*   rate given:
+*   - FILTER: Filter_Process() of Filter.c;
+*   - CONVERT: shift and sensitivity of the default profile
+*     (FirmwareProfile.h), calibration left out;
+*   - PACK: conversion to mm/s^2 and packing of the 0xA0 packet;
+*   - UART: Frame_Write() of the packet, into a buffer of the host.
+*   The time is the one of the samples, so that PROFILE_SERVICE() sends a
+*   0xAE frame every PROFILE_REPORT_MS of acquisition. Each frame is
+*   checked (header, length, CRC, footer) and decoded as the host does for
+*   the frames of the board: runs, minimum, maximum and mean of each stage
+*   in counts and in us, from the clock reported in the frame. The same
+*   lines for a frame of the board give comparable times; on the host each
+*   stage also includes one read of the clock, some tens of ns.
+*   Exits with 1 if a frame is malformed or a stage run is missing.
+*
+*   Usage:
+*       profile_bench [-r odr] [seconds]
+*   The defaults are 100 Hz (FirmwareProfile.h) and 5 s.
+*
+*   Build on Linux or macOS with:
+*       cc -O2 -Ipsoc_stubs -I../AY1920_II_HW_05_PROJ_3.cydsn -DPROFILE_ENABLE=1 -DPROFILE_HOST -o profile_bench profile_bench.c ../AY1920_II_HW_05_PROJ_3.cydsn/Profile.c ../AY1920_II_HW_05_PROJ_3.cydsn/Filter.c ../AY1920_II_HW_05_PROJ_3.cydsn/Frame.c ../AY1920_II_HW_05_PROJ_3.cydsn/CRC.c -lm
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "CRC.h"
+#include "Filter.h"
+#include "FirmwareProfile.h"
+#include "Frame.h"
+#include "Profile.h"
+#include "Timebase.h"
+
+#if !(PROFILE_ENABLE) || !defined(PROFILE_HOST)
+    #error "Build with -DPROFILE_ENABLE=1 -DPROFILE_HOST"
+#endif
+
+/**
+*   \brief Divider of UART_Debug_IntClock for 19200 baud (Frame.h).
+*/
+#define UART_CLOCK_DIVIDER 155u
+
+/**
+*   \brief Bytes of a profiling frame (header, payload, CRC, footer).
+*/
+#define PROFILE_FRAME_BYTES (FRAME_OVERHEAD + 4 + 15*PROFILE_STAGES)
+
+static const char* const stage_names[PROFILE_STAGES] = {
+    "STATUS", "READ", "FILTER", "CONVERT", "PROCESS", "PACK", "UART", "FLASH"
+};
+
+// Time of the acquisition
+static uint32_t now_ms;
+
+// Bytes sent on UART_Debug since the last clear
+static uint8_t tx_buffer[512];
+static uint16_t tx_length;
+
+/*
+*   Firmware interfaces used by Profile.c and Frame.c.
+*/
+uint32_t Timebase_GetMs(void)
+{
+    return now_ms;
+}
+
+uint8 UART_Debug_GetTxBufferSize(void)
+{
+    return 0;
+}
+
+void UART_Debug_PutArray(const uint8 string[], uint8 byteCount)
+{
+    uint8_t i;
+    for (i = 0; i < byteCount && tx_length < sizeof(tx_buffer); i++)
+    {
+        tx_buffer[tx_length++] = string[i];
+    }
+}
+
+uint16 UART_Debug_IntClock_GetDividerRegister(void)
+{
+    return UART_CLOCK_DIVIDER;
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*
+*   Check and print a profiling frame. Returns 0 if it is valid and every
+*   stage the loop runs has been measured.
+*/
+static int decode_frame(const uint8_t* frame, uint16_t length, uint32_t samples)
+{
+    const uint8_t* p = frame + 1;
+    uint16_t crc;
+    uint32_t clock_hz;
+    uint8_t stage;
+    int missing = 0;
+
+    if (length != PROFILE_FRAME_BYTES || frame[0] != FRAME_HEADER_PROFILE ||
+        frame[length - 1] != FRAME_FOOTER)
+    {
+        printf("malformed frame of %u bytes\n", length);
+        return 1;
+    }
+    crc = CRC16_Update(CRC16_INIT, frame, (uint16_t)(length - 3));
+    if (crc != (uint16_t)(frame[length - 3] | (frame[length - 2] << 8)))
+    {
+        printf("frame with a wrong CRC\n");
+        return 1;
+    }
+
+    clock_hz = get32(p);
+    p += 4;
+    printf("at %u ms, %u samples, clock %u Hz\n", now_ms, samples, clock_hz);
+    printf("  %-8s %6s %10s %10s %10s %9s %9s %9s\n",
+           "stage", "runs", "min", "max", "mean", "min us", "max us", "mean us");
+    for (stage = 0; stage < PROFILE_STAGES; stage++)
+    {
+        uint8_t id = p[0];
+        uint16_t runs = (uint16_t)(p[1] | (p[2] << 8));
+        uint32_t min = get32(p + 3);
+        uint32_t max = get32(p + 7);
+        uint32_t mean = get32(p + 11);
+        p += 15;
+
+        if (runs == 0)
+        {
+            // Stages on the sensor bus and the flash are not run on the host
+            if (id == PROFILE_STAGE_FILTER || id == PROFILE_STAGE_CONVERT ||
+                id == PROFILE_STAGE_PACK || id == PROFILE_STAGE_UART)
+            {
+                printf("  %-8s not measured\n", stage_names[id]);
+                missing = 1;
+            }
+            continue;
+        }
+        printf("  %-8s %6u %10u %10u %10u %9.3f %9.3f %9.3f\n",
+               id < PROFILE_STAGES ? stage_names[id] : "?", runs, min, max, mean,
+               min*1e6/clock_hz, max*1e6/clock_hz, mean*1e6/clock_hz);
+    }
+    return missing;
+}
+
+/*
+*   Run PROFILE_SERVICE() and decode the frame it sends, if due. Returns
+*   1 if a frame has been sent.
+*/
+static int service(uint32_t samples, int* failures)
+{
+    tx_length = 0;
+    PROFILE_SERVICE();
+    if (tx_length == 0)
+    {
+        return 0;
+    }
+    *failures |= decode_frame(tx_buffer, tx_length, samples);
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t odr = 100;
+    double seconds = 5.0;
+    uint32_t samples, n;
+    uint32_t since_frame = 0;
+    uint16_t frames = 0;
+    int failures = 0;
+    uint8_t OutArray[FIRMWARE_PACKET_SIZE];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:")) != -1)
+    {
+        if (opt == 'r')
+        {
+            odr = (uint32_t)strtoul(optarg, NULL, 10);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-r odr] [seconds]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind < argc)
+    {
+        seconds = atof(argv[optind]);
+    }
+    if (odr == 0 || seconds <= 0)
+    {
+        fprintf(stderr, "invalid rate or duration\n");
+        return 2;
+    }
+    samples = (uint32_t)(seconds*odr);
+
+    OutArray[0] = FIRMWARE_PACKET_HEADER;
+    OutArray[FIRMWARE_PACKET_SIZE-1] = FIRMWARE_PACKET_FOOTER;
+    Filter_Init();
+    srand(1);
+
+    PROFILE_START();
+    for (n = 0; n < samples; n++)
+    {
+        int16_t Raw[3];
+        int16_t Sample_mg[3];
+        uint8_t* packet;
+        double t = (double)n/odr;
+        uint8_t axis;
+
+        now_ms = (uint32_t)((uint64_t)n*1000u/odr);
+        if (service(since_frame, &failures))
+        {
+            since_frame = 0;
+            frames++;
+        }
+
+        // Left-justified register values, 1 g on Z
+        for (axis = 0; axis < 3; axis++)
+        {
+            double mg = (axis == 2 ? 1000.0 : 0.0) + 200.0*sin(2*M_PI*5.0*t + axis) +
+                        (rand() % 41 - 20);
+            double digit = mg/FIRMWARE_SENSITIVITY;
+            Raw[axis] = (int16_t)lrint(digit*(1 << FIRMWARE_SHIFT));
+        }
+        since_frame++;
+
+        PROFILE_BEGIN(PROFILE_STAGE_FILTER);
+        if (!Filter_Process(Raw))
+        {
+            PROFILE_END(PROFILE_STAGE_FILTER);
+            continue;
+        }
+        PROFILE_END(PROFILE_STAGE_FILTER);
+
+        PROFILE_BEGIN(PROFILE_STAGE_CONVERT);
+        for (axis = 0; axis < 3; axis++)
+        {
+            Sample_mg[axis] = (int16_t)((Raw[axis] >> FIRMWARE_SHIFT)*FIRMWARE_SENSITIVITY);
+        }
+        PROFILE_END(PROFILE_STAGE_CONVERT);
+
+        PROFILE_BEGIN(PROFILE_STAGE_PACK);
+        packet = &OutArray[1];
+        for (axis = 0; axis < 3; axis++)
+        {
+            packet = Frame_Put32(packet, (uint32_t)((int32_t)Sample_mg[axis]*981/100));
+        }
+        PROFILE_END(PROFILE_STAGE_PACK);
+        PROFILE_BEGIN(PROFILE_STAGE_UART);
+        Frame_Write(OutArray, FIRMWARE_PACKET_SIZE);
+        PROFILE_END(PROFILE_STAGE_UART);
+    }
+
+    // The frame of the last period, due at the end of the acquisition
+    now_ms = (uint32_t)((uint64_t)samples*1000u/odr);
+    frames += service(since_frame, &failures);
+    
+    if (frames == 0)
+    {
+        printf("no frame in %u ms, PROFILE_REPORT_MS is %u\n", now_ms, PROFILE_REPORT_MS);
+        failures = 1;
+    }
+    printf(failures ? "failed\n" : "passed\n");
+    return failures;
+}
+
+/* [] END OF FILE */
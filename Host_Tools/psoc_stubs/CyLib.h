@@ -0,0 +1,23 @@
+/**
+*   \file CyLib.h
+*   \brief Host stand-in for the CyLib.h of PSoC Creator.
+*
+*   The critical sections are provided by the host tool, which runs the
+*   interrupts of its models from the same thread.
+*/
+
+#ifndef CY_BOOT_CYLIB_H
+    #define CY_BOOT_CYLIB_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Frequency of the bus clock set in the TopDesign.
+    */
+    #define BCLK__BUS_CLK__HZ 24000000u
+    
+    uint8 CyEnterCriticalSection(void);
+    void CyExitCriticalSection(uint8 savedIntrStatus);
+    
+#endif // CY_BOOT_CYLIB_H
+/* [] END OF FILE */
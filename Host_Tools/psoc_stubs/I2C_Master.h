@@ -0,0 +1,50 @@
+/**
+*   \file I2C_Master.h
+*   \brief Host stand-in for the API of the I2C_Master component.
+*
+*   Only the buffer functions and the status values used by
+*   I2C_Interface.c, with the values of the component. The functions are
+*   provided by the host tool, as a model of the bus, and the model calls
+*   I2C_Master_ISR_ExitCallback() at the end of each transfer as the
+*   interrupt of the component does.
+*/
+
+#ifndef CY_I2C_I2C_Master_H
+    #define CY_I2C_I2C_Master_H
+    
+    #include "cytypes.h"
+    #include "CyLib.h"
+    #include "cyapicallbacks.h"
+    
+    // Transfer modes
+    #define I2C_Master_MODE_COMPLETE_XFER 0x00u
+    #define I2C_Master_MODE_REPEAT_START 0x01u
+    #define I2C_Master_MODE_NO_STOP 0x02u
+    
+    // Errors returned by the functions that start a transfer
+    #define I2C_Master_MSTR_NO_ERROR 0x00u
+    #define I2C_Master_MSTR_BUS_BUSY 0x01u
+    #define I2C_Master_MSTR_NOT_READY 0x02u
+    #define I2C_Master_MSTR_ERR_LB_NAK 0x03u
+    #define I2C_Master_MSTR_ERR_ARB_LOST 0x04u
+    #define I2C_Master_MSTR_ERR_ABORT_START_GEN 0x05u
+    
+    // Status of the buffer transfers
+    #define I2C_Master_MSTAT_RD_CMPLT 0x01u
+    #define I2C_Master_MSTAT_WR_CMPLT 0x02u
+    #define I2C_Master_MSTAT_XFER_INP 0x04u
+    #define I2C_Master_MSTAT_XFER_HALT 0x08u
+    #define I2C_Master_MSTAT_ERR_SHORT_XFER 0x10u
+    #define I2C_Master_MSTAT_ERR_ADDR_NAK 0x20u
+    #define I2C_Master_MSTAT_ERR_ARB_LOST 0x40u
+    #define I2C_Master_MSTAT_ERR_XFER 0x80u
+    
+    void I2C_Master_Start(void);
+    void I2C_Master_Stop(void);
+    uint8 I2C_Master_MasterWriteBuf(uint8 slaveAddress, uint8* wrData, uint8 cnt, uint8 mode);
+    uint8 I2C_Master_MasterReadBuf(uint8 slaveAddress, uint8* rdData, uint8 cnt, uint8 mode);
+    uint8 I2C_Master_MasterStatus(void);
+    uint8 I2C_Master_MasterClearStatus(void);
+    
+#endif // CY_I2C_I2C_Master_H
+/* [] END OF FILE */
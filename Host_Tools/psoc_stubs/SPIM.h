@@ -0,0 +1,27 @@
+/**
+*   \file SPIM.h
+*   \brief Host stand-in for the API of the SPIM component.
+*
+*   Only the functions and the status bit used by SPI_Interface.c, with
+*   the values of the component. The functions are provided by the host
+*   tool, as a model of the bus.
+*/
+
+#ifndef CY_SPIM_SPIM_H
+    #define CY_SPIM_SPIM_H
+    
+    #include "cytypes.h"
+    
+    // Bits of SPIM_ReadTxStatus()
+    #define SPIM_STS_TX_FIFO_NOT_FULL 0x04u
+    
+    void SPIM_Start(void);
+    void SPIM_Stop(void);
+    uint8 SPIM_ReadTxStatus(void);
+    void SPIM_WriteTxData(uint8 txData);
+    uint8 SPIM_ReadRxData(void);
+    uint8 SPIM_GetRxBufferSize(void);
+    void SPIM_ClearRxBuffer(void);
+    
+#endif // CY_SPIM_SPIM_H
+/* [] END OF FILE */
@@ -0,0 +1,17 @@
+/**
+*   \file SPI_CS.h
+*   \brief Host stand-in for the API of the SPI_CS pin.
+*
+*   The chip select of the LIS3DH, driven by SPI_Interface.c. The function
+*   is provided by the host tool, as a model of the bus.
+*/
+
+#ifndef CY_PINS_SPI_CS_H
+    #define CY_PINS_SPI_CS_H
+    
+    #include "cytypes.h"
+    
+    void SPI_CS_Write(uint8 value);
+    
+#endif // CY_PINS_SPI_CS_H
+/* [] END OF FILE */
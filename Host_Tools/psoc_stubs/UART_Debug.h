@@ -0,0 +1,23 @@
+/**
+*   \file UART_Debug.h
+*   \brief Host stand-in for the API of the UART_Debug component.
+*
+*   Only the functions used by Frame.c. They are provided by the host tool,
+*   which collects the bytes sent by the firmware modules it builds.
+*/
+
+#ifndef CY_UART_UART_Debug_H
+    #define CY_UART_UART_Debug_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Oversampling set in the TopDesign.
+    */
+    #define UART_Debug_OVER_SAMPLE_COUNT 8u
+    
+    uint8 UART_Debug_GetTxBufferSize(void);
+    void UART_Debug_PutArray(const uint8 string[], uint8 byteCount);
+    
+#endif // CY_UART_UART_Debug_H
+/* [] END OF FILE */
@@ -0,0 +1,16 @@
+/**
+*   \file UART_Debug_IntClock.h
+*   \brief Host stand-in for the API of the clock of UART_Debug.
+*
+*   The divider is provided by the host tool.
+*/
+
+#ifndef CY_CLOCK_UART_Debug_IntClock_H
+    #define CY_CLOCK_UART_Debug_IntClock_H
+    
+    #include "cytypes.h"
+    
+    uint16 UART_Debug_IntClock_GetDividerRegister(void);
+    
+#endif // CY_CLOCK_UART_Debug_IntClock_H
+/* [] END OF FILE */
@@ -0,0 +1,27 @@
+/**
+*   \file cytypes.h
+*   \brief Host stand-in for the cytypes.h of PSoC Creator.
+*
+*   Only the types used by the firmware modules that the host tools build
+*   unchanged (AdaptiveRate.c, Filter.c, ...), so that they compile with
+*   -Ipsoc_stubs and no generated source.
+*/
+
+#ifndef CY_BOOT_CYTYPES_H
+    #define CY_BOOT_CYTYPES_H
+    
+    #include <stddef.h>
+    #include <stdint.h>
+    
+    typedef uint8_t uint8;
+    typedef uint16_t uint16;
+    typedef uint32_t uint32;
+    typedef int8_t int8;
+    typedef int16_t int16;
+    typedef int32_t int32;
+    typedef float float32;
+    
+    #define CY_INLINE inline
+    
+#endif // CY_BOOT_CYTYPES_H
+/* [] END OF FILE */
@@ -0,0 +1,293 @@
+/**
+*   \file sensor_bus_bench.c
+*   \brief Acquisition throughput of the I2C and SPI sensor bus backends.
+*
+*   Builds the firmware LIS3DH.c and one of I2C_Interface.c and
+*   SPI_Interface.c unchanged over the mock of sensor_bus_mock.h, so the
+*   same benchmark, written against LIS3DH_* and SensorBus_* only, runs
+*   over both backends. For each output data rate:
+*   - poll: the loop of main.c without the processing, STATUS_REG polled
+*     and the sample read with LIS3DH_ReadSample() when ZYXDA is set;
+*   - fifo: the FIFO in stream mode, drained with LIS3DH_ReadFifo() each
+*     time it should hold BENCH_DRAIN_SAMPLES samples, the CPU away from
+*     the bus in between.
+*   The samples read and lost per second, the time of the read of a sample
+*   (LIS3DH_ReadSample(), or the drain over the samples it returned) and
+*   the load of the bus. The rate a backend can sustain is about 1 s over
+*   the time per sample of the fifo loop. Every sample read is checked
+*   against the numbering of the mock: a torn or reordered sample, or a
+*   count of lost samples different from the one of the device, is a
+*   failure and the exit status is 1.
+*
+*   Usage:
+*       sensor_bus_bench [-r bus bit/s] [-c cycles per API call] [seconds]
+*   The bus runs at SENSOR_BUS_BIT_RATE unless -r is given.
+*
+*   Build on Linux or macOS with, for the I2C backend:
+*       cc -O2 -Ipsoc_stubs -I../AY1920_II_HW_05_PROJ_3.cydsn -o sensor_bus_bench_i2c sensor_bus_bench.c sensor_bus_mock.c ../AY1920_II_HW_05_PROJ_3.cydsn/LIS3DH.c ../AY1920_II_HW_05_PROJ_3.cydsn/I2C_Interface.c
+*   and for the SPI backend:
+*       cc -O2 -DSENSOR_BUS_TRANSPORT=SENSOR_BUS_SPI -Ipsoc_stubs -I../AY1920_II_HW_05_PROJ_3.cydsn -o sensor_bus_bench_spi sensor_bus_bench.c sensor_bus_mock.c ../AY1920_II_HW_05_PROJ_3.cydsn/LIS3DH.c ../AY1920_II_HW_05_PROJ_3.cydsn/SPI_Interface.c
+*   e.g. sensor_bus_bench_i2c -r 400000, sensor_bus_bench_spi -r 8000000.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "LIS3DH.h"
+#include "Sensor_Bus.h"
+#include "sensor_bus_mock.h"
+
+/**
+*   \brief Samples in the FIFO at each drain of the fifo loop.
+*/
+#define BENCH_DRAIN_SAMPLES 16u
+
+/**
+*   \brief Output data rates of the benchmark.
+*/
+typedef struct {
+    LIS3DH_Mode mode;
+    LIS3DH_ODR odr;
+    uint16_t hz;
+} BenchRate;
+
+static const BenchRate rates[] = {
+    { LIS3DH_MODE_HIGH_RES, LIS3DH_ODR_100HZ, 100 },
+    { LIS3DH_MODE_HIGH_RES, LIS3DH_ODR_400HZ, 400 },
+    { LIS3DH_MODE_HIGH_RES, LIS3DH_ODR_1344HZ, 1344 },
+    { LIS3DH_MODE_LOW_POWER, LIS3DH_ODR_1600HZ_LP, 1600 },
+    { LIS3DH_MODE_LOW_POWER, LIS3DH_ODR_1344HZ, 5376 }
+};
+#define RATES (sizeof(rates)/sizeof(rates[0]))
+
+/**
+*   \brief Results of a loop.
+*/
+typedef struct {
+    uint32_t read;          ///< Samples read
+    uint32_t lost;          ///< Samples missed, from the numbering
+    uint64_t read_ns;       ///< Time in the reads of the samples
+    uint64_t bus_ns;        ///< Time the bus has been busy
+    uint64_t run_ns;        ///< Time of the loop
+    uint32_t errors;        ///< Torn or reordered samples, bus errors
+} Result;
+
+static const char* transport_names[] = {"I2C", "SPI"};
+
+// Number of the next sample expected
+static uint16_t expected;
+static uint8_t started;
+static uint8_t failures;
+
+    /*
+    *   Check a sample against the numbering of the mock.
+    */
+    static void check_sample(Result* result, const int16_t* raw)
+    {
+        uint16_t number = (uint16_t)raw[0];
+        uint16_t y = (uint16_t)~number;
+        uint16_t z = number ^ 0x5AA5;
+        
+        if ((uint16_t)raw[1] != y || (uint16_t)raw[2] != z)
+        {
+            result->errors++;
+            return;
+        }
+        if (started)
+        {
+            result->lost += (uint16_t)(number - expected);
+        }
+        started = 1;
+        expected = number + 1;
+    }
+    
+    /*
+    *   Configure the device, the FIFO and the counters for a loop.
+    */
+    static void setup(LIS3DH_Device* device, const BenchRate* rate, LIS3DH_FifoMode fifo,
+                      uint32_t bit_rate, Result* result)
+    {
+        mock_init(bit_rate);
+        SensorBus_Start();
+        // Block data update, as in the profiles of FirmwareProfile.h
+        if (SensorBus_WriteRegister(MOCK_DEVICE_ADDRESS, LIS3DH_CTRL_REG4, LIS3DH_CTRL_REG4_BDU) != NO_ERROR ||
+            LIS3DH_Init(device, MOCK_DEVICE_ADDRESS) != NO_ERROR ||
+            LIS3DH_SetMode(device, rate->mode) != NO_ERROR ||
+            LIS3DH_SetFifo(device, fifo, 0) != NO_ERROR ||
+            LIS3DH_SetODR(device, rate->odr) != NO_ERROR)
+        {
+            result->errors++;
+        }
+        started = 0;
+    }
+    
+    /*
+    *   Lost samples counted by the reader against the device.
+    */
+    static void finish(Result* result, uint64_t start_ns, uint64_t start_bus_ns)
+    {
+        const MockStats* stats = mock_stats();
+        
+        result->run_ns = mock_now_ns() - start_ns;
+        result->bus_ns = stats->bus_busy_ns - start_bus_ns;
+        // The samples after the last one read are not lost yet
+        if (result->lost > stats->lost)
+        {
+            result->errors++;
+        }
+    }
+    
+    static Result run_poll(const BenchRate* rate, uint32_t bit_rate, double run_s)
+    {
+        LIS3DH_Device device;
+        Result result = {0, 0, 0, 0, 0, 0};
+        uint64_t start_ns;
+        uint64_t end_ns;
+        uint64_t start_bus_ns;
+        
+        setup(&device, rate, LIS3DH_FIFO_BYPASS, bit_rate, &result);
+        start_ns = mock_now_ns();
+        end_ns = start_ns + (uint64_t)(run_s*1e9);
+        start_bus_ns = mock_stats()->bus_busy_ns;
+        while (mock_now_ns() < end_ns)
+        {
+            uint8_t status;
+            int16_t raw[LIS3DH_AXES];
+            uint64_t read_ns;
+        
+            if (SensorBus_ReadRegister(MOCK_DEVICE_ADDRESS, LIS3DH_STATUS_REG, &status) != NO_ERROR)
+            {
+                result.errors++;
+                break;
+            }
+            if (!(status & LIS3DH_STATUS_ZYXDA))
+            {
+                continue;
+            }
+            read_ns = mock_now_ns();
+            if (LIS3DH_ReadSample(&device, raw) != NO_ERROR)
+            {
+                result.errors++;
+                break;
+            }
+            result.read_ns += mock_now_ns() - read_ns;
+            result.read++;
+            check_sample(&result, raw);
+        }
+        finish(&result, start_ns, start_bus_ns);
+        return result;
+    }
+    
+    static Result run_fifo(const BenchRate* rate, uint32_t bit_rate, double run_s)
+    {
+        LIS3DH_Device device;
+        Result result = {0, 0, 0, 0, 0, 0};
+        uint64_t drain_ns;
+        uint64_t next_ns;
+        uint64_t start_ns;
+        uint64_t end_ns;
+        uint64_t start_bus_ns;
+        
+        setup(&device, rate, LIS3DH_FIFO_STREAM, bit_rate, &result);
+        drain_ns = (uint64_t)BENCH_DRAIN_SAMPLES*1000000000u/rate->hz;
+        next_ns = mock_now_ns() + drain_ns;
+        start_ns = mock_now_ns();
+        end_ns = start_ns + (uint64_t)(run_s*1e9);
+        start_bus_ns = mock_stats()->bus_busy_ns;
+        while (mock_now_ns() < end_ns)
+        {
+            int16_t raw[LIS3DH_FIFO_DEPTH*LIS3DH_AXES];
+            uint8_t count;
+            uint8_t overrun;
+            uint64_t read_ns;
+            uint8_t i;
+        
+            if (mock_now_ns() < next_ns)
+            {
+                mock_wait_ns(next_ns - mock_now_ns());
+            }
+            next_ns += drain_ns;
+            read_ns = mock_now_ns();
+            if (LIS3DH_ReadFifo(&device, raw, LIS3DH_FIFO_DEPTH, &count, &overrun) != NO_ERROR)
+            {
+                result.errors++;
+                break;
+            }
+            result.read_ns += mock_now_ns() - read_ns;
+            result.read += count;
+            for (i = 0; i < count; i++)
+            {
+                check_sample(&result, &raw[i*LIS3DH_AXES]);
+            }
+        }
+        finish(&result, start_ns, start_bus_ns);
+        return result;
+    }
+    
+    static void print_result(const Result* result)
+    {
+        double run_s = result->run_ns/1e9;
+        
+        printf(" | %7.1f %7.1f %7.1f %5.1f%%", result->read/run_s, result->lost/run_s,
+               result->read ? result->read_ns/1000.0/result->read : 0.0,
+               100.0*result->bus_ns/result->run_ns);
+        if (result->errors > 0)
+        {
+            printf(" %u errors", result->errors);
+            failures++;
+        }
+    }
+
+int main(int argc, char** argv)
+{
+    uint32_t bit_rate = SENSOR_BUS_BIT_RATE;
+    double run_s = 10.0;
+    uint8_t i;
+    int opt;
+    
+    while ((opt = getopt(argc, argv, "r:c:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r':
+                bit_rate = (uint32_t)atol(optarg);
+                break;
+            case 'c':
+                mock_call_cycles = (uint32_t)atol(optarg);
+                break;
+            default:
+                bit_rate = 0;
+                break;
+        }
+    }
+    if (optind < argc)
+    {
+        run_s = atof(argv[optind]);
+    }
+    if (bit_rate == 0 || run_s <= 0.0)
+    {
+        fprintf(stderr, "usage: %s [-r bus bit/s] [-c cycles per API call] [seconds]\n", argv[0]);
+        return 1;
+    }
+    
+    printf("%s at %u bit/s, %u bus clock cycles per API call, %.0f s\n\n",
+           transport_names[SENSOR_BUS_TRANSPORT], bit_rate, mock_call_cycles, run_s);
+    printf("%10s | %-30s | %-30s\n", "", "poll", "fifo");
+    printf("%10s | %7s %7s %7s %6s | %7s %7s %7s %6s\n", "ODR Hz",
+           "read/s", "lost/s", "us/smp", "bus", "read/s", "lost/s", "us/smp", "bus");
+    for (i = 0; i < RATES; i++)
+    {
+        Result poll = run_poll(&rates[i], bit_rate, run_s);
+        Result fifo = run_fifo(&rates[i], bit_rate, run_s);
+        
+        printf("%6u%-4s", rates[i].hz,
+               rates[i].mode == LIS3DH_MODE_LOW_POWER ? " LP" : "");
+        print_result(&poll);
+        print_result(&fifo);
+        printf("\n");
+    }
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
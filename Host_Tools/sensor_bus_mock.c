@@ -0,0 +1,594 @@
+/**
+*   \file sensor_bus_mock.c
+*   \brief LIS3DH register file and models of the bus components, see
+*   sensor_bus_mock.h.
+*/
+
+#include <string.h>
+#include "sensor_bus_mock.h"
+#include "CyLib.h"
+#include "I2C_Master.h"
+#include "SPIM.h"
+#include "SPI_CS.h"
+#include "LIS3DH.h"
+#include "Timebase.h"
+
+/**
+*   \brief Registers of the device.
+*/
+#define MOCK_REGISTERS 0x40
+
+/**
+*   \brief Bytes of the RX FIFO of the SPIM component.
+*/
+#define MOCK_SPI_FIFO_DEPTH 4
+
+/**
+*   \brief Read, auto-increment and address fields of the first SPI byte.
+*/
+#define MOCK_SPI_READ 0x80
+#define MOCK_SPI_MS 0x40
+#define MOCK_SPI_ADDRESS_MASK 0x3F
+
+/**
+*   \brief Auto-increment flag of the I2C sub-address.
+*/
+#define MOCK_I2C_AUTO_INCREMENT 0x80
+
+/**
+*   \brief Watermark and empty flags of FIFO_SRC_REG.
+*/
+#define MOCK_FIFO_SRC_WTM 0x80
+#define MOCK_FIFO_SRC_EMPTY 0x20
+
+/**
+*   \brief Output data rates in Hz by ODR field, normal and low power.
+*/
+static const uint16_t odr_hz[2][10] = {
+    { 0, 1, 10, 25, 50, 100, 200, 400,    0, 1344 },
+    { 0, 1, 10, 25, 50, 100, 200, 400, 1600, 5376 }
+};
+
+uint32_t mock_call_cycles = MOCK_CALL_CYCLES;
+
+static uint64_t now_ns;
+static uint32_t bit_rate;
+static MockStats stats;
+
+// Device: registers, output data, FIFO and sample clock
+static uint8_t registers[MOCK_REGISTERS];
+static uint8_t output[LIS3DH_SAMPLE_BYTES];
+static uint8_t pending[LIS3DH_SAMPLE_BYTES];
+static uint8_t pending_valid;
+static uint8_t output_reading;
+static uint8_t fifo[LIS3DH_FIFO_DEPTH][LIS3DH_SAMPLE_BYTES];
+static uint8_t fifo_head;
+static uint8_t fifo_count;
+static uint8_t status;
+static uint16_t sample_number;
+static uint64_t next_sample_ns;
+static uint64_t sample_period_ns;
+
+// I2C transfer on the bus and status of the component
+static uint8_t i2c_active;
+static uint64_t i2c_end_ns;
+static uint8_t i2c_end_status;
+static uint8_t i2c_status;
+static uint8_t i2c_pointer;
+static uint8_t i2c_increment;
+
+// SPI line, RX FIFO and transaction of the chip select
+static uint64_t spi_line_free_ns;
+static uint64_t spi_rx_ready_ns[MOCK_SPI_FIFO_DEPTH];
+static uint8_t spi_rx_data[MOCK_SPI_FIFO_DEPTH];
+static uint8_t spi_rx_head;
+static uint8_t spi_rx_count;
+static uint8_t spi_selected;
+static uint8_t spi_first;
+static uint8_t spi_read;
+static uint8_t spi_increment;
+static uint8_t spi_pointer;
+
+    /*
+    *   Time of bits on the bus.
+    */
+    static uint64_t bits_ns(uint32_t bits)
+    {
+        return ((uint64_t)bits*1000000000u + bit_rate - 1)/bit_rate;
+    }
+    
+    /*
+    *   CPU time of a call to the API of a component.
+    */
+    static void api_call(void)
+    {
+        now_ns += (uint64_t)mock_call_cycles*1000000000u/BCLK__BUS_CLK__HZ;
+    }
+    
+    static uint8_t fifo_enabled(void)
+    {
+        return (registers[LIS3DH_CTRL_REG5] & LIS3DH_CTRL_REG5_FIFO_EN) &&
+               (registers[LIS3DH_FIFO_CTRL_REG] >> 6) != LIS3DH_FIFO_BYPASS;
+    }
+    
+    /*
+    *   Sample clock from the ODR field and LPen, the first sample one
+    *   period after the change.
+    */
+    static void restart_clock(void)
+    {
+        uint8_t odr = registers[LIS3DH_CTRL_REG1] >> 4;
+        uint8_t low_power = (registers[LIS3DH_CTRL_REG1] & LIS3DH_CTRL_REG1_LPEN) ? 1 : 0;
+        uint16_t hz = (odr < 10) ? odr_hz[low_power][odr] : 0;
+        
+        if (hz == 0)
+        {
+            sample_period_ns = 0;
+            next_sample_ns = UINT64_MAX;
+            return;
+        }
+        sample_period_ns = 1000000000u/hz;
+        next_sample_ns = now_ns + sample_period_ns;
+    }
+    
+    /*
+    *   A new sample in the output registers, or in the FIFO when enabled.
+    */
+    static void produce_sample(void)
+    {
+        uint16_t axes[LIS3DH_AXES];
+        uint8_t* slot = output;
+        uint8_t axis;
+        
+        axes[0] = sample_number;
+        axes[1] = (uint16_t)~sample_number;
+        axes[2] = sample_number ^ 0x5AA5;
+        sample_number++;
+        stats.produced++;
+        
+        if (fifo_enabled())
+        {
+            if (fifo_count == LIS3DH_FIFO_DEPTH)
+            {
+                stats.lost++;
+                if ((registers[LIS3DH_FIFO_CTRL_REG] >> 6) == LIS3DH_FIFO_FIFO)
+                {
+                    // FIFO mode stops collecting when full
+                    return;
+                }
+                fifo_head = (fifo_head + 1) % LIS3DH_FIFO_DEPTH;
+                fifo_count--;
+            }
+            slot = fifo[(fifo_head + fifo_count) % LIS3DH_FIFO_DEPTH];
+            fifo_count++;
+        }
+        else if (output_reading && (registers[LIS3DH_CTRL_REG4] & LIS3DH_CTRL_REG4_BDU))
+        {
+            // Block data update: held until OUT_Z_H is read
+            if (pending_valid)
+            {
+                stats.lost++;
+            }
+            pending_valid = 1;
+            slot = pending;
+        }
+        else
+        {
+            if (status & LIS3DH_STATUS_ZYXDA)
+            {
+                stats.lost++;
+                status |= LIS3DH_STATUS_ZYXOR;
+            }
+            status |= LIS3DH_STATUS_ZYXDA;
+        }
+        for (axis = 0; axis < LIS3DH_AXES; axis++)
+        {
+            slot[2*axis] = (uint8_t)axes[axis];
+            slot[2*axis + 1] = (uint8_t)(axes[axis] >> 8);
+        }
+    }
+    
+    /*
+    *   Samples of the device up to time t.
+    */
+    static void device_update(uint64_t t)
+    {
+        while (next_sample_ns <= t)
+        {
+            produce_sample();
+            next_sample_ns += sample_period_ns;
+        }
+    }
+    
+    /*
+    *   Read a register at time t, return the next address of an
+    *   auto-increment.
+    */
+    static uint8_t device_read(uint64_t t, uint8_t address, uint8_t* data)
+    {
+        uint8_t next = (address + 1) % MOCK_REGISTERS;
+        
+        device_update(t);
+        if (address >= LIS3DH_OUT_X_L && address < LIS3DH_OUT_X_L + LIS3DH_SAMPLE_BYTES)
+        {
+            uint8_t index = address - LIS3DH_OUT_X_L;
+            if (fifo_enabled())
+            {
+                // The oldest sample moves to the output registers when its
+                // read starts, so the FIFO cannot overwrite it
+                if (index == 0 && fifo_count > 0)
+                {
+                    memcpy(output, fifo[fifo_head], LIS3DH_SAMPLE_BYTES);
+                    fifo_head = (fifo_head + 1) % LIS3DH_FIFO_DEPTH;
+                    fifo_count--;
+                }
+                *data = output[index];
+                if (index == LIS3DH_SAMPLE_BYTES - 1)
+                {
+                    // The address rolls back to OUT_X_L
+                    next = LIS3DH_OUT_X_L;
+                }
+            }
+            else
+            {
+                *data = output[index];
+                output_reading = (index < LIS3DH_SAMPLE_BYTES - 1);
+                if (index == LIS3DH_SAMPLE_BYTES - 1)
+                {
+                    status &= (uint8_t)~(LIS3DH_STATUS_ZYXDA | LIS3DH_STATUS_ZYXOR);
+                    if (pending_valid)
+                    {
+                        memcpy(output, pending, LIS3DH_SAMPLE_BYTES);
+                        pending_valid = 0;
+                        status |= LIS3DH_STATUS_ZYXDA;
+                    }
+                }
+            }
+        }
+        else if (address == LIS3DH_STATUS_REG)
+        {
+            *data = status;
+        }
+        else if (address == LIS3DH_FIFO_SRC_REG)
+        {
+            uint8_t watermark = registers[LIS3DH_FIFO_CTRL_REG] & LIS3DH_FIFO_SRC_FSS;
+            *data = (uint8_t)(fifo_count & LIS3DH_FIFO_SRC_FSS);
+            if (fifo_count == LIS3DH_FIFO_DEPTH)
+            {
+                *data |= LIS3DH_FIFO_SRC_OVRN;
+            }
+            if (fifo_count == 0)
+            {
+                *data |= MOCK_FIFO_SRC_EMPTY;
+            }
+            if (fifo_count > watermark)
+            {
+                *data |= MOCK_FIFO_SRC_WTM;
+            }
+        }
+        else
+        {
+            *data = registers[address % MOCK_REGISTERS];
+        }
+        return next;
+    }
+    
+    /*
+    *   Write a register at time t, return the next address of an
+    *   auto-increment.
+    */
+    static uint8_t device_write(uint64_t t, uint8_t address, uint8_t data)
+    {
+        address %= MOCK_REGISTERS;
+        device_update(t);
+        if (address == LIS3DH_WHO_AM_I_REG_ADDR)
+        {
+            return (address + 1) % MOCK_REGISTERS;
+        }
+        registers[address] = data;
+        if (address == LIS3DH_CTRL_REG1)
+        {
+            restart_clock();
+        }
+        else if (address == LIS3DH_FIFO_CTRL_REG && (data >> 6) == LIS3DH_FIFO_BYPASS)
+        {
+            // Bypass mode resets the FIFO
+            fifo_head = 0;
+            fifo_count = 0;
+        }
+        return (address + 1) % MOCK_REGISTERS;
+    }
+
+void mock_init(uint32_t rate)
+{
+    now_ns = 0;
+    bit_rate = rate;
+    memset(&stats, 0, sizeof(stats));
+    
+    memset(registers, 0, sizeof(registers));
+    registers[LIS3DH_WHO_AM_I_REG_ADDR] = LIS3DH_WHO_AM_I;
+    // Power down, three axes enabled
+    registers[LIS3DH_CTRL_REG1] = 0x07;
+    memset(output, 0, sizeof(output));
+    pending_valid = 0;
+    output_reading = 0;
+    fifo_head = 0;
+    fifo_count = 0;
+    status = 0;
+    sample_number = 0;
+    restart_clock();
+    
+    i2c_active = 0;
+    i2c_status = 0;
+    i2c_pointer = 0;
+    i2c_increment = 0;
+    spi_line_free_ns = 0;
+    spi_rx_head = 0;
+    spi_rx_count = 0;
+    spi_selected = 0;
+}
+
+uint64_t mock_now_ns(void)
+{
+    return now_ns;
+}
+
+void mock_wait_ns(uint64_t ns)
+{
+    now_ns += ns;
+}
+
+const MockStats* mock_stats(void)
+{
+    return &stats;
+}
+
+/*
+*   Firmware interfaces used by I2C_Interface.c, SPI_Interface.c and
+*   LIS3DH.c.
+*/
+uint8 CyEnterCriticalSection(void)
+{
+    return 0;
+}
+
+void CyExitCriticalSection(uint8 savedIntrStatus)
+{
+    (void)savedIntrStatus;
+}
+
+uint32_t Timebase_GetMs(void)
+{
+    return (uint32_t)(now_ns/1000000u);
+}
+
+/*
+*   I2C_Master component. A transfer does its work on the device at the
+*   time of each byte and ends at i2c_end_ns.
+*/
+void I2C_Master_Start(void)
+{
+}
+
+void I2C_Master_Stop(void)
+{
+}
+
+uint8 I2C_Master_MasterWriteBuf(uint8 slaveAddress, uint8* wrData, uint8 cnt, uint8 mode)
+{
+    uint64_t t = now_ns;
+    uint8 i;
+    
+    api_call();
+    if (i2c_active)
+    {
+        return I2C_Master_MSTR_BUS_BUSY;
+    }
+    i2c_active = 1;
+    i2c_status = I2C_Master_MSTAT_XFER_INP;
+    stats.transactions++;
+    // Start and slave address
+    t += bits_ns(1u + 9u);
+    if (slaveAddress != MOCK_DEVICE_ADDRESS)
+    {
+        i2c_end_ns = t + bits_ns(1u);
+        i2c_end_status = I2C_Master_MSTAT_ERR_XFER | I2C_Master_MSTAT_ERR_ADDR_NAK;
+        stats.bus_busy_ns += i2c_end_ns - now_ns;
+        return I2C_Master_MSTR_NO_ERROR;
+    }
+    for (i = 0; i < cnt; i++)
+    {
+        t += bits_ns(9u);
+        if (i == 0)
+        {
+            i2c_pointer = wrData[0] & (uint8)~MOCK_I2C_AUTO_INCREMENT;
+            i2c_increment = wrData[0] & MOCK_I2C_AUTO_INCREMENT;
+        }
+        else
+        {
+            uint8_t next = device_write(t, i2c_pointer, wrData[i]);
+            if (i2c_increment)
+            {
+                i2c_pointer = next;
+            }
+        }
+    }
+    i2c_end_ns = t + (mode == I2C_Master_MODE_NO_STOP ? 0 : bits_ns(1u));
+    i2c_end_status = I2C_Master_MSTAT_WR_CMPLT;
+    stats.bus_busy_ns += i2c_end_ns - now_ns;
+    return I2C_Master_MSTR_NO_ERROR;
+}
+
+uint8 I2C_Master_MasterReadBuf(uint8 slaveAddress, uint8* rdData, uint8 cnt, uint8 mode)
+{
+    uint64_t t = now_ns;
+    uint8 i;
+    
+    api_call();
+    (void)mode;
+    if (i2c_active)
+    {
+        return I2C_Master_MSTR_BUS_BUSY;
+    }
+    i2c_active = 1;
+    i2c_status = I2C_Master_MSTAT_XFER_INP;
+    // Start or restart and slave address
+    t += bits_ns(1u + 9u);
+    if (slaveAddress != MOCK_DEVICE_ADDRESS)
+    {
+        i2c_end_ns = t + bits_ns(1u);
+        i2c_end_status = I2C_Master_MSTAT_ERR_XFER | I2C_Master_MSTAT_ERR_ADDR_NAK;
+        stats.bus_busy_ns += i2c_end_ns - now_ns;
+        return I2C_Master_MSTR_NO_ERROR;
+    }
+    for (i = 0; i < cnt; i++)
+    {
+        uint8_t next;
+        t += bits_ns(9u);
+        next = device_read(t, i2c_pointer, &rdData[i]);
+        if (i2c_increment)
+        {
+            i2c_pointer = next;
+        }
+    }
+    i2c_end_ns = t + bits_ns(1u);
+    i2c_end_status = I2C_Master_MSTAT_RD_CMPLT;
+    stats.bus_busy_ns += i2c_end_ns - now_ns;
+    return I2C_Master_MSTR_NO_ERROR;
+}
+
+uint8 I2C_Master_MasterStatus(void)
+{
+    api_call();
+    if (i2c_active)
+    {
+        // The CPU polls until the end of the transfer
+        if (now_ns < i2c_end_ns)
+        {
+            now_ns = i2c_end_ns;
+        }
+        i2c_active = 0;
+        i2c_status = i2c_end_status;
+    }
+    return i2c_status;
+}
+
+uint8 I2C_Master_MasterClearStatus(void)
+{
+    uint8 previous = i2c_status;
+    api_call();
+    i2c_status &= (uint8)~(I2C_Master_MSTAT_RD_CMPLT | I2C_Master_MSTAT_WR_CMPLT |
+                           I2C_Master_MSTAT_ERR_XFER | I2C_Master_MSTAT_ERR_ADDR_NAK);
+    return previous;
+}
+
+/*
+*   SPIM component and chip select. A byte does its work on the device at
+*   the start of its time on the line.
+*/
+void SPIM_Start(void)
+{
+}
+
+void SPIM_Stop(void)
+{
+}
+
+void SPI_CS_Write(uint8 value)
+{
+    api_call();
+    if (value == 0 && !spi_selected)
+    {
+        spi_selected = 1;
+        spi_first = 1;
+        stats.transactions++;
+    }
+    else if (value != 0)
+    {
+        spi_selected = 0;
+    }
+}
+
+uint8 SPIM_ReadTxStatus(void)
+{
+    // SPI_Interface.c keeps at most the depth of the FIFOs on the line
+    api_call();
+    return SPIM_STS_TX_FIFO_NOT_FULL;
+}
+
+void SPIM_WriteTxData(uint8 txData)
+{
+    uint64_t start;
+    uint8_t rx = 0xFF;
+    
+    api_call();
+    start = (spi_line_free_ns > now_ns) ? spi_line_free_ns : now_ns;
+    spi_line_free_ns = start + bits_ns(8u);
+    stats.bus_busy_ns += bits_ns(8u);
+    
+    if (spi_selected && spi_first)
+    {
+        spi_first = 0;
+        spi_read = txData & MOCK_SPI_READ;
+        spi_increment = txData & MOCK_SPI_MS;
+        spi_pointer = txData & MOCK_SPI_ADDRESS_MASK;
+    }
+    else if (spi_selected)
+    {
+        uint8_t next = spi_read ? device_read(start, spi_pointer, &rx)
+                                : device_write(start, spi_pointer, txData);
+        if (spi_increment)
+        {
+            spi_pointer = next;
+        }
+    }
+    
+    if (spi_rx_count < MOCK_SPI_FIFO_DEPTH)
+    {
+        uint8_t slot = (spi_rx_head + spi_rx_count) % MOCK_SPI_FIFO_DEPTH;
+        spi_rx_ready_ns[slot] = spi_line_free_ns;
+        spi_rx_data[slot] = rx;
+        spi_rx_count++;
+    }
+}
+
+uint8 SPIM_GetRxBufferSize(void)
+{
+    uint8 size = 0;
+    
+    api_call();
+    if (spi_rx_count > 0 && spi_rx_ready_ns[spi_rx_head] > now_ns)
+    {
+        // The CPU polls until the byte on the line is in
+        now_ns = spi_rx_ready_ns[spi_rx_head];
+    }
+    while (size < spi_rx_count &&
+           spi_rx_ready_ns[(spi_rx_head + size) % MOCK_SPI_FIFO_DEPTH] <= now_ns)
+    {
+        size++;
+    }
+    return size;
+}
+
+uint8 SPIM_ReadRxData(void)
+{
+    uint8 data = 0;
+    
+    api_call();
+    if (spi_rx_count > 0)
+    {
+        data = spi_rx_data[spi_rx_head];
+        spi_rx_head = (spi_rx_head + 1) % MOCK_SPI_FIFO_DEPTH;
+        spi_rx_count--;
+    }
+    return data;
+}
+
+void SPIM_ClearRxBuffer(void)
+{
+    api_call();
+    spi_rx_head = 0;
+    spi_rx_count = 0;
+}
+
+/* [] END OF FILE */
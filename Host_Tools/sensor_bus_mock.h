@@ -0,0 +1,92 @@
+/**
+*   \file sensor_bus_mock.h
+*   \brief Mock of the sensor bus of the PROJ_3 board on the host: a
+*   LIS3DH register file behind models of the I2C_Master and SPIM
+*   components.
+*
+*   The firmware I2C_Interface.c and SPI_Interface.c build unchanged over
+*   the models (psoc_stubs/I2C_Master.h, SPIM.h, SPI_CS.h), and so does
+*   everything above SensorBus_*, LIS3DH.c first. Time is simulated:
+*   - each call to the API of a component costs mock_call_cycles of the
+*     bus clock (BCLK__BUS_CLK__HZ);
+*   - an I2C transfer takes 9 bit times per byte, slave address included,
+*     plus the start and the stop; the transfer runs in the background and
+*     I2C_Master_MasterStatus() waits for its end, as the blocking loop of
+*     I2C_Interface.c does when it polls. The interrupt of the component is
+*     not modelled, the polls move the transfers on;
+*   - an SPI byte takes 8 bit times and the next byte written to the TX
+*     FIFO starts as soon as the line is free; SPIM_GetRxBufferSize()
+*     waits for the byte on the line when the RX FIFO is empty.
+*
+*   The LIS3DH answers at address 0x18 (SDO high) over I2C and whenever
+*   its chip select is low over SPI. WHO_AM_I, CTRL_REG1, CTRL_REG4,
+*   CTRL_REG5, STATUS_REG, the output registers, FIFO_CTRL_REG and
+*   FIFO_SRC_REG behave as in the datasheet: samples at the output data
+*   rate of CTRL_REG1 (LPen selects the low power rates), the 32-sample
+*   FIFO in FIFO and stream mode, ZYXDA, ZYXOR and the block data update
+*   (BDU) of CTRL_REG4 in bypass mode, the address auto-increment (MSB of
+*   the sub-address over I2C, MS bit over SPI) and its roll-back from
+*   OUT_Z_H to OUT_X_L with the FIFO enabled. The other registers read
+*   back what was written.
+*
+*   Every sample carries its number n: X = n, Y = ~n, Z = n ^ 0x5AA5 (16
+*   bits each), so that a reader can check that it gets whole samples, in
+*   order, and count the samples it missed.
+*
+*   Build with the tools that use it, e.g.
+*       cc -O2 -Ipsoc_stubs -I../AY1920_II_HW_05_PROJ_3.cydsn -o sensor_bus_bench sensor_bus_bench.c sensor_bus_mock.c ../AY1920_II_HW_05_PROJ_3.cydsn/LIS3DH.c ../AY1920_II_HW_05_PROJ_3.cydsn/I2C_Interface.c
+*/
+
+#ifndef __SENSOR_BUS_MOCK_H
+    #define __SENSOR_BUS_MOCK_H
+    
+    #include <stdint.h>
+    
+    /**
+    *   \brief Bus address of the LIS3DH (SDO high).
+    */
+    #define MOCK_DEVICE_ADDRESS 0x18
+    
+    /**
+    *   \brief Default cost of a call to the API of a component, in cycles
+    *   of the bus clock: call, register access and return.
+    */
+    #define MOCK_CALL_CYCLES 20u
+    
+    /**
+    *   \brief Counters of the mock since mock_init().
+    */
+    typedef struct {
+        uint64_t bus_busy_ns;       ///< Time the bus lines have been busy
+        uint32_t transactions;      ///< Transfers (I2C) or chip select periods (SPI)
+        uint32_t produced;          ///< Samples produced by the device
+        uint32_t lost;              ///< Samples overwritten before being read
+    } MockStats;
+    
+    /**
+    *   \brief Cost of a call to the API of a component, in bus clock cycles.
+    */
+    extern uint32_t mock_call_cycles;
+    
+    /**
+    *   \brief Reset the device and the time, set the rate of the bus.
+    */
+    void mock_init(uint32_t bit_rate);
+    
+    /**
+    *   \brief Simulated time since mock_init(), in ns.
+    */
+    uint64_t mock_now_ns(void);
+    
+    /**
+    *   \brief Let the CPU run for a while away from the bus.
+    */
+    void mock_wait_ns(uint64_t ns);
+    
+    /**
+    *   \brief Counters of the mock.
+    */
+    const MockStats* mock_stats(void);
+
+#endif // __SENSOR_BUS_MOCK_H
+/* [] END OF FILE */
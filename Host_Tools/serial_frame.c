@@ -0,0 +1,126 @@
+/**
+*   \file serial_frame.c
+*   \brief Serial port and framing helpers, see serial_frame.h.
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "serial_frame.h"
+
+    /*
+    *   Add a byte to the CRC.
+    */
+    static uint16_t serial_crc16_update(uint16_t crc, uint8_t byte)
+    {
+        crc ^= (uint16_t)byte << 8;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+        return crc;
+    }
+    
+    uint16_t serial_crc16(const uint8_t* data, size_t length)
+    {
+        uint16_t crc = 0xFFFF;
+        while (length--)
+        {
+            crc = serial_crc16_update(crc, *data++);
+        }
+        return crc;
+    }
+    
+    uint16_t serial_get16(const uint8_t* p)
+    {
+        return (uint16_t)(p[0] | p[1] << 8);
+    }
+    
+    uint32_t serial_get32(const uint8_t* p)
+    {
+        return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    }
+    
+    int serial_frame_is_header(uint8_t header)
+    {
+        // 0xA2 to 0xAF and 0xB1 to 0xB7 (Frame.h)
+        return (header >= 0xA2 && header <= 0xAF) || (header >= 0xB1 && header <= 0xB7);
+    }
+    
+    long serial_frame_length(const uint8_t* p, size_t available)
+    {
+        uint16_t crc = 0xFFFF;
+        size_t length;
+        
+        if (available == 0)
+        {
+            return 0;
+        }
+        if (!serial_frame_is_header(p[0]))
+        {
+            return -1;
+        }
+        // CRC of the header and payload before each candidate end
+        for (length = 4; length <= SERIAL_FRAME_MAX; length++)
+        {
+            if (length > available)
+            {
+                return 0;
+            }
+            crc = serial_crc16_update(crc, p[length - 4]);
+            if (p[length - 1] == SERIAL_FRAME_FOOTER &&
+                p[length - 3] == (crc & 0xFF) && p[length - 2] == (crc >> 8))
+            {
+                return (long)length;
+            }
+        }
+        return -1;
+    }
+    
+    speed_t serial_baud(long rate)
+    {
+        switch (rate)
+        {
+            case 9600: return B9600;
+            case 19200: return B19200;
+            case 38400: return B38400;
+            case 57600: return B57600;
+            case 115200: return B115200;
+            case 230400: return B230400;
+    #ifdef B460800
+            case 460800: return B460800;
+    #endif
+    #ifdef B921600
+            case 921600: return B921600;
+    #endif
+            default: return 0;
+        }
+    }
+    
+    int serial_open(const char* path, int flags, speed_t baud, uint8_t vmin)
+    {
+        if (strcmp(path, "-") == 0)
+        {
+            return STDIN_FILENO;
+        }
+        int fd = open(path, flags | O_NOCTTY);
+        if (fd < 0)
+        {
+            perror(path);
+            return -1;
+        }
+        struct termios tio;
+        if (tcgetattr(fd, &tio) == 0)
+        {
+            cfmakeraw(&tio);
+            cfsetispeed(&tio, baud);
+            cfsetospeed(&tio, baud);
+            tio.c_cc[VMIN] = vmin;
+            tio.c_cc[VTIME] = 0;
+            tcsetattr(fd, TCSANOW, &tio);
+        }
+        return fd;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,90 @@
+/**
+*   \file serial_frame.h
+*   \brief Serial port and framing helpers shared by the host tools of the
+*   PROJ_3 firmware.
+*
+*   The firmware sends its variable length packets as
+*
+*       header | payload | CRC-16 (LSB first) | footer
+*
+*   (Frame.h), with the CRC of CRC.c over header and payload, and all the
+*   fields little endian. The tools read them from the serial port of
+*   UART_Debug, 19200 baud in the TopDesign.
+*
+*   Build with the tools that use it, e.g.
+*       cc -O2 -o telemetry_dashboard telemetry_dashboard.c serial_frame.c
+*/
+
+#ifndef __SERIAL_FRAME_H
+    #define __SERIAL_FRAME_H
+    
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <termios.h>
+    
+    /**
+    *   \brief Rate of UART_Debug in the TopDesign (FRAME_UART_BAUD).
+    */
+    #define SERIAL_DEFAULT_BAUD B19200
+    
+    /**
+    *   \brief Footer of the framed packets (FRAME_FOOTER).
+    */
+    #define SERIAL_FRAME_FOOTER 0xC0
+    
+    /**
+    *   \brief Longest framed packet: header, 255 bytes of payload, CRC and
+    *   footer.
+    */
+    #define SERIAL_FRAME_MAX 259u
+    
+    /**
+    *   \brief Same CRC-16 as CRC16_Update() in the firmware, from CRC16_INIT.
+    */
+    uint16_t serial_crc16(const uint8_t* data, size_t length);
+    
+    /**
+    *   \brief Little endian 16-bit field.
+    */
+    uint16_t serial_get16(const uint8_t* p);
+    
+    /**
+    *   \brief Little endian 32-bit field.
+    */
+    uint32_t serial_get32(const uint8_t* p);
+    
+    /**
+    *   \brief Whether the byte is the header of a framed packet, i.e. of one
+    *   of the FRAME_HEADER_* packets of Frame.h. The fixed 0xA0 packet of
+    *   the firmware profile is not framed and is not one of them.
+    */
+    int serial_frame_is_header(uint8_t header);
+    
+    /**
+    *   \brief Length of the framed packet at the start of the bytes.
+    *
+    *   The payload length is not sent, so the packet ends at the first
+    *   footer preceded by the CRC of the bytes before it.
+    *   \retval Returns the length, 0 if more bytes are needed to know it,
+    *   -1 if the bytes do not start with a framed packet.
+    */
+    long serial_frame_length(const uint8_t* p, size_t available);
+    
+    /**
+    *   \brief Constant of a baud rate for termios, 0 if not supported.
+    */
+    speed_t serial_baud(long rate);
+    
+    /**
+    *   \brief Open a port in raw mode at the given rate.
+    *
+    *   "-" is the standard input. A file or FIFO, which is not a terminal,
+    *   is read as it is.
+    *   \param flags Flags of open(), O_NOCTTY is added.
+    *   \param vmin Bytes a blocking read waits for, 0 to return at once.
+    *   \retval Returns the descriptor, -1 after printing the error.
+    */
+    int serial_open(const char* path, int flags, speed_t baud, uint8_t vmin);
+
+#endif // __SERIAL_FRAME_H
+/* [] END OF FILE */
@@ -0,0 +1,1244 @@
+/**
+*   \file stream_aggregator.c
+*   \brief Linux daemon merging the sample streams of several PROJ_3 boards.
+*
+*   Every board streams on its own serial port (or pty). The main thread
+*   waits on all the ports with epoll and hands the bytes read, stamped
+*   with their arrival time, to a pool of decoding workers. The bytes of a
+*   port always go to the same worker, so that its frames are decoded in
+*   order without locks on the parser. The sample frames recognized are:
+*   - 0xA0 packets of the firmware profile, 8 bytes (mg) or 14 bytes
+*     (mm/s^2, see FirmwareProfile.h), numbered by the aggregator;
+*   - 0xA7 frames tagged with the rate (AdaptiveRate.h);
+*   - 0xAA frames of each device of a sensor array (SensorArray.h);
+*   - 0xB2 frames of each multi-rate channel (MultiRate.h).
+*   Each device or channel of a port is a stream of its own. The other
+*   framed packets of Frame.h are recognized by their CRC and skipped
+*   whole; a byte is taken as the start of a 0xA0 packet, which has no
+*   CRC, only outside of them.
+*
+*   Alignment of the streams:
+*   - time (default): every period a record takes from each stream its
+*     newest sample older than the record time, which lags the clock by the
+*     delay so that the late bytes of a serial adapter are waited for. The
+*     samples of a burst are spread back from the arrival of the burst by
+*     the mean interval of the stream;
+*   - sequence: record n takes the sample n of each stream, counted from
+*     its first sample, for boards started together. The gaps of the
+*     sequence numbers of the frames are kept, so that a lost frame does
+*     not shift the stream. A stream too far behind the others is marked
+*     invalid in the records it misses;
+*   - resample: the clock of each stream is estimated from the sequence
+*     numbers and the arrival times of its samples (clock_drift.h), and
+*     every period a record takes the value of each stream interpolated at
+*     the record time by a windowed-sinc filter, for boards whose sample
+*     clocks drift apart over a long recording. The delay must cover half
+*     the filter (DRIFT_TAPS/2 samples) on top of the latency of the
+*     adapters, 200 ms by default in this alignment.
+*
+*   The records are published on a local SOCK_SEQPACKET socket, one record
+*   per message (a slow client loses records, it never blocks the others),
+*   and optionally in a shared memory ring. Record layout (host order):
+*
+*       uint16 size | uint16 streams | uint32 index | uint64 time_ns
+*       then for each stream: uint8 port | uint8 header | uint8 channel |
+*       uint8 valid | uint32 sample number | int32 age_us | int32 x, y, z
+*
+*   where time_ns is CLOCK_MONOTONIC and x, y, z are in the unit of the
+*   frame (mm/s^2 for the 14-byte 0xA0 packets, mg for the others); in
+*   resample alignment they are the interpolated values rounded, and the
+*   number and age are those of the last sample before time_ns. The
+*   shared memory ring starts with the header described by RingHeader and
+*   holds RING_SLOTS slots of RING_SLOT_SIZE bytes: a reader takes the slot
+*   (count - 1) % RING_SLOTS and checks that count has not moved by a full
+*   lap while it was copying.
+*
+*   Throughput per port and stream and for the whole aggregator, and the
+*   estimated rate and drift of each stream, are written on stderr at each
+*   report period. The drift is from the nominal rate given, or else from
+*   the nearest output data rate of the LIS3DH.
+*
+*   Usage:
+*       stream_aggregator [options] <port> [<port> ...]
+*           -w workers      decoding threads (default 2)
+*           -a time|seq|resample  alignment (default time)
+*           -p period_ms    period of the records in time and resample alignment (default 10)
+*           -d delay_ms     lag of the records in time and resample alignment (default 50, 200)
+*           -s path         socket of the records (default /tmp/proj3_aggregator.sock)
+*           -m name         shared memory ring, e.g. /proj3_aggregator (default none)
+*           -k bytes        size of the 0xA0 packets, 8 or 14 (default 14)
+*           -b baud         rate of the serial ports (default 19200, UART_Debug in the TopDesign)
+*           -r seconds      report period, 0 for none (default 1)
+*           -n rate_hz      nominal rate of the streams, for the drift (default none)
+*
+*   Build on Linux with:
+*       cc -O2 -pthread -o stream_aggregator stream_aggregator.c clock_drift.c serial_frame.c -lrt -lm
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "clock_drift.h"
+#include "serial_frame.h"
+
+/**
+*   \brief Values shared with the firmware (Frame.h, FirmwareProfile.h).
+*/
+#define FIRMWARE_PACKET_HEADER 0xA0
+#define FRAME_HEADER_TAGGED_DATA 0xA7
+#define FRAME_HEADER_DEVICE_DATA 0xAA
+#define FRAME_HEADER_CHANNEL_DATA 0xB2
+#define FRAME_FOOTER 0xC0
+#define TAGGED_PAYLOAD 11
+#define CHANNEL_PAYLOAD 11
+#define DEVICE_MAX_SAMPLES 32
+#define AXES 3
+
+/**
+*   \brief Alignments of the streams.
+*/
+#define ALIGN_TIME 0
+#define ALIGN_SEQUENCE 1
+#define ALIGN_RESAMPLE 2
+
+#define MAX_PORTS 32
+#define MAX_STREAMS 16
+#define MAX_WORKERS 16
+
+/**
+*   \brief Bytes read from a port at once.
+*/
+#define CHUNK_SIZE 1024
+
+/**
+*   \brief Bytes kept by a parser, enough for a partial frame and a chunk.
+*/
+#define PARSER_SIZE (2*CHUNK_SIZE)
+
+/**
+*   \brief Samples kept by each stream for the alignment, power of 2.
+*/
+#define STREAM_HISTORY 1024
+
+/**
+*   \brief Samples of a chunk decoded before they are handed to the streams.
+*/
+#define BATCH_SAMPLES 512
+
+/**
+*   \brief Samples a stream can lag the leader in sequence alignment before
+*   its records are emitted without it.
+*/
+#define SEQUENCE_WINDOW (STREAM_HISTORY/2)
+
+/**
+*   \brief Bytes of the record header and of each stream of a record.
+*/
+#define RECORD_HEADER_SIZE 16
+#define RECORD_STREAM_SIZE 24
+#define RECORD_MAX_SIZE (RECORD_HEADER_SIZE + MAX_STREAMS*RECORD_STREAM_SIZE)
+
+/**
+*   \brief Shared memory ring.
+*/
+#define RING_MAGIC 0x47413350u      // "P3AG"
+#define RING_SLOTS 4096u
+#define RING_SLOT_SIZE RECORD_MAX_SIZE
+
+/**
+*   \brief Header of the shared memory ring, followed by the slots.
+*/
+typedef struct {
+    uint32_t magic;
+    uint32_t slot_size;
+    uint32_t slots;
+    uint32_t reserved;
+    uint64_t count;                 ///< Records written, updated after the slot
+} RingHeader;
+
+/**
+*   \brief Bytes read from a port, with the time they arrived.
+*/
+typedef struct Chunk {
+    struct Chunk* next;
+    int port;
+    uint64_t arrival_ns;
+    size_t length;
+    uint8_t data[CHUNK_SIZE];
+} Chunk;
+
+/**
+*   \brief Work queue of a decoding worker.
+*/
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    Chunk* head;
+    Chunk* tail;
+    size_t depth;
+    size_t max_depth;               ///< Deepest queue since the last report
+    int stop;
+} Worker;
+
+/**
+*   \brief Sample decoded from a frame.
+*/
+typedef struct {
+    uint8_t header;
+    uint8_t channel;
+    uint16_t sequence;              ///< Sequence number of the frame
+    uint8_t has_sequence;
+    uint8_t first_of_frame;
+    uint8_t frame_samples;          ///< Samples of the frame
+    int32_t xyz[AXES];
+} Decoded;
+
+/**
+*   \brief Sample of a stream.
+*/
+typedef struct {
+    uint64_t time_ns;
+    uint32_t number;
+    int32_t xyz[AXES];
+} Sample;
+
+/**
+*   \brief Samples of one device or channel of a port.
+*/
+typedef struct {
+    int port;
+    uint8_t header;
+    uint8_t channel;
+    uint32_t next_number;           ///< Number of the next sample
+    uint16_t last_sequence;         ///< Sequence number of the last frame
+    uint8_t last_frame_samples;     ///< Samples of the last frame, for the gaps
+    int have_sequence;
+    double interval_ns;             ///< Mean time between two samples
+    uint64_t last_arrival_ns;
+    uint64_t last_time_ns;
+    uint32_t base;                  ///< Number of the sample of record 0, sequence alignment
+    uint64_t samples;               ///< Samples received
+    uint64_t lost;                  ///< Samples missing from the sequence numbers
+    uint64_t reported_samples;
+    Sample history[STREAM_HISTORY];
+    DriftEstimator drift;           ///< Clock of the stream
+    DriftResampler* resampler;      ///< Resample alignment, from the first fit of the clock
+} Stream;
+
+/**
+*   \brief Serial port and its frame parser.
+*/
+typedef struct {
+    const char* path;
+    int fd;
+    int open;
+    uint64_t bytes;                 ///< Written by the main thread
+    uint64_t reported_bytes;
+    uint8_t buffer[PARSER_SIZE];    ///< Owned by the worker of the port
+    size_t buffered;
+    uint32_t packet_number;         ///< Numbering of the 0xA0 packets
+    uint64_t frames;                ///< Counters of the worker, updated under streams_lock
+    uint64_t crc_errors;
+    uint64_t skipped;
+    uint64_t reported_frames;
+} Port;
+
+// Configuration
+static int worker_count = 2;
+static int align = ALIGN_TIME;
+static uint32_t period_ms = 10;
+static int32_t delay_ms = -1;
+static const char* socket_path = "/tmp/proj3_aggregator.sock";
+static const char* ring_name;
+static size_t packet_size = 14;
+static speed_t baud = SERIAL_DEFAULT_BAUD;
+static uint32_t report_s = 1;
+static double nominal_hz;
+
+static Port ports[MAX_PORTS];
+static int port_count;
+static Worker workers[MAX_WORKERS];
+
+// Streams, filled by the workers and read by the aligner
+static pthread_mutex_t streams_lock = PTHREAD_MUTEX_INITIALIZER;
+static Stream* streams[MAX_STREAMS];
+static int stream_count;
+static uint64_t streams_refused;
+
+// Wakes the main thread when samples arrive, sequence alignment only
+static int samples_event = -1;
+
+// Clients of the socket
+static int clients[64];
+static int client_count;
+static uint64_t client_drops;
+
+// Shared memory ring
+static RingHeader* ring;
+static size_t ring_size;
+
+// Records emitted
+static uint32_t record_index;
+static uint32_t sequence_next;
+static uint64_t reported_records;
+
+    static uint64_t now_ns(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec*1000000000u + (uint64_t)ts.tv_nsec;
+    }
+    
+    /*
+    *   Stream of a device or channel of a port, created at its first
+    *   sample. Called with streams_lock held.
+    */
+    static Stream* find_stream(int port, uint8_t header, uint8_t channel)
+    {
+        for (int i = 0; i < stream_count; i++)
+        {
+            Stream* stream = streams[i];
+            if (stream->port == port && stream->header == header && stream->channel == channel)
+            {
+                return stream;
+            }
+        }
+        if (stream_count == MAX_STREAMS)
+        {
+            streams_refused++;
+            return NULL;
+        }
+        Stream* stream = calloc(1, sizeof(Stream));
+        if (stream == NULL)
+        {
+            return NULL;
+        }
+        stream->port = port;
+        stream->header = header;
+        stream->channel = channel;
+        drift_init(&stream->drift, nominal_hz);
+        // A stream joining late starts at the current record
+        stream->base = (uint32_t)(0u - sequence_next);
+        streams[stream_count++] = stream;
+        return stream;
+    }
+    
+    /*
+    *   Length of the frame at the start of the bytes, 0 if more bytes are
+    *   needed to know it, -1 if the first byte does not start a frame.
+    *   The framed packets of every header are checked with their CRC and
+    *   taken whole, so that the bytes of their payload are never read as
+    *   the start of a 0xA0 packet, which has no CRC.
+    */
+    static long frame_length(const uint8_t* p, size_t available)
+    {
+        if (serial_frame_is_header(p[0]))
+        {
+            return serial_frame_length(p, available);
+        }
+        if (p[0] == FIRMWARE_PACKET_HEADER)
+        {
+            return (long)packet_size;
+        }
+        return -1;
+    }
+    
+    /*
+    *   Decode the samples of a frame. Returns the number of samples, 0 for
+    *   the frames without samples, -1 if the bytes are not a frame.
+    */
+    static int decode_frame(Port* port, const uint8_t* p, size_t length, Decoded* out, int room)
+    {
+        int count = 0;
+        
+        switch (p[0])
+        {
+            case FIRMWARE_PACKET_HEADER:
+                if (p[length - 1] != FRAME_FOOTER)
+                {
+                    return -1;
+                }
+                if (room < 1)
+                {
+                    return 0;
+                }
+                out[0].header = p[0];
+                out[0].channel = 0;
+                out[0].has_sequence = 1;
+                out[0].sequence = (uint16_t)port->packet_number++;
+                out[0].first_of_frame = 1;
+                out[0].frame_samples = 1;
+                for (int axis = 0; axis < AXES; axis++)
+                {
+                    out[0].xyz[axis] = (packet_size == 8) ? (int16_t)serial_get16(p + 1 + 2*axis)
+                                                              : (int32_t)serial_get32(p + 1 + 4*axis);
+                }
+                return 1;
+            case FRAME_HEADER_TAGGED_DATA:
+            case FRAME_HEADER_CHANNEL_DATA:
+                if (length != 1 + (p[0] == FRAME_HEADER_CHANNEL_DATA ? CHANNEL_PAYLOAD : TAGGED_PAYLOAD) + 3 ||
+                    room < 1)
+                {
+                    return 0;
+                }
+                // rate and decimation, or channel and decimation, then the sequence number
+                out[0].header = p[0];
+                out[0].channel = (p[0] == FRAME_HEADER_CHANNEL_DATA) ? p[1] : 0;
+                out[0].has_sequence = 1;
+                out[0].sequence = serial_get16(p + 4);
+                out[0].first_of_frame = 1;
+                out[0].frame_samples = 1;
+                for (int axis = 0; axis < AXES; axis++)
+                {
+                    out[0].xyz[axis] = (int16_t)serial_get16(p + 6 + 2*axis);
+                }
+                return 1;
+            case FRAME_HEADER_DEVICE_DATA:
+                // id, sequence number and count before the samples
+                if (length < 1 + 4 + 3 || p[4] > DEVICE_MAX_SAMPLES || length != 1 + 4 + 2*AXES*(size_t)p[4] + 3)
+                {
+                    return 0;
+                }
+                for (int i = 0; i < p[4] && count < room; i++, count++)
+                {
+                    out[count].header = p[0];
+                    out[count].channel = p[1];
+                    out[count].has_sequence = 1;
+                    out[count].sequence = serial_get16(p + 2);
+                    out[count].first_of_frame = (i == 0);
+                    out[count].frame_samples = p[4];
+                    for (int axis = 0; axis < AXES; axis++)
+                    {
+                        out[count].xyz[axis] = (int16_t)serial_get16(p + 5 + 2*(AXES*i + axis));
+                    }
+                }
+                return count;
+            default:
+                // Other framed packets, their CRC is already checked
+                return 0;
+        }
+    }
+    
+    /*
+    *   Number the samples of a stream from the sequence numbers of their
+    *   frames and spread the ones of a burst back from its arrival.
+    *   Called with streams_lock held.
+    */
+    static void add_samples(Stream* stream, const Decoded* decoded, int count, uint64_t arrival_ns)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        
+        // Mean interval from the arrivals of the bursts, smoothed
+        if (stream->last_arrival_ns != 0 && arrival_ns > stream->last_arrival_ns)
+        {
+            double interval = (double)(arrival_ns - stream->last_arrival_ns)/count;
+            stream->interval_ns = (stream->interval_ns == 0.0) ? interval
+                                  : stream->interval_ns + (interval - stream->interval_ns)/64.0;
+        }
+        stream->last_arrival_ns = arrival_ns;
+        
+        for (int i = 0; i < count; i++)
+        {
+            const Decoded* d = &decoded[i];
+            if (d->first_of_frame && d->has_sequence)
+            {
+                if (stream->have_sequence)
+                {
+                    uint16_t gap = (uint16_t)(d->sequence - stream->last_sequence - 1);
+                    // A jump backwards is a restart of the board, not a gap
+                    if (gap < 0x8000)
+                    {
+                        uint32_t missing = (uint32_t)gap*(stream->last_frame_samples ? stream->last_frame_samples : 1);
+                        stream->next_number += missing;
+                        stream->lost += missing;
+                    }
+                }
+                stream->last_sequence = d->sequence;
+                stream->last_frame_samples = d->frame_samples;
+                stream->have_sequence = 1;
+            }
+        
+            uint64_t behind = (uint64_t)((count - 1 - i)*stream->interval_ns);
+            uint64_t time_ns = arrival_ns > behind ? arrival_ns - behind : arrival_ns;
+            if (time_ns <= stream->last_time_ns)
+            {
+                time_ns = stream->last_time_ns + 1;
+            }
+            stream->last_time_ns = time_ns;
+        
+            Sample* sample = &stream->history[stream->next_number & (STREAM_HISTORY - 1)];
+            sample->time_ns = time_ns;
+            sample->number = stream->next_number++;
+            memcpy(sample->xyz, d->xyz, sizeof(sample->xyz));
+            stream->samples++;
+        
+            // The clock is fitted on the arrivals, the lower envelope of the sample times
+            drift_add(&stream->drift, sample->number, arrival_ns);
+            if (stream->resampler != NULL)
+            {
+                float xyz[DRIFT_AXES];
+                for (int axis = 0; axis < AXES; axis++)
+                {
+                    xyz[axis] = (float)d->xyz[axis];
+                }
+                resampler_push(stream->resampler, sample->number, xyz);
+            }
+        }
+        
+        if (align == ALIGN_RESAMPLE && stream->resampler == NULL && stream->drift.valid)
+        {
+            // The filter follows the lower of the record and stream rates
+            stream->resampler = malloc(sizeof(DriftResampler));
+            if (stream->resampler != NULL)
+            {
+                resampler_init(stream->resampler, 1000.0/period_ms/drift_rate_hz(&stream->drift));
+            }
+        }
+    }
+    
+    /*
+    *   Decode the frames of a chunk of bytes of a port and hand their
+    *   samples to the streams, those of each stream together.
+    */
+    static void parse_chunk(const Chunk* chunk)
+    {
+        Port* port = &ports[chunk->port];
+        Decoded decoded[BATCH_SAMPLES];
+        Decoded grouped[BATCH_SAMPLES];
+        int decoded_count = 0;
+        uint64_t frames = 0;
+        uint64_t crc_errors = 0;
+        uint64_t skipped = 0;
+        size_t position = 0;
+        
+        if (port->buffered + chunk->length > PARSER_SIZE)
+        {
+            // Cannot happen with frames shorter than a chunk, kept as a guard
+            skipped += port->buffered;
+            port->buffered = 0;
+        }
+        memcpy(port->buffer + port->buffered, chunk->data, chunk->length);
+        port->buffered += chunk->length;
+        
+        while (position < port->buffered && decoded_count < BATCH_SAMPLES - DEVICE_MAX_SAMPLES)
+        {
+            const uint8_t* p = port->buffer + position;
+            size_t available = port->buffered - position;
+            long length = frame_length(p, available);
+            if (length == 0 || (length > 0 && (size_t)length > available))
+            {
+                break;
+            }
+            int count = (length < 0) ? -1 : decode_frame(port, p, (size_t)length, decoded + decoded_count,
+                                                         BATCH_SAMPLES - decoded_count);
+            if (count < 0)
+            {
+                // Not a frame, or a header without a valid CRC: resynchronize on the next byte
+                crc_errors += serial_frame_is_header(p[0]);
+                skipped++;
+                position++;
+                continue;
+            }
+            frames++;
+            decoded_count += count;
+            position += (size_t)length;
+        }
+        memmove(port->buffer, port->buffer + position, port->buffered - position);
+        port->buffered -= position;
+        
+        pthread_mutex_lock(&streams_lock);
+        port->frames += frames;
+        port->crc_errors += crc_errors;
+        port->skipped += skipped;
+        for (int i = 0; i < decoded_count; i++)
+        {
+            int count = 0;
+            if (decoded[i].header == 0)
+            {
+                continue;
+            }
+            // The samples of the same stream, in order, the others are left for their turn
+            for (int j = i; j < decoded_count; j++)
+            {
+                if (decoded[j].header == decoded[i].header && decoded[j].channel == decoded[i].channel)
+                {
+                    grouped[count++] = decoded[j];
+                    if (j > i)
+                    {
+                        decoded[j].header = 0;
+                    }
+                }
+            }
+            Stream* stream = find_stream(chunk->port, decoded[i].header, decoded[i].channel);
+            if (stream != NULL)
+            {
+                add_samples(stream, grouped, count, chunk->arrival_ns);
+            }
+        }
+        pthread_mutex_unlock(&streams_lock);
+        
+        if (align == ALIGN_SEQUENCE && decoded_count > 0)
+        {
+            uint64_t one = 1;
+            if (write(samples_event, &one, sizeof(one)) < 0)
+            {
+                // The counter is full only if the main thread is stuck
+            }
+        }
+    }
+    
+    static void* worker_main(void* argument)
+    {
+        Worker* worker = argument;
+        
+        for (;;)
+        {
+            pthread_mutex_lock(&worker->lock);
+            while (worker->head == NULL && !worker->stop)
+            {
+                pthread_cond_wait(&worker->ready, &worker->lock);
+            }
+            Chunk* chunk = worker->head;
+            if (chunk == NULL)
+            {
+                pthread_mutex_unlock(&worker->lock);
+                return NULL;
+            }
+            worker->head = chunk->next;
+            if (worker->head == NULL)
+            {
+                worker->tail = NULL;
+            }
+            worker->depth--;
+            pthread_mutex_unlock(&worker->lock);
+        
+            parse_chunk(chunk);
+            free(chunk);
+        }
+    }
+    
+    static void worker_push(Worker* worker, Chunk* chunk)
+    {
+        chunk->next = NULL;
+        pthread_mutex_lock(&worker->lock);
+        if (worker->tail != NULL)
+        {
+            worker->tail->next = chunk;
+        }
+        else
+        {
+            worker->head = chunk;
+        }
+        worker->tail = chunk;
+        if (++worker->depth > worker->max_depth)
+        {
+            worker->max_depth = worker->depth;
+        }
+        pthread_cond_signal(&worker->ready);
+        pthread_mutex_unlock(&worker->lock);
+    }
+    
+    /*
+    *   Read the bytes available on a port and hand them to its worker.
+    */
+    static void read_port(int index, int epoll_fd)
+    {
+        Port* port = &ports[index];
+        
+        for (;;)
+        {
+            Chunk* chunk = malloc(sizeof(Chunk));
+            if (chunk == NULL)
+            {
+                return;
+            }
+            ssize_t n = read(port->fd, chunk->data, CHUNK_SIZE);
+            if (n <= 0)
+            {
+                free(chunk);
+                if (n == 0 || (errno != EAGAIN && errno != EINTR))
+                {
+                    // Board unplugged or pty closed by the other side
+                    fprintf(stderr, "%s: closed\n", port->path);
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, port->fd, NULL);
+                    close(port->fd);
+                    port->open = 0;
+                }
+                return;
+            }
+            chunk->port = index;
+            chunk->arrival_ns = now_ns();
+            chunk->length = (size_t)n;
+            port->bytes += (uint64_t)n;
+            worker_push(&workers[index % worker_count], chunk);
+            if (n < CHUNK_SIZE)
+            {
+                return;
+            }
+        }
+    }
+    
+    /*
+    *   Send a record to the clients and to the shared memory ring.
+    */
+    static void publish(const uint8_t* record, size_t size)
+    {
+        for (int i = 0; i < client_count; )
+        {
+            ssize_t sent = send(clients[i], record, size, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                client_drops++;
+            }
+            else if (sent < 0)
+            {
+                close(clients[i]);
+                clients[i] = clients[--client_count];
+                continue;
+            }
+            i++;
+        }
+        if (ring != NULL)
+        {
+            uint64_t count = ring->count;
+            uint8_t* slot = (uint8_t*)(ring + 1) + (count % RING_SLOTS)*RING_SLOT_SIZE;
+            memcpy(slot, record, size);
+            __atomic_store_n(&ring->count, count + 1, __ATOMIC_RELEASE);
+        }
+        record_index++;
+    }
+    
+    /*
+    *   Start a record of the given time with the streams known so far.
+    */
+    static uint8_t* record_start(uint8_t* record, uint64_t time_ns)
+    {
+        uint16_t size = (uint16_t)(RECORD_HEADER_SIZE + stream_count*RECORD_STREAM_SIZE);
+        uint16_t count = (uint16_t)stream_count;
+        memcpy(record, &size, 2);
+        memcpy(record + 2, &count, 2);
+        memcpy(record + 4, &record_index, 4);
+        memcpy(record + 8, &time_ns, 8);
+        return record + RECORD_HEADER_SIZE;
+    }
+    
+    static uint8_t* record_stream(uint8_t* p, const Stream* stream, const Sample* sample, int32_t age_us)
+    {
+        static const int32_t zero[AXES] = { 0 };
+        p[0] = (uint8_t)stream->port;
+        p[1] = stream->header;
+        p[2] = stream->channel;
+        p[3] = (sample != NULL);
+        memcpy(p + 4, sample ? &sample->number : &stream->next_number, 4);
+        memcpy(p + 8, &age_us, 4);
+        memcpy(p + 12, sample ? sample->xyz : zero, sizeof(zero));
+        return p + RECORD_STREAM_SIZE;
+    }
+    
+    /*
+    *   Time alignment: newest sample of each stream not later than the
+    *   record time. Called with streams_lock held.
+    */
+    static void emit_time_record(uint64_t time_ns)
+    {
+        uint8_t record[RECORD_MAX_SIZE];
+        uint8_t* p;
+        
+        if (stream_count == 0)
+        {
+            return;
+        }
+        p = record_start(record, time_ns);
+        
+        for (int i = 0; i < stream_count; i++)
+        {
+            Stream* stream = streams[i];
+            const Sample* found = NULL;
+            uint32_t kept = stream->next_number < STREAM_HISTORY ? stream->next_number : STREAM_HISTORY;
+            for (uint32_t k = 1; k <= kept; k++)
+            {
+                const Sample* sample = &stream->history[(stream->next_number - k) & (STREAM_HISTORY - 1)];
+                // Lost samples leave old entries in the history
+                if (sample->number != stream->next_number - k)
+                {
+                    continue;
+                }
+                if (sample->time_ns <= time_ns)
+                {
+                    found = sample;
+                    break;
+                }
+            }
+            // Older than a few intervals, the stream has stopped
+            double stale_ns = 4.0*stream->interval_ns + 1e6*period_ms;
+            if (found != NULL && (double)(time_ns - found->time_ns) > stale_ns)
+            {
+                found = NULL;
+            }
+            p = record_stream(p, stream, found, found ? (int32_t)((time_ns - found->time_ns)/1000u) : 0);
+        }
+        publish(record, (size_t)(p - record));
+    }
+    
+    /*
+    *   Resample alignment: value of each stream interpolated at the record
+    *   time from its estimated clock. Called with streams_lock held.
+    */
+    static void emit_resampled_record(uint64_t time_ns)
+    {
+        uint8_t record[RECORD_MAX_SIZE];
+        uint8_t* p;
+        
+        if (stream_count == 0)
+        {
+            return;
+        }
+        p = record_start(record, time_ns);
+        
+        for (int i = 0; i < stream_count; i++)
+        {
+            Stream* stream = streams[i];
+            Sample sample;
+            double number;
+            double sample_ns;
+            float xyz[DRIFT_AXES];
+            int valid = stream->resampler != NULL &&
+                        drift_position(&stream->drift, time_ns, &number) &&
+                        resampler_evaluate(stream->resampler, number, xyz);
+            int32_t age_us = 0;
+            if (valid)
+            {
+                sample.time_ns = time_ns;
+                sample.number = (uint32_t)(int64_t)floor(number);
+                for (int axis = 0; axis < AXES; axis++)
+                {
+                    sample.xyz[axis] = (int32_t)lrintf(xyz[axis]);
+                }
+                if (drift_time(&stream->drift, floor(number), &sample_ns))
+                {
+                    age_us = (int32_t)(((double)time_ns - sample_ns)/1000.0);
+                }
+            }
+            p = record_stream(p, stream, valid ? &sample : NULL, age_us);
+        }
+        publish(record, (size_t)(p - record));
+    }
+    
+    /*
+    *   LIS3DH output data rate nearest to a rate, for the drift of the
+    *   streams without a nominal rate.
+    */
+    static double nearest_rate(double rate)
+    {
+        static const double rates[] = { 1.0, 10.0, 25.0, 50.0, 100.0, 200.0, 400.0, 1344.0, 1600.0, 5376.0 };
+        double nearest = rates[0];
+        for (size_t i = 1; i < sizeof(rates)/sizeof(rates[0]); i++)
+        {
+            if (fabs(log(rates[i]/rate)) < fabs(log(nearest/rate)))
+            {
+                nearest = rates[i];
+            }
+        }
+        return nearest;
+    }
+    
+    /*
+    *   Sequence alignment: emit the records all the streams have reached,
+    *   or that the slowest stream has let fall behind by SEQUENCE_WINDOW.
+    *   Called with streams_lock held.
+    */
+    static void emit_sequence_records(void)
+    {
+        uint8_t record[RECORD_MAX_SIZE];
+        
+        while (stream_count > 0)
+        {
+            uint32_t lowest = UINT32_MAX;
+            uint32_t highest = 0;
+            for (int i = 0; i < stream_count; i++)
+            {
+                // Samples of the stream up to its base + reached - 1
+                uint32_t reached = streams[i]->next_number - streams[i]->base;
+                lowest = reached < lowest ? reached : lowest;
+                highest = reached > highest ? reached : highest;
+            }
+            if (lowest <= sequence_next && highest < sequence_next + SEQUENCE_WINDOW)
+            {
+                return;
+            }
+        
+            uint64_t newest = 0;
+            uint8_t* p = record_start(record, 0);
+            for (int i = 0; i < stream_count; i++)
+            {
+                Stream* stream = streams[i];
+                uint32_t number = stream->base + sequence_next;
+                const Sample* sample = &stream->history[number & (STREAM_HISTORY - 1)];
+                if (sample->number != number || (int32_t)(stream->next_number - number) <= 0 ||
+                    stream->next_number - number > STREAM_HISTORY)
+                {
+                    sample = NULL;
+                }
+                else if (sample->time_ns > newest)
+                {
+                    newest = sample->time_ns;
+                }
+                p = record_stream(p, stream, sample, 0);
+            }
+            // Time of the newest sample of the record, the age is from it
+            memcpy(record + 8, &newest, 8);
+            for (int i = 0; i < stream_count; i++)
+            {
+                uint8_t* entry = record + RECORD_HEADER_SIZE + i*RECORD_STREAM_SIZE;
+                if (entry[3])
+                {
+                    const Sample* sample = &streams[i]->history[(streams[i]->base + sequence_next) & (STREAM_HISTORY - 1)];
+                    int32_t age_us = (int32_t)((newest - sample->time_ns)/1000u);
+                    memcpy(entry + 8, &age_us, 4);
+                }
+            }
+            publish(record, (size_t)(p - record));
+            sequence_next++;
+        }
+    }
+    
+    static void report(double seconds)
+    {
+        uint64_t total_bytes = 0;
+        uint64_t total_samples = 0;
+        
+        pthread_mutex_lock(&streams_lock);
+        for (int i = 0; i < port_count; i++)
+        {
+            Port* port = &ports[i];
+            fprintf(stderr, "%-20s %s %9.0f B/s %8.1f frames/s, %llu crc errors, %llu bytes skipped\n",
+                    port->path, port->open ? "open  " : "closed",
+                    (port->bytes - port->reported_bytes)/seconds,
+                    (port->frames - port->reported_frames)/seconds,
+                    (unsigned long long)port->crc_errors, (unsigned long long)port->skipped);
+            total_bytes += port->bytes - port->reported_bytes;
+            port->reported_bytes = port->bytes;
+            port->reported_frames = port->frames;
+        }
+        for (int i = 0; i < stream_count; i++)
+        {
+            Stream* stream = streams[i];
+            double rate = stream->interval_ns > 0 ? 1e9/stream->interval_ns : 0.0;
+            fprintf(stderr, "  stream %2d: port %d header 0x%02X channel %u, %8.1f samples/s (mean %.2f Hz), %llu lost\n",
+                    i, stream->port, stream->header, stream->channel,
+                    (stream->samples - stream->reported_samples)/seconds, rate,
+                    (unsigned long long)stream->lost);
+            if (stream->drift.valid)
+            {
+                double estimated = drift_rate_hz(&stream->drift);
+                double nominal = nominal_hz > 0.0 ? nominal_hz : nearest_rate(estimated);
+                fprintf(stderr, "             clock %.4f Hz, %+8.1f ppm from %g Hz, jitter %.2f ms\n",
+                        estimated, (estimated/nominal - 1.0)*1e6, nominal, stream->drift.spread_ns/1e6);
+            }
+            total_samples += stream->samples - stream->reported_samples;
+            stream->reported_samples = stream->samples;
+        }
+        pthread_mutex_unlock(&streams_lock);
+        
+        size_t deepest = 0;
+        for (int i = 0; i < worker_count; i++)
+        {
+            pthread_mutex_lock(&workers[i].lock);
+            deepest = workers[i].max_depth > deepest ? workers[i].max_depth : deepest;
+            workers[i].max_depth = workers[i].depth;
+            pthread_mutex_unlock(&workers[i].lock);
+        }
+        fprintf(stderr, "aggregate: %9.0f B/s, %8.1f samples/s, %8.1f records/s, %d clients, "
+                        "%llu client drops, deepest worker queue %zu chunks\n",
+                total_bytes/seconds, total_samples/seconds, (record_index - reported_records)/seconds,
+                client_count, (unsigned long long)client_drops, deepest);
+        reported_records = record_index;
+    }
+    
+    static int open_ring(void)
+    {
+        int fd = shm_open(ring_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            perror(ring_name);
+            return -1;
+        }
+        ring_size = sizeof(RingHeader) + (size_t)RING_SLOTS*RING_SLOT_SIZE;
+        if (ftruncate(fd, (off_t)ring_size) != 0)
+        {
+            perror("ftruncate");
+            close(fd);
+            return -1;
+        }
+        ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (ring == MAP_FAILED)
+        {
+            perror("mmap");
+            ring = NULL;
+            return -1;
+        }
+        ring->slot_size = RING_SLOT_SIZE;
+        ring->slots = RING_SLOTS;
+        ring->count = 0;
+        __atomic_store_n(&ring->magic, RING_MAGIC, __ATOMIC_RELEASE);
+        return 0;
+    }
+    
+    static int open_socket(void)
+    {
+        struct sockaddr_un address;
+        int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0);
+        if (fd < 0)
+        {
+            perror("socket");
+            return -1;
+        }
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+        unlink(socket_path);
+        if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 8) != 0)
+        {
+            perror(socket_path);
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    
+    static int timer(uint64_t period_ns)
+    {
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        struct itimerspec spec;
+        spec.it_interval.tv_sec = (time_t)(period_ns/1000000000u);
+        spec.it_interval.tv_nsec = (long)(period_ns%1000000000u);
+        spec.it_value = spec.it_interval;
+        timerfd_settime(fd, 0, &spec, NULL);
+        return fd;
+    }
+    
+    static int usage(const char* name)
+    {
+        fprintf(stderr, "usage: %s [-w workers] [-a time|seq|resample] [-p period_ms] [-d delay_ms] [-s socket]\n"
+                        "          [-m shm_name] [-k 8|14] [-b baud] [-r seconds] [-n rate_hz] <port> [<port> ...]\n", name);
+        return 2;
+    }
+    
+int main(int argc, char** argv)
+{
+    int option;
+    while ((option = getopt(argc, argv, "w:a:p:d:s:m:k:b:r:n:")) != -1)
+    {
+        switch (option)
+        {
+            case 'w': worker_count = atoi(optarg); break;
+            case 'a':
+                align = (strcmp(optarg, "seq") == 0) ? ALIGN_SEQUENCE :
+                        (strcmp(optarg, "resample") == 0) ? ALIGN_RESAMPLE : ALIGN_TIME;
+                break;
+            case 'p': period_ms = (uint32_t)atoi(optarg); break;
+            case 'd': delay_ms = atoi(optarg); break;
+            case 's': socket_path = optarg; break;
+            case 'm': ring_name = optarg; break;
+            case 'k': packet_size = (size_t)atoi(optarg); break;
+            case 'b': baud = serial_baud(atol(optarg)); break;
+            case 'r': report_s = (uint32_t)atoi(optarg); break;
+            case 'n': nominal_hz = atof(optarg); break;
+            default: return usage(argv[0]);
+        }
+    }
+    if (optind >= argc || argc - optind > MAX_PORTS || worker_count < 1 || worker_count > MAX_WORKERS ||
+        period_ms == 0 || (packet_size != 8 && packet_size != 14) || baud == 0)
+    {
+        return usage(argv[0]);
+    }
+    if (delay_ms < 0)
+    {
+        delay_ms = (align == ALIGN_RESAMPLE) ? 200 : 50;
+    }
+    
+    int epoll_fd = epoll_create1(0);
+    struct epoll_event event;
+    
+    // Ports are tagged with their index, the other descriptors from MAX_PORTS
+    enum { TAG_LISTEN = MAX_PORTS, TAG_RECORD, TAG_REPORT, TAG_SAMPLES, TAG_SIGNAL };
+    for (int i = optind; i < argc; i++)
+    {
+        Port* port = &ports[port_count];
+        port->path = argv[i];
+        port->fd = serial_open(argv[i], O_RDWR | O_NONBLOCK, baud, 0);
+        if (port->fd < 0)
+        {
+            return 1;
+        }
+        port->open = 1;
+        event.events = EPOLLIN;
+        event.data.u32 = (uint32_t)port_count;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, port->fd, &event);
+        port_count++;
+    }
+    
+    int listen_fd = open_socket();
+    if (listen_fd < 0 || (ring_name != NULL && open_ring() != 0))
+    {
+        return 1;
+    }
+    event.events = EPOLLIN;
+    event.data.u32 = TAG_LISTEN;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    
+    int record_timer = -1;
+    if (align == ALIGN_SEQUENCE)
+    {
+        samples_event = eventfd(0, EFD_NONBLOCK);
+        event.data.u32 = TAG_SAMPLES;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, samples_event, &event);
+    }
+    else
+    {
+        record_timer = timer((uint64_t)period_ms*1000000u);
+        event.data.u32 = TAG_RECORD;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, record_timer, &event);
+    }
+    int report_timer = -1;
+    if (report_s > 0)
+    {
+        report_timer = timer((uint64_t)report_s*1000000000u);
+        event.data.u32 = TAG_REPORT;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, report_timer, &event);
+    }
+    
+    // Stopped cleanly on Ctrl-C or kill, so that the socket is removed
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK);
+    event.data.u32 = TAG_SIGNAL;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &event);
+    
+    for (int i = 0; i < worker_count; i++)
+    {
+        pthread_mutex_init(&workers[i].lock, NULL);
+        pthread_cond_init(&workers[i].ready, NULL);
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+    }
+    
+    int running = 1;
+    while (running)
+    {
+        struct epoll_event events[MAX_PORTS + 8];
+        int n = epoll_wait(epoll_fd, events, MAX_PORTS + 8, -1);
+        for (int i = 0; i < n; i++)
+        {
+            uint32_t tag = events[i].data.u32;
+            uint64_t expirations;
+        
+            if (tag < MAX_PORTS)
+            {
+                read_port((int)tag, epoll_fd);
+            }
+            else if (tag == TAG_LISTEN)
+            {
+                int client = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK);
+                if (client >= 0 && client_count < (int)(sizeof(clients)/sizeof(clients[0])))
+                {
+                    clients[client_count++] = client;
+                }
+                else if (client >= 0)
+                {
+                    close(client);
+                }
+            }
+            else if (tag == TAG_RECORD)
+            {
+                if (read(record_timer, &expirations, sizeof(expirations)) == sizeof(expirations))
+                {
+                    pthread_mutex_lock(&streams_lock);
+                    uint64_t time_ns = now_ns() - (uint64_t)delay_ms*1000000u;
+                    if (align == ALIGN_RESAMPLE)
+                    {
+                        emit_resampled_record(time_ns);
+                    }
+                    else
+                    {
+                        emit_time_record(time_ns);
+                    }
+                    pthread_mutex_unlock(&streams_lock);
+                }
+            }
+            else if (tag == TAG_SAMPLES)
+            {
+                if (read(samples_event, &expirations, sizeof(expirations)) == sizeof(expirations))
+                {
+                    pthread_mutex_lock(&streams_lock);
+                    emit_sequence_records();
+                    pthread_mutex_unlock(&streams_lock);
+                }
+            }
+            else if (tag == TAG_REPORT)
+            {
+                if (read(report_timer, &expirations, sizeof(expirations)) == sizeof(expirations))
+                {
+                    report((double)report_s*expirations);
+                }
+            }
+            else if (tag == TAG_SIGNAL)
+            {
+                running = 0;
+            }
+        }
+    }
+    
+    for (int i = 0; i < worker_count; i++)
+    {
+        pthread_mutex_lock(&workers[i].lock);
+        workers[i].stop = 1;
+        pthread_cond_signal(&workers[i].ready);
+        pthread_mutex_unlock(&workers[i].lock);
+        pthread_join(workers[i].thread, NULL);
+    }
+    for (int i = 0; i < client_count; i++)
+    {
+        close(clients[i]);
+    }
+    close(listen_fd);
+    unlink(socket_path);
+    if (ring != NULL)
+    {
+        munmap(ring, ring_size);
+        shm_unlink(ring_name);
+    }
+    for (int i = 0; i < stream_count; i++)
+    {
+        free(streams[i]->resampler);
+        free(streams[i]);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,296 @@
+/**
+*   \file telemetry_dashboard.c
+*   \brief Host dashboard of the telemetry frames of the PROJ_3 firmware.
+*
+*   Picks the telemetry frames described in Telemetry.h out of the stream,
+*   skipping all the other frames, and shows the last period next to the
+*   totals and the worst values since the start: samples/s, drop rate,
+*   STATUS_REG polls per sample, bus errors by cause, bus and UART load.
+*
+*   Usage:
+*       telemetry_dashboard [-b baud] <port> [csv]
+*       telemetry_dashboard - [csv] < capture.bin
+*
+*   The port is opened at 19200 baud, the rate of UART_Debug in the
+*   TopDesign (FRAME_UART_BAUD in Frame.h); -b sets another rate.
+*
+*   With csv one line per frame is printed instead of the dashboard, for
+*   logging long runs. "-" reads a stream recorded on standard input.
+*
+*   Build on Linux or macOS with: cc -O2 -o telemetry_dashboard telemetry_dashboard.c serial_frame.c
+*/
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "serial_frame.h"
+
+/**
+*   \brief Values shared with the firmware (Frame.h, Telemetry.h, BusStats.h).
+*/
+#define FRAME_HEADER_TELEMETRY 0xAF
+#define FRAME_FOOTER 0xC0
+#define TELEMETRY_PAYLOAD 29
+#define BUS_ERROR_TYPES 4
+
+/**
+*   \brief Counters of one telemetry period.
+*/
+typedef struct {
+    uint16_t period_ms;
+    uint16_t acquired;
+    uint16_t sent;
+    uint16_t dropped;
+    uint16_t polls;
+    uint16_t transactions;
+    uint16_t bus_errors[BUS_ERROR_TYPES];
+    uint16_t bus_load;
+    uint32_t tx_bytes;
+    uint16_t uart_load;
+    uint8_t tx_high_watermark;
+} Telemetry;
+
+/**
+*   \brief Totals and worst values since the start.
+*/
+typedef struct {
+    uint32_t frames;
+    uint64_t period_ms;
+    uint64_t acquired;
+    uint64_t sent;
+    uint64_t dropped;
+    uint64_t polls;
+    uint64_t transactions;
+    uint64_t bus_errors[BUS_ERROR_TYPES];
+    uint64_t tx_bytes;
+    uint16_t max_bus_load;
+    uint16_t max_uart_load;
+    uint8_t max_tx_high_watermark;
+} Totals;
+
+static const char* const bus_error_names[BUS_ERROR_TYPES] = { "nak", "arbitration", "not ready", "other" };
+
+// Rate of the serial port, the firmware runs UART_Debug at 19200 baud (FRAME_UART_BAUD)
+static speed_t baud = SERIAL_DEFAULT_BAUD;
+
+// Sliding window used to find the frames in the received bytes
+static uint8_t window[1 + TELEMETRY_PAYLOAD + 3];
+static size_t window_count;
+
+    /*
+    *   Check if the window holds a valid telemetry frame.
+    */
+    static const uint8_t* match_frame(void)
+    {
+        if (window_count < sizeof(window))
+        {
+            return NULL;
+        }
+        if (window[0] != FRAME_HEADER_TELEMETRY || window[sizeof(window) - 1] != FRAME_FOOTER)
+        {
+            return NULL;
+        }
+        uint16_t crc = serial_crc16(window, 1 + TELEMETRY_PAYLOAD);
+        if (window[1 + TELEMETRY_PAYLOAD] != (crc & 0xFF) || window[2 + TELEMETRY_PAYLOAD] != (crc >> 8))
+        {
+            return NULL;
+        }
+        return window + 1;
+    }
+    
+    /*
+    *   Next 16-bit field of a payload.
+    */
+    static uint16_t take16(const uint8_t** p)
+    {
+        uint16_t value = serial_get16(*p);
+        *p += 2;
+        return value;
+    }
+    
+    /*
+    *   Decode the payload of a telemetry frame.
+    */
+    static void parse_telemetry(const uint8_t* p, Telemetry* t)
+    {
+        t->period_ms = take16(&p);
+        t->acquired = take16(&p);
+        t->sent = take16(&p);
+        t->dropped = take16(&p);
+        t->polls = take16(&p);
+        t->transactions = take16(&p);
+        for (int i = 0; i < BUS_ERROR_TYPES; i++)
+        {
+            t->bus_errors[i] = take16(&p);
+        }
+        t->bus_load = take16(&p);
+        t->tx_bytes = serial_get32(p);
+        p += 4;
+        t->uart_load = take16(&p);
+        t->tx_high_watermark = p[0];
+    }
+    
+    static void accumulate(Totals* totals, const Telemetry* t)
+    {
+        totals->frames++;
+        totals->period_ms += t->period_ms;
+        totals->acquired += t->acquired;
+        totals->sent += t->sent;
+        totals->dropped += t->dropped;
+        totals->polls += t->polls;
+        totals->transactions += t->transactions;
+        for (int i = 0; i < BUS_ERROR_TYPES; i++)
+        {
+            totals->bus_errors[i] += t->bus_errors[i];
+        }
+        totals->tx_bytes += t->tx_bytes;
+        if (t->bus_load > totals->max_bus_load)
+        {
+            totals->max_bus_load = t->bus_load;
+        }
+        if (t->uart_load > totals->max_uart_load)
+        {
+            totals->max_uart_load = t->uart_load;
+        }
+        if (t->tx_high_watermark > totals->max_tx_high_watermark)
+        {
+            totals->max_tx_high_watermark = t->tx_high_watermark;
+        }
+    }
+    
+    static double ratio(double numerator, double denominator)
+    {
+        return denominator > 0 ? numerator/denominator : 0.0;
+    }
+    
+    static void print_csv(const Telemetry* t, int header)
+    {
+        if (header)
+        {
+            printf("period_ms,acquired,sent,dropped,polls,transactions,"
+                   "nak,arbitration,not_ready,other,bus_load_pm,tx_bytes,uart_load_pm,tx_high_watermark\n");
+        }
+        printf("%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+               t->period_ms, t->acquired, t->sent, t->dropped, t->polls, t->transactions,
+               t->bus_errors[0], t->bus_errors[1], t->bus_errors[2], t->bus_errors[3],
+               t->bus_load, t->tx_bytes, t->uart_load, t->tx_high_watermark);
+        fflush(stdout);
+    }
+    
+    static void print_dashboard(const Telemetry* t, const Totals* totals)
+    {
+        double seconds = t->period_ms/1000.0;
+        double total_seconds = totals->period_ms/1000.0;
+        
+        // Clear the terminal and go home
+        printf("\033[H\033[2J");
+        printf("telemetry frames %u, %.0f s\n\n", totals->frames, total_seconds);
+        printf("%-22s %12s %12s\n", "", "last", "total");
+        printf("%-22s %12.1f %12.1f\n", "acquired samples/s",
+               ratio(t->acquired, seconds), ratio((double)totals->acquired, total_seconds));
+        printf("%-22s %12.1f %12.1f\n", "sent samples/s",
+               ratio(t->sent, seconds), ratio((double)totals->sent, total_seconds));
+        printf("%-22s %12u %12llu\n", "dropped samples",
+               t->dropped, (unsigned long long)totals->dropped);
+        printf("%-22s %11.3f%% %11.3f%%\n", "drop rate",
+               100.0*ratio(t->dropped, t->acquired + t->dropped),
+               100.0*ratio((double)totals->dropped, (double)(totals->acquired + totals->dropped)));
+        printf("%-22s %12.2f %12.2f\n", "polls per sample",
+               ratio(t->polls, t->acquired), ratio((double)totals->polls, (double)totals->acquired));
+        printf("%-22s %12.1f %12.1f\n", "bus transactions/s",
+               ratio(t->transactions, seconds), ratio((double)totals->transactions, total_seconds));
+        for (int i = 0; i < BUS_ERROR_TYPES; i++)
+        {
+            printf("bus errors %-11s %12u %12llu\n", bus_error_names[i],
+                   t->bus_errors[i], (unsigned long long)totals->bus_errors[i]);
+        }
+        printf("\n%-22s %12s %12s\n", "", "last", "worst");
+        printf("%-22s %11.1f%% %11.1f%%\n", "bus load", t->bus_load/10.0, totals->max_bus_load/10.0);
+        printf("%-22s %11.1f%% %11.1f%%\n", "uart load", t->uart_load/10.0, totals->max_uart_load/10.0);
+        printf("%-22s %12u %12u\n", "tx buffer watermark", t->tx_high_watermark, totals->max_tx_high_watermark);
+        printf("%-22s %12.0f %12.0f\n", "uart bytes/s",
+               ratio(t->tx_bytes, seconds), ratio((double)totals->tx_bytes, total_seconds));
+        fflush(stdout);
+    }
+    
+    static int usage(const char* name)
+    {
+        fprintf(stderr, "usage: %s [-b baud] <port> [csv]\n"
+                        "       %s - [csv] < capture.bin\n", name, name);
+        return 2;
+    }
+
+int main(int argc, char** argv)
+{
+    int option;
+    while ((option = getopt(argc, argv, "b:")) != -1)
+    {
+        if (option != 'b' || (baud = serial_baud(atol(optarg))) == 0)
+        {
+            return usage(argv[0]);
+        }
+    }
+    // Positional arguments from argv[1] on
+    argv[optind - 1] = argv[0];
+    argc -= optind - 1;
+    argv += optind - 1;
+    
+    if (argc < 2)
+    {
+        return usage(argv[0]);
+    }
+    int csv = (argc > 2 && strcmp(argv[2], "csv") == 0);
+    int fd = serial_open(argv[1], O_RDONLY, baud, 1);
+    if (fd < 0)
+    {
+        return 1;
+    }
+    
+    Totals totals;
+    Telemetry telemetry;
+    uint8_t buffer[256];
+    ssize_t n;
+    memset(&totals, 0, sizeof(totals));
+    
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (ssize_t i = 0; i < n; i++)
+        {
+            if (window_count == sizeof(window))
+            {
+                memmove(window, window + 1, sizeof(window) - 1);
+                window_count--;
+            }
+            window[window_count++] = buffer[i];
+        
+            const uint8_t* found = match_frame();
+            if (!found)
+            {
+                continue;
+            }
+            parse_telemetry(found, &telemetry);
+            accumulate(&totals, &telemetry);
+            if (csv)
+            {
+                print_csv(&telemetry, totals.frames == 1);
+            }
+            else
+            {
+                print_dashboard(&telemetry, &totals);
+            }
+            // The frame must not be matched again by the next bytes
+            window_count = 0;
+        }
+    }
+    if (fd != STDIN_FILENO)
+    {
+        close(fd);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */